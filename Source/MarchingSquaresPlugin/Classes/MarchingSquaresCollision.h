@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/ScopeRWLock.h"
+
+class FMarchingSquaresVoxelMirror;
+struct FKAggregateGeom;
+
+// Collision geometry
+//
+// Simplified 2D collision shapes of a fill type cooked from voxel mirror
+// data per map section block. Fill type regions of a block are clipped to
+// the block cell rect, traced as closed contour loops, simplified and
+// decomposed into convex polygons. Blocks containing holes are split until
+// each part is hole free. Only blocks with cells affected by mirror writes
+// since the previous cook are cooked. Positions are in voxel unit.
+
+class FMarchingSquaresCollision
+{
+public:
+
+    struct FCookParameter
+    {
+        uint8 FillType = 1;
+
+        // Map section block size, each block covers block size - 1 cells
+        // on each axis, matching map section geometry
+        int32 BlockSize = 64;
+
+        // Block count, blocks outside the map dimension are ignored
+        FIntPoint BlockCount = FIntPoint::ZeroValue;
+
+        // Contour simplification tolerance in voxel unit
+        float SimplifyTolerance = .5f;
+
+        // Maximum number of convex polygon points
+        int32 MaxPolygonPointCount = 8;
+
+        bool operator==(const FCookParameter& Other) const;
+
+        FORCEINLINE bool operator!=(const FCookParameter& Other) const
+        {
+            return ! (*this == Other);
+        }
+    };
+
+    struct FConvexPolygon
+    {
+        // Counter-clockwise convex polygon points
+        TArray<FVector2D> Points;
+
+        FORCEINLINE bool operator==(const FConvexPolygon& Other) const
+        {
+            return Points == Other.Points;
+        }
+    };
+
+    struct FBlockCollision
+    {
+        // Block cell rect, max exclusive
+        FIntRect CellRect;
+
+        TArray<FConvexPolygon> Polygons;
+
+        // Incremented each time block polygons change
+        uint32 Revision = 0;
+    };
+
+private:
+
+    // Collision data, guarded by the collision lock
+
+    mutable FRWLock CollisionLock;
+
+    FCookParameter Parameter;
+    FCookParameter CookedParameter;
+    FIntPoint CookedDimension = FIntPoint::ZeroValue;
+    uint32 MirrorRevision = 0;
+
+    TArray<FBlockCollision> Blocks;
+    TArray<FIntPoint> ChangedBlocks;
+
+    // Async update state
+
+    FGraphEventRef UpdateTask;
+    FThreadSafeBool bUpdating;
+    FThreadSafeBool bUpdateRequested;
+
+    static void DecomposeLoop(
+        const TArray<FVector2D>& LoopPoints,
+        const FCookParameter& CookParameter,
+        TArray<FConvexPolygon>& OutPolygons
+        );
+
+    void Cook(const FMarchingSquaresVoxelMirror& Mirror);
+
+public:
+
+    ~FMarchingSquaresCollision();
+
+    // Cook polygons of cells within the cell rect, max exclusive
+    static void CookBlock(
+        const FMarchingSquaresVoxelMirror& Mirror,
+        const FCookParameter& CookParameter,
+        const FIntRect& CellRect,
+        TArray<FConvexPolygon>& OutPolygons
+        );
+
+    // Cook blocks updated since the previous cook. Changing cook parameter
+    // cooks all blocks.
+    void Update(const FMarchingSquaresVoxelMirror& Mirror, const FCookParameter& CookParameter);
+
+    // Cook on a background task. Completion callback is called from the
+    // background task. If a cook is in progress, another cook with the
+    // latest parameter is run after it completes and false is returned.
+    bool UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, const FCookParameter& CookParameter, TFunction<void()> OnComplete);
+
+    FORCEINLINE bool IsUpdating() const
+    {
+        return bUpdating;
+    }
+
+    void Reset();
+
+    // Add block polygons to the aggregate geometry as convex elements
+    // extruded between min and max z. Polygon points are scaled by the
+    // voxel scale.
+    static void AddConvexElements(
+        const TArray<FConvexPolygon>& Polygons,
+        const FVector2D& VoxelScale,
+        float MinZ,
+        float MaxZ,
+        FKAggregateGeom& OutGeom
+        );
+
+    // QUERY FUNCTIONS
+
+    FIntPoint GetBlockCount() const;
+
+    // Returns blocks with polygons changed by the previous cook. All blocks
+    // are reported after a cook parameter change, consumers should discard
+    // blocks outside the block count.
+    TArray<FIntPoint> GetChangedBlocks() const;
+
+    bool GetBlockCollision(const FIntPoint& Block, FBlockCollision& OutCollision) const;
+
+    uint32 GetBlockRevision(const FIntPoint& Block) const;
+};
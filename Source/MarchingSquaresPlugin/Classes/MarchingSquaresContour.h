@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MarchingSquaresContour.generated.h"
+
+class FMarchingSquaresVoxelMirror;
+
+// Contour extraction
+//
+// Extracts fill type boundaries as ordered polylines from voxel mirror
+// data. Only iso-line segments of cells with the fill type are evaluated,
+// using the same edge crossings and saddle resolution as the map build.
+// Segments are chained by shared cell edges, polylines keep the filled
+// side on the left (counter-clockwise outer boundaries). Positions are in
+// voxel unit.
+
+class FMarchingSquaresContour
+{
+public:
+
+    struct FContourPolyline
+    {
+        // Closed polylines do not repeat the first point
+        TArray<FVector2D> Points;
+        bool bClosed = false;
+    };
+
+    struct FExtractParameter
+    {
+        uint8 FillType = 1;
+
+        // Cell rect to extract, max exclusive. Empty rect extracts the whole
+        // map. Contours crossing the rect bounds are open polylines unless
+        // closed at rect border.
+        FIntRect CellRect;
+
+        // Close contours along the map border instead of leaving open
+        // polylines where fill type regions touch the map border
+        bool bCloseAtMapBorder = false;
+
+        // Close contours along the cell rect bounds, each filled region
+        // clipped to the rect becomes a closed polyline. Implies closing at
+        // the map border where the rect touches the map border.
+        bool bCloseAtRectBorder = false;
+
+        // Simplification tolerance in voxel unit, simplification is disabled
+        // if tolerance is zero or less
+        float SimplifyTolerance = 0.f;
+    };
+
+    static void ExtractContours(
+        const FMarchingSquaresVoxelMirror& Mirror,
+        const FExtractParameter& Parameter,
+        TArray<FContourPolyline>& OutPolylines
+        );
+};
+
+USTRUCT(BlueprintType)
+struct FMarchingSquaresContourPolyline
+{
+    GENERATED_BODY()
+
+    // Polyline points in voxel unit, closed polylines do not repeat the
+    // first point
+    UPROPERTY(BlueprintReadWrite)
+    TArray<FVector2D> Points;
+
+    UPROPERTY(BlueprintReadWrite)
+    bool bClosed = false;
+};
@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI/RULRHIBuffer.h"
+#include "MarchingSquaresDistanceField.generated.h"
+
+class FMarchingSquaresMap;
+class UMarchingSquaresMapRef;
+class UTextureRenderTarget2D;
+
+// Distance field
+//
+// Signed distance to the nearest fill type boundary generated on the GPU
+// from voxel data. Texels are seeded with sub-voxel edge crossings of voxel
+// feature data and propagated with jump flooding. Distances are in voxel
+// unit, negative inside the fill type and clamped to the max distance. Each
+// field texel covers field scale voxels on each axis, texel (x, y) samples
+// voxel (x, y) * field scale.
+
+class FMarchingSquaresDistanceField
+{
+public:
+
+    enum { MAX_FIELD_SCALE = 8 };
+
+    struct FFieldParameter
+    {
+        uint8 FillType = 1;
+
+        // Voxels per field texel on each axis
+        int32 FieldScale = 1;
+
+        // Maximum distance in voxel unit, zero or less is unbounded. Bounded
+        // fields limit incremental updates to the max distance around the
+        // updated voxel rect.
+        float MaxDistance = 0.f;
+
+        bool operator==(const FFieldParameter& Other) const;
+
+        FORCEINLINE bool operator!=(const FFieldParameter& Other) const
+        {
+            return ! (*this == Other);
+        }
+    };
+
+    struct FUpdateFieldParameter
+    {
+        FMarchingSquaresMap*    Map;
+        FFieldParameter         Field;
+        UTextureRenderTarget2D* OutputRTT = nullptr;
+
+        // Voxel rect to update, max exclusive. Empty rect updates the whole
+        // field. Field parameter or map dimension changes always update the
+        // whole field.
+        FIntRect VoxelRect;
+    };
+
+    static FIntPoint GetFieldDimension(const FIntPoint& MapDimension, int32 FieldScale);
+
+private:
+
+    // Render thread resources
+
+    FFieldParameter Field_RT;
+    FIntPoint       MapDimension_RT = FIntPoint::ZeroValue;
+    FIntPoint       FieldDimension_RT = FIntPoint::ZeroValue;
+
+    // Jump flood seed ping-pong buffers
+    FRULRWBuffer SeedData[2];
+
+    FTexture2DRHIRef           DistanceTexture;
+    FUnorderedAccessViewRHIRef DistanceTextureUAV;
+
+    void UpdateField_RT(
+        FRHICommandListImmediate& RHICmdList,
+        FMarchingSquaresMap& Map,
+        const FFieldParameter& Field,
+        const FIntRect& VoxelRect,
+        UTextureRenderTarget2D* OutputRTT
+        );
+
+    void ClearField_RT();
+
+public:
+
+    void UpdateField(const FUpdateFieldParameter& Parameter);
+    void ClearField();
+
+    // Render thread accessors
+
+    // Distance texture of the last update, PF_R32_FLOAT
+    FORCEINLINE FTexture2DRHIParamRef GetDistanceTexture_RT() const
+    {
+        return DistanceTexture;
+    }
+
+    FORCEINLINE FIntPoint GetFieldDimension_RT() const
+    {
+        return FieldDimension_RT;
+    }
+};
+
+UCLASS(BlueprintType, Blueprintable)
+class UMarchingSquaresDistanceFieldRef : public UObject
+{
+    GENERATED_BODY()
+
+    FMarchingSquaresDistanceField DistanceField;
+
+    void UpdateField(UMarchingSquaresMapRef* MapRef, const FIntRect& VoxelRect);
+
+public:
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Distance Field Settings", meta=(ClampMin="0", UIMin="0", ClampMax="255", UIMax="255"))
+    int32 FillType = 1;
+
+    // Voxels per field texel on each axis
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Distance Field Settings", meta=(ClampMin="1", UIMin="1", ClampMax="8", UIMax="8"))
+    int32 FieldScale = 1;
+
+    // Maximum distance in voxel unit, zero or less is unbounded
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Distance Field Settings", meta=(ClampMin="0", UIMin="0"))
+    float MaxDistance = 0.f;
+
+    // Optional copy target, must be a RTF_R32f render target with the field
+    // dimension, see GetFieldDimension()
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Distance Field Settings")
+    UTextureRenderTarget2D* OutputRTT = nullptr;
+
+    FORCEINLINE FMarchingSquaresDistanceField& GetDistanceField()
+    {
+        return DistanceField;
+    }
+
+    UFUNCTION(BlueprintCallable)
+    FIntPoint GetFieldDimension(UMarchingSquaresMapRef* MapRef) const;
+
+    // Generate the whole distance field
+    UFUNCTION(BlueprintCallable)
+    void GenerateField(UMarchingSquaresMapRef* MapRef);
+
+    // Update distance field texels affected by voxel edits within the voxel
+    // rect, max exclusive
+    UFUNCTION(BlueprintCallable)
+    void UpdateFieldRect(UMarchingSquaresMapRef* MapRef, FIntPoint VoxelMin, FIntPoint VoxelMax);
+
+    UFUNCTION(BlueprintCallable)
+    void ClearField();
+};
@@ -23,54 +23,40 @@
 // THE SOFTWARE.
 //
 ////////////////////////////////////////////////////////////////////////////////
-//
-
-#include "/Engine/Private/Common.ush"
-
-float2 _DrawExts;
-
-void DrawStencilMaskVS(
-	in  float2 Position : ATTRIBUTE0,
-	out float4 OutPos   : SV_POSITION
-    )
-{
-    float2 pt = (Position.xy/_DrawExts);
-
-    // Flip y-axis within render target dimension
-    pt.y  = (2.f-pt.y);
-    pt   -= 1.f;
-
-	OutPos = float4(pt, 0, 1);
-}
-
-void DrawStencilMaskPS(
-	out uint OutColor : SV_Target0
-    )
-{
-    OutColor = 1;
-}
-
-void DrawStencilEdgeVS(
-	in  float3 Position : ATTRIBUTE0,
-	out nointerpolation uint OutColor : TEXCOORD0,
-	out float4 OutPos : SV_POSITION
-    )
-{
-    float2 pt = (Position.xy/_DrawExts);
-    float  id = Position.z;
+// 
 
-    // Flip y-axis within render target dimension
-    pt.y  = (2.f-pt.y);
-    pt   -= 1.f;
+#pragma once
 
-    OutColor = 1+uint(id+.5f);
-	OutPos   = float4(pt, 0, 1);
-}
+#include "CoreMinimal.h"
 
-void DrawStencilEdgePS(
-	nointerpolation uint InColor : TEXCOORD0,
-	out uint OutColor : SV_Target0
-    )
+class FMarchingSquaresGeometryUtils
 {
-    OutColor = InColor;
-}
+public:
+
+    // Simplify polyline within the specified distance tolerance.
+    //
+    // Consecutive points closer than the tolerance are merged before running
+    // Douglas-Peucker on the remaining points. Closed polylines keep at least
+    // three points. If the simplified closed polyline self-intersects, the
+    // simplification is retried with a smaller tolerance and falls back to
+    // the input points if it still fails. Returns false if no point is
+    // removed, in which case output points equals input points.
+    static bool SimplifyPolyline(
+        const TArray<FVector2D>& InPoints,
+        TArray<FVector2D>& OutPoints,
+        float Tolerance,
+        bool bClosed
+        );
+
+    // Returns whether any non-adjacent segment of the polyline intersects
+    static bool HasSelfIntersection(const TArray<FVector2D>& Points, bool bClosed);
+
+private:
+
+    static void SimplifyPolylineImpl(
+        const TArray<FVector2D>& InPoints,
+        TArray<FVector2D>& OutPoints,
+        float Tolerance,
+        bool bClosed
+        );
+};
@@ -30,6 +30,60 @@
 #include "CoreMinimal.h"
 #include "Mesh/PMUMeshTypes.h"
 #include "RHI/RULRHIBuffer.h"
+#include "MarchingSquaresMapHistory.h"
+#include "MarchingSquaresVoxelMirror.h"
+#include "MarchingSquaresVoxelStats.h"
+#include "MarchingSquaresVoxelComponents.h"
+#include "MarchingSquaresCollision.h"
+#include "MarchingSquaresNavGraph.h"
+#include "MarchingSquaresSectionBVH.h"
+
+// CPU voxel data with the same layout and encoding as the GPU voxel state,
+// feature and distance data, used by CPU stencil paths on hosts without a GPU
+
+struct FMarchingSquaresCPUVoxelData
+{
+    FIntPoint      Dimension = FIntPoint::ZeroValue;
+    TArray<uint32> VoxelStateData;
+    TArray<uint32> VoxelFeatureData;
+
+    // Voxel distance data, same layout as the GPU voxel distance data.
+    // Empty if the map has no distance layers.
+    int32          DistanceLayerCount = 0;
+    float          DistanceRange = 1.f;
+    TArray<uint32> VoxelDistanceData;
+
+    FORCEINLINE int32 GetVoxelCount() const
+    {
+        return Dimension.X * Dimension.Y;
+    }
+
+    FORCEINLINE int32 GetDistancePairStride() const
+    {
+        return (Dimension.X+1) / 2;
+    }
+
+    FORCEINLINE int32 GetDistanceIndex(int32 X, int32 Y, int32 Layer) const
+    {
+        const int32 PairStride = GetDistancePairStride();
+        return (X/2) + Y*PairStride + Layer*(PairStride*Dimension.Y);
+    }
+
+    FORCEINLINE bool HasDistanceData() const
+    {
+        return DistanceLayerCount > 0;
+    }
+
+    FORCEINLINE bool IsValid() const
+    {
+        const int32 VoxelCount = GetVoxelCount();
+        const int32 DistanceCount = GetDistancePairStride() * Dimension.Y * DistanceLayerCount;
+        return VoxelCount > 0
+            && VoxelStateData.Num() == VoxelCount
+            && VoxelFeatureData.Num() == VoxelCount
+            && VoxelDistanceData.Num() == DistanceCount;
+    }
+};
 
 class FMarchingSquaresMap
 {
@@ -48,6 +102,64 @@ private:
     TArray<FPrefabData> AppliedPrefabs;
     TArray< TArray<FPMUMeshSection> > SectionGroups;
 
+    // Build with section geometry in flight. Cell case and geometry count
+    // scan are dispatched with the build, scan sums are read back through
+    // a fenced staging copy and size the triangulation, which is dispatched
+    // once the sum readback has finished. Geometry is then read back the
+    // same way and copied out to the build sections once all readbacks have
+    // finished. Each build owns its own output buffers.
+
+    struct FPendingBuild
+    {
+        enum { READBACK_COUNT = 5 };
+
+        uint32    FillType = 0;
+        bool      bPartialBuild = false;
+        bool      bUseDualMesh = false;
+        bool      bUseDistance = false;
+        bool      bTriangulated = false;
+        bool      bHasGeometry = false;
+        FIntRect  BlockRect;
+        int32     SectionCount = 0;
+        ERHIFeatureLevel::Type FeatureLevel = ERHIFeatureLevel::SM5;
+
+        FIntPoint Dimension;
+        FIntPoint BuildBlockCount;
+        int32     BlockSize = 0;
+        int32     GridCountX = 0;
+        int32     GridCount = 0;
+        int32     VCount = 0;
+        int32     ICount = 0;
+        float     BoundsSurfaceZ = 0.f;
+        float     BoundsExtrudeZ = 0.f;
+
+        // Vertex (x) and index (y) offsets of each build block
+        TArray<FIntPoint> BlockGeomOffsets;
+
+        // Cell case and geometry scan data, released once the
+        // triangulation has been dispatched
+        FRULRWBuffer           CellCaseData;
+        FRULRWBufferStructured OffsetData;
+        FRULRWBufferStructured SumData;
+        int32                  ScanBlockCount = 0;
+        int32                  BlockOffset = 0;
+
+        // Geometry sum of each build block followed by the build total
+        TUniquePtr<FRHIGPUBufferReadback> SumReadback;
+        uint32 SumReadbackSize = 0;
+
+        // Position, tangent, texture coordinate, color and index data
+        TUniquePtr<FRHIGPUBufferReadback> Readbacks[READBACK_COUNT];
+        uint32 ReadbackSizes[READBACK_COUNT];
+
+        bool IsSumReadbackReady() const;
+        bool IsReadbackReady() const;
+    };
+
+    TArray<TSharedRef<FPendingBuild>> PendingBuilds;
+    bool bPendingBuildUpdateScheduled = false;
+    FMarchingSquaresSectionBVH SectionBVH;
+
     // Build map properties
 
     FIntPoint Dimension_GT;
@@ -56,6 +168,33 @@ private:
 
     FRULRWBuffer VoxelStateData;
     FRULRWBuffer VoxelFeatureData;
+    FRULRWBuffer VoxelDistanceData;
+
+    int32 DistanceLayerCount_RT = 0;
+    float DistanceRange_RT = 1.f;
+
+    // Render thread copies of map settings, see CommitSettings()
+
+    bool bEnableSectionBVH_RT = false;
+    bool bEnableCollision_RT = false;
+    FMarchingSquaresCollision::FCookParameter CollisionParameter_RT;
+    bool bEnableNavGraph_RT = false;
+    FMarchingSquaresNavGraph::FGraphParameter NavGraphParameter_RT;
+
+    FMarchingSquaresCPUVoxelData CPUVoxelData;
+
+    FMarchingSquaresMapHistory History;
+    FThreadSafeCounter PendingHistoryApplyCount;
+
+    FMarchingSquaresVoxelMirror VoxelMirror;
+    FIntRect VoxelEditRect_RT;
+
+    // Declared after the voxel mirror, stats, components and collision
+    // destruction waits for in-flight updates reading the mirror
+    FMarchingSquaresVoxelStats VoxelStats;
+    FMarchingSquaresVoxelComponents VoxelComponents;
+    FMarchingSquaresCollision Collision;
+    FMarchingSquaresNavGraph NavGraph;
 
     FRHICommandListImmediate*      RHICmdListPtr = nullptr;
     TShaderMap<FGlobalShaderType>* RHIShaderMap  = nullptr;
@@ -64,17 +203,73 @@ private:
 	FTexture2DRHIRef           DebugTextureRHI;
     FUnorderedAccessViewRHIRef DebugTextureUAV;
 
-    // Render thread functions
+    // Surface and extrude height with packed normals of each voxel baked
+    // from the height map, see MarchingSquaresCS.usf. Baked on height map
+    // change and rebaked on build if the map dimension or height settings
+    // differ from the baked ones.
 
-    void ClearMap_RT(FRHICommandListImmediate& RHICmdList);
-    void InitializeVoxelData_RT(FRHICommandListImmediate& RHICmdList, FIntPoint InDimension);
+    FTexture2DRHIRef           HeightNormalTexture;
+    FShaderResourceViewRHIRef  HeightNormalSRV;
+    FUnorderedAccessViewRHIRef HeightNormalUAV;
+
+    FTexture2DRHIRef HeightNormalBakedMap;
+    FVector2D        HeightNormalBakedScale = FVector2D::ZeroVector;
+    int32            HeightNormalBakedLevel = -1;
 
-    bool BuildMapExec(uint32 FillType, bool bGenerateWalls);
-    void BuildMap_RT(FRHICommandListImmediate& RHICmdList, uint32 FillType, bool bGenerateWalls, ERHIFeatureLevel::Type InFeatureLevel);
+    // Render thread functions
 
-    void GenerateMarchingCubes_RT(uint32 FillType, bool bGenerateWalls);
+    void ClearMap_RT(FRHICommandListImmediate& RHICmdList);
+    void InitializeVoxelData_RT(FRHICommandListImmediate& RHICmdList, FIntPoint InDimension, int32 InDistanceLayerCount, float InDistanceRange, int32 InHistoryLimit, bool bInVoxelMirror);
+    void ApplyHistory_RT(FRHICommandListImmediate& RHICmdList, bool bUndo, const TArray<uint32>& BuildFillTypes, bool bGenerateWalls);
+
+    bool IsHeightNormalBaked_RT() const;
+    void BakeHeightNormal_RT(FRHICommandListImmediate& RHICmdList);
+
+    FIntRect CalculateBlockRect(const FIntRect& VoxelRect, const FIntPoint& BlockCount) const;
+
+    FMarchingSquaresCollision::FCookParameter GetCollisionParameter() const;
+    bool UpdateCollisionAsync(const FMarchingSquaresCollision::FCookParameter& CookParameter);
+
+    FMarchingSquaresNavGraph::FGraphParameter GetNavGraphParameter() const;
+    bool UpdateNavGraphAsync(const FMarchingSquaresNavGraph::FGraphParameter& GraphParameter);
+
+    // Voxel mirror readback resolve callback, cooks collision and updates
+    // navigation graph of the resolved blocks if enabled
+    void OnVoxelMirrorResolved_RT(const TArray<FIntPoint>& ResolvedBlocks);
+
+
+    bool BuildMapExec(uint32 FillType, bool bGenerateWalls, const FIntRect& BlockRect, bool bPartialBuild);
+    void BuildMap_RT(
+        FRHICommandListImmediate& RHICmdList,
+        uint32 FillType,
+        bool bGenerateWalls,
+        FIntRect BlockRect,
+        bool bPartialBuild,
+        ERHIFeatureLevel::Type InFeatureLevel
+        );
+
+    // Generate cell case and geometry count scan of sections within the
+    // block rect. Block rect is expanded to the whole map if sections have
+    // not been built with the same mesh type. Scan sums are read back to
+    // the pending build, the render thread never waits for them.
+    void GenerateMarchingCubes_RT(uint32 FillType, bool bGenerateWalls, FIntRect& BlockRect, FPendingBuild& OutBuild);
+
+    // Dispatch triangulation of a pending build sized by its resolved scan
+    // sums. Section geometry is read back to the pending build.
+    void TriangulateBuild_RT(FRHICommandListImmediate& RHICmdList, FPendingBuild& Build);
+
+    // Triangulate pending builds whose sum readbacks have finished, copy
+    // out pending builds whose geometry readbacks have finished and
+    // broadcast their build done events. Polled once per game thread tick
+    // while builds are pending.
+    void SchedulePendingBuildUpdate_RT();
+    void UpdatePendingBuilds_RT(FRHICommandListImmediate& RHICmdList);
+    void ResolveBuild_RT(FPendingBuild& Build);
+    void CopySections_RT(FPendingBuild& Build);
 
 public:
+
+    FMarchingSquaresMap();
     
     DECLARE_EVENT_TwoParams(FMarchingSquaresMap, FBuildMapDone, bool, uint32);
 
@@ -83,9 +278,38 @@ public:
         return BuildMapDoneEvent;
     }
 
+    // Partial build event, block rect is the rebuilt section rect
+    DECLARE_EVENT_ThreeParams(FMarchingSquaresMap, FBuildMapRectDone, bool, uint32, const FIntRect&);
+
+    FORCEINLINE FBuildMapRectDone& OnBuildMapRectDone()
+    {
+        return BuildMapRectDoneEvent;
+    }
+
+    // Collision cook event, called from the cook task with blocks whose
+    // collision polygons changed
+    DECLARE_EVENT_OneParam(FMarchingSquaresMap, FCollisionUpdated, const TArray<FIntPoint>&);
+
+    FORCEINLINE FCollisionUpdated& OnCollisionUpdated()
+    {
+        return CollisionUpdatedEvent;
+    }
+
+    // Navigation graph update event, called from the update task with
+    // blocks whose regions were rebuilt
+    DECLARE_EVENT_OneParam(FMarchingSquaresMap, FNavGraphUpdated, const TArray<FIntPoint>&);
+
+    FORCEINLINE FNavGraphUpdated& OnNavGraphUpdated()
+    {
+        return NavGraphUpdatedEvent;
+    }
+
 private:
 
     FBuildMapDone BuildMapDoneEvent;
+    FBuildMapRectDone BuildMapRectDoneEvent;
+    FCollisionUpdated CollisionUpdatedEvent;
+    FNavGraphUpdated NavGraphUpdatedEvent;
 
 public:
 
@@ -100,6 +324,40 @@ public:
 	float ExtrudeHeightScale = 1.f;
     int32 HeightMapMipLevel = 0;
 
+    // Number of fill types with signed distance voxel data, starting from
+    // fill type zero. Zero disables voxel distance data. Fill types with
+    // distance data use the distance to resolve edge crossings on build.
+    int32 DistanceLayerCount = 0;
+
+    // Voxel distance range in voxel unit, distances are clamped to range
+    float DistanceRange = 4.f;
+
+    // Maximum number of undo history entries of voxel edits. Zero disables
+    // edit history.
+    int32 HistoryLimit = 0;
+
+    // Keep a CPU copy of voxel data for voxel queries, see
+    // FMarchingSquaresVoxelMirror
+    bool bEnableVoxelMirror = false;
+
+    // Cook collision polygons of the collision fill type from voxel mirror
+    // data whenever a mirror readback or CPU voxel data copy lands, see
+    // FMarchingSquaresCollision. Requires the voxel mirror.
+    bool bEnableCollision = false;
+    int32 CollisionFillType = 1;
+    float CollisionSimplifyTolerance = .5f;
+    int32 CollisionMaxPolygonPointCount = 8;
+
+    // Update the navigation graph of passable fill types whenever a voxel
+    // mirror readback or CPU voxel data copy lands, see
+    // FMarchingSquaresNavGraph. Requires the voxel mirror.
+    bool bEnableNavGraph = false;
+    TArray<uint8> NavPassableFillTypes;
+
+    // Build CPU bounding volume hierarchies of section triangles after
+    // each build for section trace queries, see FMarchingSquaresSectionBVH
+    bool bEnableSectionBVH = false;
+
     FTexture2DRHIParamRef HeightMap;
     UTextureRenderTarget2D* DebugRTT;
 
@@ -122,6 +380,15 @@ public:
         return Dimension_GT.X > 0 && Dimension_GT.Y > 0 && BlockSize > 0 && BlockSize < FMath::Max(Dimension_GT.X, Dimension_GT.Y);
     }
 
+    FORCEINLINE FIntPoint GetBlockCount() const
+    {
+        return (BlockSize > 0) ? (Dimension_GT / BlockSize) : FIntPoint::ZeroValue;
+    }
+
+    // Returns block rect of blocks with cells affected by voxels within
+    // the voxel rect. Block rect max is exclusive.
+    FIntRect GetBlockRect(const FIntRect& VoxelRect) const;
+
     // Render thread accessors
 
     FORCEINLINE int32 GetVoxelCount_RT() const
@@ -139,16 +406,173 @@ public:
         return Dimension_RT.X > 0 && Dimension_RT.Y > 0 && BlockSize > 0 && BlockSize < FMath::Max(Dimension_RT.X, Dimension_RT.Y);
     }
 
+    FORCEINLINE FIntPoint GetBlockCount_RT() const
+    {
+        return (BlockSize > 0) ? (Dimension_RT / BlockSize) : FIntPoint::ZeroValue;
+    }
+
+    FORCEINLINE bool HasVoxelDistanceData_RT() const
+    {
+        return DistanceLayerCount_RT > 0 && VoxelDistanceData.IsValid();
+    }
+
+    FORCEINLINE int32 GetDistanceLayerCount_RT() const
+    {
+        return DistanceLayerCount_RT;
+    }
+
+    FORCEINLINE float GetDistanceRange_RT() const
+    {
+        return DistanceRange_RT;
+    }
+
     // MAP GENERATION FUNCTIONS
 
     void SetDimension(FIntPoint InDimension);
+
+    // Copy map settings read by render thread functions to their render
+    // thread copies. Called after map settings have been changed.
+    void CommitSettings();
+
+    // Set height map and bake surface height and normals at map resolution
+    // for map builds. Render thread only. Changes to height map contents
+    // require another call to be rebaked.
     void SetHeightMap(FTexture2DRHIParamRef InHeightMap);
+
     void InitializeVoxelData();
+
+    // Allocate CPU voxel data with empty voxel state if dimension or
+    // distance layout has changed
+    void InitializeCPUVoxelData();
+    void ClearCPUVoxelData();
+
+    // Build sections of the whole map. Section geometry is read back
+    // asynchronously, build done events are broadcast in build order once
+    // the sections have been copied out, at least a frame after the build.
     void BuildMap(int32 FillType, bool bGenerateWalls);
+
+    // Rebuild only sections of blocks affected by voxels within the voxel
+    // rect. Broadcasts build map rect done event instead of build map done.
+    void BuildMapRect(int32 FillType, bool bGenerateWalls, const FIntRect& VoxelRect);
     void ClearMap();
 
+    // HISTORY FUNCTIONS
+
+    // Voxel edits between begin and end history group are recorded as a
+    // single history entry
+    void BeginHistoryGroup();
+    void EndHistoryGroup();
+
+    // Restore voxel data of the last history entry and rebuild sections of
+    // the restored blocks for each build fill type
+    void UndoHistory(const TArray<uint32>& BuildFillTypes, bool bGenerateWalls);
+    void RedoHistory(const TArray<uint32>& BuildFillTypes, bool bGenerateWalls);
+    void ClearHistory();
+
+    // CPU voxel data writers must enclose CPU voxel data writes within
+    // BeginVoxelEditCPU() and EndVoxelEditCPU() to be recorded in history.
+    // Voxel rect must cover all written voxels, max exclusive.
+    void BeginVoxelEditCPU(const FIntRect& VoxelRect);
+    void EndVoxelEditCPU();
+
+    FORCEINLINE const FMarchingSquaresMapHistory& GetHistory() const
+    {
+        return History;
+    }
+
+    // VOXEL MIRROR FUNCTIONS
+
+    // Resolve finished voxel mirror readback and start the next readback
+    // of pending voxel edits
+    void UpdateVoxelMirror();
+
+    // Copy CPU voxel data within the voxel rect to the voxel mirror. CPU
+    // voxel writers call this after writing to CPU voxel data.
+    void UpdateVoxelMirrorCPU(const FIntRect& VoxelRect);
+
+    FORCEINLINE const FMarchingSquaresVoxelMirror& GetVoxelMirror() const
+    {
+        return VoxelMirror;
+    }
+
+    // VOXEL STATISTICS FUNCTIONS
+
+    // Update voxel statistics from voxel mirror data on a background task.
+    // Returns false if the voxel mirror is disabled or an update is in
+    // progress. Completion callback is called from the background task.
+    bool UpdateVoxelStats(TFunction<void()> OnComplete);
+
+    FORCEINLINE const FMarchingSquaresVoxelStats& GetVoxelStats() const
+    {
+        return VoxelStats;
+    }
+
+    // VOXEL COMPONENT FUNCTIONS
+
+    // Update voxel connected components from voxel mirror data on a
+    // background task. Returns false if the voxel mirror is disabled or an
+    // update is in progress. Completion callback is called from the
+    // background task.
+    bool UpdateVoxelComponents(TFunction<void()> OnComplete);
+
+    FORCEINLINE const FMarchingSquaresVoxelComponents& GetVoxelComponents() const
+    {
+        return VoxelComponents;
+    }
+
+    // COLLISION FUNCTIONS
+
+    // Cook collision of blocks updated since the previous cook on a
+    // background task, broadcasts collision updated on completion. Returns
+    // false if the voxel mirror is disabled or a cook is in progress, in
+    // which case the in-flight cook is followed by another cook.
+    bool UpdateCollision();
+
+    FORCEINLINE const FMarchingSquaresCollision& GetCollision() const
+    {
+        return Collision;
+    }
+
+    // NAVIGATION GRAPH FUNCTIONS
+
+    // Update navigation graph of blocks written since the previous update
+    // on a background task, broadcasts navigation graph updated on
+    // completion. Returns false if the voxel mirror is disabled or an
+    // update is in progress, in which case the in-flight update is followed
+    // by another update.
+    bool UpdateNavGraph();
+
+    FORCEINLINE const FMarchingSquaresNavGraph& GetNavGraph() const
+    {
+        return NavGraph;
+    }
+
+    FORCEINLINE bool HasCPUVoxelData() const
+    {
+        return CPUVoxelData.IsValid()
+            && CPUVoxelData.Dimension == Dimension_GT
+            && CPUVoxelData.DistanceLayerCount == FMath::Max(0, DistanceLayerCount)
+            && CPUVoxelData.DistanceRange == FMath::Max(KINDA_SMALL_NUMBER, DistanceRange);
+    }
+
+    FORCEINLINE FMarchingSquaresCPUVoxelData& GetCPUVoxelData()
+    {
+        return CPUVoxelData;
+    }
+
+    FORCEINLINE const FMarchingSquaresCPUVoxelData& GetCPUVoxelData() const
+    {
+        return CPUVoxelData;
+    }
+
     // RENDER THREAD FUNCTIONS
 
+    // Voxel writers must enclose voxel state and feature writes within
+    // BeginVoxelEdit_RT() and EndVoxelEdit_RT() to be recorded in history.
+    // Voxel rect must cover all written voxels, max exclusive.
+    void BeginVoxelEdit_RT(const FIntRect& VoxelRect);
+    void EndVoxelEdit_RT();
+
     FORCEINLINE FRULRWBuffer& GetVoxelStateData()
     {
         return VoxelStateData;
@@ -159,6 +583,11 @@ public:
         return VoxelFeatureData;
     }
 
+    FORCEINLINE FRULRWBuffer& GetVoxelDistanceData()
+    {
+        return VoxelDistanceData;
+    }
+
     FORCEINLINE FUnorderedAccessViewRHIRef& GetDebugRTTUAV()
     {
         return DebugTextureUAV;
@@ -192,11 +621,19 @@ public:
         {
             SectionGroups[FillType].Empty();
         }
+
+        SectionBVH.ClearGroup(FillType);
     }
 
     void ClearSections()
     {
         SectionGroups.Empty();
+        SectionBVH.Clear();
+    }
+
+    FORCEINLINE const FMarchingSquaresSectionBVH& GetSectionBVH() const
+    {
+        return SectionBVH;
     }
 
     // PREFAB FUNCTIONS
@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "RHIGPUReadback.h"
+#include "RHI/RULRHIBuffer.h"
+
+class FMarchingSquaresMap;
+struct FMarchingSquaresCPUVoxelData;
+
+// Block-granular voxel edit history
+//
+// Voxel records of history blocks (BlockSize x BlockSize voxels)
+// overlapping a voxel edit are copied on the GPU to a capture buffer before
+// the edit is written and again once the edit is committed, the capture
+// buffer is then read back asynchronously. Once the readback fence has
+// been reached only blocks with changed voxel words are kept, stored as XOR
+// delta of the records before and after the edit with zero runs
+// compressed. Applying a delta to either state yields the other, undo and
+// redo are the same operation. Deltas are applied on the GPU, entries not
+// yet read back are applied straight from their capture buffer.
+//
+// A voxel record holds voxel state, voxel feature and the packed distance
+// word of each distance layer owned by the voxel, distance words are owned
+// by the even voxel of each packed voxel pair. CPU voxel data edits are
+// recorded as deltas of CPU voxel records in the same entries.
+//
+// History entries are owned by the render thread. CPU voxel data edits are
+// captured on the game thread and handed to the render thread on commit.
+
+class FMarchingSquaresMapHistory
+{
+public:
+
+    struct FBlockDelta
+    {
+        // Block voxel rect, max exclusive
+        FIntRect       VoxelRect;
+        TArray<uint32> Delta;
+    };
+
+private:
+
+    // Voxel records of captured blocks before the edit followed by voxel
+    // records after the edit, block records are BlockSize^2 voxel records
+    struct FCaptureChunk
+    {
+        TArray<FIntRect> Blocks;
+        FRULRWBuffer     BlockData;
+        FRULRWBuffer     CaptureData;
+        TUniquePtr<FRHIGPUBufferReadback> Readback;
+        uint32 CaptureByteCount = 0;
+
+        FORCEINLINE bool IsReadbackReady() const
+        {
+            return Readback.IsValid() && Readback->IsReady();
+        }
+    };
+
+public:
+
+    struct FHistoryEntry
+    {
+        // Record deltas of GPU voxel data blocks
+        TArray<FBlockDelta> Blocks;
+
+        // Voxel state, feature and distance deltas of CPU voxel data blocks
+        TArray<FBlockDelta> CPUBlocks;
+
+        // Capture chunks in flight, blocks are resolved from the chunks
+        // once all chunk readbacks have finished
+        TArray<TSharedPtr<FCaptureChunk>> Captures;
+
+        // Voxel rect of all GPU and CPU blocks, max exclusive
+        FIntRect VoxelRect;
+        FIntRect CPUVoxelRect;
+
+        FORCEINLINE bool IsResolved() const
+        {
+            return Captures.Num() == 0;
+        }
+
+        SIZE_T GetAllocatedSize() const;
+    };
+
+private:
+
+    // Undo entries ordered from oldest to newest
+    TArray<FHistoryEntry> UndoEntries;
+    TArray<FHistoryEntry> RedoEntries;
+
+    // Blocks captured by the pending entry, capture chunks hold voxel
+    // records before the first edit of the entry
+    TSet<FIntPoint> PendingBlocks;
+    TArray<TSharedPtr<FCaptureChunk>> PendingCaptures;
+    TArray<FBlockDelta> PendingCPUBlocks;
+
+    FIntPoint Dimension_RT = FIntPoint::ZeroValue;
+    int32     BlockSize_RT = 0;
+    int32     DistanceLayerCount_RT = 0;
+    int32     HistoryLimit_RT = 0;
+    int32     GroupDepth_RT = 0;
+
+    // CPU voxel data blocks captured by BeginEditCPU(), game thread only
+    TMap<FIntPoint, TArray<uint32>> CPUSnapshots;
+    int32 CPUBlockSize = 0;
+
+    // Game thread visible history state
+
+    FThreadSafeCounter UndoCount;
+    FThreadSafeCounter RedoCount;
+    FThreadSafeCounter AllocatedSize;
+
+    FORCEINLINE int32 GetRecordStride() const
+    {
+        return 2 + DistanceLayerCount_RT;
+    }
+
+    FORCEINLINE int32 GetBlockRecordSize() const
+    {
+        return BlockSize_RT * BlockSize_RT * GetRecordStride();
+    }
+
+    FIntRect GetBlockVoxelRect(const FIntPoint& Block) const;
+
+    void CaptureChunk_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, FCaptureChunk& Chunk, bool bAfterEdit);
+    void CommitPendingEntry_RT(FMarchingSquaresMap& Map);
+    void ResolveEntry_RT(FHistoryEntry& Entry);
+    bool ApplyEntry_RT(FMarchingSquaresMap& Map, const FHistoryEntry& Entry);
+    void ApplyCaptureData_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, FRULRWBuffer& BlockData, FRULRWBuffer& EntryData, int32 BlockCount, uint32 PairOffset);
+    void UpdateCounters_RT();
+
+    static void WriteBlockData_RT(const TArray<FIntRect>& Blocks, FRULRWBuffer& OutBlockData);
+
+    // CPU voxel data records hold voxel state and feature, row major, with
+    // the distance word of each distance layer following even x voxels
+    static void CopyBlockCPU(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& VoxelRect, TArray<uint32>& OutRecords);
+    static void ApplyBlockCPU(FMarchingSquaresCPUVoxelData& VoxelData, const FBlockDelta& BlockDelta);
+
+    // Delta encoding: [zero run count, literal count, literal words...]
+    // repeated, trailing zero run omitted. Empty delta means no change.
+    static void EncodeDelta(const uint32* Before, const uint32* After, int32 Count, TArray<uint32>& OutDelta);
+    static void ApplyDelta(const TArray<uint32>& Delta, uint32* Data, int32 Count);
+
+public:
+
+    // Configure history, clears history if map layout or limit has changed.
+    // History limit of zero disables history.
+    void Configure_RT(const FIntPoint& Dimension, int32 BlockSize, int32 DistanceLayerCount, int32 HistoryLimit);
+
+    FORCEINLINE bool IsEnabled_RT() const
+    {
+        return HistoryLimit_RT > 0 && BlockSize_RT > 0 && Dimension_RT.X > 0 && Dimension_RT.Y > 0;
+    }
+
+    // Capture blocks overlapping the voxel rect before the voxel data is
+    // written. Each edit must be closed with EndEdit_RT().
+    void BeginEdit_RT(FMarchingSquaresMap& Map, const FIntRect& VoxelRect);
+
+    // Commit captured blocks as a single history entry unless within a
+    // history group
+    void EndEdit_RT(FMarchingSquaresMap& Map);
+
+    // Add CPU voxel data block deltas to the pending entry, committed as
+    // a single history entry unless within a history group
+    void AddEditCPU_RT(FMarchingSquaresMap& Map, TArray<FBlockDelta>& Blocks);
+
+    // Edits within a history group are committed as a single entry
+    void BeginGroup_RT();
+    void EndGroup_RT(FMarchingSquaresMap& Map);
+
+    // Resolve entries whose capture readbacks have finished, never waits
+    // for the GPU
+    void Update_RT();
+
+    // Restore voxel data of the last entry. Returns false if there is no
+    // entry to restore, restored GPU and CPU voxel rects otherwise. Rects
+    // are empty if the entry holds no blocks of the voxel data.
+    bool Undo_RT(FMarchingSquaresMap& Map, FIntRect& OutVoxelRect, FIntRect& OutCPUVoxelRect);
+    bool Redo_RT(FMarchingSquaresMap& Map, FIntRect& OutVoxelRect, FIntRect& OutCPUVoxelRect);
+
+    void Clear_RT();
+
+    // CPU VOXEL DATA FUNCTIONS
+
+    // Capture CPU voxel data blocks overlapping the voxel rect before the
+    // CPU voxel data is written, game thread only
+    void BeginEditCPU(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& VoxelRect, int32 BlockSize);
+
+    // Get deltas of blocks changed since BeginEditCPU(), game thread only
+    void EndEditCPU(const FMarchingSquaresCPUVoxelData& VoxelData, TArray<FBlockDelta>& OutBlocks);
+
+    FORCEINLINE int32 GetUndoCount() const
+    {
+        return UndoCount.GetValue();
+    }
+
+    FORCEINLINE int32 GetRedoCount() const
+    {
+        return RedoCount.GetValue();
+    }
+
+    // Returns approximate history memory size in bytes
+    FORCEINLINE int32 GetAllocatedSize() const
+    {
+        return AllocatedSize.GetValue();
+    }
+};
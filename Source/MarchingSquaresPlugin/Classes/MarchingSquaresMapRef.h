@@ -29,11 +29,20 @@
 
 #include "CoreMinimal.h"
 #include "MarchingSquaresMap.h"
+#include "MarchingSquaresVoxelImport.h"
+#include "MarchingSquaresContour.h"
 #include "Mesh/PMUMeshTypes.h"
 #include "Shaders/RULShaderParameters.h"
 #include "MarchingSquaresMapRef.generated.h"
 
+class UBodySetup;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FMarchingSquaresMapRef_OnBuildMapDone, bool, bResult, int32, FillType);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FMarchingSquaresMapRef_OnBuildMapRectDone, bool, bResult, int32, FillType, FIntPoint, SectionMin, FIntPoint, SectionMax);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FMarchingSquaresMapRef_OnVoxelStatsUpdated);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FMarchingSquaresMapRef_OnVoxelComponentsUpdated);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMarchingSquaresMapRef_OnCollisionUpdated, const TArray<FIntPoint>&, ChangedBlocks);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMarchingSquaresMapRef_OnNavGraphUpdated, const TArray<FIntPoint>&, ChangedBlocks);
 
 UCLASS(BlueprintType, Blueprintable)
 class UMarchingSquaresMapRef : public UObject
@@ -43,6 +52,11 @@ class UMarchingSquaresMapRef : public UObject
     FMarchingSquaresMap Map;
 
     void OnBuildMapDoneCallback(bool bBuildMapResult, uint32 FillType);
+    void OnBuildMapRectDoneCallback(bool bBuildMapResult, uint32 FillType, const FIntRect& BlockRect);
+    void OnVoxelStatsUpdatedCallback();
+    void OnVoxelComponentsUpdatedCallback();
+    void OnCollisionUpdatedCallback(const TArray<FIntPoint>& ChangedBlocks);
+    void OnNavGraphUpdatedCallback(const TArray<FIntPoint>& ChangedBlocks);
 
 public:
 
@@ -64,6 +78,58 @@ public:
     UPROPERTY(EditAnywhere, Category="Map Settings", BlueprintReadWrite)
     float BoundsExtrudeOverrideZ = 0.f;
 
+    // Number of fill types, starting from fill type zero, that keep signed
+    // distance voxel data. Zero disables voxel distance data.
+    UPROPERTY(EditAnywhere, Category="Distance Settings", BlueprintReadWrite, meta=(ClampMin="0", UIMin="0"))
+    int32 DistanceLayerCount = 0;
+
+    // Voxel distance range in voxel unit. Poly stencils also update voxel
+    // distance within range of the stencil edges, build rects following a
+    // stencil should cover the stencil bounds grown by the range.
+    UPROPERTY(EditAnywhere, Category="Distance Settings", BlueprintReadWrite, meta=(ClampMin="1", UIMin="1"))
+    float DistanceRange = 4.f;
+
+    // Maximum number of voxel edit undo entries. Zero disables edit history.
+    UPROPERTY(EditAnywhere, Category="History Settings", BlueprintReadWrite, meta=(ClampMin="0", UIMin="0"))
+    int32 HistoryLimit = 0;
+
+    // Keep a CPU copy of voxel data for voxel query functions. GPU voxel
+    // edits are read back asynchronously, queries may lag voxel edits.
+    UPROPERTY(EditAnywhere, Category="Query Settings", BlueprintReadWrite)
+    bool bEnableVoxelMirror = false;
+
+    // Keep a CPU bounding volume hierarchy of built section triangles for
+    // section trace functions. Trees of rebuilt sections are refreshed
+    // after each build.
+    UPROPERTY(EditAnywhere, Category="Query Settings", BlueprintReadWrite)
+    bool bEnableSectionBVH = false;
+
+    // Cook collision polygons of the collision fill type on a background
+    // task whenever voxel mirror data of edited blocks lands. Requires the
+    // voxel mirror.
+    UPROPERTY(EditAnywhere, Category="Collision Settings", BlueprintReadWrite)
+    bool bEnableCollision = false;
+
+    UPROPERTY(EditAnywhere, Category="Collision Settings", BlueprintReadWrite, meta=(ClampMin="0", UIMin="0", ClampMax="255", UIMax="255"))
+    int32 CollisionFillType = 1;
+
+    // Collision contour simplification tolerance in voxel unit
+    UPROPERTY(EditAnywhere, Category="Collision Settings", BlueprintReadWrite, meta=(ClampMin="0", UIMin="0"))
+    float CollisionSimplifyTolerance = .5f;
+
+    // Maximum number of points of each convex collision polygon
+    UPROPERTY(EditAnywhere, Category="Collision Settings", BlueprintReadWrite, meta=(ClampMin="3", UIMin="3"))
+    int32 CollisionMaxPolygonPointCount = 8;
+
+    // Update the navigation graph on a background task whenever voxel
+    // mirror data of edited blocks lands. Requires the voxel mirror.
+    UPROPERTY(EditAnywhere, Category="Navigation Settings", BlueprintReadWrite)
+    bool bEnableNavGraph = false;
+
+    // Fill types walkable by navigation graph regions
+    UPROPERTY(EditAnywhere, Category="Navigation Settings", BlueprintReadWrite)
+    TArray<int32> NavPassableFillTypes;
+
     UPROPERTY(EditAnywhere, Category="Height Settings", BlueprintReadWrite)
     float SurfaceHeightScale = 1.0f;
 
@@ -79,6 +145,30 @@ public:
     UPROPERTY(BlueprintAssignable, Category="Map Settings")
     FMarchingSquaresMapRef_OnBuildMapDone OnBuildMapDone;
 
+    // Called when BuildMapRect() finishes. Section min and max are the
+    // rebuilt section grid rect, max exclusive.
+    UPROPERTY(BlueprintAssignable, Category="Map Settings")
+    FMarchingSquaresMapRef_OnBuildMapRectDone OnBuildMapRectDone;
+
+    // Called when UpdateVoxelStats() finishes
+    UPROPERTY(BlueprintAssignable, Category="Query Settings")
+    FMarchingSquaresMapRef_OnVoxelStatsUpdated OnVoxelStatsUpdated;
+
+    // Called when UpdateVoxelComponents() finishes
+    UPROPERTY(BlueprintAssignable, Category="Query Settings")
+    FMarchingSquaresMapRef_OnVoxelComponentsUpdated OnVoxelComponentsUpdated;
+
+    // Called when a collision cook finishes with section blocks whose
+    // collision polygons changed
+    UPROPERTY(BlueprintAssignable, Category="Collision Settings")
+    FMarchingSquaresMapRef_OnCollisionUpdated OnCollisionUpdated;
+
+    // Called when a navigation graph update finishes with mirror blocks
+    // whose regions were rebuilt. Portals of neighbouring blocks may also
+    // have changed.
+    UPROPERTY(BlueprintAssignable, Category="Navigation Settings")
+    FMarchingSquaresMapRef_OnNavGraphUpdated OnNavGraphUpdated;
+
     UPROPERTY(BlueprintReadWrite, Category="Prefabs")
     TArray<class UStaticMesh*> MeshPrefabs;
 
@@ -123,12 +213,230 @@ public:
     UFUNCTION(BlueprintCallable)
     void BuildMap(int32 FillType, bool bGenerateWalls);
 
+    // Rebuild only sections overlapping the voxel rect, max exclusive
+    UFUNCTION(BlueprintCallable)
+    void BuildMapRect(int32 FillType, bool bGenerateWalls, FIntPoint VoxelMin, FIntPoint VoxelMax);
+
     UFUNCTION(BlueprintCallable)
     void ClearMap();
 
     UFUNCTION(BlueprintCallable)
     void SetHeightMap(FRULShaderTextureParameterInput TextureInput);
 
+    // HISTORY FUNCTIONS
+
+    // Voxel edits between begin and end history group are undone as one
+    UFUNCTION(BlueprintCallable)
+    void BeginHistoryGroup();
+
+    UFUNCTION(BlueprintCallable)
+    void EndHistoryGroup();
+
+    // Restore voxel data of the last edit and rebuild affected sections of
+    // each build fill type. Broadcasts build map rect done per fill type.
+    UFUNCTION(BlueprintCallable)
+    void UndoEdit(const TArray<int32>& BuildFillTypes, bool bGenerateWalls);
+
+    UFUNCTION(BlueprintCallable)
+    void RedoEdit(const TArray<int32>& BuildFillTypes, bool bGenerateWalls);
+
+    UFUNCTION(BlueprintCallable)
+    void ClearHistory();
+
+    // History counts are updated once queued render commands are executed
+
+    UFUNCTION(BlueprintCallable)
+    int32 GetUndoCount() const;
+
+    UFUNCTION(BlueprintCallable)
+    int32 GetRedoCount() const;
+
+    // IMPORT FUNCTIONS
+
+    // Import voxel fill types from a texture, one texel per voxel with texel
+    // (0, 0) at the voxel offset. Fill type channel is read as 8-bit UNORM.
+    // Optional edge texture channel holds anti-aliased coverage of non-zero
+    // fill types and must match fill type texture size.
+    UFUNCTION(BlueprintCallable)
+    void ImportVoxelTexture(
+        FRULShaderTextureParameterInput FillTypeTexture,
+        FRULShaderTextureParameterInput EdgeTexture,
+        bool bUseEdgeTexture,
+        FIntPoint Offset,
+        EMarchingSquaresImportChannel FillTypeChannel,
+        EMarchingSquaresImportChannel EdgeChannel
+        );
+
+    // Import voxel fill types from a row-major image. Edges are optional
+    // edge coverage values, empty or matching fill type count.
+    UFUNCTION(BlueprintCallable)
+    void ImportVoxelImage(
+        const TArray<uint8>& FillTypes,
+        const TArray<uint8>& Edges,
+        FIntPoint ImageSize,
+        FIntPoint Offset,
+        bool bImportToCPUVoxelData
+        );
+
+    // QUERY FUNCTIONS
+    //
+    // Queries use the voxel mirror, see bEnableVoxelMirror. Positions are in
+    // voxel unit.
+
+    // Poll pending voxel mirror readback without a voxel edit
+    UFUNCTION(BlueprintCallable)
+    void UpdateVoxelMirror();
+
+    // Returns true if all voxel edits have been read back to the mirror
+    UFUNCTION(BlueprintCallable)
+    bool IsVoxelMirrorSynced() const;
+
+    // Returns voxel fill type, -1 if the voxel is outside the map or the
+    // mirror is not available
+    UFUNCTION(BlueprintCallable)
+    int32 GetVoxelFillType(FIntPoint Voxel) const;
+
+    UFUNCTION(BlueprintCallable)
+    bool IsPointFilled(FVector2D Point, int32 FillType) const;
+
+    // Find the first fill type boundary along the segment, hit normal
+    // points away from the filled side
+    UFUNCTION(BlueprintCallable)
+    bool RaycastBoundary(FVector2D Start, FVector2D End, int32 FillType, FVector2D& HitLocation, FVector2D& HitNormal) const;
+
+    // Returns filled area fraction of the rect, area outside the map is
+    // considered empty
+    UFUNCTION(BlueprintCallable)
+    float GetFillFraction(FVector2D RectMin, FVector2D RectMax, int32 FillType) const;
+
+    // Extract fill type boundaries from the voxel mirror as ordered
+    // polylines with the filled side on the left. Open polylines end on the
+    // map border unless closed at map border. Simplification is disabled if
+    // tolerance is zero or less.
+    UFUNCTION(BlueprintCallable)
+    TArray<FMarchingSquaresContourPolyline> ExtractContours(int32 FillType, bool bCloseAtMapBorder, float SimplifyTolerance) const;
+
+    // Extract contours of cells within the cell rect, max exclusive.
+    // Contours crossing the rect bounds are open polylines.
+    UFUNCTION(BlueprintCallable)
+    TArray<FMarchingSquaresContourPolyline> ExtractContoursInRect(int32 FillType, FIntPoint CellMin, FIntPoint CellMax, bool bCloseAtMapBorder, float SimplifyTolerance) const;
+
+    // VOXEL STATISTICS FUNCTIONS
+    //
+    // Fill type area and boundary length in voxel unit evaluated from the
+    // voxel mirror. Statistics are kept per mirror block (32x32 cells) and
+    // only blocks updated since the previous evaluation are evaluated.
+
+    // Evaluate statistics on a background task, broadcasts voxel stats
+    // updated on completion. Returns false if an update is in progress.
+    UFUNCTION(BlueprintCallable)
+    bool UpdateVoxelStats();
+
+    // Coverage is the filled area fraction of the map
+    UFUNCTION(BlueprintCallable)
+    void GetFillTypeStats(int32 FillType, float& Area, float& Perimeter, float& Coverage) const;
+
+    UFUNCTION(BlueprintCallable)
+    FIntPoint GetVoxelStatsBlockCount() const;
+
+    UFUNCTION(BlueprintCallable)
+    bool GetBlockFillTypeStats(FIntPoint Block, int32 FillType, float& Area, float& Perimeter) const;
+
+    // VOXEL COMPONENT FUNCTIONS
+    //
+    // Connected regions of voxels with equal fill type evaluated from the
+    // voxel mirror. Component ids are valid until the next update.
+
+    // Label components on a background task, broadcasts voxel components
+    // updated on completion. Returns false if an update is in progress.
+    UFUNCTION(BlueprintCallable)
+    bool UpdateVoxelComponents();
+
+    UFUNCTION(BlueprintCallable)
+    int32 GetVoxelComponentCount() const;
+
+    // Component bounds are in voxel unit, max exclusive
+    UFUNCTION(BlueprintCallable)
+    bool GetVoxelComponent(int32 ComponentId, int32& FillType, int32& VoxelCount, FIntPoint& BoundsMin, FIntPoint& BoundsMax) const;
+
+    // Returns component id of the fill type region containing the point,
+    // -1 if the point is outside the fill type surface
+    UFUNCTION(BlueprintCallable)
+    int32 GetVoxelComponentAt(FVector2D Point, int32 FillType) const;
+
+    // Returns true if both points are within the same fill type region
+    UFUNCTION(BlueprintCallable)
+    bool AreVoxelPointsConnected(FVector2D PointA, FVector2D PointB, int32 FillType) const;
+
+    // COLLISION FUNCTIONS
+    //
+    // Convex collision polygons per section block in voxel unit, see
+    // bEnableCollision
+
+    // Cook collision of blocks updated since the previous cook, broadcasts
+    // collision updated on completion
+    UFUNCTION(BlueprintCallable)
+    bool UpdateCollision();
+
+    UFUNCTION(BlueprintCallable)
+    FIntPoint GetCollisionBlockCount() const;
+
+    // Returns block convex polygons as closed counter-clockwise polylines
+    UFUNCTION(BlueprintCallable)
+    TArray<FMarchingSquaresContourPolyline> GetBlockCollisionPolygons(FIntPoint Block) const;
+
+    // Replace convex elements of the body setup with block polygons
+    // extruded between min and max z and recreate physics meshes. Owning
+    // components need to recreate their physics state afterwards.
+    UFUNCTION(BlueprintCallable)
+    bool BuildBlockBodySetup(UBodySetup* BodySetup, FIntPoint Block, FVector2D VoxelScale, float MinZ, float MaxZ) const;
+
+    // NAVIGATION GRAPH FUNCTIONS
+    //
+    // Walkable regions per voxel mirror block connected by portals across
+    // block borders, see bEnableNavGraph. Positions are in voxel unit.
+
+    // Update navigation graph of blocks written since the previous update,
+    // broadcasts navigation graph updated on completion
+    UFUNCTION(BlueprintCallable)
+    bool UpdateNavGraph();
+
+    UFUNCTION(BlueprintCallable)
+    FIntPoint GetNavGraphBlockCount() const;
+
+    UFUNCTION(BlueprintCallable)
+    TArray<FMarchingSquaresNavNode> GetNavBlockNodes(FIntPoint Block) const;
+
+    // Returns portals on all four borders of the block
+    UFUNCTION(BlueprintCallable)
+    TArray<FMarchingSquaresNavPortal> GetNavBlockPortals(FIntPoint Block) const;
+
+    // Returns false if the voxel is not within a walkable region
+    UFUNCTION(BlueprintCallable)
+    bool GetNavNodeAt(FIntPoint Voxel, FMarchingSquaresNavNode& OutNode) const;
+
+    UFUNCTION(BlueprintCallable)
+    TArray<FMarchingSquaresNavPortal> GetNavNodePortals(FIntPoint Block, int32 Region) const;
+
+    // SECTION TRACE FUNCTIONS
+    //
+    // Traces against built section triangles, see bEnableSectionBVH.
+    // Positions are in section local space. Negative fill type traces
+    // sections of all fill types.
+
+    // Find the closest section hit along the ray
+    UFUNCTION(BlueprintCallable)
+    bool RaycastSections(FVector Origin, FVector Direction, float MaxDistance, int32 FillType, FVector& HitLocation, FVector& HitNormal, float& HitDistance, int32& HitSectionIndex) const;
+
+    // Find the closest section hit along the segment
+    UFUNCTION(BlueprintCallable)
+    bool SegmentTraceSections(FVector Start, FVector End, int32 FillType, FVector& HitLocation, FVector& HitNormal, float& HitDistance, int32& HitSectionIndex) const;
+
+    // Returns true if any section triangle blocks the segment. Faster than
+    // SegmentTraceSections() for line of sight tests.
+    UFUNCTION(BlueprintCallable)
+    bool IsSegmentBlockedBySections(FVector Start, FVector End, int32 FillType) const;
+
     // SECTION FUNCTIONS
 
     UFUNCTION(BlueprintCallable)
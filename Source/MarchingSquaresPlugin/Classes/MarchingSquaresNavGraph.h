@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/ScopeRWLock.h"
+#include "MarchingSquaresVoxelMirror.h"
+#include "MarchingSquaresNavGraph.generated.h"
+
+// Navigation graph
+//
+// Block level navigation graph built from voxel mirror data. Graph nodes
+// are walkable regions of each mirror block, connected regions of voxels
+// with passable fill types using the same connectivity as voxel components.
+// Graph edges are portals, runs of passable voxel pairs across a block
+// border connecting the same two regions, and single diagonal links of
+// saddle cells straddling a block border or block corner. Only blocks
+// written since the previous update are relabeled, portals are relinked on
+// borders of relabeled blocks. Positions are in voxel unit.
+
+class FMarchingSquaresNavGraph
+{
+public:
+
+    enum { BLOCK_SIZE = FMarchingSquaresVoxelMirror::BLOCK_SIZE };
+
+    struct FNodeId
+    {
+        FIntPoint Block = FIntPoint::ZeroValue;
+        int32     Region = -1;
+
+        FORCEINLINE bool IsValid() const
+        {
+            return Region >= 0;
+        }
+
+        FORCEINLINE bool operator==(const FNodeId& Other) const
+        {
+            return Block == Other.Block && Region == Other.Region;
+        }
+    };
+
+    struct FNode
+    {
+        FNodeId Id;
+        int32   VoxelCount = 0;
+
+        // Voxel bounds, max exclusive
+        FIntRect Bounds;
+
+        // Region voxel nearest to the region centroid
+        FIntPoint Anchor = FIntPoint::ZeroValue;
+    };
+
+    struct FPortal
+    {
+        // Node on the lower block and node on the upper block of the border,
+        // blocks are ordered by block index
+        FNodeId NodeA;
+        FNodeId NodeB;
+
+        // Portal segment on the border line between the voxel pairs. Start
+        // and end are the saddle cell center for diagonal links.
+        FVector2D Start;
+        FVector2D End;
+
+        // Number of passable voxel pairs, one for diagonal links
+        int32 Width = 0;
+
+        // Travel distance from node A anchor to node B anchor through the
+        // portal center
+        float Cost = 0.f;
+    };
+
+    struct FGraphParameter
+    {
+        TArray<uint8> PassableFillTypes;
+
+        bool operator==(const FGraphParameter& Other) const;
+
+        FORCEINLINE bool operator!=(const FGraphParameter& Other) const
+        {
+            return ! (*this == Other);
+        }
+    };
+
+private:
+
+    enum { INVALID_LABEL = 0xFFFF };
+
+    struct FBlockGraph
+    {
+        FIntPoint Block;
+        FIntRect  VoxelRect;
+
+        // Local region label of each voxel, row major
+        TArray<uint16> Labels;
+
+        TArray<FNode> Nodes;
+
+        // Passable cell centers of cells with the minimum corner on the
+        // last voxel column and the last voxel row
+        TBitArray<> BorderCenters[2];
+
+        // Portals to the next block on the x and y axis, and diagonal links
+        // of the cell on the block corner shared with the next x, y and xy
+        // blocks
+        TArray<FPortal> Portals[3];
+    };
+
+    // Graph data, guarded by the graph lock
+
+    mutable FRWLock GraphLock;
+
+    FGraphParameter Parameter;
+    FGraphParameter GraphParameter;
+    FIntPoint Dimension = FIntPoint::ZeroValue;
+    FIntPoint BlockCount = FIntPoint::ZeroValue;
+    uint32    MirrorRevision = 0;
+
+    TArray<FBlockGraph> Blocks;
+    TArray<FIntPoint>   ChangedBlocks;
+
+    // Async update state
+
+    FGraphEventRef UpdateTask;
+    FThreadSafeBool bUpdating;
+    FThreadSafeBool bUpdateRequested;
+
+    static void LabelBlock(const TArray<uint32>& States, const bool bPassable[256], FBlockGraph& Block);
+
+    // Link regions of two adjacent blocks, block B follows block A on the
+    // specified axis. Diagonal links of saddle cells on the border use the
+    // same connection rule as cells within a block.
+    static void LinkBlocks(const FBlockGraph& BlockA, const FBlockGraph& BlockB, int32 Axis, TArray<FPortal>& OutPortals);
+
+    // Link diagonal corners of the saddle cell shared by four blocks, block
+    // B, C and D follow block A on the x, y and xy axis
+    static void LinkCorner(const FBlockGraph& BlockA, const FBlockGraph& BlockB, const FBlockGraph& BlockC, const FBlockGraph& BlockD, TArray<FPortal>& OutPortals);
+
+    void Build(const FMarchingSquaresVoxelMirror& Mirror);
+
+    // Query helpers, caller must hold the graph lock
+
+    const FBlockGraph* FindBlockUnlocked(const FIntPoint& Block) const;
+    void GetBlockPortalsUnlocked(const FIntPoint& Block, TArray<FPortal>& OutPortals) const;
+
+public:
+
+    ~FMarchingSquaresNavGraph();
+
+    // Rebuild blocks written since the previous update. Changing graph
+    // parameter rebuilds all blocks.
+    void Update(const FMarchingSquaresVoxelMirror& Mirror, const FGraphParameter& InParameter);
+
+    // Update on a background task. Completion callback is called from the
+    // background task. If an update is in progress, another update with the
+    // latest parameter is run after it completes and false is returned.
+    bool UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, const FGraphParameter& InParameter, TFunction<void()> OnComplete);
+
+    FORCEINLINE bool IsUpdating() const
+    {
+        return bUpdating;
+    }
+
+    void Reset();
+
+    // QUERY FUNCTIONS
+
+    uint32 GetMirrorRevision() const;
+
+    FIntPoint GetBlockCount() const;
+
+    // Returns blocks rebuilt by the previous update. Portals of rebuilt
+    // blocks and their neighbours are relinked.
+    TArray<FIntPoint> GetChangedBlocks() const;
+
+    bool GetBlockNodes(const FIntPoint& Block, TArray<FNode>& OutNodes) const;
+
+    // Get portals on all four borders and corners of the block
+    bool GetBlockPortals(const FIntPoint& Block, TArray<FPortal>& OutPortals) const;
+
+    bool GetNode(const FNodeId& NodeId, FNode& OutNode) const;
+
+    void GetNodePortals(const FNodeId& NodeId, TArray<FPortal>& OutPortals) const;
+
+    // Returns node of the walkable region containing the voxel, invalid
+    // node id if the voxel is not passable or outside the map
+    FNodeId GetNodeAt(const FIntPoint& Voxel) const;
+};
+
+USTRUCT(BlueprintType)
+struct FMarchingSquaresNavNode
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadWrite)
+    FIntPoint Block = FIntPoint::ZeroValue;
+
+    // Region index within the block, -1 for invalid nodes
+    UPROPERTY(BlueprintReadWrite)
+    int32 Region = -1;
+
+    UPROPERTY(BlueprintReadWrite)
+    int32 VoxelCount = 0;
+
+    // Voxel bounds, max exclusive
+    UPROPERTY(BlueprintReadWrite)
+    FIntPoint BoundsMin = FIntPoint::ZeroValue;
+
+    UPROPERTY(BlueprintReadWrite)
+    FIntPoint BoundsMax = FIntPoint::ZeroValue;
+
+    UPROPERTY(BlueprintReadWrite)
+    FIntPoint Anchor = FIntPoint::ZeroValue;
+};
+
+USTRUCT(BlueprintType)
+struct FMarchingSquaresNavPortal
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadWrite)
+    FIntPoint BlockA = FIntPoint::ZeroValue;
+
+    UPROPERTY(BlueprintReadWrite)
+    int32 RegionA = -1;
+
+    UPROPERTY(BlueprintReadWrite)
+    FIntPoint BlockB = FIntPoint::ZeroValue;
+
+    UPROPERTY(BlueprintReadWrite)
+    int32 RegionB = -1;
+
+    UPROPERTY(BlueprintReadWrite)
+    FVector2D Start = FVector2D::ZeroVector;
+
+    UPROPERTY(BlueprintReadWrite)
+    FVector2D End = FVector2D::ZeroVector;
+
+    UPROPERTY(BlueprintReadWrite)
+    int32 Width = 0;
+
+    UPROPERTY(BlueprintReadWrite)
+    float Cost = 0.f;
+};
@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeRWLock.h"
+#include "Mesh/PMUMeshTypes.h"
+
+// Section bounding volume hierarchy
+//
+// CPU copy of built section triangles organized in a compact binary BVH per
+// section for ray and segment queries against the generated geometry.
+// Section trees are rebuilt from section data after each build, only for
+// the rebuilt sections. Queries first cull sections by their local bounds
+// and then traverse the section trees. Positions are in section local
+// space, the space of section positions and SectionLocalBox.
+
+class FMarchingSquaresSectionBVH
+{
+public:
+
+    struct FTraceResult
+    {
+        float   Distance = 0.f;
+        FVector Location = FVector::ZeroVector;
+
+        // Triangle normal facing the trace origin
+        FVector Normal = FVector::ZeroVector;
+
+        int32 FillType = -1;
+        int32 SectionIndex = -1;
+    };
+
+private:
+
+    enum { MAX_LEAF_TRIANGLE_COUNT = 4 };
+    enum { MAX_TRAVERSAL_DEPTH = 64 };
+
+    struct FNode
+    {
+        FVector Min;
+        FVector Max;
+
+        // Leaf nodes, index of the first triangle. Interior nodes, index of
+        // the second child, the first child follows the node.
+        int32 Offset;
+
+        // Zero for interior nodes
+        int32 TriangleCount;
+    };
+
+    struct FSectionTree
+    {
+        // Section local box grown to contain the section triangles
+        FBox Bounds = FBox(ForceInitToZero);
+
+        TArray<FNode> Nodes;
+
+        // Three vertices per triangle in leaf order
+        TArray<FVector> Vertices;
+
+        FORCEINLINE bool IsValid() const
+        {
+            return Nodes.Num() > 0;
+        }
+    };
+
+    // Section trees per fill type and section index, guarded by the tree lock
+
+    mutable FRWLock TreeLock;
+    TArray< TArray<FSectionTree> > TreeGroups;
+
+    static void BuildTree(const FPMUMeshSection& Section, FSectionTree& OutTree);
+
+    static bool TraceTree(
+        const FSectionTree& Tree,
+        const FVector& Origin,
+        const FVector& Direction,
+        const FVector& InvDirection,
+        float MaxDistance,
+        bool bAnyHit,
+        float& OutDistance,
+        FVector& OutNormal
+        );
+
+    bool Trace(const FVector& Origin, const FVector& Direction, float MaxDistance, int32 FillType, bool bAnyHit, FTraceResult& OutResult) const;
+
+public:
+
+    // Rebuild trees of the specified sections of the fill type. Rebuilds
+    // all sections if the section count differs from the previous update.
+    void UpdateSections(int32 FillType, const TArray<FPMUMeshSection>& Sections, const TArray<int32>& SectionIndices);
+
+    void ClearGroup(int32 FillType);
+    void Clear();
+
+    // QUERY FUNCTIONS
+    //
+    // Negative fill type traces sections of all fill types
+
+    // Find the closest hit along the ray, direction does not need to be
+    // normalized
+    bool Raycast(const FVector& Origin, const FVector& Direction, float MaxDistance, int32 FillType, FTraceResult& OutResult) const;
+
+    // Find the closest hit along the segment
+    bool SegmentTrace(const FVector& Start, const FVector& End, int32 FillType, FTraceResult& OutResult) const;
+
+    // Returns true if any section triangle intersects the segment, stops on
+    // the first hit found
+    bool IsSegmentBlocked(const FVector& Start, const FVector& End, int32 FillType) const;
+};
@@ -29,16 +29,39 @@
 
 #include "CoreMinimal.h"
 #include "RHI/RULRHIBuffer.h"
+#include "MarchingSquaresStencilTexturePool.h"
 #include "MarchingSquaresStencil.h"
 #include "MarchingSquaresStencilPoly.generated.h"
 
 class FMarchingSquaresMap;
 class UMarchingSquaresMapRef;
+struct FMarchingSquaresCPUVoxelData;
 
 class FMarchingSquaresStencilPoly
 {
 public:
 
+    // Stencil operation modes, must match MarchingSquaresStencilCommon.ush
+    //
+    // Union    : Stencil area is set to the stencil fill type
+    // Subtract : Stencil fill type inside stencil area is set to op fill type
+    // Intersect: Stencil fill type outside stencil area is set to op fill type
+    // Replace  : Op fill type inside stencil area is set to stencil fill type
+
+    enum EStencilOpMode
+    {
+        STENCIL_OP_UNION     = 0,
+        STENCIL_OP_SUBTRACT  = 1,
+        STENCIL_OP_INTERSECT = 2,
+        STENCIL_OP_REPLACE   = 3
+    };
+
+    struct FStencilOp
+    {
+        EStencilOpMode Mode       = STENCIL_OP_UNION;
+        uint32         OpFillType = 0;
+    };
+
     struct FGenerateVoxelFeatureParameter
     {
         FMarchingSquaresMap* Map;
@@ -46,6 +69,108 @@ public:
 
         TArray<FVector2D>       StencilPoints;
         float                   StencilEdgeRadius;
+
+        // Stencil points simplification tolerance in voxel unit,
+        // simplification is disabled if tolerance is zero or less
+        float                   SimplifyTolerance;
+
+        FStencilOp              Op;
+    };
+
+    // Cap modes of open polyline stencil ends
+    //
+    // Butt  : Stroke ends at the end points
+    // Square: Stroke is extended by half width beyond the end points
+    // Round : Stroke ends with half circles around the end points
+
+    enum EStencilCapMode
+    {
+        STENCIL_CAP_BUTT   = 0,
+        STENCIL_CAP_SQUARE = 1,
+        STENCIL_CAP_ROUND  = 2
+    };
+
+    struct FStencilPolyData
+    {
+        uint32                  FillType;
+
+        TArray<FVector2D>       StencilPoints;
+        float                   StencilEdgeRadius;
+    };
+
+    // Open polyline stroked with per-point width. Stencil area only covers
+    // the stroke band, outlined as a single closed poly triangulated the
+    // same as any other stencil poly.
+
+    struct FStencilPolylineData
+    {
+        uint32                  FillType;
+
+        TArray<FVector2D>       Points;
+
+        // Per-point stroke width, points without width use the default width
+        TArray<float>           Widths;
+        float                   Width;
+
+        EStencilCapMode         StartCap;
+        EStencilCapMode         EndCap;
+
+        float                   StencilEdgeRadius;
+    };
+
+    struct FGenerateVoxelFeaturePolylineParameter
+    {
+        FMarchingSquaresMap*         Map;
+        TArray<FStencilPolylineData> Polylines;
+        FStencilOp                   Op;
+    };
+
+    struct FGenerateVoxelFeatureBatchParameter
+    {
+        FMarchingSquaresMap*     Map;
+        TArray<FStencilPolyData> Polys;
+        float                    SimplifyTolerance = 0.f;
+
+        // Intersect operation splits a batch per fill type in draw order,
+        // each fill type is intersected only with polys of that fill type
+        FStencilOp               Op;
+    };
+
+    // Single stencil applied to multiple maps of the same dimension. Stencil
+    // is rasterized once, voxel data is written per map with the map fill
+    // type. Maps that do not match the first map dimension are skipped.
+
+    struct FGenerateVoxelFeatureMultiParameter
+    {
+        TArray<FMarchingSquaresMap*> Maps;
+        TArray<uint32>               FillTypes;
+
+        TArray<FVector2D>            StencilPoints;
+        float                        StencilEdgeRadius = 1.f;
+        float                        SimplifyTolerance = 0.f;
+
+        FStencilOp                   Op;
+    };
+
+    // Cached stencil transform, applied as scale, rotation (degrees)
+    // then translation to the cached local space geometry
+
+    struct FStencilTransform
+    {
+        FVector2D Translation = FVector2D::ZeroVector;
+        float     Rotation    = 0.f;
+        FVector2D Scale       = FVector2D::UnitVector;
+
+        // Returns row major 2x2 rotation-scale matrix
+        FVector4 GetMatrix() const;
+        FVector2D TransformPoint(const FVector2D& Point) const;
+    };
+
+    struct FApplyCachedStencilParameter
+    {
+        FMarchingSquaresMap* Map;
+        FStencilTransform    Transform;
+        FStencilOp           Op;
     };
 
 private:
@@ -64,40 +189,406 @@ private:
     } GCC_ALIGN(64);
 
     typedef TResourceArray<FAlignedLineGeom, VERTEXBUFFER_ALIGNMENT> FLineGeomData;
+    typedef TResourceArray<FRULAlignedUint, VERTEXBUFFER_ALIGNMENT>  FLineStateData;
+
+    // Sums of stencil triangle or edge segment bounds span (width + height),
+    // bounds the tile bin entry count of the items under any transform
+
+    struct FSpanSum
+    {
+        float Sum   = 0.f;
+        float SqSum = 0.f;
+    };
+
+    // Stencil geometry constructed in local space, used as the source of
+    // cached stencil render resources
+
+    struct FCachedGeometryData
+    {
+        TResourceArray<FVector, VERTEXBUFFER_ALIGNMENT> Vertices;
+        TResourceArray<uint32, INDEXBUFFER_ALIGNMENT>   Indices;
+        FLineGeomData    LineGeomArr;
+        FLineStateData   LineStateArr;
+        FBox2D           Bounds;
+        FSpanSum         SpanSum;
+        FSpanSum         EdgeSpanSum;
+    };
+
+    // Line state flags, must match MarchingSquaresStencilPolyCS.usf
+
+    enum { LINE_STATE_FILL_TYPE_MASK = 0xFF };
+    enum { LINE_STATE_EDGE_FLAG      = 0x100 };
+
+    // Maximum line id that fit the 16-bit stencil texture and voxel state line id
+
+    enum { MAX_LINE_ID = 0xFFFE };
+
+    // Tile bin item source, must match MarchingSquaresStencilPolyCS.usf
+
+    enum { TILE_BIN_SOURCE_TRIANGLE = 0 };
+    enum { TILE_BIN_SOURCE_EDGE     = 1 };
+
+    // Per tile item lists written by the tile bin kernels. Tile offsets
+    // hold the start of each tile item list followed by the total entry
+    // count, tile cursors hold the tile counts during binning. Item list
+    // capacity is a conservative bound of the entry count, grown as
+    // required.
+
+    struct FTileBinData
+    {
+        FRULRWBuffer OffsetData;
+        FRULRWBuffer CursorData;
+        FRULRWBuffer ItemData;
+        int32        OffsetCapacity = 0;
+        int32        ItemCapacity   = 0;
+
+        void Release();
+    };
+
+    // Tile bin items are read from draw vertex and index data for triangle
+    // bins, line geom and line state data for edge segment bins
+
+    struct FTileBinParameter
+    {
+        uint32    Source    = TILE_BIN_SOURCE_TRIANGLE;
+        int32     ItemCount = 0;
+        int32     EntryBound = 0;
+        FIntPoint TileCount;
+        FIntPoint TileSize;
+        FVector2D Origin;
+        float     Range = 0.f;
+
+        FShaderResourceViewRHIParamRef ItemDataSRV0 = nullptr;
+        FShaderResourceViewRHIParamRef ItemDataSRV1 = nullptr;
+        uint32                         ItemDataOffset0 = 0;
+        uint32                         ItemDataOffset1 = 0;
+    };
+
+    // Dynamic shader read buffer written as an upload ring. Each upload is
+    // written at the ring write offset, which advances per upload and wraps
+    // to the start of the ring when the upload does not fit the remaining
+    // capacity. Uploads never overwrite data of the most recent uploads
+    // still read by in-flight dispatches, ring capacity holds at least
+    // UPLOAD_RING_SEGMENT_COUNT uploads of the largest upload size.
+
+    enum { UPLOAD_RING_SEGMENT_COUNT = 4 };
+
+    struct FUploadRing
+    {
+        FVertexBufferRHIRef       Buffer;
+        FStructuredBufferRHIRef   StructuredBuffer;
+        FShaderResourceViewRHIRef SRV;
+        int32                     Stride      = 0;
+        int32                     Capacity    = 0;
+        int32                     WriteOffset = 0;
+
+        FORCEINLINE bool IsValid() const
+        {
+            return SRV.IsValid();
+        }
+
+        // Reallocates the ring if it does not hold enough uploads of the
+        // given element count. Structured buffer if format is PF_Unknown.
+        void Reserve(int32 Count, int32 MinCount, int32 InStride, EPixelFormat Format);
+
+        // Writes elements at the ring write offset, returns element offset
+        int32 Write(const void* Data, int32 Count);
+
+        void Release();
+    };
+
+    // Line data buffers and element offsets of a stencil application
+
+    struct FLineDataRef
+    {
+        FShaderResourceViewRHIParamRef GeomSRV     = nullptr;
+        FShaderResourceViewRHIParamRef StateSRV    = nullptr;
+        uint32                         GeomOffset  = 0;
+        uint32                         StateOffset = 0;
+        int32                          Count       = 0;
+        FSpanSum                       EdgeSpanSum;
+    };
+
+    // Draw data buffers and element offsets of a stencil application,
+    // vertex offset is in float elements of the packed float3 vertices
+
+    struct FDrawDataRef
+    {
+        FShaderResourceViewRHIParamRef VertexSRV     = nullptr;
+        FShaderResourceViewRHIParamRef IndexSRV      = nullptr;
+        uint32                         VertexOffset  = 0;
+        uint32                         IndexOffset   = 0;
+        int32                          TriangleCount = 0;
+        FSpanSum                       SpanSum;
+    };
 
     // Render Resource Data
 
     FIntPoint Dimension  = FIntPoint::ZeroValue;
     int32     VoxelCount = 0;
 
-    FTexture2DRHIRef          StencilTextureRTV;
-    FTexture2DRHIRef          StencilTextureRSV;
-    FShaderResourceViewRHIRef StencilTextureSRV;
+    // Stencil texture, written by the stencil rasterizer kernel and read
+    // by the voxel kernels. Each texel holds (line id + 1) of the last
+    // stencil triangle covering the texel center, zero if uncovered.
+    //
+    // Borrowed from the shared stencil texture pool for the duration of a
+    // single stencil application. Map-sized by default, tile scratch
+    // textures only cover the stencil rect with texel origin at
+    // StencilTextureOffset.
+
+    FMarchingSquaresStencilTexture StencilTexture;
+    FIntPoint                      StencilTextureOffset = FIntPoint::ZeroValue;
+    bool                           bTileScratchTexture_RT = false;
 
     // Transient Render Data
 
-    uint32            FillType;
-    float             StencilEdgeRadius;
-    TArray<FVector2D> StencilPoints;
+    TArray<FStencilPolyData> StencilPolys;
+    FIntRect                 StencilRect;
+
+    // Upload Render Data
+    //
+    // Persistent upload rings reused across stencil applications. Upload
+    // line data refers to the line data of the current application.
+
+    enum { MIN_UPLOAD_LINE_COUNT   = 256  };
+    enum { MIN_UPLOAD_VERTEX_COUNT = 1024 };
+    enum { MIN_UPLOAD_INDEX_COUNT  = 4096 };
+
+    FUploadRing  LineGeomRing;
+    FUploadRing  LineStateRing;
+    FUploadRing  DrawVertexRing;
+    FUploadRing  DrawIndexRing;
+    FLineDataRef UploadLineData;
+
+    // Stencil triangles binned per stencil tile and stencil edge segments
+    // binned per voxel distance kernel group tile
+
+    enum { STENCIL_TILE_SIZE = 16 };
+    enum { MIN_TILE_BIN_COUNT = 1024 };
+
+    FTileBinData StencilTileBin;
+    FTileBinData DistanceTileBin;
 
-    FRULRWBufferStructured LineGeomData;
+    // Cached Stencil Render Data
+
+    FRULRWBuffer           CachedVertexData;
+    FRULRWBuffer           CachedIndexData;
+    int32                  CachedVertexCount = 0;
+    int32                  CachedIndexCount  = 0;
+    int32                  CachedLineCount   = 0;
+    uint32                 CachedFillType    = 0;
+    FBox2D                 CachedBounds;
+    FSpanSum               CachedSpanSum;
+    FSpanSum               CachedEdgeSpanSum;
+    FRULRWBufferStructured CachedLineGeomData;
+    FRULRWBuffer           CachedLineStateData;
+
+    // Game thread cached geometry state
+
+    bool bHasCachedGeometry = false;
+
+    bool bTileScratchTexture = false;
 
     FRHICommandListImmediate*      RHICmdListPtr = nullptr;
     TShaderMap<FGlobalShaderType>* RHIShaderMap  = nullptr;
 
-    void DrawStencilMask_RT();
-    void DrawStencilEdge_RT();
-    void ResolveStencilTexture_RT();
+    void BuildStencilMask(const FStencilPolyData& Poly, int32 MaskId, TArray<FVector>& Vertices, TArray<int32>& Indices) const;
+    void BuildStencilEdge(const FStencilPolyData& Poly, int32 LineOffset, TArray<FVector>& Vertices, TArray<int32>& Indices, FLineGeomData& LineGeomArr) const;
+
+    bool FilterStencilPoly(const FStencilPolyData& Poly, float SimplifyTolerance, FStencilPolyData& OutPoly) const;
+    void FilterStencilPolys(const TArray<FStencilPolyData>& Polys, float SimplifyTolerance, TArray<FStencilPolyData>& OutPolys) const;
+
+    void BuildStencilGeometry(
+        const TArray<FStencilPolyData>& Polys,
+        TArray<FVector>& Vertices,
+        TArray<int32>& Indices,
+        FLineGeomData& LineGeomArr,
+        FLineStateData& LineStateArr
+        ) const;
+
+    void BuildLineStateData(const TArray<FStencilPolyData>& Polys, FLineStateData& LineStateArr) const;
+
+    static FSpanSum GetTriangleSpanSum(const TArray<FVector>& Vertices, const TArray<int32>& Indices);
+    static FSpanSum GetEdgeSpanSum(const FLineGeomData& LineGeomArr, const FLineStateData& LineStateArr);
+    static int32 GetTileBinEntryBound(const FSpanSum& SpanSum, int32 ItemCount, float Scale, float Range, FIntPoint TileSize, FIntPoint TileCount);
+
+    static FORCEINLINE int32 GetLineDataCount(const TArray<FStencilPolyData>& Polys)
+    {
+        int32 LineDataCount = 0;
+
+        for (const FStencilPolyData& Poly : Polys)
+        {
+            LineDataCount += Poly.StencilPoints.Num() + 1;
+        }
+
+        return LineDataCount;
+    }
+
+    bool CalculateStencilRect(const FBox2D& Bounds);
+
+    void PrepareStencil_RT(FMarchingSquaresMap& Map);
+    void BorrowStencilTexture_RT();
+    void ReturnStencilTexture_RT();
+    bool DrawStencil_RT();
+    bool DrawCachedStencil_RT(const FStencilTransform& Transform);
+    void RasterizeStencil_RT(const FDrawDataRef& DrawData, const FStencilTransform& Transform);
+    void BinTileItems_RT(FTileBinData& TileBin, const FTileBinParameter& Parameter, const FStencilTransform& Transform);
+    void WriteVoxelData_RT(
+        FMarchingSquaresMap& Map,
+        const FLineDataRef& LineData,
+        uint32 FillType,
+        const FStencilTransform& Transform,
+        const FStencilOp& Op
+        );
+    void UploadLineData_RT(const FLineGeomData& LineGeomArr, const FLineStateData& LineStateArr);
+    void UploadLineStateData_RT(const FLineStateData& LineStateArr);
+    void UploadDrawData_RT(const TArray<FVector>& Vertices, const TArray<int32>& Indices, FDrawDataRef& OutDrawData);
     void ReleaseResources_RT();
+    void ReleaseUploadResources_RT();
+    void ReleaseCachedResources_RT();
+
+    void GenerateVoxelFeatures_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, const FStencilOp& Op);
+    void GenerateVoxelFeaturesMulti_RT(
+        FRHICommandListImmediate& RHICmdList,
+        const TArray<FMarchingSquaresMap*>& Maps,
+        const TArray<uint32>& FillTypes,
+        const FStencilOp& Op
+        );
+
+    // CPU stencil functions, see MarchingSquaresStencilPolyCPU.cpp
+
+    static void RasterizeStencilCPU(
+        const TArray<FVector>& Vertices,
+        const TArray<int32>& Indices,
+        const FIntRect& Rect,
+        TArray<uint32>& OutStencilData
+        );
 
-    void GenerateVoxelFeatures_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, uint32 FillType);
-    void GenerateVoxelFeatures_RT(FRHICommandListImmediate& RHICmdList, const FGenerateVoxelFeatureParameter& Parameter);
+    static void WriteVoxelDataCPU(
+        FMarchingSquaresCPUVoxelData& VoxelData,
+        const TArray<uint32>& StencilData,
+        const FIntRect& Rect,
+        const FLineGeomData& LineGeomArr,
+        const FLineStateData& LineStateArr,
+        uint32 FillType,
+        const FStencilOp& Op
+        );
+
+    void ApplyStencilPolysCPU(FMarchingSquaresMap& Map, const TArray<FStencilPolyData>& Polys, uint32 FillType, const FStencilOp& Op) const;
+
+    void CacheStencilGeometry_RT(FCachedGeometryData& Geometry);
+    void ApplyCachedStencil_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, const FStencilTransform& Transform, const FStencilOp& Op);
     void ClearStencil_RT(FRHICommandListImmediate& RHICmdList);
 
 public:
 
     void GenerateVoxelFeatures(const FGenerateVoxelFeatureParameter& Parameter);
+    void GenerateVoxelFeatures(const FGenerateVoxelFeatureBatchParameter& Parameter);
+    void GenerateVoxelFeatures(const FGenerateVoxelFeaturePolylineParameter& Parameter);
+    void GenerateVoxelFeatures(const FGenerateVoxelFeatureMultiParameter& Parameter);
     void ClearStencil();
+
+    // Construct counter-clockwise stroke band outline of an open polyline.
+    // Interior points are mitered, joins over the miter limit are beveled.
+    // Returns false if the polyline has less than two distinct points or
+    // no width.
+    static bool BuildPolylineOutline(const FStencilPolylineData& Polyline, FStencilPolyData& OutPoly);
+
+    // Borrow stencil rect sized scratch textures instead of map-sized
+    // textures on subsequent stencil applications
+    FORCEINLINE void SetTileScratchTexture(bool bInTileScratchTexture)
+    {
+        bTileScratchTexture = bInTileScratchTexture;
+    }
+
+    FORCEINLINE bool IsTileScratchTexture() const
+    {
+        return bTileScratchTexture;
+    }
+
+    // CPU implementation of GenerateVoxelFeatures(), writes map CPU voxel
+    // and distance data instead of GPU voxel data and does not require a
+    // render thread. Voxel state and feature words are identical to the
+    // GPU path on the same input, see MarchingSquaresStencilPolyCPU.cpp.
+    void GenerateVoxelFeaturesCPU(const FGenerateVoxelFeatureParameter& Parameter);
+    void GenerateVoxelFeaturesCPU(const FGenerateVoxelFeatureBatchParameter& Parameter);
+
+    // Apply fixture stencil batches through the GPU and CPU paths on
+    // scratch maps and compare voxel state and feature words. Flushes
+    // rendering commands, intended for validation runs only. Returns false
+    // on any mismatch. Also run by the msq.VerifyCPUStencil console command.
+    static bool VerifyCPUStencilFixture();
+
+    // Triangulate and construct stencil line geometry once in local space.
+    // Cached stencil is then applied using only a transform, skipping
+    // triangulation and line geometry construction per application.
+    // Edge radius is scaled along with the stencil geometry.
+    void CacheStencilGeometry(const FStencilPolyData& Poly, float SimplifyTolerance = 0.f);
+    void ApplyCachedStencil(const FApplyCachedStencilParameter& Parameter);
+    void ClearCachedStencil();
+
+    FORCEINLINE bool HasCachedStencil() const
+    {
+        return bHasCachedGeometry;
+    }
+};
+
+UENUM(BlueprintType)
+enum class EMarchingSquaresStencilOp : uint8
+{
+    Union,
+    Subtract,
+    Intersect,
+    Replace
+};
+
+USTRUCT(BlueprintType)
+struct FMarchingSquaresStencilPolyEntry
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    TArray<FVector2D> StencilPoints;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    float StencilEdgeRadius = 1.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    int32 FillType = 1;
+};
+
+UENUM(BlueprintType)
+enum class EMarchingSquaresStencilCap : uint8
+{
+    Butt,
+    Square,
+    Round
+};
+
+USTRUCT(BlueprintType)
+struct FMarchingSquaresStencilPolylineEntry
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    TArray<FVector2D> Points;
+
+    // Per-point stroke width in voxel unit, points without width or with
+    // zero or less width use the default width
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    TArray<float> Widths;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    float Width = 4.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    EMarchingSquaresStencilCap StartCap = EMarchingSquaresStencilCap::Round;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    EMarchingSquaresStencilCap EndCap = EMarchingSquaresStencilCap::Round;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    int32 FillType = 1;
 };
 
 UCLASS()
@@ -115,6 +606,69 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
     float StencilEdgeRadius;
 
+    // Simplify stencil points before triangulation. Points that deviate less
+    // than the tolerance (in voxel unit) from the simplified outline are
+    // removed. Zero or less disables simplification.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings", meta=(ClampMin="0"))
+    float SimplifyTolerance = 0.f;
+
+    // Stencil operation applied by all stencil applications. Subtract and
+    // intersect set removed voxels to OpFillType, replace only writes over
+    // voxels with OpFillType.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    EMarchingSquaresStencilOp StencilOp = EMarchingSquaresStencilOp::Union;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings", meta=(ClampMin="0", ClampMax="255"))
+    int32 OpFillType = 0;
+
+    // Rasterize into stencil rect sized scratch textures instead of
+    // map-sized textures. Reduces scratch memory for stencils that are
+    // small relative to the map.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    bool bUseTileScratchTexture = false;
+
+    FMarchingSquaresStencilPoly::FStencilOp GetStencilOp() const;
+
     void ClearStencil() override;
     void ApplyStencilToMap(UMarchingSquaresMapRef* MapRef, int32 FillType) override;
+
+    // Rasterize all entries in a single pass and write voxel state and
+    // features once. Later entries are drawn over earlier ones.
+    UFUNCTION(BlueprintCallable)
+    void ApplyStencilBatchToMap(UMarchingSquaresMapRef* MapRef, const TArray<FMarchingSquaresStencilPolyEntry>& Entries);
+
+    // Rasterize the stencil once and write voxel data of each map. Maps
+    // must share the same dimension. A single fill type is applied to all
+    // maps, otherwise fill types are matched to maps by index.
+    UFUNCTION(BlueprintCallable)
+    void ApplyStencilToMaps(const TArray<UMarchingSquaresMapRef*>& MapRefs, const TArray<int32>& FillTypes);
+
+    // Stroke open polylines and write only the stroke bands in a single
+    // pass. Uses the stencil edge radius and stencil operation, stroke
+    // widths are expected to be larger than the stencil edge radius.
+    UFUNCTION(BlueprintCallable)
+    void ApplyPolylineStencilToMap(UMarchingSquaresMapRef* MapRef, const TArray<FMarchingSquaresStencilPolylineEntry>& Entries);
+
+    // Apply stencil to the map CPU voxel data without the render thread.
+    // CPU voxel data is initialized on first application and is not
+    // synchronized with the map GPU voxel data.
+    UFUNCTION(BlueprintCallable)
+    void ApplyStencilToMapCPU(UMarchingSquaresMapRef* MapRef, int32 FillType);
+
+    // Cache current stencil points with the specified fill type.
+    // Cached stencil is kept until re-cached or cleared.
+    UFUNCTION(BlueprintCallable)
+    void CacheStencil(int32 FillType);
+
+    UFUNCTION(BlueprintCallable)
+    void ClearCachedStencil();
+
+    UFUNCTION(BlueprintCallable)
+    bool HasCachedStencil() const;
+
+    // Apply cached stencil with the specified transform. Stencil is scaled,
+    // rotated around the local origin then translated in voxel unit.
+    // Scale is clamped to positive values.
+    UFUNCTION(BlueprintCallable)
+    void ApplyCachedStencilToMap(UMarchingSquaresMapRef* MapRef, FVector2D Location, float Rotation = 0.f, FVector2D Scale = FVector2D(1.f, 1.f));
 };
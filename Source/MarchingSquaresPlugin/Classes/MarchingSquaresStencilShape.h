@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI/RULRHIBuffer.h"
+#include "MarchingSquaresStencil.h"
+#include "MarchingSquaresStencilShape.generated.h"
+
+class FMarchingSquaresMap;
+class UMarchingSquaresMapRef;
+
+class FMarchingSquaresStencilShape
+{
+public:
+
+    // Shape types, must match MarchingSquaresStencilShapeCS.usf
+
+    enum EShapeType
+    {
+        SHAPE_TYPE_CIRCLE  = 0,
+        SHAPE_TYPE_CAPSULE = 1,
+        SHAPE_TYPE_RECT    = 2,
+        SHAPE_TYPE_RING    = 3
+    };
+
+    struct FStencilShapeData
+    {
+        EShapeType ShapeType;
+        uint32     FillType;
+
+        // Circle, rect and ring center or capsule start point
+        FVector2D  Location;
+
+        // Capsule end point
+        FVector2D  EndLocation;
+
+        // Rect half extents
+        FVector2D  Extents;
+
+        // Circle, capsule start and ring outer radius
+        float      Radius;
+
+        // Capsule end radius, zero or less uses start radius
+        float      EndRadius;
+
+        // Ring inner radius
+        float      InnerRadius;
+
+        // Rect rotation in degrees
+        float      Rotation;
+    };
+
+    struct FGenerateVoxelFeatureParameter
+    {
+        FMarchingSquaresMap*      Map;
+        TArray<FStencilShapeData> Shapes;
+    };
+
+    // Returns shape bounds, returns false if shape has no area
+    static bool GetShapeBounds(const FStencilShapeData& Shape, FBox2D& OutBounds);
+
+private:
+
+    MS_ALIGN(16) struct FAlignedShapeGeom
+    {
+        FVector4 Geom;
+        FVector4 Params;
+        FVector4 Bounds;
+        uint32   Type;
+        uint32   FillType;
+        uint32   Padding0;
+        uint32   Padding1;
+    } GCC_ALIGN(16);
+
+    typedef TResourceArray<FAlignedShapeGeom, VERTEXBUFFER_ALIGNMENT> FShapeGeomData;
+
+    enum { MIN_UPLOAD_SHAPE_COUNT = 64 };
+
+    // Persistent shape geometry upload buffer, reused across stencil
+    // applications and only grown when an upload exceeds the capacity
+    FRULRWBufferStructured ShapeGeomData;
+    int32                  ShapeGeomCapacity = 0;
+
+    void UploadShapeGeom_RT(const FShapeGeomData& ShapeGeomArr);
+
+    static void GetShapeGeom(const FStencilShapeData& Shape, const FBox2D& Bounds, FAlignedShapeGeom& OutGeom);
+
+    void GenerateVoxelFeatures_RT(
+        FRHICommandListImmediate& RHICmdList,
+        FMarchingSquaresMap& Map,
+        FShapeGeomData& ShapeGeomArr,
+        const FBox2D& Bounds
+        );
+
+    void ClearStencil_RT(FRHICommandListImmediate& RHICmdList);
+
+public:
+
+    void GenerateVoxelFeatures(const FGenerateVoxelFeatureParameter& Parameter);
+    void ClearStencil();
+};
+
+UENUM(BlueprintType)
+enum class EMarchingSquaresStencilShapeType : uint8
+{
+    Circle,
+    Capsule,
+    Rectangle,
+    Ring
+};
+
+USTRUCT(BlueprintType)
+struct FMarchingSquaresStencilShapeEntry
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    EMarchingSquaresStencilShapeType ShapeType = EMarchingSquaresStencilShapeType::Circle;
+
+    // Circle, rectangle and ring center or capsule start point
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    FVector2D Location = FVector2D::ZeroVector;
+
+    // Capsule end point
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    FVector2D EndLocation = FVector2D::ZeroVector;
+
+    // Rectangle half extents
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    FVector2D Extents = FVector2D::UnitVector;
+
+    // Circle, capsule start and ring outer radius
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    float Radius = 1.f;
+
+    // Capsule end radius, zero or less uses start radius
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    float EndRadius = 0.f;
+
+    // Ring inner radius
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    float InnerRadius = 0.f;
+
+    // Rectangle rotation in degrees
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    float Rotation = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    int32 FillType = 1;
+};
+
+UCLASS()
+class UMarchingSquaresStencilShapeRef : public UMarchingSquaresStencilRef
+{
+    GENERATED_BODY()
+
+    FMarchingSquaresStencilShape Stencil;
+
+public:
+
+    // Shape applied by ApplyStencilToMap(), fill type of the entry is
+    // replaced by the fill type specified on application
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stencil Settings")
+    FMarchingSquaresStencilShapeEntry Shape;
+
+    static bool ConvertShapeEntry(const FMarchingSquaresStencilShapeEntry& Entry, FMarchingSquaresStencilShape::FStencilShapeData& OutShape);
+
+    void ClearStencil() override;
+    void ApplyStencilToMap(UMarchingSquaresMapRef* MapRef, int32 FillType) override;
+
+    // Evaluate all entries in a single compute pass over the combined
+    // shape bounds. Later entries are drawn over earlier ones.
+    UFUNCTION(BlueprintCallable)
+    void ApplyStencilBatchToMap(UMarchingSquaresMapRef* MapRef, const TArray<FMarchingSquaresStencilShapeEntry>& Entries);
+};
@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MarchingSquaresStencilShape.h"
+#include "MarchingSquaresStencilStroke.generated.h"
+
+class FMarchingSquaresMap;
+class UMarchingSquaresMapRef;
+
+// Brush stroke stencil. Stroke samples are swept with tapered capsules
+// between consecutive samples and accumulated until flushed. Each flush
+// stamps the pending swept shapes in a single shape stencil dispatch and
+// rebuilds only the map blocks covered by the swept bounds.
+
+class FMarchingSquaresStencilStroke
+{
+public:
+
+    struct FBeginStrokeParameter
+    {
+        FMarchingSquaresMap* Map;
+        uint32               FillType;
+
+        // Fill types rebuilt on each flush, empty to skip rebuild
+        TArray<uint32>       BuildFillTypes;
+        bool                 bGenerateWalls;
+
+        // Minimum sample distance relative to the smaller sample radius,
+        // closer samples are skipped
+        float                SampleSpacing = .25f;
+    };
+
+private:
+
+    typedef FMarchingSquaresStencilShape::FStencilShapeData FShapeData;
+
+    FMarchingSquaresStencilShape ShapeStencil;
+
+    FMarchingSquaresMap* Map = nullptr;
+    uint32               FillType = 0;
+    TArray<uint32>       BuildFillTypes;
+    bool                 bGenerateWalls = false;
+    float                SampleSpacing = .25f;
+
+    bool      bStrokeActive = false;
+    bool      bHasLastSample = false;
+    FVector2D LastSampleLocation;
+    float     LastSampleRadius = 0.f;
+
+    TArray<FShapeData> PendingShapes;
+    FBox2D             PendingBounds;
+
+    void AddPendingShape(const FShapeData& Shape);
+
+public:
+
+    void BeginStroke(const FBeginStrokeParameter& Parameter);
+    void AddSample(const FVector2D& Location, float Radius);
+    void FlushStroke();
+    void EndStroke();
+    void ClearStencil();
+
+    FORCEINLINE bool IsStrokeActive() const
+    {
+        return bStrokeActive;
+    }
+
+    FORCEINLINE bool HasPendingSamples() const
+    {
+        return PendingShapes.Num() > 0;
+    }
+};
+
+UCLASS(BlueprintType, Blueprintable)
+class UMarchingSquaresStencilStrokeRef : public UObject
+{
+    GENERATED_BODY()
+
+    FMarchingSquaresStencilStroke Stencil;
+
+    UPROPERTY()
+    UMarchingSquaresMapRef* StrokeMapRef;
+
+public:
+
+    // Minimum sample distance relative to the smaller sample radius
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stroke Settings", meta=(ClampMin="0"))
+    float SampleSpacing = .25f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Stroke Settings")
+    bool bGenerateWalls = false;
+
+    // Begin stroke on the map. Fill types in build fill types are
+    // rebuilt over the stamped area on each flush.
+    UFUNCTION(BlueprintCallable)
+    void BeginStroke(UMarchingSquaresMapRef* MapRef, int32 FillType, const TArray<int32>& BuildFillTypes);
+
+    // Add stroke sample in voxel unit. Samples are stamped on flush.
+    UFUNCTION(BlueprintCallable)
+    void AddStrokeSample(FVector2D Location, float Radius);
+
+    // Stamp pending samples and rebuild affected blocks, expected to be
+    // called once per frame while the stroke is active
+    UFUNCTION(BlueprintCallable)
+    void FlushStroke();
+
+    // Flush pending samples and end stroke
+    UFUNCTION(BlueprintCallable)
+    void EndStroke();
+
+    UFUNCTION(BlueprintCallable)
+    bool IsStrokeActive() const;
+
+    UFUNCTION(BlueprintCallable)
+    void ClearStencil();
+};
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHIResources.h"
+
+// Stencil scratch texture with its shader resource and unordered access views
+
+struct FMarchingSquaresStencilTexture
+{
+    FTexture2DRHIRef           Texture;
+    FUnorderedAccessViewRHIRef UAV;
+    FShaderResourceViewRHIRef  SRV;
+    FIntPoint                  Size   = FIntPoint::ZeroValue;
+    EPixelFormat               Format = PF_Unknown;
+
+    FORCEINLINE bool IsValid() const
+    {
+        return IsValidRef(Texture) && IsValidRef(UAV) && IsValidRef(SRV);
+    }
+
+    void Release();
+};
+
+// Render thread pool of stencil scratch textures shared by all stencil
+// instances. Textures are keyed by size and format, stencils borrow a
+// texture for the duration of a single stencil application and return it
+// afterwards. Idle textures are kept up to MAX_FREE_TEXTURE_COUNT.
+
+class FMarchingSquaresStencilTexturePool
+{
+public:
+
+    enum { MAX_FREE_TEXTURE_COUNT = 4 };
+
+    // Tile scratch texture dimension granularity, stencil rects of similar
+    // sizes share the same texture size
+    enum { TILE_SIZE_GRANULARITY = 64 };
+
+    static FMarchingSquaresStencilTexturePool& Get();
+
+    // Returns tile scratch texture size that fits the specified rect size
+    static FIntPoint GetTileScratchSize(const FIntPoint& RectSize);
+
+    // Borrow texture of the specified size and format, reuses an idle
+    // texture if available or creates a new one otherwise
+    void Borrow_RT(const FIntPoint& Size, EPixelFormat Format, FMarchingSquaresStencilTexture& OutTexture);
+
+    // Return borrowed texture to the pool, texture is reset on return
+    void Return_RT(FMarchingSquaresStencilTexture& Texture);
+
+    void ReleaseResources_RT();
+    void ReleaseResources();
+
+    FORCEINLINE int32 GetFreeTextureCount_RT() const
+    {
+        return FreeTextures.Num();
+    }
+
+private:
+
+    // Idle textures, ordered from least to most recently returned
+    TArray<FMarchingSquaresStencilTexture> FreeTextures;
+};
@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/ScopeRWLock.h"
+
+class FMarchingSquaresVoxelMirror;
+
+// Voxel connected components
+//
+// Labels connected regions of voxels with equal fill type from voxel mirror
+// data. Voxels are connected to edge neighbors of the same fill type and to
+// diagonal neighbors across saddle cells with the center resolved to their
+// fill type, matching the connectivity of the built surface.
+//
+// Voxels are labeled per mirror block and block labels are merged across
+// block borders with union-find. Only blocks written since the previous
+// update are relabeled, the merge is evaluated on each update.
+
+class FMarchingSquaresVoxelComponents
+{
+public:
+
+    struct FComponent
+    {
+        int32 FillType = 0;
+        int32 VoxelCount = 0;
+
+        // Voxel bounds, max exclusive
+        FIntRect Bounds;
+    };
+
+private:
+
+    struct FBlockLabels
+    {
+        FIntRect VoxelRect;
+
+        // Block voxel states and local voxel labels, row major
+        TArray<uint32> States;
+        TArray<uint16> Labels;
+
+        // Local label data
+        TArray<uint8>    LabelFillTypes;
+        TArray<int32>    LabelSizes;
+        TArray<FIntRect> LabelBounds;
+
+        // Component id of each local label, assigned on merge
+        TArray<int32>    LabelComponents;
+    };
+
+    // Label data, guarded by the label lock
+
+    mutable FRWLock LabelLock;
+
+    FIntPoint  Dimension = FIntPoint::ZeroValue;
+    FIntPoint  BlockCount = FIntPoint::ZeroValue;
+    uint32     MirrorRevision = 0;
+
+    TArray<FBlockLabels> Blocks;
+    TArray<FComponent>   Components;
+
+    // Async update state
+
+    FGraphEventRef UpdateTask;
+    FThreadSafeBool bUpdating;
+
+    static void LabelBlock(FBlockLabels& Block);
+
+    // Merge block labels into components, caller must hold the write lock
+    void MergeBlocks();
+
+    int32 GetComponentIdUnlocked(const FIntPoint& Voxel) const;
+
+public:
+
+    ~FMarchingSquaresVoxelComponents();
+
+    // Relabel blocks written since the previous update and merge labels
+    void Update(const FMarchingSquaresVoxelMirror& Mirror);
+
+    // Update components on a background task. Completion callback is called
+    // from the background task. Returns false if an update is in progress.
+    bool UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, TFunction<void()> OnComplete);
+
+    FORCEINLINE bool IsUpdating() const
+    {
+        return bUpdating;
+    }
+
+    void Reset();
+
+    // QUERY FUNCTIONS
+
+    int32 GetComponentCount() const;
+
+    bool GetComponent(int32 ComponentId, FComponent& OutComponent) const;
+
+    TArray<FComponent> GetComponents() const;
+
+    // Returns component id of the voxel, -1 if the voxel is not labeled
+    int32 GetComponentId(const FIntPoint& Voxel) const;
+
+    // Returns component id of the fill type region containing the point,
+    // -1 if the point is not within the fill type surface. Point fill
+    // state is evaluated from current mirror data.
+    int32 GetComponentId(const FMarchingSquaresVoxelMirror& Mirror, const FVector2D& Point, uint8 FillType) const;
+};
@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHIResources.h"
+#include "MarchingSquaresVoxelImport.generated.h"
+
+class FMarchingSquaresMap;
+
+UENUM(BlueprintType)
+enum class EMarchingSquaresImportChannel : uint8
+{
+    Red,
+    Green,
+    Blue,
+    Alpha
+};
+
+// Bulk voxel import
+//
+// Writes voxel state and feature data of a voxel rect from a fill type
+// image in a single pass. Each texel holds the fill type of a single voxel.
+// Optional edge image holds anti-aliased coverage of non-zero fill types,
+// used to place edge crossings and normals on the 0.5 coverage iso line.
+// Without edge image, edge crossings are placed on voxel edge midpoints.
+// Voxel distance within range of the import rect is regenerated from the
+// imported edge crossings, CPU import rejects maps with distance layers.
+
+class FMarchingSquaresVoxelImport
+{
+public:
+
+    struct FImportParameter
+    {
+        FMarchingSquaresMap* Map;
+
+        // Voxel location of image texel (0, 0)
+        FIntPoint Offset;
+
+        EMarchingSquaresImportChannel FillTypeChannel;
+        EMarchingSquaresImportChannel EdgeChannel;
+    };
+
+    // CPU image, edge data is optional and must either be empty or match
+    // fill type data size
+
+    struct FImportImage
+    {
+        FIntPoint     Size = FIntPoint::ZeroValue;
+        TArray<uint8> FillTypeData;
+        TArray<uint8> EdgeData;
+
+        FORCEINLINE int32 GetTexelCount() const
+        {
+            return Size.X * Size.Y;
+        }
+
+        FORCEINLINE bool IsValid() const
+        {
+            return GetTexelCount() > 0 && FillTypeData.Num() == GetTexelCount();
+        }
+
+        FORCEINLINE bool HasEdgeData() const
+        {
+            return EdgeData.Num() == GetTexelCount();
+        }
+    };
+
+    // Returns image rect clipped to the map dimension
+    static FIntRect GetImportRect(const FIntPoint& Dimension, const FIntPoint& Offset, const FIntPoint& ImageSize);
+
+    static void ImportTexture_RT(
+        FRHICommandListImmediate& RHICmdList,
+        const FImportParameter& Parameter,
+        FTexture2DRHIParamRef FillTypeTexture,
+        FTexture2DRHIParamRef EdgeTexture
+        );
+
+    static void ImportImage_RT(
+        FRHICommandListImmediate& RHICmdList,
+        const FImportParameter& Parameter,
+        const FImportImage& Image
+        );
+
+    // Upload image to a transient texture and import on the render thread
+    static void ImportImage(const FImportParameter& Parameter, const FImportImage& Image);
+
+    // Import to map CPU voxel data, voxel rows are written in parallel.
+    // Aborts if the map has distance layers.
+    static void ImportImageCPU(const FImportParameter& Parameter, const FImportImage& Image);
+
+private:
+
+    static void ImportTextureSRV_RT(
+        FRHICommandListImmediate& RHICmdList,
+        FMarchingSquaresMap& Map,
+        const FIntPoint& Offset,
+        const FIntPoint& ImageSize,
+        const FVector4& FillTypeMask,
+        const FVector4& EdgeMask,
+        FShaderResourceViewRHIParamRef FillTypeSRV,
+        FShaderResourceViewRHIParamRef EdgeSRV
+        );
+
+    static FVector4 GetChannelMask(EMarchingSquaresImportChannel Channel);
+};
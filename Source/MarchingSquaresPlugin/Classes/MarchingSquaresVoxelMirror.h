@@ -0,0 +1,327 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/BitArray.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopeRWLock.h"
+#include "RHIGPUReadback.h"
+#include "RHI/RULRHIBuffer.h"
+
+struct FMarchingSquaresCPUVoxelData;
+
+// CPU voxel mirror
+//
+// CPU copy of map voxel state, feature and distance data used to answer
+// gameplay queries without render thread synchronization. GPU voxel edits
+// mark mirror blocks (BLOCK_SIZE x BLOCK_SIZE voxels) dirty, dirty blocks are
+// copied to a compact buffer, copied again to a staging buffer and only
+// resolved once the readback fence has been reached. CPU voxel writers
+// copy written voxels directly, pending readbacks of blocks written by
+// a CPU copy after the blocks were marked dirty are discarded.
+//
+// Mirror data lags GPU voxel data by at least one readback. Queries are
+// safe to call from any thread and use the same edge crossing
+// interpolation as the map triangulation, fill types with a distance layer
+// place crossings and resolve saddles from the mirrored distance data.
+// Positions are in voxel unit.
+
+class FMarchingSquaresVoxelMirror
+{
+public:
+
+    // Must match MarchingSquaresVoxelMirrorCS.usf
+    enum { BLOCK_SIZE = 32 };
+
+    // Maximum number of blocks copied per readback
+    enum { MAX_READBACK_BLOCK_COUNT = 64 };
+
+    // Cell corner fill state and edge crossings of a single fill type
+    struct FCellGeometry
+    {
+        // Corner fill flags, same bit order as the build case code:
+        // (x, y), (x+1, y), (x, y+1), (x+1, y+1)
+        uint32 CaseCode;
+
+        // Saddle case resolution, see CellWriteCaseKernel
+        bool bFilledCenter;
+
+        // Cell local edge crossing points: bottom, top, left, right
+        FVector2D Crossings[4];
+
+        FORCEINLINE bool IsCornerFilled(int32 Corner) const
+        {
+            return (CaseCode >> Corner) & 1;
+        }
+    };
+
+    // Cell segment end point features
+    //
+    // 0-3: Edge crossings (bottom, top, left, right)
+    // 4-7: Corners in build case code order
+
+    enum ECellFeature
+    {
+        CELL_FEATURE_EDGE_BOTTOM = 0,
+        CELL_FEATURE_EDGE_TOP    = 1,
+        CELL_FEATURE_EDGE_LEFT   = 2,
+        CELL_FEATURE_EDGE_RIGHT  = 3,
+        CELL_FEATURE_CORNER      = 4
+    };
+
+    // Cell side flags, same order as the edge crossings
+
+    enum ECellSide
+    {
+        CELL_SIDE_BOTTOM = 1 << 0,
+        CELL_SIDE_TOP    = 1 << 1,
+        CELL_SIDE_LEFT   = 1 << 2,
+        CELL_SIDE_RIGHT  = 1 << 3
+    };
+
+    // Cell boundary segment, filled side on the left
+    struct FCellSegment
+    {
+        FVector2D P0;
+        FVector2D P1;
+        int32     Feature0;
+        int32     Feature1;
+    };
+
+    struct FRaycastResult
+    {
+        FVector2D Location;
+
+        // Boundary normal pointing away from the filled side
+        FVector2D Normal;
+
+        // Hit time along the ray segment [0, 1]
+        float Time;
+    };
+
+private:
+
+    // Mirror data, guarded by the data lock
+
+    mutable FRWLock DataLock;
+    FIntPoint       Dimension = FIntPoint::ZeroValue;
+    TArray<uint32>  VoxelStateData;
+    TArray<uint32>  VoxelFeatureData;
+
+    // Voxel distance data, same layout and encoding as the map voxel
+    // distance data. Empty if the map has no distance layers.
+    int32           DistanceLayerCount = 0;
+    float           DistanceRange = 1.f;
+    TArray<uint32>  VoxelDistanceData;
+
+    // Data revision, incremented on each data write. Block revisions hold
+    // the data revision of the last write to each block, CPU block
+    // revisions hold the data revision of the last CPU voxel data copy.
+    uint32          Revision = 0;
+    FIntPoint       BlockCount = FIntPoint::ZeroValue;
+    TArray<uint32>  BlockRevisions;
+    TArray<uint32>  CPUBlockRevisions;
+
+    // Render thread readback state
+
+    bool       bEnabled_RT = false;
+    FIntPoint  Dimension_RT = FIntPoint::ZeroValue;
+    FIntPoint  BlockCount_RT = FIntPoint::ZeroValue;
+    int32      DistanceLayerCount_RT = 0;
+    float      DistanceRange_RT = 1.f;
+    TBitArray<> DirtyBlocks_RT;
+    int32      DirtyBlockCount_RT = 0;
+
+    // Data revision at the time each block was last marked dirty
+    TArray<uint32> DirtyRevisions_RT;
+
+    FRULRWBuffer      ReadbackData;
+    FRULRWBuffer      ReadbackBlockData;
+    TUniquePtr<FRHIGPUBufferReadback> Readback;
+    TArray<FIntPoint> ReadbackBlocks;
+    TArray<uint32>    ReadbackRevisions;
+
+    // Number of dirty and in-flight blocks, visible to all threads
+    FThreadSafeCounter PendingBlockCount;
+
+    FORCEINLINE int32 GetVoxelIndex(int32 X, int32 Y) const
+    {
+        return X + Y * Dimension.X;
+    }
+
+    FORCEINLINE int32 GetDistanceIndex(int32 X, int32 Y, int32 Layer) const
+    {
+        const int32 PairStride = (Dimension.X+1) / 2;
+        return (X/2) + Y*PairStride + Layer*(PairStride*Dimension.Y);
+    }
+
+    // Readback block size in uint32, interleaved voxel state and feature
+    // followed by distance pairs of each distance layer
+    FORCEINLINE static int32 GetReadbackBlockStride(int32 InDistanceLayerCount)
+    {
+        return BLOCK_SIZE*BLOCK_SIZE*2 + InDistanceLayerCount*(BLOCK_SIZE*BLOCK_SIZE/2);
+    }
+
+    void ResetData(const FIntPoint& InDimension, int32 InDistanceLayerCount, float InDistanceRange);
+
+    // Reset block revisions to the current data revision, caller must
+    // hold the data write lock
+    void ResetBlockRevisions();
+
+    // Mark blocks overlapping the voxel rect as written, caller must hold
+    // the data write lock
+    void MarkBlockRevisions(const FIntRect& VoxelRect);
+
+    // Returns true if the block has been written by a CPU voxel data copy
+    // after the dirty revision, caller must hold the data lock
+    FORCEINLINE bool IsCPUWrittenAfter(int32 BlockIndex, uint32 DirtyRevision) const
+    {
+        return CPUBlockRevisions.IsValidIndex(BlockIndex) && CPUBlockRevisions[BlockIndex] > DirtyRevision;
+    }
+
+    void StartReadback_RT(FRHICommandListImmediate& RHICmdList, FRULRWBuffer& SrcStateData, FRULRWBuffer& SrcFeatureData, FRULRWBuffer& SrcDistanceData);
+    void ResolveReadback_RT();
+    void UpdatePendingCount_RT();
+
+    // Unlocked query functions, caller must hold the data lock
+
+    float GetVoxelDistanceUnlocked(int32 X, int32 Y, int32 Layer) const;
+    bool GetCellGeometryUnlocked(const FIntPoint& Cell, uint8 FillType, FCellGeometry& OutGeometry) const;
+    float GetCellCoverageUnlocked(const FIntPoint& Cell, uint8 FillType, const FBox2D& LocalRect) const;
+
+public:
+
+    // Readback resolve event, called from the render thread with the
+    // blocks whose mirror data was written by the resolved readback
+    DECLARE_EVENT_OneParam(FMarchingSquaresVoxelMirror, FReadbackResolved, const TArray<FIntPoint>&);
+
+    FORCEINLINE FReadbackResolved& OnReadbackResolved()
+    {
+        return ReadbackResolvedEvent;
+    }
+
+private:
+
+    FReadbackResolved ReadbackResolvedEvent;
+
+public:
+
+    // RENDER THREAD FUNCTIONS
+
+    // Configure mirror, resets mirror data and marks all blocks dirty if
+    // the mirror is enabled or the dimension or distance layout has changed
+    void Configure_RT(const FIntPoint& InDimension, int32 InDistanceLayerCount, float InDistanceRange, bool bInEnabled);
+
+    FORCEINLINE bool IsEnabled_RT() const
+    {
+        return bEnabled_RT;
+    }
+
+    void MarkDirty_RT(const FIntRect& VoxelRect);
+
+    // Resolve readback once its fence has been reached and start a
+    // readback of the next dirty blocks. Only a single readback is in
+    // flight at any time, the call never waits for the GPU.
+    void Update_RT(FRHICommandListImmediate& RHICmdList, FRULRWBuffer& SrcStateData, FRULRWBuffer& SrcFeatureData, FRULRWBuffer& SrcDistanceData);
+
+    void Release_RT();
+
+    // CPU VOXEL DATA FUNCTIONS
+
+    // Copy voxel rect of CPU voxel data, max exclusive. Dirty and
+    // in-flight readbacks of the written blocks are discarded.
+    void CopyVoxelData(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& VoxelRect);
+
+    // QUERY FUNCTIONS
+
+    bool IsValid() const;
+    FIntPoint GetDimension() const;
+
+    // Returns true if there are no dirty or in-flight blocks
+    FORCEINLINE bool IsSynced() const
+    {
+        return PendingBlockCount.GetValue() == 0;
+    }
+
+    // Returns current data revision, incremented on each mirror write
+    uint32 GetRevision() const;
+
+    // Returns current data revision, block revisions and mirror block
+    // count as a single snapshot
+    uint32 GetBlockRevisions(TArray<uint32>& OutBlockRevisions, FIntPoint& OutBlockCount) const;
+
+    // Copy voxel states within the voxel rect, row major. Returns false if
+    // the rect is not within the mirror dimension.
+    bool CopyVoxelStates(const FIntRect& VoxelRect, TArray<uint32>& OutStates) const;
+
+    // Invoke visitor with cell geometry of each distinct corner fill type
+    // of each cell within the cell rect. Cells are visited under a single
+    // read lock, visitor must not call other mirror functions.
+    void VisitCellGeometry(
+        const FIntRect& CellRect,
+        TFunctionRef<void(const FIntPoint& Cell, uint8 FillType, const FCellGeometry& Geometry)> Visitor
+        ) const;
+
+    // Invoke visitor with cell geometry of the fill type for cells within
+    // the cell rect with at least a single corner of the fill type
+    void VisitCellGeometry(
+        const FIntRect& CellRect,
+        uint8 FillType,
+        TFunctionRef<void(const FIntPoint& Cell, const FCellGeometry& Geometry)> Visitor
+        ) const;
+
+    // Returns voxel fill type, -1 if the voxel is outside the map
+    int32 GetVoxelFillType(const FIntPoint& Voxel) const;
+
+    bool GetCellGeometry(const FIntPoint& Cell, uint8 FillType, FCellGeometry& OutGeometry) const;
+
+    bool IsPointFilled(const FVector2D& Point, uint8 FillType) const;
+
+    // Find the first fill type boundary crossed by the ray segment
+    bool Raycast(const FVector2D& Start, const FVector2D& End, uint8 FillType, FRaycastResult& OutResult) const;
+
+    // Returns exact filled area fraction of the rect, area outside the map
+    // is considered empty
+    float GetFillFraction(const FBox2D& Rect, uint8 FillType) const;
+
+    // CELL GEOMETRY UTILITY
+
+    // Returns number of cell boundary segments, at most two
+    static int32 GetCellSegments(const FCellGeometry& Geometry, FCellSegment OutSegments[2]);
+
+    // Returns number of filled area outline segments lying on the cell
+    // sides specified by the side mask (ECellSide), at most four
+    static int32 GetCellSideSegments(const FCellGeometry& Geometry, uint32 SideMask, FCellSegment OutSegments[4]);
+
+    static bool IsCellPointFilled(const FCellGeometry& Geometry, const FVector2D& LocalPoint);
+
+    // Returns cell filled area in [0, 1]
+    static float GetCellFilledArea(const FCellGeometry& Geometry);
+};
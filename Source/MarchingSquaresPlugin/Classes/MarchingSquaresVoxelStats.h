@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/ScopeRWLock.h"
+
+class FMarchingSquaresVoxelMirror;
+
+// Voxel statistics
+//
+// Per fill type filled area and boundary length of the marching squares
+// surface evaluated from voxel mirror data, using the same edge crossings
+// and saddle resolution as the map build. Statistics are kept per mirror
+// block and only blocks with cells affected by mirror writes since the
+// previous update are evaluated. Area and length are in voxel unit,
+// boundary length excludes the map border.
+
+class FMarchingSquaresVoxelStats
+{
+public:
+
+    struct FFillTypeStats
+    {
+        int32 FillType = 0;
+        float Area = 0.f;
+        float Perimeter = 0.f;
+    };
+
+    struct FBlockStats
+    {
+        // Block cell rect, max exclusive
+        FIntRect CellRect;
+
+        // Statistics of fill types present in the block, sorted by fill type
+        TArray<FFillTypeStats> FillTypes;
+
+        const FFillTypeStats* FindFillType(int32 FillType) const;
+    };
+
+private:
+
+    // Statistics data, guarded by the stats lock
+
+    mutable FRWLock StatsLock;
+
+    FIntPoint   BlockCount = FIntPoint::ZeroValue;
+    uint32      MirrorRevision = 0;
+    float       TotalCellArea = 0.f;
+
+    TArray<FBlockStats>    Blocks;
+    TArray<FFillTypeStats> Totals;
+
+    // Async update state
+
+    FGraphEventRef UpdateTask;
+    FThreadSafeBool bUpdating;
+
+    static void EvaluateBlock(const FMarchingSquaresVoxelMirror& Mirror, FBlockStats& Block);
+
+public:
+
+    ~FMarchingSquaresVoxelStats();
+
+    // Evaluate statistics of blocks updated since the previous update
+    void Update(const FMarchingSquaresVoxelMirror& Mirror);
+
+    // Update statistics on a background task. Completion callback is called
+    // from the background task. Returns false if an update is in progress.
+    bool UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, TFunction<void()> OnComplete);
+
+    FORCEINLINE bool IsUpdating() const
+    {
+        return bUpdating;
+    }
+
+    void Reset();
+
+    // QUERY FUNCTIONS
+
+    FFillTypeStats GetTotalStats(int32 FillType) const;
+
+    // Returns filled area fraction of the map
+    float GetCoverage(int32 FillType) const;
+
+    TArray<FFillTypeStats> GetTotalStats() const;
+
+    FIntPoint GetBlockCount() const;
+
+    bool GetBlockStats(const FIntPoint& Block, FBlockStats& OutStats) const;
+};
@@ -0,0 +1,645 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresCollision.h"
+
+#include "Async/ParallelFor.h"
+#include "PhysicsEngine/AggregateGeom.h"
+#include "EarcutTypes.h"
+
+#include "MarchingSquaresContour.h"
+#include "MarchingSquaresGeometryUtils.h"
+#include "MarchingSquaresVoxelMirror.h"
+
+namespace MarchingSquaresCollisionUtils
+{
+    // Minimum simplification tolerance, removes collinear contour points of
+    // straight cell edges and rect borders
+    static const float MIN_SIMPLIFY_TOLERANCE = .01f;
+
+    // Minimum polygon area in squared voxel unit
+    static const float MIN_POLYGON_AREA = .0001f;
+
+    static const float CONVEX_TOLERANCE = .0001f;
+
+    FORCEINLINE float GetTurn(const FVector2D& A, const FVector2D& B, const FVector2D& C)
+    {
+        return FVector2D::CrossProduct(B-A, C-B);
+    }
+
+    FORCEINLINE uint64 GetEdgeKey(int32 A, int32 B)
+    {
+        return (uint64(uint32(A)) << 32) | uint64(uint32(B));
+    }
+
+    float GetSignedArea(const TArray<FVector2D>& Points)
+    {
+        const int32 PointCount = Points.Num();
+        float Area = 0.f;
+
+        for (int32 i=0, j=PointCount-1; i<PointCount; j=i++)
+        {
+            Area += FVector2D::CrossProduct(Points[j], Points[i]);
+        }
+
+        return Area * .5f;
+    }
+
+    bool IsConvex(const TArray<FVector2D>& Points, const TArray<int32>& Indices)
+    {
+        const int32 IndexCount = Indices.Num();
+
+        for (int32 i=0; i<IndexCount; ++i)
+        {
+            const FVector2D& A(Points[Indices[(i+IndexCount-1) % IndexCount]]);
+            const FVector2D& B(Points[Indices[i]]);
+            const FVector2D& C(Points[Indices[(i+1) % IndexCount]]);
+
+            if (GetTurn(A, B, C) < -CONVEX_TOLERANCE)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Hertel-Mehlhorn merge of counter-clockwise triangles into convex
+    // polygons, adjacent polygons are merged across shared edges while the
+    // result stays convex and within the point count limit
+
+    void MergeTriangles(
+        const TArray<FVector2D>& Points,
+        const TArray<int32>& TriangleIndices,
+        int32 MaxPointCount,
+        TArray<TArray<int32>>& OutPolygons
+        )
+    {
+        TArray<TArray<int32>>& Polygons(OutPolygons);
+        TMap<uint64, int32> EdgePolygons;
+
+        const int32 TriangleCount = TriangleIndices.Num() / 3;
+
+        Polygons.Reset(TriangleCount);
+        EdgePolygons.Reserve(TriangleCount * 3);
+
+        for (int32 ti=0; ti<TriangleCount; ++ti)
+        {
+            int32 A = TriangleIndices[ti*3  ];
+            int32 B = TriangleIndices[ti*3+1];
+            int32 C = TriangleIndices[ti*3+2];
+
+            const float Turn = GetTurn(Points[A], Points[B], Points[C]);
+
+            // Skip degenerate triangles
+
+            if (FMath::Abs(Turn) < CONVEX_TOLERANCE)
+            {
+                continue;
+            }
+
+            if (Turn < 0.f)
+            {
+                Swap(B, C);
+            }
+
+            const int32 PolygonIndex = Polygons.Num();
+            TArray<int32>& Polygon(Polygons[Polygons.AddDefaulted()]);
+            Polygon.Emplace(A);
+            Polygon.Emplace(B);
+            Polygon.Emplace(C);
+
+            EdgePolygons.Add(GetEdgeKey(A, B), PolygonIndex);
+            EdgePolygons.Add(GetEdgeKey(B, C), PolygonIndex);
+            EdgePolygons.Add(GetEdgeKey(C, A), PolygonIndex);
+        }
+
+        for (int32 i=0; i<Polygons.Num(); ++i)
+        {
+            bool bMerged = Polygons[i].Num() > 0;
+
+            while (bMerged)
+            {
+                bMerged = false;
+
+                TArray<int32>& Polygon(Polygons[i]);
+                const int32 PointCount = Polygon.Num();
+
+                for (int32 e=0; e<PointCount; ++e)
+                {
+                    const int32 A = Polygon[e];
+                    const int32 B = Polygon[(e+1) % PointCount];
+
+                    const int32* OtherIndexPtr = EdgePolygons.Find(GetEdgeKey(B, A));
+
+                    if (! OtherIndexPtr || *OtherIndexPtr == i)
+                    {
+                        continue;
+                    }
+
+                    TArray<int32>& Other(Polygons[*OtherIndexPtr]);
+                    const int32 OtherPointCount = Other.Num();
+
+                    if ((PointCount + OtherPointCount - 2) > MaxPointCount)
+                    {
+                        continue;
+                    }
+
+                    // Merged polygon walks this polygon from B to A then the
+                    // other polygon from the point after A to the point
+                    // before B
+
+                    const int32 OtherEdge = Other.Find(B);
+                    check(OtherEdge != INDEX_NONE);
+
+                    TArray<int32> Merged;
+                    Merged.Reserve(PointCount + OtherPointCount - 2);
+
+                    for (int32 k=0; k<PointCount; ++k)
+                    {
+                        Merged.Emplace(Polygon[(e+1+k) % PointCount]);
+                    }
+
+                    for (int32 k=2; k<OtherPointCount; ++k)
+                    {
+                        Merged.Emplace(Other[(OtherEdge+k) % OtherPointCount]);
+                    }
+
+                    if (! IsConvex(Points, Merged))
+                    {
+                        continue;
+                    }
+
+                    for (int32 k=0; k<PointCount; ++k)
+                    {
+                        EdgePolygons.Remove(GetEdgeKey(Polygon[k], Polygon[(k+1) % PointCount]));
+                    }
+
+                    for (int32 k=0; k<OtherPointCount; ++k)
+                    {
+                        EdgePolygons.Remove(GetEdgeKey(Other[k], Other[(k+1) % OtherPointCount]));
+                    }
+
+                    for (int32 k=0; k<Merged.Num(); ++k)
+                    {
+                        EdgePolygons.Add(GetEdgeKey(Merged[k], Merged[(k+1) % Merged.Num()]), i);
+                    }
+
+                    Polygon = MoveTemp(Merged);
+                    Other.Reset();
+
+                    bMerged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    void AddPolygon(TArray<FMarchingSquaresCollision::FConvexPolygon>& OutPolygons, const TArray<FVector2D>& Points, const TArray<int32>& Indices)
+    {
+        const int32 IndexCount = Indices.Num();
+
+        FMarchingSquaresCollision::FConvexPolygon Polygon;
+        Polygon.Points.Reserve(IndexCount);
+
+        // Skip collinear points left by merged triangles
+
+        for (int32 i=0; i<IndexCount; ++i)
+        {
+            const FVector2D& A(Points[Indices[(i+IndexCount-1) % IndexCount]]);
+            const FVector2D& B(Points[Indices[i]]);
+            const FVector2D& C(Points[Indices[(i+1) % IndexCount]]);
+
+            if (GetTurn(A, B, C) > CONVEX_TOLERANCE)
+            {
+                Polygon.Points.Emplace(B);
+            }
+        }
+
+        if (Polygon.Points.Num() >= 3 && GetSignedArea(Polygon.Points) > MIN_POLYGON_AREA)
+        {
+            OutPolygons.Emplace(MoveTemp(Polygon));
+        }
+    }
+}
+
+bool FMarchingSquaresCollision::FCookParameter::operator==(const FCookParameter& Other) const
+{
+    return FillType             == Other.FillType
+        && BlockSize            == Other.BlockSize
+        && BlockCount           == Other.BlockCount
+        && SimplifyTolerance    == Other.SimplifyTolerance
+        && MaxPolygonPointCount == Other.MaxPolygonPointCount;
+}
+
+FMarchingSquaresCollision::~FMarchingSquaresCollision()
+{
+    // Wait for in-flight cook, the task references this object
+
+    if (UpdateTask.IsValid() && ! UpdateTask->IsComplete())
+    {
+        FTaskGraphInterface::Get().WaitUntilTaskCompletes(UpdateTask);
+    }
+}
+
+void FMarchingSquaresCollision::CookBlock(
+    const FMarchingSquaresVoxelMirror& Mirror,
+    const FCookParameter& CookParameter,
+    const FIntRect& CellRect,
+    TArray<FConvexPolygon>& OutPolygons
+    )
+{
+    using namespace MarchingSquaresCollisionUtils;
+
+    if (CellRect.Area() <= 0)
+    {
+        return;
+    }
+
+    // Trace fill type regions clipped to the cell rect as closed loops
+
+    FMarchingSquaresContour::FExtractParameter ExtractParameter;
+    ExtractParameter.FillType = CookParameter.FillType;
+    ExtractParameter.CellRect = CellRect;
+    ExtractParameter.bCloseAtRectBorder = true;
+
+    TArray<FMarchingSquaresContour::FContourPolyline> Loops;
+    FMarchingSquaresContour::ExtractContours(Mirror, ExtractParameter, Loops);
+
+    // Hole loops are clockwise and never touch the rect bounds. Split the
+    // rect along the longer axis until each part is hole free, single cells
+    // never contain holes.
+
+    bool bHasHole = false;
+
+    for (const FMarchingSquaresContour::FContourPolyline& Loop : Loops)
+    {
+        if (Loop.bClosed && GetSignedArea(Loop.Points) < 0.f)
+        {
+            bHasHole = true;
+            break;
+        }
+    }
+
+    if (bHasHole && (CellRect.Width() > 1 || CellRect.Height() > 1))
+    {
+        FIntRect RectA(CellRect);
+        FIntRect RectB(CellRect);
+
+        if (CellRect.Width() >= CellRect.Height())
+        {
+            RectA.Max.X = RectB.Min.X = CellRect.Min.X + CellRect.Width()/2;
+        }
+        else
+        {
+            RectA.Max.Y = RectB.Min.Y = CellRect.Min.Y + CellRect.Height()/2;
+        }
+
+        CookBlock(Mirror, CookParameter, RectA, OutPolygons);
+        CookBlock(Mirror, CookParameter, RectB, OutPolygons);
+        return;
+    }
+
+    for (const FMarchingSquaresContour::FContourPolyline& Loop : Loops)
+    {
+        if (Loop.bClosed)
+        {
+            DecomposeLoop(Loop.Points, CookParameter, OutPolygons);
+        }
+    }
+}
+
+void FMarchingSquaresCollision::DecomposeLoop(
+    const TArray<FVector2D>& LoopPoints,
+    const FCookParameter& CookParameter,
+    TArray<FConvexPolygon>& OutPolygons
+    )
+{
+    using namespace MarchingSquaresCollisionUtils;
+
+    const int32 MaxPointCount = FMath::Max(3, CookParameter.MaxPolygonPointCount);
+
+    TArray<FVector2D> Points;
+
+    const bool bSimplified = FMarchingSquaresGeometryUtils::SimplifyPolyline(
+        LoopPoints,
+        Points,
+        FMath::Max(CookParameter.SimplifyTolerance, MIN_SIMPLIFY_TOLERANCE),
+        true
+        );
+
+    if (! bSimplified)
+    {
+        Points = LoopPoints;
+    }
+
+    if (Points.Num() < 3 || GetSignedArea(Points) <= MIN_POLYGON_AREA)
+    {
+        return;
+    }
+
+    TArray<int32> Indices;
+
+    // Convex loop within the point count limit, use as is
+
+    if (Points.Num() <= MaxPointCount)
+    {
+        Indices.SetNumUninitialized(Points.Num());
+
+        for (int32 i=0; i<Points.Num(); ++i)
+        {
+            Indices[i] = i;
+        }
+
+        if (IsConvex(Points, Indices))
+        {
+            AddPolygon(OutPolygons, Points, Indices);
+            return;
+        }
+    }
+
+    // Triangulate and merge triangles into convex polygons
+
+    TArray<int32> TriangleIndices;
+    FECUtils::Earcut(Points, TriangleIndices, false);
+
+    TArray<TArray<int32>> Polygons;
+    MergeTriangles(Points, TriangleIndices, MaxPointCount, Polygons);
+
+    for (const TArray<int32>& Polygon : Polygons)
+    {
+        if (Polygon.Num() >= 3)
+        {
+            AddPolygon(OutPolygons, Points, Polygon);
+        }
+    }
+}
+
+void FMarchingSquaresCollision::Cook(const FMarchingSquaresVoxelMirror& Mirror)
+{
+    enum { MIRROR_BLOCK_SIZE = FMarchingSquaresVoxelMirror::BLOCK_SIZE };
+
+    TArray<uint32> BlockRevisions;
+    FIntPoint MirrorBlockCount;
+
+    const uint32 Revision = Mirror.GetBlockRevisions(BlockRevisions, MirrorBlockCount);
+    const FIntPoint Dimension(Mirror.GetDimension());
+
+    FCookParameter CookParameter;
+    bool bReset;
+    uint32 PrevRevision;
+
+    {
+        FRWScopeLock ScopeLock(CollisionLock, SLT_ReadOnly);
+
+        CookParameter = Parameter;
+        PrevRevision = MirrorRevision;
+
+        bReset  = (CookParameter != CookedParameter) || (Dimension != CookedDimension) || (Revision < PrevRevision);
+        bReset |= Blocks.Num() != (CookParameter.BlockCount.X * CookParameter.BlockCount.Y);
+    }
+
+    // Collect blocks with cells affected by writes since the previous cook.
+    // Cells read voxels up to the cell rect max on each axis.
+
+    const FIntPoint BlockCount(CookParameter.BlockCount.ComponentMax(FIntPoint::ZeroValue));
+    const FIntRect MapCellRect(FIntPoint::ZeroValue, Dimension - FIntPoint(1,1));
+    const int32 BlockCellCount = CookParameter.BlockSize - 1;
+
+    TArray<FIntPoint> DirtyBlocks;
+    TArray<FIntRect> DirtyRects;
+
+    if (BlockCellCount > 0 && MapCellRect.Area() > 0 && BlockRevisions.Num() > 0)
+    {
+        for (int32 by=0; by<BlockCount.Y; ++by)
+        for (int32 bx=0; bx<BlockCount.X; ++bx)
+        {
+            FIntRect CellRect(
+                bx*BlockCellCount,
+                by*BlockCellCount,
+                (bx+1)*BlockCellCount,
+                (by+1)*BlockCellCount
+                );
+            CellRect.Clip(MapCellRect);
+
+            if (CellRect.Area() <= 0)
+            {
+                continue;
+            }
+
+            const FIntPoint MirrorMin(CellRect.Min / MIRROR_BLOCK_SIZE);
+            const FIntPoint MirrorMax((CellRect.Max / MIRROR_BLOCK_SIZE).ComponentMin(MirrorBlockCount - FIntPoint(1,1)));
+
+            bool bDirty = bReset;
+
+            for (int32 y=MirrorMin.Y; ! bDirty && y<=MirrorMax.Y; ++y)
+            for (int32 x=MirrorMin.X; ! bDirty && x<=MirrorMax.X; ++x)
+            {
+                bDirty = BlockRevisions[x + y*MirrorBlockCount.X] > PrevRevision;
+            }
+
+            if (bDirty)
+            {
+                DirtyBlocks.Emplace(bx, by);
+                DirtyRects.Emplace(CellRect);
+            }
+        }
+    }
+
+    // Cook dirty blocks in parallel
+
+    TArray<TArray<FConvexPolygon>> CookedPolygons;
+    CookedPolygons.SetNum(DirtyBlocks.Num());
+
+    ParallelFor(DirtyBlocks.Num(), [&](int32 i)
+    {
+        CookBlock(Mirror, CookParameter, DirtyRects[i], CookedPolygons[i]);
+    } );
+
+    FRWScopeLock ScopeLock(CollisionLock, SLT_Write);
+
+    if (bReset)
+    {
+        Blocks.Reset();
+        Blocks.SetNum(BlockCount.X * BlockCount.Y);
+        CookedParameter = CookParameter;
+        CookedDimension = Dimension;
+    }
+
+    // Only report blocks with changed polygons
+
+    ChangedBlocks.Reset();
+
+    for (int32 i=0; i<DirtyBlocks.Num(); ++i)
+    {
+        const FIntPoint& BlockId(DirtyBlocks[i]);
+        FBlockCollision& Block(Blocks[BlockId.X + BlockId.Y*BlockCount.X]);
+
+        Block.CellRect = DirtyRects[i];
+
+        if (bReset || Block.Polygons != CookedPolygons[i])
+        {
+            Block.Polygons = MoveTemp(CookedPolygons[i]);
+            ++Block.Revision;
+            ChangedBlocks.Emplace(BlockId);
+        }
+    }
+
+    MirrorRevision = Revision;
+}
+
+void FMarchingSquaresCollision::Update(const FMarchingSquaresVoxelMirror& Mirror, const FCookParameter& CookParameter)
+{
+    {
+        FRWScopeLock ScopeLock(CollisionLock, SLT_Write);
+        Parameter = CookParameter;
+    }
+
+    Cook(Mirror);
+}
+
+bool FMarchingSquaresCollision::UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, const FCookParameter& CookParameter, TFunction<void()> OnComplete)
+{
+    {
+        FRWScopeLock ScopeLock(CollisionLock, SLT_Write);
+        Parameter = CookParameter;
+    }
+
+    // Request a cook, an in-flight cook picks up the request on completion
+
+    bUpdateRequested = true;
+
+    if (bUpdating.AtomicSet(true))
+    {
+        return false;
+    }
+
+    const FMarchingSquaresVoxelMirror* MirrorPtr(&Mirror);
+
+    UpdateTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this, MirrorPtr, OnComplete]()
+        {
+            do
+            {
+                bUpdateRequested = false;
+                Cook(*MirrorPtr);
+                bUpdating = false;
+
+                if (OnComplete)
+                {
+                    OnComplete();
+                }
+            }
+            while (bUpdateRequested && ! bUpdating.AtomicSet(true));
+        },
+        TStatId(),
+        nullptr,
+        ENamedThreads::AnyBackgroundThreadNormalTask
+        );
+
+    return true;
+}
+
+void FMarchingSquaresCollision::Reset()
+{
+    FRWScopeLock ScopeLock(CollisionLock, SLT_Write);
+
+    CookedParameter = FCookParameter();
+    CookedDimension = FIntPoint::ZeroValue;
+    MirrorRevision = 0;
+
+    Blocks.Empty();
+    ChangedBlocks.Empty();
+}
+
+void FMarchingSquaresCollision::AddConvexElements(
+    const TArray<FConvexPolygon>& Polygons,
+    const FVector2D& VoxelScale,
+    float MinZ,
+    float MaxZ,
+    FKAggregateGeom& OutGeom
+    )
+{
+    OutGeom.ConvexElems.Reserve(OutGeom.ConvexElems.Num() + Polygons.Num());
+
+    for (const FConvexPolygon& Polygon : Polygons)
+    {
+        FKConvexElem& ConvexElem(OutGeom.ConvexElems[OutGeom.ConvexElems.AddDefaulted()]);
+        ConvexElem.VertexData.Reserve(Polygon.Points.Num() * 2);
+
+        for (const FVector2D& Point : Polygon.Points)
+        {
+            ConvexElem.VertexData.Emplace(Point.X * VoxelScale.X, Point.Y * VoxelScale.Y, MinZ);
+            ConvexElem.VertexData.Emplace(Point.X * VoxelScale.X, Point.Y * VoxelScale.Y, MaxZ);
+        }
+
+        ConvexElem.UpdateElemBox();
+    }
+}
+
+// QUERY FUNCTIONS
+
+FIntPoint FMarchingSquaresCollision::GetBlockCount() const
+{
+    FRWScopeLock ScopeLock(CollisionLock, SLT_ReadOnly);
+    return CookedParameter.BlockCount;
+}
+
+TArray<FIntPoint> FMarchingSquaresCollision::GetChangedBlocks() const
+{
+    FRWScopeLock ScopeLock(CollisionLock, SLT_ReadOnly);
+    return ChangedBlocks;
+}
+
+bool FMarchingSquaresCollision::GetBlockCollision(const FIntPoint& Block, FBlockCollision& OutCollision) const
+{
+    FRWScopeLock ScopeLock(CollisionLock, SLT_ReadOnly);
+
+    const FIntPoint& BlockCount(CookedParameter.BlockCount);
+
+    if (Block.X < 0 || Block.Y < 0 || Block.X >= BlockCount.X || Block.Y >= BlockCount.Y || Blocks.Num() != BlockCount.X*BlockCount.Y)
+    {
+        return false;
+    }
+
+    OutCollision = Blocks[Block.X + Block.Y*BlockCount.X];
+    return true;
+}
+
+uint32 FMarchingSquaresCollision::GetBlockRevision(const FIntPoint& Block) const
+{
+    FRWScopeLock ScopeLock(CollisionLock, SLT_ReadOnly);
+
+    const FIntPoint& BlockCount(CookedParameter.BlockCount);
+
+    if (Block.X < 0 || Block.Y < 0 || Block.X >= BlockCount.X || Block.Y >= BlockCount.Y || Blocks.Num() != BlockCount.X*BlockCount.Y)
+    {
+        return 0;
+    }
+
+    return Blocks[Block.X + Block.Y*BlockCount.X].Revision;
+}
@@ -0,0 +1,295 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresContour.h"
+
+#include "Async/ParallelFor.h"
+#include "MarchingSquaresGeometryUtils.h"
+#include "MarchingSquaresVoxelMirror.h"
+
+namespace MarchingSquaresContourUtils
+{
+    typedef FMarchingSquaresVoxelMirror::FCellGeometry FCellGeometry;
+    typedef FMarchingSquaresVoxelMirror::FCellSegment  FCellSegment;
+
+    // Number of cell rows processed per parallel task
+    enum { ROW_BAND_SIZE = 16 };
+
+    // Contour segment, end point keys identify shared cell edge crossings
+    // and map border corner voxels
+    struct FSegment
+    {
+        FVector2D P0;
+        FVector2D P1;
+        int64     Key0;
+        int64     Key1;
+    };
+
+    FORCEINLINE int64 GetFeatureKey(const FIntPoint& Dimension, const FIntPoint& Cell, int32 Feature)
+    {
+        const int64 VoxelCount = int64(Dimension.X) * Dimension.Y;
+
+        // Edge crossing keys are voxel index * 2 + edge axis
+
+        switch (Feature)
+        {
+            case FMarchingSquaresVoxelMirror::CELL_FEATURE_EDGE_BOTTOM:
+                return (Cell.X + int64(Cell.Y  ) * Dimension.X) * 2;
+            case FMarchingSquaresVoxelMirror::CELL_FEATURE_EDGE_TOP:
+                return (Cell.X + int64(Cell.Y+1) * Dimension.X) * 2;
+            case FMarchingSquaresVoxelMirror::CELL_FEATURE_EDGE_LEFT:
+                return (Cell.X + int64(Cell.Y  ) * Dimension.X) * 2 + 1;
+            case FMarchingSquaresVoxelMirror::CELL_FEATURE_EDGE_RIGHT:
+                return (Cell.X+1 + int64(Cell.Y) * Dimension.X) * 2 + 1;
+        }
+
+        // Corner keys follow edge crossing keys
+
+        const int32 Corner = Feature - FMarchingSquaresVoxelMirror::CELL_FEATURE_CORNER;
+        const FIntPoint Voxel(Cell.X + (Corner & 1), Cell.Y + (Corner >> 1));
+
+        return VoxelCount * 2 + Voxel.X + int64(Voxel.Y) * Dimension.X;
+    }
+
+    FORCEINLINE void AddSegment(TArray<FSegment>& Segments, const FIntPoint& Dimension, const FIntPoint& Cell, const FCellSegment& CellSegment)
+    {
+        const FVector2D CellOrigin(Cell);
+
+        FSegment Segment;
+        Segment.P0 = CellOrigin + CellSegment.P0;
+        Segment.P1 = CellOrigin + CellSegment.P1;
+        Segment.Key0 = GetFeatureKey(Dimension, Cell, CellSegment.Feature0);
+        Segment.Key1 = GetFeatureKey(Dimension, Cell, CellSegment.Feature1);
+
+        Segments.Emplace(Segment);
+    }
+
+    FORCEINLINE void AddPoint(TArray<FVector2D>& Points, const FVector2D& Point)
+    {
+        // Skip zero length segments of crossings on cell corners
+
+        if (Points.Num() == 0 || Points.Last() != Point)
+        {
+            Points.Emplace(Point);
+        }
+    }
+}
+
+void FMarchingSquaresContour::ExtractContours(
+    const FMarchingSquaresVoxelMirror& Mirror,
+    const FExtractParameter& Parameter,
+    TArray<FContourPolyline>& OutPolylines
+    )
+{
+    using namespace MarchingSquaresContourUtils;
+
+    OutPolylines.Reset();
+
+    const FIntPoint Dimension(Mirror.GetDimension());
+    const FIntRect MapCellRect(FIntPoint::ZeroValue, Dimension - FIntPoint(1,1));
+
+    if (MapCellRect.Area() <= 0)
+    {
+        return;
+    }
+
+    FIntRect CellRect(MapCellRect);
+
+    if (Parameter.CellRect.Area() > 0)
+    {
+        CellRect.Clip(Parameter.CellRect);
+    }
+
+    if (CellRect.Area() <= 0)
+    {
+        return;
+    }
+
+    // Emit cell segments in parallel row bands
+
+    const int32 BandCount = (CellRect.Height()+ROW_BAND_SIZE-1) / ROW_BAND_SIZE;
+
+    TArray<TArray<FSegment>> BandSegments;
+    BandSegments.SetNum(BandCount);
+
+    ParallelFor(BandCount, [&](int32 BandIndex)
+    {
+        const int32 BandMinY = CellRect.Min.Y + BandIndex*ROW_BAND_SIZE;
+        const int32 BandMaxY = FMath::Min(BandMinY+ROW_BAND_SIZE, CellRect.Max.Y);
+
+        TArray<FSegment>& Segments(BandSegments[BandIndex]);
+
+        Mirror.VisitCellGeometry(
+            FIntRect(CellRect.Min.X, BandMinY, CellRect.Max.X, BandMaxY),
+            Parameter.FillType,
+            [&](const FIntPoint& Cell, const FCellGeometry& Geometry)
+            {
+                FCellSegment CellSegments[4];
+
+                const int32 SegmentCount = FMarchingSquaresVoxelMirror::GetCellSegments(Geometry, CellSegments);
+
+                for (int32 i=0; i<SegmentCount; ++i)
+                {
+                    AddSegment(Segments, Dimension, Cell, CellSegments[i]);
+                }
+
+                // Filled outline along the map or rect border
+
+                if (Parameter.bCloseAtMapBorder || Parameter.bCloseAtRectBorder)
+                {
+                    const FIntRect& BorderRect(Parameter.bCloseAtRectBorder ? CellRect : MapCellRect);
+                    const FIntPoint CellMin(BorderRect.Min);
+                    const FIntPoint CellMax(BorderRect.Max - FIntPoint(1,1));
+
+                    uint32 SideMask = 0;
+                    SideMask |= (Cell.Y == CellMin.Y) ? FMarchingSquaresVoxelMirror::CELL_SIDE_BOTTOM : 0;
+                    SideMask |= (Cell.Y == CellMax.Y) ? FMarchingSquaresVoxelMirror::CELL_SIDE_TOP    : 0;
+                    SideMask |= (Cell.X == CellMin.X) ? FMarchingSquaresVoxelMirror::CELL_SIDE_LEFT   : 0;
+                    SideMask |= (Cell.X == CellMax.X) ? FMarchingSquaresVoxelMirror::CELL_SIDE_RIGHT  : 0;
+
+                    if (SideMask != 0)
+                    {
+                        const int32 SideSegmentCount = FMarchingSquaresVoxelMirror::GetCellSideSegments(Geometry, SideMask, CellSegments);
+
+                        for (int32 i=0; i<SideSegmentCount; ++i)
+                        {
+                            AddSegment(Segments, Dimension, Cell, CellSegments[i]);
+                        }
+                    }
+                }
+            } );
+    } );
+
+    TArray<FSegment> Segments;
+
+    for (TArray<FSegment>& BandSegmentArr : BandSegments)
+    {
+        Segments.Append(MoveTemp(BandSegmentArr));
+    }
+
+    const int32 SegmentCount = Segments.Num();
+
+    if (SegmentCount == 0)
+    {
+        return;
+    }
+
+    // Link segments by shared end point keys. Each key has at most a single
+    // outgoing and a single incoming segment.
+
+    TMap<int64, int32> SegmentStarts;
+    TSet<int64> SegmentEnds;
+
+    SegmentStarts.Reserve(SegmentCount);
+    SegmentEnds.Reserve(SegmentCount);
+
+    for (int32 i=0; i<SegmentCount; ++i)
+    {
+        SegmentStarts.Add(Segments[i].Key0, i);
+        SegmentEnds.Add(Segments[i].Key1);
+    }
+
+    TBitArray<> VisitedSegments(false, SegmentCount);
+
+    auto TraceChain = [&](int32 StartIndex)
+    {
+        FContourPolyline Polyline;
+        AddPoint(Polyline.Points, Segments[StartIndex].P0);
+
+        int32 Index = StartIndex;
+
+        while (true)
+        {
+            VisitedSegments[Index] = true;
+            AddPoint(Polyline.Points, Segments[Index].P1);
+
+            const int32* NextIndex = SegmentStarts.Find(Segments[Index].Key1);
+
+            if (! NextIndex || VisitedSegments[*NextIndex])
+            {
+                Polyline.bClosed = (NextIndex && *NextIndex == StartIndex);
+                break;
+            }
+
+            Index = *NextIndex;
+        }
+
+        if (Polyline.bClosed && Polyline.Points.Num() > 1 && Polyline.Points.Last() == Polyline.Points[0])
+        {
+            Polyline.Points.Pop(false);
+        }
+
+        const int32 MinPointCount = Polyline.bClosed ? 3 : 2;
+
+        if (Polyline.Points.Num() >= MinPointCount)
+        {
+            OutPolylines.Emplace(MoveTemp(Polyline));
+        }
+    };
+
+    // Trace open chains from segments without an incoming segment, then
+    // trace the remaining closed loops
+
+    for (int32 i=0; i<SegmentCount; ++i)
+    {
+        if (! VisitedSegments[i] && ! SegmentEnds.Contains(Segments[i].Key0))
+        {
+            TraceChain(i);
+        }
+    }
+
+    for (int32 i=0; i<SegmentCount; ++i)
+    {
+        if (! VisitedSegments[i])
+        {
+            TraceChain(i);
+        }
+    }
+
+    // Simplify polylines
+
+    if (Parameter.SimplifyTolerance > 0.f)
+    {
+        ParallelFor(OutPolylines.Num(), [&](int32 i)
+        {
+            FContourPolyline& Polyline(OutPolylines[i]);
+            TArray<FVector2D> SimplifiedPoints;
+
+            const bool bSimplified = FMarchingSquaresGeometryUtils::SimplifyPolyline(
+                Polyline.Points,
+                SimplifiedPoints,
+                Parameter.SimplifyTolerance,
+                Polyline.bClosed
+                );
+
+            if (bSimplified)
+            {
+                Polyline.Points = MoveTemp(SimplifiedPoints);
+            }
+        } );
+    }
+}
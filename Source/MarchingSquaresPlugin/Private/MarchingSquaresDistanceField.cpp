@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresDistanceField.h"
+
+#include "ShaderParameters.h"
+#include "ShaderCore.h"
+#include "ShaderParameterUtils.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+#include "MarchingSquaresMapRef.h"
+#include "Shaders/RULShaderDefinitions.h"
+
+// COMPUTE SHADER DEFINITIONS
+
+class FMSQDistanceFieldSeedCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQDistanceFieldSeedCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "VoxelStateData",   VoxelStateData,
+        "VoxelFeatureData", VoxelFeatureData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutSeedData", OutSeedData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_6(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",     Params_MapDimension,
+        "_FieldDim",   Params_FieldDimension,
+        "_FieldScale", Params_FieldScale,
+        "_FillType",   Params_FillType,
+        "_RectMin",    Params_RectMin,
+        "_RectDim",    Params_RectDim
+        )
+};
+
+class FMSQDistanceFieldJumpFloodCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQDistanceFieldJumpFloodCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "SeedData", SeedData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutSeedData", OutSeedData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_7(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_FieldDim",   Params_FieldDimension,
+        "_FieldScale", Params_FieldScale,
+        "_RectMin",    Params_RectMin,
+        "_RectDim",    Params_RectDim,
+        "_FloodMin",   Params_FloodMin,
+        "_FloodMax",   Params_FloodMax,
+        "_StepSize",   Params_StepSize
+        )
+};
+
+class FMSQDistanceFieldResolveCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQDistanceFieldResolveCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "VoxelStateData", VoxelStateData,
+        "SeedData",       SeedData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutDistanceTexture", OutDistanceTexture
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_7(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",      Params_MapDimension,
+        "_FieldDim",    Params_FieldDimension,
+        "_FieldScale",  Params_FieldScale,
+        "_FillType",    Params_FillType,
+        "_RectMin",     Params_RectMin,
+        "_RectDim",     Params_RectDim,
+        "_MaxDistance", Params_MaxDistance
+        )
+};
+
+IMPLEMENT_SHADER_TYPE(, FMSQDistanceFieldSeedCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresDistanceFieldCS.usf"), TEXT("SeedKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMSQDistanceFieldJumpFloodCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresDistanceFieldCS.usf"), TEXT("JumpFloodKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMSQDistanceFieldResolveCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresDistanceFieldCS.usf"), TEXT("ResolveKernel"), SF_Compute);
+
+bool FMarchingSquaresDistanceField::FFieldParameter::operator==(const FFieldParameter& Other) const
+{
+    return FillType    == Other.FillType
+        && FieldScale  == Other.FieldScale
+        && MaxDistance == Other.MaxDistance;
+}
+
+FIntPoint FMarchingSquaresDistanceField::GetFieldDimension(const FIntPoint& MapDimension, int32 FieldScale)
+{
+    const int32 Scale = FMath::Clamp<int32>(FieldScale, 1, MAX_FIELD_SCALE);
+    return (MapDimension + FIntPoint(Scale-1, Scale-1)) / Scale;
+}
+
+void FMarchingSquaresDistanceField::UpdateField_RT(
+    FRHICommandListImmediate& RHICmdList,
+    FMarchingSquaresMap& Map,
+    const FFieldParameter& Field,
+    const FIntRect& VoxelRect,
+    UTextureRenderTarget2D* OutputRTT
+    )
+{
+    check(IsInRenderingThread());
+
+    FRULRWBuffer& VoxelStateData(Map.GetVoxelStateData());
+    FRULRWBuffer& VoxelFeatureData(Map.GetVoxelFeatureData());
+
+    if (! Map.HasValidDimension_RT() || ! VoxelStateData.IsValid() || ! VoxelFeatureData.IsValid())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresDistanceField::UpdateField_RT() ABORTED - Map voxel data has not been initialized"));
+        return;
+    }
+
+    const FIntPoint MapDimension(Map.GetDimension_RT());
+    const int32     FieldScale = FMath::Clamp<int32>(Field.FieldScale, 1, MAX_FIELD_SCALE);
+    const FIntPoint FieldDimension(GetFieldDimension(MapDimension, FieldScale));
+    const FIntRect  FieldRect(FIntPoint::ZeroValue, FieldDimension);
+
+    const bool bFullUpdate = (VoxelRect.Area() <= 0)
+        || ! DistanceTexture.IsValid()
+        || Field != Field_RT
+        || MapDimension != MapDimension_RT;
+
+    // Create field resources on dimension change
+
+    if (! DistanceTexture.IsValid() || FieldDimension != FieldDimension_RT)
+    {
+        ClearField_RT();
+
+        const int32 TexelCount = FieldDimension.X * FieldDimension.Y;
+
+        for (int32 i=0; i<2; ++i)
+        {
+            SeedData[i].Initialize(
+                sizeof(float) * 2,
+                TexelCount,
+                PF_G32R32F,
+                nullptr,
+                BUF_Static,
+                TEXT("DistanceFieldSeedData")
+                );
+        }
+
+        FRHIResourceCreateInfo CreateInfo;
+        DistanceTexture = RHICreateTexture2D(FieldDimension.X, FieldDimension.Y, PF_R32_FLOAT, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
+        DistanceTextureUAV = RHICreateUnorderedAccessView(DistanceTexture);
+    }
+
+    Field_RT = Field;
+    MapDimension_RT = MapDimension;
+    FieldDimension_RT = FieldDimension;
+
+    // Unbounded fields use the map diagonal as max distance
+
+    const float MaxDistance = (Field.MaxDistance > 0.f) ? Field.MaxDistance : FVector2D(MapDimension).Size();
+    const int32 MaxTexelDistance = FMath::CeilToInt(MaxDistance / FieldScale) + 1;
+
+    // Resolve rect covers texels within the max distance of the updated
+    // voxels. Flood rect additionally covers seeds within the max distance
+    // of resolved texels. Voxels before the voxel rect own edges into the
+    // rect and are included.
+
+    FIntRect ResolveRect(FieldRect);
+    FIntRect FloodRect(FieldRect);
+
+    if (! bFullUpdate)
+    {
+        const FIntPoint UpdateMin(VoxelRect.Min - FIntPoint(1,1));
+        const FIntPoint UpdateMax(VoxelRect.Max + FIntPoint(FieldScale-1, FieldScale-1));
+
+        ResolveRect = FIntRect(
+            FIntPoint(FMath::DivideAndRoundDown(UpdateMin.X, FieldScale), FMath::DivideAndRoundDown(UpdateMin.Y, FieldScale)),
+            FIntPoint(FMath::DivideAndRoundDown(UpdateMax.X, FieldScale), FMath::DivideAndRoundDown(UpdateMax.Y, FieldScale))
+            );
+        ResolveRect.InflateRect(MaxTexelDistance);
+        ResolveRect.Clip(FieldRect);
+
+        FloodRect = ResolveRect;
+        FloodRect.InflateRect(MaxTexelDistance);
+        FloodRect.Clip(FieldRect);
+    }
+
+    if (ResolveRect.Area() <= 0)
+    {
+        return;
+    }
+
+    const FIntPoint FloodDim(FloodRect.Size());
+    const FIntPoint ResolveDim(ResolveRect.Size());
+    const uint32 FillType = Field.FillType;
+
+    TShaderMap<FGlobalShaderType>* RHIShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    // Seed flood rect texels with boundary crossings
+
+    RHICmdList.BeginComputePass(TEXT("DistanceFieldSeed"));
+    {
+        TShaderMapRef<FMSQDistanceFieldSeedCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelFeatureData"), VoxelFeatureData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutSeedData"), SeedData[0].UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), MapDimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FieldDim"), FieldDimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FieldScale"), static_cast<uint32>(FieldScale));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), FillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RectMin"), FloodRect.Min);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RectDim"), FloodDim);
+        ComputeShader->DispatchAndClear(RHICmdList, FloodDim.X, FloodDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+
+    // Jump flood with halving step sizes, starting from the largest step
+    // that can reach seeds within the max distance. A final unit step pass
+    // corrects most remaining jump flood errors.
+
+    const int32 FloodExtent = FMath::Min(MaxTexelDistance, FMath::Max(FloodDim.X, FloodDim.Y));
+
+    TArray<uint32> StepSizes;
+
+    for (uint32 StepSize=FMath::RoundUpToPowerOfTwo(FloodExtent)/2; StepSize>=1; StepSize/=2)
+    {
+        StepSizes.Emplace(StepSize);
+    }
+
+    StepSizes.Emplace(1);
+
+    int32 SrcIndex = 0;
+
+    for (uint32 StepSize : StepSizes)
+    {
+        const int32 DstIndex = 1 - SrcIndex;
+
+        RHICmdList.BeginComputePass(TEXT("DistanceFieldJumpFlood"));
+        {
+            TShaderMapRef<FMSQDistanceFieldJumpFloodCS> ComputeShader(RHIShaderMap);
+            ComputeShader->SetShader(RHICmdList);
+            ComputeShader->BindSRV(RHICmdList, TEXT("SeedData"), SeedData[SrcIndex].SRV);
+            ComputeShader->BindUAV(RHICmdList, TEXT("OutSeedData"), SeedData[DstIndex].UAV);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_FieldDim"), FieldDimension);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_FieldScale"), static_cast<uint32>(FieldScale));
+            ComputeShader->SetParameter(RHICmdList, TEXT("_RectMin"), FloodRect.Min);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_RectDim"), FloodDim);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_FloodMin"), FloodRect.Min);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_FloodMax"), FloodRect.Max);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_StepSize"), StepSize);
+            ComputeShader->DispatchAndClear(RHICmdList, FloodDim.X, FloodDim.Y, 1);
+        }
+        RHICmdList.EndComputePass();
+
+        SrcIndex = DstIndex;
+    }
+
+    // Resolve signed distance of resolve rect texels
+
+    RHICmdList.BeginComputePass(TEXT("DistanceFieldResolve"));
+    {
+        TShaderMapRef<FMSQDistanceFieldResolveCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("SeedData"), SeedData[SrcIndex].SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutDistanceTexture"), DistanceTextureUAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), MapDimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FieldDim"), FieldDimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FieldScale"), static_cast<uint32>(FieldScale));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), FillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RectMin"), ResolveRect.Min);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RectDim"), ResolveDim);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MaxDistance"), MaxDistance);
+        ComputeShader->DispatchAndClear(RHICmdList, ResolveDim.X, ResolveDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+
+    // Copy resolved texels to the output render target
+
+    if (OutputRTT)
+    {
+        FTextureRenderTargetResource* OutputResource = OutputRTT->GetRenderTargetResource();
+        FTextureRHIRef OutputTexture(OutputResource ? OutputResource->TextureRHI : FTextureRHIRef());
+
+        const bool bValidOutput = OutputTexture.IsValid()
+            && OutputRTT->GetFormat() == PF_R32_FLOAT
+            && OutputRTT->SizeX == FieldDimension.X
+            && OutputRTT->SizeY == FieldDimension.Y;
+
+        if (bValidOutput)
+        {
+            RHICmdList.CopyToResolveTarget(
+                DistanceTexture,
+                OutputTexture,
+                FResolveParams(FResolveRect(ResolveRect.Min.X, ResolveRect.Min.Y, ResolveRect.Max.X, ResolveRect.Max.Y))
+                );
+        }
+        else
+        {
+            UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresDistanceField::UpdateField_RT() Output render target copy skipped - Output render target must be RTF_R32f with field dimension (%d, %d)"), FieldDimension.X, FieldDimension.Y);
+        }
+    }
+}
+
+void FMarchingSquaresDistanceField::ClearField_RT()
+{
+    SeedData[0].Release();
+    SeedData[1].Release();
+
+    DistanceTextureUAV.SafeRelease();
+    DistanceTexture.SafeRelease();
+
+    Field_RT = FFieldParameter();
+    MapDimension_RT = FIntPoint::ZeroValue;
+    FieldDimension_RT = FIntPoint::ZeroValue;
+}
+
+void FMarchingSquaresDistanceField::UpdateField(const FUpdateFieldParameter& Parameter)
+{
+    check(Parameter.Map != nullptr);
+    check(Parameter.Map->HasValidDimension());
+
+    FMarchingSquaresDistanceField* DistanceField(this);
+    FMarchingSquaresMap* Map(Parameter.Map);
+    FFieldParameter Field(Parameter.Field);
+    FIntRect VoxelRect(Parameter.VoxelRect);
+    UTextureRenderTarget2D* OutputRTT(Parameter.OutputRTT);
+
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresDistanceField_UpdateField)(
+        [DistanceField, Map, Field, VoxelRect, OutputRTT](FRHICommandListImmediate& RHICmdList)
+        {
+            DistanceField->UpdateField_RT(RHICmdList, *Map, Field, VoxelRect, OutputRTT);
+        } );
+}
+
+void FMarchingSquaresDistanceField::ClearField()
+{
+    FMarchingSquaresDistanceField* DistanceField(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresDistanceField_ClearField)(
+        [DistanceField](FRHICommandListImmediate& RHICmdList)
+        {
+            DistanceField->ClearField_RT();
+        } );
+}
+
+void UMarchingSquaresDistanceFieldRef::UpdateField(UMarchingSquaresMapRef* MapRef, const FIntRect& VoxelRect)
+{
+    if (! IsValid(MapRef) || ! MapRef->HasValidMap())
+    {
+        return;
+    }
+
+    FMarchingSquaresDistanceField::FUpdateFieldParameter Parameter;
+    Parameter.Map = &MapRef->GetMap();
+    Parameter.Field.FillType = static_cast<uint8>(FMath::Clamp(FillType, 0, 255));
+    Parameter.Field.FieldScale = FMath::Clamp<int32>(FieldScale, 1, FMarchingSquaresDistanceField::MAX_FIELD_SCALE);
+    Parameter.Field.MaxDistance = MaxDistance;
+    Parameter.OutputRTT = OutputRTT;
+    Parameter.VoxelRect = VoxelRect;
+
+    DistanceField.UpdateField(Parameter);
+}
+
+FIntPoint UMarchingSquaresDistanceFieldRef::GetFieldDimension(UMarchingSquaresMapRef* MapRef) const
+{
+    if (! IsValid(MapRef) || ! MapRef->HasValidMap())
+    {
+        return FIntPoint::ZeroValue;
+    }
+
+    return FMarchingSquaresDistanceField::GetFieldDimension(MapRef->GetMapDimension(), FieldScale);
+}
+
+void UMarchingSquaresDistanceFieldRef::GenerateField(UMarchingSquaresMapRef* MapRef)
+{
+    UpdateField(MapRef, FIntRect());
+}
+
+void UMarchingSquaresDistanceFieldRef::UpdateFieldRect(UMarchingSquaresMapRef* MapRef, FIntPoint VoxelMin, FIntPoint VoxelMax)
+{
+    const FIntRect VoxelRect(VoxelMin, VoxelMax);
+
+    // Skip empty rect, an empty voxel rect would update the whole field
+
+    if (VoxelRect.Area() > 0)
+    {
+        UpdateField(MapRef, VoxelRect);
+    }
+}
+
+void UMarchingSquaresDistanceFieldRef::ClearField()
+{
+    DistanceField.ClearField();
+}
@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresGeometryUtils.h"
+
+namespace MarchingSquaresGeometryUtils
+{
+    float PointSegmentDistanceSq(const FVector2D& P, const FVector2D& A, const FVector2D& B)
+    {
+        const FVector2D AB = B-A;
+        const float LenSq = AB.SizeSquared();
+
+        if (LenSq < SMALL_NUMBER)
+        {
+            return FVector2D::DistSquared(P, A);
+        }
+
+        const float T = FMath::Clamp(((P-A) | AB) / LenSq, 0.f, 1.f);
+        return FVector2D::DistSquared(P, A + AB*T);
+    }
+
+    float Orient(const FVector2D& A, const FVector2D& B, const FVector2D& C)
+    {
+        return (B-A) ^ (C-A);
+    }
+
+    bool SegmentsIntersect(const FVector2D& A0, const FVector2D& A1, const FVector2D& B0, const FVector2D& B1)
+    {
+        const float O0 = Orient(A0, A1, B0);
+        const float O1 = Orient(A0, A1, B1);
+        const float O2 = Orient(B0, B1, A0);
+        const float O3 = Orient(B0, B1, A1);
+
+        // Only proper crossing is considered, touching segments of a
+        // simplified outline are resolved by the rasterizer without issue
+        return ((O0 > 0.f) != (O1 > 0.f)) && ((O2 > 0.f) != (O3 > 0.f))
+            && (O0 != 0.f) && (O1 != 0.f) && (O2 != 0.f) && (O3 != 0.f);
+    }
+
+    void DouglasPeucker(const TArray<FVector2D>& Points, int32 First, int32 Last, float ToleranceSq, TBitArray<>& KeepFlags)
+    {
+        typedef TPair<int32, int32> FRange;
+
+        TArray<FRange> Stack;
+        Stack.Emplace(First, Last);
+
+        while (Stack.Num() > 0)
+        {
+            const FRange Range = Stack.Pop(false);
+            const int32 i0 = Range.Key;
+            const int32 i1 = Range.Value;
+
+            if ((i1-i0) < 2)
+            {
+                continue;
+            }
+
+            const FVector2D& A(Points[i0]);
+            const FVector2D& B(Points[i1]);
+
+            float MaxDistSq = -1.f;
+            int32 MaxIndex = -1;
+
+            for (int32 i=i0+1; i<i1; ++i)
+            {
+                const float DistSq = PointSegmentDistanceSq(Points[i], A, B);
+
+                if (DistSq > MaxDistSq)
+                {
+                    MaxDistSq = DistSq;
+                    MaxIndex = i;
+                }
+            }
+
+            if (MaxDistSq > ToleranceSq)
+            {
+                KeepFlags[MaxIndex] = true;
+                Stack.Emplace(i0, MaxIndex);
+                Stack.Emplace(MaxIndex, i1);
+            }
+        }
+    }
+}
+
+bool FMarchingSquaresGeometryUtils::SimplifyPolyline(
+    const TArray<FVector2D>& InPoints,
+    TArray<FVector2D>& OutPoints,
+    float Tolerance,
+    bool bClosed
+    )
+{
+    const int32 MinPointCount = bClosed ? 3 : 2;
+
+    if (Tolerance <= 0.f || InPoints.Num() <= MinPointCount)
+    {
+        OutPoints = InPoints;
+        return false;
+    }
+
+    const int32 MaxIterations = 3;
+
+    for (int32 It=0; It<MaxIterations; ++It)
+    {
+        TArray<FVector2D> Points;
+        SimplifyPolylineImpl(InPoints, Points, Tolerance, bClosed);
+
+        // Simplification removes too many points, retry with smaller tolerance
+        if (Points.Num() < MinPointCount)
+        {
+            Tolerance *= .5f;
+            continue;
+        }
+
+        // Make sure simplification does not introduce self-intersection
+        if (bClosed && HasSelfIntersection(Points, bClosed))
+        {
+            Tolerance *= .5f;
+            continue;
+        }
+
+        if (Points.Num() < InPoints.Num())
+        {
+            OutPoints = MoveTemp(Points);
+            return true;
+        }
+
+        break;
+    }
+
+    OutPoints = InPoints;
+    return false;
+}
+
+void FMarchingSquaresGeometryUtils::SimplifyPolylineImpl(
+    const TArray<FVector2D>& InPoints,
+    TArray<FVector2D>& OutPoints,
+    float Tolerance,
+    bool bClosed
+    )
+{
+    using namespace MarchingSquaresGeometryUtils;
+
+    const float ToleranceSq = Tolerance*Tolerance;
+
+    // Merge consecutive points within tolerance
+
+    TArray<FVector2D> Points;
+    Points.Reserve(InPoints.Num()+1);
+    Points.Emplace(InPoints[0]);
+
+    for (int32 i=1; i<InPoints.Num(); ++i)
+    {
+        if (FVector2D::DistSquared(InPoints[i], Points.Last()) > ToleranceSq)
+        {
+            Points.Emplace(InPoints[i]);
+        }
+    }
+
+    // Make sure open polyline keeps its end point
+
+    if (! bClosed && Points.Num() > 1 && Points.Last() != InPoints.Last())
+    {
+        Points.Last() = InPoints.Last();
+    }
+
+    // Remove closing point that coincide with the first point
+
+    if (bClosed)
+    {
+        while (Points.Num() > 1 && FVector2D::DistSquared(Points.Last(), Points[0]) <= ToleranceSq)
+        {
+            Points.Pop(false);
+        }
+    }
+
+    const int32 PointCount = Points.Num();
+
+    if (PointCount < 3)
+    {
+        OutPoints = MoveTemp(Points);
+        return;
+    }
+
+    TBitArray<> KeepFlags(false, PointCount+1);
+
+    if (bClosed)
+    {
+        // Split closed polyline at the point furthest from the first point
+        // and simplify both chains, the first point is duplicated at the end
+
+        int32 SplitIndex = 1;
+        float SplitDistSq = -1.f;
+
+        for (int32 i=1; i<PointCount; ++i)
+        {
+            const float DistSq = FVector2D::DistSquared(Points[i], Points[0]);
+
+            if (DistSq > SplitDistSq)
+            {
+                SplitDistSq = DistSq;
+                SplitIndex = i;
+            }
+        }
+
+        Points.Emplace(Points[0]);
+
+        KeepFlags[0] = true;
+        KeepFlags[SplitIndex] = true;
+
+        DouglasPeucker(Points, 0, SplitIndex, ToleranceSq, KeepFlags);
+        DouglasPeucker(Points, SplitIndex, PointCount, ToleranceSq, KeepFlags);
+    }
+    else
+    {
+        KeepFlags[0] = true;
+        KeepFlags[PointCount-1] = true;
+
+        DouglasPeucker(Points, 0, PointCount-1, ToleranceSq, KeepFlags);
+    }
+
+    OutPoints.Reset(PointCount);
+
+    for (int32 i=0; i<PointCount; ++i)
+    {
+        if (KeepFlags[i])
+        {
+            OutPoints.Emplace(Points[i]);
+        }
+    }
+}
+
+bool FMarchingSquaresGeometryUtils::HasSelfIntersection(const TArray<FVector2D>& Points, bool bClosed)
+{
+    using namespace MarchingSquaresGeometryUtils;
+
+    const int32 PointCount = Points.Num();
+    const int32 SegmentCount = bClosed ? PointCount : (PointCount-1);
+
+    if (SegmentCount < 3)
+    {
+        return false;
+    }
+
+    // Sweep segments sorted by minimum x, only segments with overlapping
+    // x range are tested against each other
+
+    struct FSegment
+    {
+        int32 Index;
+        float MinX;
+        float MaxX;
+    };
+
+    TArray<FSegment> Segments;
+    Segments.SetNumUninitialized(SegmentCount);
+
+    for (int32 i=0; i<SegmentCount; ++i)
+    {
+        const FVector2D& P0(Points[i]);
+        const FVector2D& P1(Points[(i+1) % PointCount]);
+        Segments[i] = { i, FMath::Min(P0.X, P1.X), FMath::Max(P0.X, P1.X) };
+    }
+
+    Segments.Sort([](const FSegment& A, const FSegment& B) { return A.MinX < B.MinX; });
+
+    for (int32 si=0; si<SegmentCount; ++si)
+    {
+        const FSegment& SA(Segments[si]);
+        const FVector2D& A0(Points[SA.Index]);
+        const FVector2D& A1(Points[(SA.Index+1) % PointCount]);
+
+        for (int32 sj=si+1; sj<SegmentCount && Segments[sj].MinX <= SA.MaxX; ++sj)
+        {
+            const int32 IndexB = Segments[sj].Index;
+            const int32 IndexDelta = FMath::Abs(SA.Index-IndexB);
+
+            // Skip adjacent segments
+            if (IndexDelta <= 1 || (bClosed && IndexDelta == (SegmentCount-1)))
+            {
+                continue;
+            }
+
+            const FVector2D& B0(Points[IndexB]);
+            const FVector2D& B1(Points[(IndexB+1) % PointCount]);
+
+            if (SegmentsIntersect(A0, A1, B0, B1))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
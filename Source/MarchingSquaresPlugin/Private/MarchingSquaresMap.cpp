@@ -34,6 +34,8 @@
 #include "Engine/StaticMeshSocket.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "RHIUtilities.h"
+#include "GenericWorkerThread.h"
+#include "GWTTickManager.h"
 
 #include "MarchingSquaresPlugin.h"
 #include "RenderingUtilityLibrary.h"
@@ -43,7 +45,7 @@
 
 // COMPUTE SHADER DEFINITIONS
 
-template<uint32 bGenerateWalls>
+template<uint32 bGenerateWalls, uint32 bUseDistance>
 class TMarchingSquaresMapWriteCellCaseCS : public FRULBaseComputeShader<16,16,1>
 {
 public:
@@ -63,15 +65,17 @@ public:
     {
         FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
         OutEnvironment.SetDefine(TEXT("MARCHING_SQUARES_GENERATE_WALLS"), bGenerateWalls);
+        OutEnvironment.SetDefine(TEXT("MARCHING_SQUARES_USE_DISTANCE"), bUseDistance);
     }
 
     RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(TMarchingSquaresMapWriteCellCaseCS)
 
-    RUL_DECLARE_SHADER_PARAMETERS_1(
+    RUL_DECLARE_SHADER_PARAMETERS_2(
         SRV,
         FShaderResourceParameter,
         FResourceId,
-        "VoxelStateData", VoxelStateData
+        "VoxelStateData",    VoxelStateData,
+        "VoxelDistanceData", VoxelDistanceData
         )
 
     RUL_DECLARE_SHADER_PARAMETERS_3(
@@ -83,13 +87,15 @@ public:
         "OutDebugTexture",  OutDebugTexture
         )
 
-    RUL_DECLARE_SHADER_PARAMETERS_3(
+    RUL_DECLARE_SHADER_PARAMETERS_5(
         Value,
         FShaderParameter,
         FParameterId,
-        "_GDim",     Params_GDim,
-        "_LDim",     Params_LDim,
-        "_FillType", Params_FillType
+        "_GDim",          Params_GDim,
+        "_LDim",          Params_LDim,
+        "_BlockRect",     Params_BlockRect,
+        "_FillType",      Params_FillType,
+        "_DistanceRange", Params_DistanceRange
         )
 };
 
@@ -119,23 +125,57 @@ class FMarchingSquaresMapWriteCellCompactIdCS : public FRULBaseComputeShader<16,
         "OutEdgeCellIdData", OutEdgeCellIdData
         )
 
-    RUL_DECLARE_SHADER_PARAMETERS_2(
+    RUL_DECLARE_SHADER_PARAMETERS_3(
         Value,
         FShaderParameter,
         FParameterId,
-        "_GDim", Params_GDim,
-        "_LDim", Params_LDim
+        "_GDim",      Params_GDim,
+        "_LDim",      Params_LDim,
+        "_BlockRect", Params_BlockRect
         )
 };
 
-template<uint32 bGenerateWalls>
-class TMarchingSquaresMapTriangulateFillCellCS : public FRULBaseComputeShader<256,1,1>
+class FMarchingSquaresMapCopyBuildSumCS : public FRULBaseComputeShader<256,1,1>
+{
+    typedef FRULBaseComputeShader<256,1,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMarchingSquaresMapCopyBuildSumCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "SumData", SumData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutBuildSumData", OutBuildSumData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_3(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_BlockRect",      Params_BlockRect,
+        "_BlockOffset",    Params_BlockOffset,
+        "_ScanBlockCount", Params_ScanBlockCount
+        )
+};
+
+class FMarchingSquaresMapBakeHeightNormalCS : public FRULBaseComputeShader<16,16,1>
 {
 public:
 
-    typedef FRULBaseComputeShader<256,1,1> FBaseType;
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
 
-    DECLARE_SHADER_TYPE(TMarchingSquaresMapTriangulateFillCellCS, Global);
+    DECLARE_SHADER_TYPE(FMarchingSquaresMapBakeHeightNormalCS, Global);
 
 public:
 
@@ -147,10 +187,9 @@ public:
     static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
     {
         FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-        OutEnvironment.SetDefine(TEXT("MARCHING_SQUARES_GENERATE_WALLS"), bGenerateWalls);
     }
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER_WITH_TEXTURE(TMarchingSquaresMapTriangulateFillCellCS)
+    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER_WITH_TEXTURE(FMarchingSquaresMapBakeHeightNormalCS)
 
     RUL_DECLARE_SHADER_PARAMETERS_1(
         Texture,
@@ -166,13 +205,55 @@ public:
         "samplerHeightMap", SurfaceHeightMapSampler
         )
 
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutHeightNormalMap", OutHeightNormalMap
+        )
+
     RUL_DECLARE_SHADER_PARAMETERS_3(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_GDim",        Params_GDim,
+        "_SampleLevel", Params_SampleLevel,
+        "_HeightScale", Params_HeightScale
+        )
+};
+
+template<uint32 bGenerateWalls>
+class TMarchingSquaresMapTriangulateFillCellCS : public FRULBaseComputeShader<256,1,1>
+{
+public:
+
+    typedef FRULBaseComputeShader<256,1,1> FBaseType;
+
+    DECLARE_SHADER_TYPE(TMarchingSquaresMapTriangulateFillCellCS, Global);
+
+public:
+
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return RHISupportsComputeShaders(Parameters.Platform);
+    }
+
+    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+    {
+        FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+        OutEnvironment.SetDefine(TEXT("MARCHING_SQUARES_GENERATE_WALLS"), bGenerateWalls);
+    }
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(TMarchingSquaresMapTriangulateFillCellCS)
+
+    RUL_DECLARE_SHADER_PARAMETERS_4(
         SRV,
         FShaderResourceParameter,
         FResourceId,
-        "OffsetData",     OffsetData,
-        "SumData",        SumData,
-        "FillCellIdData", FillCellIdData
+        "HeightNormalMap", HeightNormalMap,
+        "OffsetData",      OffsetData,
+        "SumData",         SumData,
+        "FillCellIdData",  FillCellIdData
         )
 
     RUL_DECLARE_SHADER_PARAMETERS_5(
@@ -186,23 +267,22 @@ public:
         "OutIndexData",    OutIndexData
         )
 
-    RUL_DECLARE_SHADER_PARAMETERS_9(
+    RUL_DECLARE_SHADER_PARAMETERS_8(
         Value,
         FShaderParameter,
         FParameterId,
         "_GDim",          Params_GDim,
         "_LDim",          Params_LDim,
+        "_BlockRect",     Params_BlockRect,
         "_GeomCount",     Params_GeomCount,
-        "_SampleLevel",   Params_SampleLevel,
         "_FillCellCount", Params_FillCellCount,
         "_BlockOffset",   Params_BlockOffset,
-        "_HeightScale",   Params_HeightScale,
         "_HeightOffset",  Params_HeightOffset,
         "_Color",         Params_Color
         )
 };
 
-template<uint32 bGenerateWalls>
+template<uint32 bGenerateWalls, uint32 bUseDistance>
 class TMarchingSquaresMapTriangulateEdgeCellCS : public FRULBaseComputeShader<256,1,1>
 {
 public:
@@ -222,33 +302,22 @@ public:
     {
         FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
         OutEnvironment.SetDefine(TEXT("MARCHING_SQUARES_GENERATE_WALLS"), bGenerateWalls);
+        OutEnvironment.SetDefine(TEXT("MARCHING_SQUARES_USE_DISTANCE"), bUseDistance);
     }
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER_WITH_TEXTURE(TMarchingSquaresMapTriangulateEdgeCellCS)
+    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(TMarchingSquaresMapTriangulateEdgeCellCS)
 
-    RUL_DECLARE_SHADER_PARAMETERS_1(
-        Texture,
-        FShaderResourceParameter,
-        FResourceId,
-        "HeightMap", HeightMap
-        )
-
-    RUL_DECLARE_SHADER_PARAMETERS_1(
-        Sampler,
-        FShaderResourceParameter,
-        FResourceId,
-        "samplerHeightMap", SurfaceHeightMapSampler
-        )
-
-    RUL_DECLARE_SHADER_PARAMETERS_5(
+    RUL_DECLARE_SHADER_PARAMETERS_7(
         SRV,
         FShaderResourceParameter,
         FResourceId,
-        "VoxelFeatureData", VoxelFeatureData,
-        "OffsetData",       OffsetData,
-        "SumData",          SumData,
-        "EdgeCellIdData",   EdgeCellIdData,
-        "CellCaseData",     CellCaseData
+        "HeightNormalMap",   HeightNormalMap,
+        "VoxelFeatureData",  VoxelFeatureData,
+        "VoxelDistanceData", VoxelDistanceData,
+        "OffsetData",        OffsetData,
+        "SumData",           SumData,
+        "EdgeCellIdData",    EdgeCellIdData,
+        "CellCaseData",      CellCaseData
         )
 
     RUL_DECLARE_SHADER_PARAMETERS_5(
@@ -262,32 +331,64 @@ public:
         "OutIndexData",    OutIndexData
         )
 
-    RUL_DECLARE_SHADER_PARAMETERS_9(
+    RUL_DECLARE_SHADER_PARAMETERS_10(
         Value,
         FShaderParameter,
         FParameterId,
         "_GDim",          Params_GDim,
         "_LDim",          Params_LDim,
+        "_BlockRect",     Params_BlockRect,
+        "_FillType",      Params_FillType,
+        "_DistanceRange", Params_DistanceRange,
         "_GeomCount",     Params_GeomCount,
-        "_SampleLevel",   Params_SampleLevel,
         "_EdgeCellCount", Params_FillCellCount,
         "_BlockOffset",   Params_BlockOffset,
-        "_HeightScale",   Params_HeightScale,
         "_HeightOffset",  Params_HeightOffset,
         "_Color",         Params_Color
         )
 };
 
-IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapWriteCellCaseCS<0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCaseKernel"), SF_Compute);
-IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapWriteCellCaseCS<1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCaseKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapWriteCellCaseCS<0,0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCaseKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapWriteCellCaseCS<1,0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCaseKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapWriteCellCaseCS<0,1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCaseKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapWriteCellCaseCS<1,1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCaseKernel"), SF_Compute);
 
 IMPLEMENT_SHADER_TYPE(, FMarchingSquaresMapWriteCellCompactIdCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CellWriteCompactIdKernel"), SF_Compute);
 
+IMPLEMENT_SHADER_TYPE(, FMarchingSquaresMapCopyBuildSumCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("CopyBuildSumKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMarchingSquaresMapBakeHeightNormalCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("BakeHeightNormalKernel"), SF_Compute);
+
 IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateFillCellCS<0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateFillCell"), SF_Compute);
 IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateFillCellCS<1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateFillCell"), SF_Compute);
 
-IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateEdgeCellCS<0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateEdgeCell"), SF_Compute);
-IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateEdgeCellCS<1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateEdgeCell"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateEdgeCellCS<0,0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateEdgeCell"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateEdgeCellCS<1,0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateEdgeCell"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateEdgeCellCS<0,1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateEdgeCell"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMarchingSquaresMapTriangulateEdgeCellCS<1,1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresCS.usf"), TEXT("TriangulateEdgeCell"), SF_Compute);
+
+// Returns shader permutation for the specified wall and distance options
+template<template<uint32, uint32> class TShaderType>
+typename TShaderType<0,0>::FBaseType* GetMarchingSquaresMapShader(TShaderMap<FGlobalShaderType>* ShaderMap, bool bGenerateWalls, bool bUseDistance)
+{
+    if (bUseDistance)
+    {
+        return bGenerateWalls
+            ? static_cast<typename TShaderType<0,0>::FBaseType*>(*TShaderMapRef<TShaderType<1,1>>(ShaderMap))
+            : static_cast<typename TShaderType<0,0>::FBaseType*>(*TShaderMapRef<TShaderType<0,1>>(ShaderMap));
+    }
+    else
+    {
+        return bGenerateWalls
+            ? static_cast<typename TShaderType<0,0>::FBaseType*>(*TShaderMapRef<TShaderType<1,0>>(ShaderMap))
+            : static_cast<typename TShaderType<0,0>::FBaseType*>(*TShaderMapRef<TShaderType<0,0>>(ShaderMap));
+    }
+}
+
+FMarchingSquaresMap::FMarchingSquaresMap()
+{
+    VoxelMirror.OnReadbackResolved().AddRaw(this, &FMarchingSquaresMap::OnVoxelMirrorResolved_RT);
+}
 
 void FMarchingSquaresMap::SetDimension(FIntPoint InDimension)
 {
@@ -297,13 +398,109 @@ void FMarchingSquaresMap::SetDimension(FIntPoint InDimension)
     }
 }
 
+void FMarchingSquaresMap::CommitSettings()
+{
+    FMarchingSquaresMap* Map(this);
+    bool bInSectionBVH = bEnableSectionBVH;
+    bool bInCollision = bEnableCollision && bEnableVoxelMirror;
+    FMarchingSquaresCollision::FCookParameter InCollisionParameter(GetCollisionParameter());
+    bool bInNavGraph = bEnableNavGraph && bEnableVoxelMirror;
+    FMarchingSquaresNavGraph::FGraphParameter InNavGraphParameter(GetNavGraphParameter());
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_CommitSettings)(
+        [Map, bInSectionBVH, bInCollision, InCollisionParameter, bInNavGraph, InNavGraphParameter](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->bEnableSectionBVH_RT = bInSectionBVH;
+            Map->bEnableCollision_RT = bInCollision;
+            Map->CollisionParameter_RT = InCollisionParameter;
+            Map->bEnableNavGraph_RT = bInNavGraph;
+            Map->NavGraphParameter_RT = InNavGraphParameter;
+        } );
+}
+
 void FMarchingSquaresMap::SetHeightMap(FTexture2DRHIParamRef InHeightMap)
 {
+    check(IsInRenderingThread());
+
     HeightMap = InHeightMap;
+
+    // Bake the new height map, without valid dimension the height map is
+    // baked on the next build
+
+    if (HasValidDimension_RT())
+    {
+        BakeHeightNormal_RT(FRHICommandListExecutor::GetImmediateCommandList());
+    }
+}
+
+bool FMarchingSquaresMap::IsHeightNormalBaked_RT() const
+{
+    return HeightNormalTexture.IsValid()
+        && HeightNormalTexture->GetSizeX() == Dimension_RT.X
+        && HeightNormalTexture->GetSizeY() == Dimension_RT.Y
+        && HeightNormalBakedMap.GetReference() == HeightMap
+        && HeightNormalBakedScale == FVector2D(SurfaceHeightScale, ExtrudeHeightScale)
+        && HeightNormalBakedLevel == FMath::Max(0, HeightMapMipLevel);
+}
+
+void FMarchingSquaresMap::BakeHeightNormal_RT(FRHICommandListImmediate& RHICmdList)
+{
+    check(IsInRenderingThread());
+    check(HasValidDimension_RT());
+
+    const FIntPoint Dimension(Dimension_RT);
+
+    // Create bake texture at map resolution, 8 bytes per voxel with half
+    // float heights and octahedral packed normals
+
+    if (! HeightNormalTexture.IsValid() ||
+        HeightNormalTexture->GetSizeX() != Dimension.X ||
+        HeightNormalTexture->GetSizeY() != Dimension.Y)
+    {
+        FRHIResourceCreateInfo CreateInfo;
+        HeightNormalTexture = RHICreateTexture2D(
+            Dimension.X,
+            Dimension.Y,
+            PF_R32G32_UINT,
+            1,
+            1,
+            TexCreate_ShaderResource | TexCreate_UAV,
+            CreateInfo
+            );
+
+        HeightNormalUAV = RHICreateUnorderedAccessView(HeightNormalTexture);
+        HeightNormalSRV = RHICreateShaderResourceView(HeightNormalTexture, 0);
+    }
+
+    FSamplerStateRHIParamRef HeightMapSampler = TStaticSamplerState<SF_Bilinear,AM_Clamp,AM_Clamp,AM_Clamp>::GetRHI();
+
+    FVector2D HeightScale;
+    HeightScale.X = SurfaceHeightScale;
+    HeightScale.Y = ExtrudeHeightScale;
+
+    uint32 SampleLevel = FMath::Max(0, HeightMapMipLevel);
+
+    RHICmdList.BeginComputePass(TEXT("MarchingSquaresMapBakeHeightNormal"));
+
+    TShaderMapRef<FMarchingSquaresMapBakeHeightNormalCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+    ComputeShader->SetShader(RHICmdList);
+    ComputeShader->BindTexture(RHICmdList, TEXT("HeightMap"), TEXT("samplerHeightMap"), HeightMap, HeightMapSampler);
+    ComputeShader->BindUAV(RHICmdList, TEXT("OutHeightNormalMap"), HeightNormalUAV);
+    ComputeShader->SetParameter(RHICmdList, TEXT("_GDim"),        Dimension);
+    ComputeShader->SetParameter(RHICmdList, TEXT("_SampleLevel"), SampleLevel);
+    ComputeShader->SetParameter(RHICmdList, TEXT("_HeightScale"), HeightScale);
+    ComputeShader->DispatchAndClear(RHICmdList, Dimension.X, Dimension.Y, 1);
+
+    RHICmdList.EndComputePass();
+
+    HeightNormalBakedMap = HeightMap;
+    HeightNormalBakedScale = HeightScale;
+    HeightNormalBakedLevel = SampleLevel;
 }
 
 void FMarchingSquaresMap::ClearMap()
 {
+    ClearCPUVoxelData();
+
     FMarchingSquaresMap* Map(this);
     ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_ClearMap)(
         [Map](FRHICommandListImmediate& RHICmdList)
@@ -318,24 +515,86 @@ void FMarchingSquaresMap::InitializeVoxelData()
 
     FMarchingSquaresMap* Map(this);
     FIntPoint Dimension(Dimension_GT);
+    int32 LayerCount = FMath::Max(0, DistanceLayerCount);
+    float Range = FMath::Max(KINDA_SMALL_NUMBER, DistanceRange);
+    int32 InHistoryLimit = FMath::Max(0, HistoryLimit);
+    bool bInVoxelMirror = bEnableVoxelMirror;
     ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_InitializeVoxelData)(
-        [Map, Dimension](FRHICommandListImmediate& RHICmdList)
+        [Map, Dimension, LayerCount, Range, InHistoryLimit, bInVoxelMirror](FRHICommandListImmediate& RHICmdList)
         {
-            Map->InitializeVoxelData_RT(RHICmdList, Dimension);
+            Map->InitializeVoxelData_RT(RHICmdList, Dimension, LayerCount, Range, InHistoryLimit, bInVoxelMirror);
         } );
 }
 
+void FMarchingSquaresMap::InitializeCPUVoxelData()
+{
+    check(HasValidDimension());
+
+    if (HasCPUVoxelData())
+    {
+        return;
+    }
+
+    const int32 VoxelCount = GetVoxelCount();
+
+    // Initialize with the same default data as the GPU voxel data
+
+    CPUVoxelData.Dimension = Dimension_GT;
+
+    CPUVoxelData.VoxelStateData.Reset(VoxelCount);
+    CPUVoxelData.VoxelStateData.SetNumZeroed(VoxelCount);
+
+    CPUVoxelData.VoxelFeatureData.Reset(VoxelCount);
+    CPUVoxelData.VoxelFeatureData.SetNumUninitialized(VoxelCount);
+    FMemory::Memset(CPUVoxelData.VoxelFeatureData.GetData(), 0xFF, VoxelCount * CPUVoxelData.VoxelFeatureData.GetTypeSize());
+
+    // Inside of fill type zero, outside of the others
+
+    CPUVoxelData.DistanceLayerCount = FMath::Max(0, DistanceLayerCount);
+    CPUVoxelData.DistanceRange = FMath::Max(KINDA_SMALL_NUMBER, DistanceRange);
+
+    const int32 LayerSize = CPUVoxelData.GetDistancePairStride() * Dimension_GT.Y;
+    const int32 DistanceDataCount = LayerSize * CPUVoxelData.DistanceLayerCount;
+
+    CPUVoxelData.VoxelDistanceData.Reset(DistanceDataCount);
+    CPUVoxelData.VoxelDistanceData.SetNumUninitialized(DistanceDataCount);
+
+    for (int32 i=0; i<DistanceDataCount; ++i)
+    {
+        CPUVoxelData.VoxelDistanceData[i] = (i < LayerSize) ? 0x80018001 : 0x7FFF7FFF;
+    }
+}
+
+void FMarchingSquaresMap::ClearCPUVoxelData()
+{
+    CPUVoxelData.Dimension = FIntPoint::ZeroValue;
+    CPUVoxelData.VoxelStateData.Empty();
+    CPUVoxelData.VoxelFeatureData.Empty();
+    CPUVoxelData.DistanceLayerCount = 0;
+    CPUVoxelData.VoxelDistanceData.Empty();
+}
+
 void FMarchingSquaresMap::ClearMap_RT(FRHICommandListImmediate& RHICmdList)
 {
+    PendingBuilds.Empty();
+    History.Clear_RT();
+    VoxelMirror.Release_RT();
+
     VoxelStateData.Release();
     VoxelFeatureData.Release();
+    VoxelDistanceData.Release();
 
     DebugRTTRHI = nullptr;
 	DebugTextureRHI.SafeRelease();
     DebugTextureUAV.SafeRelease();
+
+    HeightNormalSRV.SafeRelease();
+    HeightNormalUAV.SafeRelease();
+    HeightNormalTexture.SafeRelease();
+    HeightNormalBakedMap.SafeRelease();
 }
 
-void FMarchingSquaresMap::InitializeVoxelData_RT(FRHICommandListImmediate& RHICmdList, FIntPoint InDimension)
+void FMarchingSquaresMap::InitializeVoxelData_RT(FRHICommandListImmediate& RHICmdList, FIntPoint InDimension, int32 InDistanceLayerCount, float InDistanceRange, int32 InHistoryLimit, bool bInVoxelMirror)
 {
     check(IsInRenderingThread());
 
@@ -345,10 +604,31 @@ void FMarchingSquaresMap::InitializeVoxelData_RT(FRHICommandListImmediate& RHICm
     {
         VoxelStateData.Release();
         VoxelFeatureData.Release();
+        VoxelDistanceData.Release();
 
         Dimension_RT = InDimension;
     }
 
+    // History is cleared if the history block layout, distance layer count
+    // or limit has changed
+
+    History.Configure_RT(Dimension_RT, BlockSize, InDistanceLayerCount, InHistoryLimit);
+
+    // Distance layout or range changes invalidate distance data
+
+    if (DistanceLayerCount_RT != InDistanceLayerCount || DistanceRange_RT != InDistanceRange)
+    {
+        VoxelDistanceData.Release();
+
+        DistanceLayerCount_RT = InDistanceLayerCount;
+        DistanceRange_RT = InDistanceRange;
+    }
+
+    // Voxel mirror is reset and scheduled for a full readback if it has
+    // been enabled or the dimension or distance layout has changed
+
+    VoxelMirror.Configure_RT(Dimension_RT, DistanceLayerCount_RT, DistanceRange_RT, bInVoxelMirror);
+
     check(HasValidDimension_RT());
 
     FIntPoint Dimension = Dimension_RT;
@@ -404,21 +684,427 @@ void FMarchingSquaresMap::InitializeVoxelData_RT(FRHICommandListImmediate& RHICm
             TEXT("VoxelFeatureData")
             );
     }
-}
 
-void FMarchingSquaresMap::BuildMap(int32 FillType, bool bGenerateWalls)
-{
-    uint32 BuildFillType = FMath::Max(0, FillType);
-    bool bCallResult = BuildMapExec(BuildFillType, bGenerateWalls);
+    // Construct voxel distance data
+    //
+    // Two voxels are packed per element as 16-bit SNORM, see
+    // MarchingSquaresCommon.ush. All voxels are initialized with empty
+    // fill type state: inside of fill type zero, outside of the others.
+
+    if (DistanceLayerCount_RT > 0 && ! VoxelDistanceData.IsValid())
+    {
+        const int32 PairStride = (Dimension.X+1) / 2;
+        const int32 LayerSize  = PairStride * Dimension.Y;
+        const int32 DistanceDataCount = LayerSize * DistanceLayerCount_RT;
+
+        const uint32 InsideValue  = 0x80018001;
+        const uint32 OutsideValue = 0x7FFF7FFF;
+
+        FVoxelData VoxelDistanceDefaultData(false);
+        VoxelDistanceDefaultData.SetNumUninitialized(DistanceDataCount);
+
+        for (int32 i=0; i<DistanceDataCount; ++i)
+        {
+            VoxelDistanceDefaultData[i] = (i < LayerSize) ? InsideValue : OutsideValue;
+        }
+
+        VoxelDistanceData.Initialize(
+            sizeof(FVoxelData::ElementType),
+            DistanceDataCount,
+            PF_R32_UINT,
+            &VoxelDistanceDefaultData,
+            BUF_Static,
+            TEXT("VoxelDistanceData")
+            );
+    }
+
+    // Start voxel mirror readback of existing voxel data
+
+    VoxelMirror.Update_RT(RHICmdList, VoxelStateData, VoxelFeatureData, VoxelDistanceData);
+}
+
+void FMarchingSquaresMap::BuildMap(int32 FillType, bool bGenerateWalls)
+{
+    uint32 BuildFillType = FMath::Max(0, FillType);
+    bool bCallResult = BuildMapExec(BuildFillType, bGenerateWalls, FIntRect(FIntPoint::ZeroValue, GetBlockCount()), false);
+
+    // Call failed, broadcast build map done event
+    if (! bCallResult)
+    {
+        BuildMapDoneEvent.Broadcast(false, BuildFillType);
+    }
+}
+
+void FMarchingSquaresMap::BuildMapRect(int32 FillType, bool bGenerateWalls, const FIntRect& VoxelRect)
+{
+    uint32 BuildFillType = FMath::Max(0, FillType);
+    FIntRect BlockRect(GetBlockRect(VoxelRect));
+    bool bCallResult = false;
+
+    // Skip build if voxel bounds does not overlap any block
+    if (BlockRect.Area() > 0)
+    {
+        bCallResult = BuildMapExec(BuildFillType, bGenerateWalls, BlockRect, true);
+    }
+
+    // Call failed, broadcast build map rect done event
+    if (! bCallResult)
+    {
+        BuildMapRectDoneEvent.Broadcast(false, BuildFillType, BlockRect);
+    }
+}
+
+FIntRect FMarchingSquaresMap::GetBlockRect(const FIntRect& VoxelRect) const
+{
+    return CalculateBlockRect(VoxelRect, GetBlockCount());
+}
+
+FIntRect FMarchingSquaresMap::CalculateBlockRect(const FIntRect& VoxelRect, const FIntPoint& BlockCount) const
+{
+    const int32 CellBlockSize = BlockSize-1;
+
+    if (CellBlockSize < 1 || BlockCount.X < 1 || BlockCount.Y < 1)
+    {
+        return FIntRect();
+    }
+
+    // Voxels are shared by the cells on both sides of the voxel, grow
+    // voxel bounds by a single cell before converting to block unit.
+    // Block rect max is exclusive.
+
+    FIntRect BlockRect;
+    BlockRect.Min.X = FMath::Clamp((VoxelRect.Min.X-1) / CellBlockSize, 0, BlockCount.X);
+    BlockRect.Min.Y = FMath::Clamp((VoxelRect.Min.Y-1) / CellBlockSize, 0, BlockCount.Y);
+    BlockRect.Max.X = FMath::Clamp(((VoxelRect.Max.X-1) / CellBlockSize) + 1, 0, BlockCount.X);
+    BlockRect.Max.Y = FMath::Clamp(((VoxelRect.Max.Y-1) / CellBlockSize) + 1, 0, BlockCount.Y);
+
+    if (BlockRect.Min.X >= BlockRect.Max.X || BlockRect.Min.Y >= BlockRect.Max.Y)
+    {
+        return FIntRect();
+    }
+
+    return BlockRect;
+}
+
+void FMarchingSquaresMap::BeginHistoryGroup()
+{
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_BeginHistoryGroup)(
+        [Map](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->History.BeginGroup_RT();
+        } );
+}
+
+void FMarchingSquaresMap::EndHistoryGroup()
+{
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_EndHistoryGroup)(
+        [Map](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->History.EndGroup_RT(*Map);
+        } );
+}
+
+void FMarchingSquaresMap::UndoHistory(const TArray<uint32>& BuildFillTypes, bool bGenerateWalls)
+{
+    if (! HasValidDimension())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMap::UndoHistory() ABORTED - Invalid map dimension"));
+        return;
+    }
+
+    // Queued history applies write CPU voxel data on the render thread
+    PendingHistoryApplyCount.Increment();
+
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_UndoHistory)(
+        [Map, BuildFillTypes, bGenerateWalls](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->ApplyHistory_RT(RHICmdList, true, BuildFillTypes, bGenerateWalls);
+            Map->PendingHistoryApplyCount.Decrement();
+        } );
+}
+
+void FMarchingSquaresMap::RedoHistory(const TArray<uint32>& BuildFillTypes, bool bGenerateWalls)
+{
+    if (! HasValidDimension())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMap::RedoHistory() ABORTED - Invalid map dimension"));
+        return;
+    }
+
+    // Queued history applies write CPU voxel data on the render thread
+    PendingHistoryApplyCount.Increment();
+
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_RedoHistory)(
+        [Map, BuildFillTypes, bGenerateWalls](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->ApplyHistory_RT(RHICmdList, false, BuildFillTypes, bGenerateWalls);
+            Map->PendingHistoryApplyCount.Decrement();
+        } );
+}
+
+void FMarchingSquaresMap::ClearHistory()
+{
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_ClearHistory)(
+        [Map](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->History.Clear_RT();
+        } );
+}
+
+void FMarchingSquaresMap::BeginVoxelEditCPU(const FIntRect& VoxelRect)
+{
+    check(IsInGameThread());
+
+    if (HistoryLimit < 1 || ! HasCPUVoxelData())
+    {
+        return;
+    }
+
+    // Wait for queued history applies to finish writing CPU voxel data
+    if (PendingHistoryApplyCount.GetValue() > 0)
+    {
+        FlushRenderingCommands();
+    }
+
+    History.BeginEditCPU(CPUVoxelData, VoxelRect, BlockSize);
+}
+
+void FMarchingSquaresMap::EndVoxelEditCPU()
+{
+    check(IsInGameThread());
+
+    TArray<FMarchingSquaresMapHistory::FBlockDelta> Blocks;
+    History.EndEditCPU(CPUVoxelData, Blocks);
+
+    if (Blocks.Num() < 1)
+    {
+        return;
+    }
+
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_EndVoxelEditCPU)(
+        [Map, Blocks](FRHICommandListImmediate& RHICmdList) mutable
+        {
+            Map->History.AddEditCPU_RT(*Map, Blocks);
+        } );
+}
+
+void FMarchingSquaresMap::BeginVoxelEdit_RT(const FIntRect& VoxelRect)
+{
+    VoxelEditRect_RT = VoxelRect;
+    History.BeginEdit_RT(*this, VoxelRect);
+}
+
+void FMarchingSquaresMap::EndVoxelEdit_RT()
+{
+    History.EndEdit_RT(*this);
+
+    if (VoxelMirror.IsEnabled_RT())
+    {
+        VoxelMirror.MarkDirty_RT(VoxelEditRect_RT);
+        VoxelMirror.Update_RT(FRHICommandListExecutor::GetImmediateCommandList(), VoxelStateData, VoxelFeatureData, VoxelDistanceData);
+    }
+}
+
+void FMarchingSquaresMap::UpdateVoxelMirror()
+{
+    FMarchingSquaresMap* Map(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_UpdateVoxelMirror)(
+        [Map](FRHICommandListImmediate& RHICmdList)
+        {
+            Map->VoxelMirror.Update_RT(RHICmdList, Map->VoxelStateData, Map->VoxelFeatureData, Map->VoxelDistanceData);
+            Map->History.Update_RT();
+        } );
+}
+
+bool FMarchingSquaresMap::UpdateVoxelStats(TFunction<void()> OnComplete)
+{
+    if (! bEnableVoxelMirror)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMap::UpdateVoxelStats() ABORTED - Voxel mirror is disabled"));
+        return false;
+    }
+
+    return VoxelStats.UpdateAsync(VoxelMirror, OnComplete);
+}
+
+bool FMarchingSquaresMap::UpdateVoxelComponents(TFunction<void()> OnComplete)
+{
+    if (! bEnableVoxelMirror)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMap::UpdateVoxelComponents() ABORTED - Voxel mirror is disabled"));
+        return false;
+    }
+
+    return VoxelComponents.UpdateAsync(VoxelMirror, OnComplete);
+}
+
+bool FMarchingSquaresMap::UpdateCollision()
+{
+    if (! bEnableVoxelMirror)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMap::UpdateCollision() ABORTED - Voxel mirror is disabled"));
+        return false;
+    }
+
+    return UpdateCollisionAsync(GetCollisionParameter());
+}
+
+FMarchingSquaresCollision::FCookParameter FMarchingSquaresMap::GetCollisionParameter() const
+{
+    FMarchingSquaresCollision::FCookParameter CookParameter;
+    CookParameter.FillType = static_cast<uint8>(FMath::Clamp(CollisionFillType, 0, 0xFF));
+    CookParameter.BlockSize = BlockSize;
+    CookParameter.BlockCount = GetBlockCount();
+    CookParameter.SimplifyTolerance = CollisionSimplifyTolerance;
+    CookParameter.MaxPolygonPointCount = CollisionMaxPolygonPointCount;
+    return CookParameter;
+}
+
+bool FMarchingSquaresMap::UpdateCollisionAsync(const FMarchingSquaresCollision::FCookParameter& CookParameter)
+{
+    FMarchingSquaresMap* Map(this);
+
+    return Collision.UpdateAsync(
+        VoxelMirror,
+        CookParameter,
+        [Map]()
+        {
+            Map->CollisionUpdatedEvent.Broadcast(Map->Collision.GetChangedBlocks());
+        } );
+}
+
+bool FMarchingSquaresMap::UpdateNavGraph()
+{
+    if (! bEnableVoxelMirror)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMap::UpdateNavGraph() ABORTED - Voxel mirror is disabled"));
+        return false;
+    }
+
+    return UpdateNavGraphAsync(GetNavGraphParameter());
+}
+
+FMarchingSquaresNavGraph::FGraphParameter FMarchingSquaresMap::GetNavGraphParameter() const
+{
+    FMarchingSquaresNavGraph::FGraphParameter GraphParameter;
+    GraphParameter.PassableFillTypes = NavPassableFillTypes;
+    return GraphParameter;
+}
+
+bool FMarchingSquaresMap::UpdateNavGraphAsync(const FMarchingSquaresNavGraph::FGraphParameter& GraphParameter)
+{
+    FMarchingSquaresMap* Map(this);
+
+    return NavGraph.UpdateAsync(
+        VoxelMirror,
+        GraphParameter,
+        [Map]()
+        {
+            Map->NavGraphUpdatedEvent.Broadcast(Map->NavGraph.GetChangedBlocks());
+        } );
+}
+
+void FMarchingSquaresMap::OnVoxelMirrorResolved_RT(const TArray<FIntPoint>& ResolvedBlocks)
+{
+    check(IsInRenderingThread());
+
+    // Cook and navigation graph update use mirror block revisions to only
+    // rebuild blocks written by the resolved readback
+
+    if (bEnableCollision_RT)
+    {
+        UpdateCollisionAsync(CollisionParameter_RT);
+    }
+
+    if (bEnableNavGraph_RT)
+    {
+        UpdateNavGraphAsync(NavGraphParameter_RT);
+    }
+}
+
+void FMarchingSquaresMap::UpdateVoxelMirrorCPU(const FIntRect& VoxelRect)
+{
+    if (bEnableVoxelMirror && HasCPUVoxelData())
+    {
+        VoxelMirror.CopyVoxelData(CPUVoxelData, VoxelRect);
+
+        if (bEnableCollision)
+        {
+            UpdateCollision();
+        }
+
+        if (bEnableNavGraph)
+        {
+            UpdateNavGraph();
+        }
+    }
+}
+
+void FMarchingSquaresMap::ApplyHistory_RT(FRHICommandListImmediate& RHICmdList, bool bUndo, const TArray<uint32>& BuildFillTypes, bool bGenerateWalls)
+{
+    check(IsInRenderingThread());
+
+    FIntRect VoxelRect;
+    FIntRect CPUVoxelRect;
+
+    const bool bApplied = bUndo
+        ? History.Undo_RT(*this, VoxelRect, CPUVoxelRect)
+        : History.Redo_RT(*this, VoxelRect, CPUVoxelRect);
+
+    if (! bApplied)
+    {
+        return;
+    }
+
+    // Copy restored CPU voxel data to the voxel mirror, GPU voxel data
+    // mirror blocks are refreshed by the mirror readback instead
+
+    if (CPUVoxelRect.Area() > 0 && VoxelMirror.IsEnabled_RT() && CPUVoxelData.IsValid())
+    {
+        VoxelMirror.CopyVoxelData(CPUVoxelData, CPUVoxelRect);
+
+        if (bEnableCollision_RT)
+        {
+            UpdateCollisionAsync(CollisionParameter_RT);
+        }
+
+        if (bEnableNavGraph_RT)
+        {
+            UpdateNavGraphAsync(NavGraphParameter_RT);
+        }
+    }
+
+    if (VoxelRect.Area() <= 0)
+    {
+        return;
+    }
+
+    if (VoxelMirror.IsEnabled_RT())
+    {
+        VoxelMirror.MarkDirty_RT(VoxelRect);
+        VoxelMirror.Update_RT(RHICmdList, VoxelStateData, VoxelFeatureData, VoxelDistanceData);
+    }
+
+    // Rebuild only sections of the restored blocks
 
-    // Call failed, broadcast build map done event
-    if (! bCallResult)
+    const FIntRect BlockRect(CalculateBlockRect(VoxelRect, GetBlockCount_RT()));
+
+    if (BlockRect.Area() > 0)
     {
-        BuildMapDoneEvent.Broadcast(false, BuildFillType);
+        for (uint32 FillType : BuildFillTypes)
+        {
+            BuildMap_RT(RHICmdList, FillType, bGenerateWalls, BlockRect, true, GMaxRHIFeatureLevel);
+        }
     }
 }
 
-bool FMarchingSquaresMap::BuildMapExec(uint32 FillType, bool bGenerateWalls)
+bool FMarchingSquaresMap::BuildMapExec(uint32 FillType, bool bGenerateWalls, const FIntRect& BlockRect, bool bPartialBuild)
 {
     if (! HasValidDimension())
     {
@@ -428,15 +1114,22 @@ bool FMarchingSquaresMap::BuildMapExec(uint32 FillType, bool bGenerateWalls)
 
     FMarchingSquaresMap* Map(this);
     ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_BuildMap)(
-        [Map, FillType, bGenerateWalls](FRHICommandListImmediate& RHICmdList)
+        [Map, FillType, bGenerateWalls, BlockRect, bPartialBuild](FRHICommandListImmediate& RHICmdList)
         {
-            Map->BuildMap_RT(RHICmdList, FillType, bGenerateWalls, GMaxRHIFeatureLevel);
+            Map->BuildMap_RT(RHICmdList, FillType, bGenerateWalls, BlockRect, bPartialBuild, GMaxRHIFeatureLevel);
         } );
 
     return true;
 }
 
-void FMarchingSquaresMap::BuildMap_RT(FRHICommandListImmediate& RHICmdList, uint32 FillType, bool bGenerateWalls, ERHIFeatureLevel::Type InFeatureLevel)
+void FMarchingSquaresMap::BuildMap_RT(
+    FRHICommandListImmediate& RHICmdList,
+    uint32 FillType,
+    bool bGenerateWalls,
+    FIntRect BlockRect,
+    bool bPartialBuild,
+    ERHIFeatureLevel::Type InFeatureLevel
+    )
 {
     checkf(VoxelStateData.IsValid()  , TEXT("FMarchingSquaresMap::BuildMap() ABORTED - Dimension has been updated and InitializeVoxelData() has not been called"));
     checkf(VoxelFeatureData.IsValid(), TEXT("FMarchingSquaresMap::BuildMap() ABORTED - Dimension has been updated and InitializeVoxelData() has not been called"));
@@ -448,7 +1141,20 @@ void FMarchingSquaresMap::BuildMap_RT(FRHICommandListImmediate& RHICmdList, uint
 
     check(RHIShaderMap != nullptr);
 
-    GenerateMarchingCubes_RT(FillType, bGenerateWalls);
+    // Dispatch cell case and geometry count scan, triangulation is
+    // dispatched once the scan sum readback has finished and sections are
+    // copied out once the geometry readback has finished, see
+    // UpdatePendingBuilds_RT()
+
+    TSharedRef<FPendingBuild> Build(MakeShareable(new FPendingBuild));
+    Build->FillType = FillType;
+    Build->bPartialBuild = bPartialBuild;
+    Build->FeatureLevel = InFeatureLevel;
+
+    GenerateMarchingCubes_RT(FillType, bGenerateWalls, BlockRect, *Build);
+
+    Build->BlockRect = BlockRect;
+    PendingBuilds.Emplace(Build);
 
     // Copy resolve debug texture to debug rtt
 
@@ -468,10 +1174,141 @@ void FMarchingSquaresMap::BuildMap_RT(FRHICommandListImmediate& RHICmdList, uint
     RHICmdListPtr = nullptr;
     RHIShaderMap  = nullptr;
 
-    BuildMapDoneEvent.Broadcast(true, FillType);
+    SchedulePendingBuildUpdate_RT();
+}
+
+void FMarchingSquaresMap::SchedulePendingBuildUpdate_RT()
+{
+    check(IsInRenderingThread());
+
+    if (bPendingBuildUpdateScheduled)
+    {
+        return;
+    }
+
+    bPendingBuildUpdateScheduled = true;
+
+    // Poll pending builds on the next game thread tick, triangulation and
+    // copy-out are each deferred by at least a frame
+
+    FMarchingSquaresMap* Map(this);
+    FGWTTickManager& TickManager(IGenericWorkerThread::Get().GetTickManager());
+    FGWTTickManager::FTickCallback TickCallback(
+        [Map]()
+        {
+            ENQUEUE_RENDER_COMMAND(FMarchingSquaresMap_UpdatePendingBuilds)(
+                [Map](FRHICommandListImmediate& RHICmdList)
+                {
+                    Map->UpdatePendingBuilds_RT(RHICmdList);
+                } );
+        } );
+    TickManager.EnqueueTickCallback(TickCallback);
+}
+
+void FMarchingSquaresMap::UpdatePendingBuilds_RT(FRHICommandListImmediate& RHICmdList)
+{
+    check(IsInRenderingThread());
+
+    bPendingBuildUpdateScheduled = false;
+
+    // Triangulate builds whose scan sums have been read back, scan data
+    // is no longer required once the triangulation has been dispatched
+
+    for (const TSharedRef<FPendingBuild>& Build : PendingBuilds)
+    {
+        if (! Build->bTriangulated && Build->IsSumReadbackReady())
+        {
+            TriangulateBuild_RT(RHICmdList, *Build);
+
+            Build->CellCaseData.Release();
+            Build->OffsetData.Release();
+            Build->SumData.Release();
+        }
+    }
+
+    // Builds are resolved in dispatch order, later builds of the same
+    // sections overwrite earlier ones
+
+    while (PendingBuilds.Num() > 0 && PendingBuilds[0]->IsReadbackReady())
+    {
+        TSharedRef<FPendingBuild> Build(PendingBuilds[0]);
+        PendingBuilds.RemoveAt(0, 1, false);
+
+        ResolveBuild_RT(*Build);
+    }
+
+    if (PendingBuilds.Num() > 0)
+    {
+        SchedulePendingBuildUpdate_RT();
+    }
+}
+
+void FMarchingSquaresMap::ResolveBuild_RT(FPendingBuild& Build)
+{
+    const uint32 FillType = Build.FillType;
+    const FIntRect& BlockRect(Build.BlockRect);
+
+    // Sections have been cleared or rebuilt with a different layout, or
+    // the map has been resized since the build was dispatched, discard
+    // build geometry
+
+    const bool bResized = Build.BlockSize > 0 && Build.Dimension != Dimension_RT;
+
+    if (bResized || ! SectionGroups.IsValidIndex(FillType) || SectionGroups[FillType].Num() != Build.SectionCount)
+    {
+        if (Build.bPartialBuild)
+        {
+            BuildMapRectDoneEvent.Broadcast(false, FillType, BlockRect);
+        }
+        else
+        {
+            BuildMapDoneEvent.Broadcast(false, FillType);
+        }
+        return;
+    }
+
+    CopySections_RT(Build);
+
+    // Rebuild section trees of the built sections, block rect is clipped
+    // to the sections rebuilt by the build
+
+    if (bEnableSectionBVH_RT)
+    {
+        const TArray<FPMUMeshSection>& Sections(SectionGroups[FillType]);
+        const FIntPoint GridCount2D(GetBlockCount_RT());
+        const int32 GridCountX = GridCount2D.X;
+        const int32 GridCount  = GridCount2D.X * GridCount2D.Y;
+
+        TArray<int32> SectionIndices;
+
+        for (int32 gy=BlockRect.Min.Y; gy<BlockRect.Max.Y; ++gy)
+        for (int32 gx=BlockRect.Min.X; gx<BlockRect.Max.X; ++gx)
+        {
+            const int32 i = gx + gy*GridCountX;
+
+            SectionIndices.Emplace(i);
+
+            // Extrude section of dual mesh builds
+            if (Sections.Num() > GridCount)
+            {
+                SectionIndices.Emplace(i+GridCount);
+            }
+        }
+
+        SectionBVH.UpdateSections(FillType, Sections, SectionIndices);
+    }
+
+    if (Build.bPartialBuild)
+    {
+        BuildMapRectDoneEvent.Broadcast(true, FillType, BlockRect);
+    }
+    else
+    {
+        BuildMapDoneEvent.Broadcast(true, FillType);
+    }
 }
 
-void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGenerateWalls)
+void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGenerateWalls, FIntRect& BlockRect, FPendingBuild& OutBuild)
 {
     check(IsInRenderingThread());
     check(RHICmdListPtr != nullptr);
@@ -480,17 +1317,92 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
     check(HasValidDimension_RT());
 
     FIntPoint Dimension = Dimension_RT;
-    int32 VoxelCount = GetVoxelCount();
 
     FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
 
     const bool bUseDualMesh = ! bInGenerateWalls;
 
+    // Prepare mesh sections
+
+    int32 GridCountX = (Dimension.X / BlockSize);
+    int32 GridCountY = (Dimension.Y / BlockSize);
+    int32 GridCount  = (GridCountX * GridCountY);
+    int32 TotalGridCount = GridCount;
+
+    if (bUseDualMesh)
+    {
+        TotalGridCount *= 2;
+    }
+
+    if (! SectionGroups.IsValidIndex(FillType))
+    {
+        SectionGroups.SetNum(FillType+1, false);
+    }
+
+    TArray<FPMUMeshSection>& SectionSections(SectionGroups[FillType]);
+
+    OutBuild.bUseDualMesh = bUseDualMesh;
+    OutBuild.SectionCount = TotalGridCount;
+
+    // Clamp build block rect to the map blocks. Partial build requires
+    // sections built with the same mesh type, build the whole map otherwise.
+
+    const FIntRect MapBlockRect(FIntPoint::ZeroValue, FIntPoint(GridCountX, GridCountY));
+
+    BlockRect.Clip(MapBlockRect);
+
+    if (SectionSections.Num() != TotalGridCount)
+    {
+        BlockRect = MapBlockRect;
+    }
+
+    if (BlockRect == MapBlockRect)
+    {
+        SectionSections.Reset(TotalGridCount);
+        SectionSections.SetNum(TotalGridCount);
+    }
+    else
+    {
+        for (int32 gy=BlockRect.Min.Y; gy<BlockRect.Max.Y; ++gy)
+        for (int32 gx=BlockRect.Min.X; gx<BlockRect.Max.X; ++gx)
+        {
+            int32 i = gx + gy*GridCountX;
+
+            SectionSections[i] = FPMUMeshSection();
+
+            if (bUseDualMesh)
+            {
+                SectionSections[i+GridCount] = FPMUMeshSection();
+            }
+        }
+    }
+
+    // Empty block rect, return
+    if (BlockRect.Area() <= 0)
+    {
+        OutBuild.bTriangulated = true;
+        return;
+    }
+
+    // Build dispatch covers block rect only, each block is dispatched
+    // with BlockSize^2 threads and writes to block-linear cell data
+
+    const FIntPoint BuildBlockCount = BlockRect.Size();
+    const FIntPoint BuildDim = BuildBlockCount * BlockSize;
+    const FIntVector4 BuildBlockRect(BlockRect.Min.X, BlockRect.Min.Y, BuildBlockCount.X, BuildBlockCount.Y);
+
+    // Cell data count of the build block rect
+    int32 VoxelCount = BuildDim.X * BuildDim.Y;
+
+    // Use voxel distance data if the build fill type has a distance layer
+
+    const bool bUseDistance = HasVoxelDistanceData_RT() && (FillType < uint32(DistanceLayerCount_RT));
+
     typedef TResourceArray<FRULAlignedUint, VERTEXBUFFER_ALIGNMENT> FIndexData;
 
     // Construct cell case data
 
-    FRULRWBuffer CellCaseData;
+    FRULRWBuffer& CellCaseData(OutBuild.CellCaseData);
     CellCaseData.Initialize(
         sizeof(FIndexData::ElementType),
         VoxelCount,
@@ -520,33 +1432,28 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
 
     RHICmdList.BeginComputePass(TEXT("MarchingSquaresMapWriteCellCase"));
     {
-        TMarchingSquaresMapWriteCellCaseCS<0>::FBaseType* ComputeShader;
-
-        if (bUseDualMesh)
-        {
-            ComputeShader = *TShaderMapRef<TMarchingSquaresMapWriteCellCaseCS<0>>(RHIShaderMap);
-        }
-        else
-        {
-            ComputeShader = *TShaderMapRef<TMarchingSquaresMapWriteCellCaseCS<1>>(RHIShaderMap);
-        }
+        TMarchingSquaresMapWriteCellCaseCS<0,0>::FBaseType* ComputeShader;
+        ComputeShader = GetMarchingSquaresMapShader<TMarchingSquaresMapWriteCellCaseCS>(RHIShaderMap, ! bUseDualMesh, bUseDistance);
 
         ComputeShader->SetShader(RHICmdList);
         ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelDistanceData"), VoxelDistanceData.SRV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutCellCaseData"), CellCaseData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutGeomCountData"), GeomCountData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutDebugTexture"), DebugTextureUAV);
         ComputeShader->SetParameter(RHICmdList, TEXT("_GDim"), Dimension);
         ComputeShader->SetParameter(RHICmdList, TEXT("_LDim"), FIntPoint(BlockSize, BlockSize));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockRect"), BuildBlockRect);
         ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), FillType);
-        ComputeShader->DispatchAndClear(RHICmdList, Dimension.X, Dimension.Y, 1);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceRange"), DistanceRange_RT);
+        ComputeShader->DispatchAndClear(RHICmdList, BuildDim.X, BuildDim.Y, 1);
     }
     RHICmdList.EndComputePass();
 
     // Scan cell geometry count data to generate geometry offset and sum data
 
-    FRULRWBufferStructured OffsetData;
-    FRULRWBufferStructured SumData;
+    FRULRWBufferStructured& OffsetData(OutBuild.OffsetData);
+    FRULRWBufferStructured& SumData(OutBuild.SumData);
 
     const int32 ScanBlockCount = FRULPrefixSumScan::ExclusiveScan4D(
         GeomCountData.SRV,
@@ -557,34 +1464,114 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
         BUF_Static
         );
 
-    // Get geometry count scan sum data
-
     check(ScanBlockCount > 0);
-    check(SumData.Buffer->GetStride() > 0);
 
-    const int32 SumDataCount = SumData.Buffer->GetSize() / SumData.Buffer->GetStride();
-    FGeomCountData SumArr;
-    SumArr.SetNumUninitialized(SumDataCount);
+    const int32 BlockOffset = FRULPrefixSumScan::GetBlockOffsetForSize(BlockSize*BlockSize);
 
-    check(SumDataCount > 0);
+    // Copy scan sums of each build block and the build total to a buffer
+    // that can be read back. Sum data sizes the geometry buffers, the
+    // triangulation is dispatched once the sum readback has finished
+    // instead of locking sum data and waiting for the GPU.
 
-    void* SumDataPtr = RHILockStructuredBuffer(SumData.Buffer, 0, SumData.Buffer->GetSize(), RLM_ReadOnly);
-    FMemory::Memcpy(SumArr.GetData(), SumDataPtr, SumData.Buffer->GetSize());
-    RHIUnlockStructuredBuffer(SumData.Buffer);
+    const int32 BuildBlockTotal = BuildBlockCount.X * BuildBlockCount.Y;
+    const int32 BuildSumCount = BuildBlockTotal + 2;
 
-    FGeomCountDataType BufferSum = SumArr[ScanBlockCount];
+    FRULRWBuffer BuildSumData;
+    BuildSumData.Initialize(
+        sizeof(uint32),
+        BuildSumCount * 4,
+        PF_R32_UINT,
+        BUF_Static,
+        TEXT("BuildSumData")
+        );
 
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() BufferSum: X=%d,Y=%d,Z=%d,W=%d"), BufferSum.X,BufferSum.Y,BufferSum.Z,BufferSum.W);
+    RHICmdList.BeginComputePass(TEXT("MarchingSquaresMapCopyBuildSum"));
+    {
+        TShaderMapRef<FMarchingSquaresMapCopyBuildSumCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("SumData"), SumData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutBuildSumData"), BuildSumData.UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockRect"), BuildBlockRect);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockOffset"), BlockOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_ScanBlockCount"), ScanBlockCount);
+        ComputeShader->DispatchAndClear(RHICmdList, BuildSumCount, 1, 1);
+    }
+    RHICmdList.EndComputePass();
 
-    // Calculate geometry allocation sizes
+    OutBuild.SumReadback = MakeUnique<FRHIGPUBufferReadback>(TEXT("MarchingSquaresMapBuildSumReadback"));
+    OutBuild.SumReadback->EnqueueCopy(RHICmdList, BuildSumData.Buffer);
+    OutBuild.SumReadbackSize = BuildSumData.Buffer->GetSize();
+
+    OutBuild.Dimension = Dimension;
+    OutBuild.BlockSize = BlockSize;
+    OutBuild.BuildBlockCount = BuildBlockCount;
+    OutBuild.GridCountX = GridCountX;
+    OutBuild.GridCount = GridCount;
+    OutBuild.bUseDistance = bUseDistance;
+    OutBuild.ScanBlockCount = ScanBlockCount;
+    OutBuild.BlockOffset = BlockOffset;
+}
 
-    const int32 BlockOffset = FRULPrefixSumScan::GetBlockOffsetForSize(BlockSize*BlockSize);
+void FMarchingSquaresMap::TriangulateBuild_RT(FRHICommandListImmediate& RHICmdList, FPendingBuild& Build)
+{
+    check(IsInRenderingThread());
+    check(Build.SumReadback.IsValid());
+
+    Build.bTriangulated = true;
+
+    // Voxel data has been released or resized since the build dispatch,
+    // the build is discarded on resolve
+
+    const FIntPoint Dimension = Build.Dimension;
+
+    if (! VoxelFeatureData.IsValid() || Dimension != Dimension_RT)
+    {
+        Build.SumReadback.Reset();
+        return;
+    }
+
+    TShaderMap<FGlobalShaderType>* ShaderMap = GetGlobalShaderMap(Build.FeatureLevel);
+
+    const uint32 FillType = Build.FillType;
+    const bool bUseDualMesh = Build.bUseDualMesh;
+    const bool bUseDistance = Build.bUseDistance && HasVoxelDistanceData_RT();
+    const int32 BuildBlockSize = Build.BlockSize;
+    const int32 BlockOffset = Build.BlockOffset;
+    const FIntPoint BuildBlockCount = Build.BuildBlockCount;
+    const FIntPoint BuildDim = BuildBlockCount * BuildBlockSize;
+    const FIntVector4 BuildBlockRect(Build.BlockRect.Min.X, Build.BlockRect.Min.Y, BuildBlockCount.X, BuildBlockCount.Y);
+    const int32 BuildBlockTotal = BuildBlockCount.X * BuildBlockCount.Y;
+
+    FRULRWBuffer& CellCaseData(Build.CellCaseData);
+    FRULRWBufferStructured& OffsetData(Build.OffsetData);
+    FRULRWBufferStructured& SumData(Build.SumData);
+
+    // Get geometry count scan sums, staging buffer fence has been reached
+    // and the lock does not stall
+
+    const uint32* SumDataPtr = reinterpret_cast<const uint32*>(Build.SumReadback->Lock(Build.SumReadbackSize));
+
+    Build.BlockGeomOffsets.SetNumUninitialized(BuildBlockTotal+1);
+
+    for (int32 bi=0; bi<=BuildBlockTotal; ++bi)
+    {
+        Build.BlockGeomOffsets[bi] = FIntPoint(SumDataPtr[bi*4], SumDataPtr[bi*4+1]);
+    }
+
+    const uint32* BufferSum = SumDataPtr + (BuildBlockTotal+1) * 4;
+
+    const int32 VCount = BufferSum[0];
+    const int32 ICount = BufferSum[1];
 
-    const int32 VCount = BufferSum.X;
-    const int32 ICount = BufferSum.Y;
+    const int32 FillCellCount = BufferSum[2];
+    const int32 EdgeCellCount = BufferSum[3];
 
-    const int32 FillCellCount = BufferSum.Z;
-    const int32 EdgeCellCount = BufferSum.W;
+    Build.SumReadback->Unlock();
+    Build.SumReadback.Reset();
+
+    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::TriangulateBuild_RT() BufferSum: X=%d,Y=%d,Z=%d,W=%d"), VCount,ICount,FillCellCount,EdgeCellCount);
+
+    // Calculate geometry allocation sizes
 
     int32 TotalVCount = VCount;
     int32 TotalICount = ICount;
@@ -595,13 +1582,9 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
         TotalICount *= 2;
     }
     
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() BlockOffset: %d"), BlockOffset);
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() VCount: %d"), VCount);
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() ICount: %d"), ICount);
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() FillCellCount: %d"), FillCellCount);
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() EdgeCellCount: %d"), EdgeCellCount);
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() TotalVCount: %d"), TotalVCount);
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() TotalICount: %d"), TotalICount);
+    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::TriangulateBuild_RT() BlockOffset: %d"), BlockOffset);
+    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::TriangulateBuild_RT() TotalVCount: %d"), TotalVCount);
+    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::TriangulateBuild_RT() TotalICount: %d"), TotalICount);
 
     // Empty map, return
     if (TotalVCount < 3 || TotalICount < 3)
@@ -609,6 +1592,8 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
         return;
     }
 
+    typedef TResourceArray<FRULAlignedUint, VERTEXBUFFER_ALIGNMENT> FIndexData;
+
     // Generate compact triangulation data
     
     FRULRWBuffer FillCellIdData;
@@ -638,27 +1623,43 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
 
     RHICmdList.BeginComputePass(TEXT("MarchingSquaresMapWriteCellCompactId"));
     {
-        TShaderMapRef<FMarchingSquaresMapWriteCellCompactIdCS> CellWriteCompactIdCS(RHIShaderMap);
+        TShaderMapRef<FMarchingSquaresMapWriteCellCompactIdCS> CellWriteCompactIdCS(ShaderMap);
         CellWriteCompactIdCS->SetShader(RHICmdList);
         CellWriteCompactIdCS->BindSRV(RHICmdList, TEXT("GeomCountData"), GeomCountData.SRV);
         CellWriteCompactIdCS->BindSRV(RHICmdList, TEXT("OffsetData"), OffsetData.SRV);
         CellWriteCompactIdCS->BindUAV(RHICmdList, TEXT("OutFillCellIdData"), FillCellIdData.UAV);
         CellWriteCompactIdCS->BindUAV(RHICmdList, TEXT("OutEdgeCellIdData"), EdgeCellIdData.UAV);
         CellWriteCompactIdCS->SetParameter(RHICmdList, TEXT("_GDim"), Dimension);
-        CellWriteCompactIdCS->SetParameter(RHICmdList, TEXT("_LDim"), FIntPoint(BlockSize, BlockSize));
-        CellWriteCompactIdCS->DispatchAndClear(RHICmdList, Dimension.X, Dimension.Y, 1);
+        CellWriteCompactIdCS->SetParameter(RHICmdList, TEXT("_LDim"), FIntPoint(BuildBlockSize, BuildBlockSize));
+        CellWriteCompactIdCS->SetParameter(RHICmdList, TEXT("_BlockRect"), BuildBlockRect);
+        CellWriteCompactIdCS->DispatchAndClear(RHICmdList, BuildDim.X, BuildDim.Y, 1);
     }
     RHICmdList.EndComputePass();
 
-    FRWByteAddressBuffer PositionData;
-    FRWByteAddressBuffer TangentData;
+    // Position and tangent data are raw views of vertex buffers, vertex
+    // buffers can be copied to readback staging buffers
+
+    FRULRWBuffer PositionData;
+    FRULRWBuffer TangentData;
     FRULRWBuffer TexCoordData;
     FRULRWBuffer ColorData;
     FRULRWBuffer IndexData;
 
-    PositionData.Initialize(TotalVCount*3*sizeof(float), BUF_Static);
+    PositionData.Initialize(
+        sizeof(float),
+        TotalVCount*3,
+        PF_R32_UINT,
+        BUF_Static | BUF_ByteAddressBuffer,
+        TEXT("Position Data")
+        );
 
-    TangentData.Initialize(TotalVCount*2*sizeof(FRULAlignedUint), BUF_Static);
+    TangentData.Initialize(
+        sizeof(FRULAlignedUint),
+        TotalVCount*2,
+        PF_R32_UINT,
+        BUF_Static | BUF_ByteAddressBuffer,
+        TEXT("Tangent Data")
+        );
 
     TexCoordData.Initialize(
         sizeof(FRULAlignedVector2D),
@@ -684,6 +1685,14 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
         TEXT("Index Data")
         );
 
+    // Rebake height normal texture if height settings changed since the
+    // previous bake
+
+    if (! IsHeightNormalBaked_RT())
+    {
+        BakeHeightNormal_RT(RHICmdList);
+    }
+
     if (FillCellCount > 0)
     {
         RHICmdList.BeginComputePass(TEXT("MarchingSquaresMapTriangulateFillCell"));
@@ -692,43 +1701,35 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
 
         if (bUseDualMesh)
         {
-            ComputeShader = *TShaderMapRef<TMarchingSquaresMapTriangulateFillCellCS<0>>(RHIShaderMap);
+            ComputeShader = *TShaderMapRef<TMarchingSquaresMapTriangulateFillCellCS<0>>(ShaderMap);
         }
         else
         {
-            ComputeShader = *TShaderMapRef<TMarchingSquaresMapTriangulateFillCellCS<1>>(RHIShaderMap);
+            ComputeShader = *TShaderMapRef<TMarchingSquaresMapTriangulateFillCellCS<1>>(ShaderMap);
         }
 
-        FSamplerStateRHIParamRef HeightMapSampler = TStaticSamplerState<SF_Bilinear,AM_Clamp,AM_Clamp,AM_Clamp>::GetRHI();
-
-        FVector2D HeightScale;
-        HeightScale.X = SurfaceHeightScale;
-        HeightScale.Y = ExtrudeHeightScale;
-
         FIntPoint GeomCount;
         GeomCount.X = VCount;
         GeomCount.Y = ICount;
 
-        float  HeightOffset = BaseHeightOffset;
-        uint32 SampleLevel  = FMath::Max(0, HeightMapMipLevel);
+        float HeightOffset = BaseHeightOffset;
 
         ComputeShader->SetShader(RHICmdList);
-        ComputeShader->BindTexture(RHICmdList, TEXT("HeightMap"), TEXT("samplerHeightMap"), HeightMap, HeightMapSampler);
-        ComputeShader->BindSRV(RHICmdList, TEXT("OffsetData"),     OffsetData.SRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("SumData"),        SumData.SRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("FillCellIdData"), FillCellIdData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("HeightNormalMap"), HeightNormalSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("OffsetData"),      OffsetData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("SumData"),         SumData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("FillCellIdData"),  FillCellIdData.SRV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutPositionData"), PositionData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutTangentData"),  TangentData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutTexCoordData"), TexCoordData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutColorData"),    ColorData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutIndexData"),    IndexData.UAV);
         ComputeShader->SetParameter(RHICmdList, TEXT("_GDim"),          Dimension);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_LDim"),          FIntPoint(BlockSize, BlockSize));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LDim"),          FIntPoint(BuildBlockSize, BuildBlockSize));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockRect"),     BuildBlockRect);
         ComputeShader->SetParameter(RHICmdList, TEXT("_GeomCount"),     GeomCount);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_SampleLevel"),   SampleLevel);
         ComputeShader->SetParameter(RHICmdList, TEXT("_FillCellCount"), FillCellCount);
         ComputeShader->SetParameter(RHICmdList, TEXT("_BlockOffset"),   BlockOffset);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_HeightScale"),   HeightScale);
         ComputeShader->SetParameter(RHICmdList, TEXT("_HeightOffset"),  HeightOffset);
         ComputeShader->SetParameter(RHICmdList, TEXT("_Color"),         FVector4(1,0,0,1));
         ComputeShader->DispatchAndClear(RHICmdList, FillCellCount, 1, 1);
@@ -740,49 +1741,36 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
     {
         RHICmdList.BeginComputePass(TEXT("MarchingSquaresMapTriangulateEdgeCell"));
 
-        TMarchingSquaresMapTriangulateEdgeCellCS<0>::FBaseType* ComputeShader;
-
-        if (bUseDualMesh)
-        {
-            ComputeShader = *TShaderMapRef<TMarchingSquaresMapTriangulateEdgeCellCS<0>>(RHIShaderMap);
-        }
-        else
-        {
-            ComputeShader = *TShaderMapRef<TMarchingSquaresMapTriangulateEdgeCellCS<1>>(RHIShaderMap);
-        }
-
-        FSamplerStateRHIParamRef HeightMapSampler = TStaticSamplerState<SF_Bilinear,AM_Clamp,AM_Clamp,AM_Clamp>::GetRHI();
-
-        FVector2D HeightScale;
-        HeightScale.X = SurfaceHeightScale;
-        HeightScale.Y = ExtrudeHeightScale;
+        TMarchingSquaresMapTriangulateEdgeCellCS<0,0>::FBaseType* ComputeShader;
+        ComputeShader = GetMarchingSquaresMapShader<TMarchingSquaresMapTriangulateEdgeCellCS>(ShaderMap, ! bUseDualMesh, bUseDistance);
 
         FIntPoint GeomCount;
         GeomCount.X = VCount;
         GeomCount.Y = ICount;
 
-        float  HeightOffset = BaseHeightOffset;
-        uint32 SampleLevel  = FMath::Max(0, HeightMapMipLevel);
+        float HeightOffset = BaseHeightOffset;
 
         ComputeShader->SetShader(RHICmdList);
-        ComputeShader->BindTexture(RHICmdList, TEXT("HeightMap"), TEXT("samplerHeightMap"), HeightMap, HeightMapSampler);
-        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelFeatureData"), VoxelFeatureData.SRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("OffsetData"),       OffsetData.SRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("SumData"),          SumData.SRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("EdgeCellIdData"),   EdgeCellIdData.SRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("CellCaseData"),     CellCaseData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("HeightNormalMap"),   HeightNormalSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelFeatureData"),  VoxelFeatureData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelDistanceData"), VoxelDistanceData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("OffsetData"),        OffsetData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("SumData"),           SumData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("EdgeCellIdData"),    EdgeCellIdData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("CellCaseData"),      CellCaseData.SRV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutPositionData"), PositionData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutTangentData"),  TangentData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutTexCoordData"), TexCoordData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutColorData"),    ColorData.UAV);
         ComputeShader->BindUAV(RHICmdList, TEXT("OutIndexData"),    IndexData.UAV);
         ComputeShader->SetParameter(RHICmdList, TEXT("_GDim"),          Dimension);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_LDim"),          FIntPoint(BlockSize, BlockSize));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LDim"),          FIntPoint(BuildBlockSize, BuildBlockSize));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockRect"),     BuildBlockRect);
         ComputeShader->SetParameter(RHICmdList, TEXT("_GeomCount"),     GeomCount);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_SampleLevel"),   SampleLevel);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"),      FillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceRange"), DistanceRange_RT);
         ComputeShader->SetParameter(RHICmdList, TEXT("_EdgeCellCount"), EdgeCellCount);
         ComputeShader->SetParameter(RHICmdList, TEXT("_BlockOffset"),   BlockOffset);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_HeightScale"),   HeightScale);
         ComputeShader->SetParameter(RHICmdList, TEXT("_HeightOffset"),  HeightOffset);
         ComputeShader->SetParameter(RHICmdList, TEXT("_Color"),         FVector4(1,0,0,1));
         ComputeShader->DispatchAndClear(RHICmdList, EdgeCellCount, 1, 1);
@@ -790,33 +1778,111 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
         RHICmdList.EndComputePass();
     }
 
-    // Construct mesh sections
+    // Read back section geometry, copied out to sections once the
+    // readback fences have been reached
 
-    int32 GridCountX = (Dimension.X / BlockSize);
-    int32 GridCountY = (Dimension.Y / BlockSize);
-    int32 GridCount  = (GridCountX * GridCountY);
-    int32 TotalGridCount = GridCount;
+    Build.VCount = VCount;
+    Build.ICount = ICount;
+    Build.bHasGeometry = true;
 
-    if (bUseDualMesh)
+    // Bounds height of the dispatched build
+
+    Build.BoundsSurfaceZ =  BaseHeightOffset + SurfaceHeightScale + 1.f;
+    Build.BoundsExtrudeZ = -BaseHeightOffset + ExtrudeHeightScale - 1.f;
+
+    if (bOverrideBoundsZ)
     {
-        TotalGridCount *= 2;
+        if (BoundsSurfaceOverrideZ > KINDA_SMALL_NUMBER)
+        {
+            Build.BoundsSurfaceZ =  BaseHeightOffset + BoundsSurfaceOverrideZ + 1.f;
+        }
+
+        if (BoundsExtrudeOverrideZ > KINDA_SMALL_NUMBER)
+        {
+            Build.BoundsExtrudeZ = -BaseHeightOffset - BoundsExtrudeOverrideZ - 1.f;
+        }
     }
 
-    if (! SectionGroups.IsValidIndex(FillType))
+    FRULRWBuffer* OutputData[FPendingBuild::READBACK_COUNT] = {
+        &PositionData,
+        &TangentData,
+        &TexCoordData,
+        &ColorData,
+        &IndexData
+        };
+
+    for (int32 ri=0; ri<FPendingBuild::READBACK_COUNT; ++ri)
     {
-        SectionGroups.SetNum(FillType+1, false);
+        Build.Readbacks[ri] = MakeUnique<FRHIGPUBufferReadback>(TEXT("MarchingSquaresMapSectionReadback"));
+        Build.Readbacks[ri]->EnqueueCopy(RHICmdList, OutputData[ri]->Buffer);
+        Build.ReadbackSizes[ri] = OutputData[ri]->Buffer->GetSize();
     }
+}
 
-    TArray<FPMUMeshSection>& SectionSections(SectionGroups[FillType]);
+bool FMarchingSquaresMap::FPendingBuild::IsSumReadbackReady() const
+{
+    return SumReadback.IsValid() && SumReadback->IsReady();
+}
+
+bool FMarchingSquaresMap::FPendingBuild::IsReadbackReady() const
+{
+    if (! bTriangulated)
+    {
+        return false;
+    }
+
+    if (! bHasGeometry)
+    {
+        return true;
+    }
+
+    for (int32 ri=0; ri<READBACK_COUNT; ++ri)
+    {
+        if (! Readbacks[ri]->IsReady())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FMarchingSquaresMap::CopySections_RT(FPendingBuild& Build)
+{
+    // Empty build, sections have been cleared on dispatch
+    if (! Build.bHasGeometry)
+    {
+        return;
+    }
+
+    typedef TResourceArray<FRULAlignedUint, VERTEXBUFFER_ALIGNMENT> FIndexData;
+
+    TArray<FPMUMeshSection>& SectionSections(SectionGroups[Build.FillType]);
+
+    const FIntRect& BlockRect(Build.BlockRect);
+    const FIntPoint& BuildBlockCount(Build.BuildBlockCount);
+    const FIntPoint& Dimension(Build.Dimension);
+    const int32 GridCountX = Build.GridCountX;
+    const int32 GridCount = Build.GridCount;
+    const int32 VCount = Build.VCount;
+    const int32 ICount = Build.ICount;
+    const int32 BuildBlockSize = Build.BlockSize;
+    const bool bUseDualMesh = Build.bUseDualMesh;
+
+    // Staging buffer fences have been reached, locks do not stall
 
-    SectionSections.Reset(TotalGridCount);
-    SectionSections.SetNum(TotalGridCount);
+    uint8* ReadbackDataPtr[FPendingBuild::READBACK_COUNT];
 
-    uint8* PositionDataPtr = reinterpret_cast<uint8*>(RHILockStructuredBuffer(PositionData.Buffer, 0, PositionData.Buffer->GetSize(), RLM_ReadOnly));
-    uint8* TangentDataPtr  = reinterpret_cast<uint8*>(RHILockStructuredBuffer(TangentData.Buffer, 0, TangentData.Buffer->GetSize(), RLM_ReadOnly));
-    uint8* TexCoordDataPtr = reinterpret_cast<uint8*>(RHILockVertexBuffer(TexCoordData.Buffer, 0, TexCoordData.Buffer->GetSize(), RLM_ReadOnly));
-    uint8* ColorDataPtr    = reinterpret_cast<uint8*>(RHILockVertexBuffer(ColorData.Buffer, 0, ColorData.Buffer->GetSize(), RLM_ReadOnly));
-    uint8* IndexDataPtr    = reinterpret_cast<uint8*>(RHILockVertexBuffer(IndexData.Buffer, 0, IndexData.Buffer->GetSize(), RLM_ReadOnly));
+    for (int32 ri=0; ri<FPendingBuild::READBACK_COUNT; ++ri)
+    {
+        ReadbackDataPtr[ri] = reinterpret_cast<uint8*>(Build.Readbacks[ri]->Lock(Build.ReadbackSizes[ri]));
+    }
+
+    uint8* PositionDataPtr = ReadbackDataPtr[0];
+    uint8* TangentDataPtr  = ReadbackDataPtr[1];
+    uint8* TexCoordDataPtr = ReadbackDataPtr[2];
+    uint8* ColorDataPtr    = ReadbackDataPtr[3];
+    uint8* IndexDataPtr    = ReadbackDataPtr[4];
 
     const int32 PositionDataStride = sizeof(FRULAlignedVector);
     const int32 TangentDataStride  = sizeof(FRULAlignedUintPoint);
@@ -824,27 +1890,30 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
     const int32 ColorDataStride    = sizeof(FRULAlignedUint);
     const int32 IndexDataStride    = sizeof(FIndexData::ElementType);
 
-    for (int32 gy=0; gy<GridCountY; ++gy)
-    for (int32 gx=0; gx<GridCountX; ++gx)
+    for (int32 by=0; by<BuildBlockCount.Y; ++by)
+    for (int32 bx=0; bx<BuildBlockCount.X; ++bx)
     {
-        int32 i  = gx + gy*GridCountX;
-        int32 i0 =  i    * BlockOffset;
-        int32 i1 = (i+1) * BlockOffset;
+        // Build block index and map section grid index
+
+        int32 bi = bx + by*BuildBlockCount.X;
+        int32 gx = bx + BlockRect.Min.X;
+        int32 gy = by + BlockRect.Min.Y;
 
-        FGeomCountDataType Sum0 = SumArr[i0];
-        FGeomCountDataType Sum1 = SumArr[i1];
+        int32 i = gx + gy*GridCountX;
 
-        uint32 GVOffset = Sum0[0];
-        uint32 GIOffset = Sum0[1];
+        const FIntPoint& GeomOffset0(Build.BlockGeomOffsets[bi  ]);
+        const FIntPoint& GeomOffset1(Build.BlockGeomOffsets[bi+1]);
 
-        uint32 GVCount = Sum1[0] - GVOffset;
-        uint32 GICount = Sum1[1] - GIOffset;
+        uint32 GVOffset = GeomOffset0.X;
+        uint32 GIOffset = GeomOffset0.Y;
 
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() [%d] Grid Geometry Count (%d, %d)"), i, i0, i1);
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() [%d] GVOffset: %u"), i, GVOffset);
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() [%d] GIOffset: %u"), i, GIOffset);
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() [%d] GVCount: %u"), i, GVCount);
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::GenerateMarchingCubes_RT() [%d] GICount: %u"), i, GICount);
+        uint32 GVCount = GeomOffset1.X - GVOffset;
+        uint32 GICount = GeomOffset1.Y - GIOffset;
+
+        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::CopySections_RT() [%d] GVOffset: %u"), i, GVOffset);
+        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::CopySections_RT() [%d] GIOffset: %u"), i, GIOffset);
+        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::CopySections_RT() [%d] GVCount: %u"), i, GVCount);
+        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresMap::CopySections_RT() [%d] GICount: %u"), i, GICount);
 
         bool bValidSection = (GVCount >= 3 && GICount >= 3);
 
@@ -856,27 +1925,11 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
 
         // Calculate local bounds
 
-        float BoundsSurfaceZ =  BaseHeightOffset + SurfaceHeightScale + 1.f;
-        float BoundsExtrudeZ = -BaseHeightOffset + ExtrudeHeightScale - 1.f;
-
-        if (bOverrideBoundsZ)
-        {
-            if (BoundsSurfaceOverrideZ > KINDA_SMALL_NUMBER)
-            {
-                BoundsSurfaceZ =  BaseHeightOffset + BoundsSurfaceOverrideZ + 1.f;
-            }
-
-            if (BoundsExtrudeOverrideZ > KINDA_SMALL_NUMBER)
-            {
-                BoundsExtrudeZ = -BaseHeightOffset - BoundsExtrudeOverrideZ - 1.f;
-            }
-        }
-
         FBox LocalBounds(ForceInitToZero);
-        LocalBounds.Min = FVector(gx*BlockSize, gy*BlockSize, 0);
-        LocalBounds.Max = LocalBounds.Min + FVector(BlockSize, BlockSize, 0);
-        LocalBounds.Min.Z = BoundsExtrudeZ;
-        LocalBounds.Max.Z = BoundsSurfaceZ;
+        LocalBounds.Min = FVector(gx*BuildBlockSize, gy*BuildBlockSize, 0);
+        LocalBounds.Max = LocalBounds.Min + FVector(BuildBlockSize, BuildBlockSize, 0);
+        LocalBounds.Min.Z = Build.BoundsExtrudeZ;
+        LocalBounds.Max.Z = Build.BoundsSurfaceZ;
         LocalBounds = LocalBounds.ShiftBy(-FVector(Dimension.X,Dimension.Y,0)/2.f);
 
         // Copy surface geometry
@@ -973,11 +2026,17 @@ void FMarchingSquaresMap::GenerateMarchingCubes_RT(uint32 FillType, bool bInGene
         }
     }
 
-    RHIUnlockVertexBuffer(IndexData.Buffer);
-    RHIUnlockVertexBuffer(ColorData.Buffer);
-    RHIUnlockVertexBuffer(TexCoordData.Buffer);
-    RHIUnlockStructuredBuffer(TangentData.Buffer);
-    RHIUnlockStructuredBuffer(PositionData.Buffer);
+    for (int32 ri=0; ri<FPendingBuild::READBACK_COUNT; ++ri)
+    {
+        Build.Readbacks[ri]->Unlock();
+    }
+
+    // Release staging buffers
+
+    for (int32 ri=0; ri<FPendingBuild::READBACK_COUNT; ++ri)
+    {
+        Build.Readbacks[ri].Reset();
+    }
 }
 
 //bool FMarchingSquaresMap::IsPrefabValid(int32 PrefabIndex, int32 LODIndex, int32 SectionIndex) const
@@ -0,0 +1,961 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+
+#include "MarchingSquaresMapHistory.h"
+
+#include "RHICommandList.h"
+#include "ShaderParameters.h"
+#include "ShaderCore.h"
+#include "ShaderParameterUtils.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+#include "RHI/RULAlignedTypes.h"
+#include "Shaders/RULShaderDefinitions.h"
+
+// Maximum block count of a single capture chunk, larger edits are captured
+// in multiple chunks
+
+#define MAX_CAPTURE_BLOCK_COUNT 256
+
+// COMPUTE SHADER DEFINITIONS
+
+class FMSQHistoryCaptureCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQHistoryCaptureCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_4(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "VoxelStateData",    VoxelStateData,
+        "VoxelFeatureData",  VoxelFeatureData,
+        "VoxelDistanceData", VoxelDistanceData,
+        "HistoryBlockData",  HistoryBlockData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutCaptureData", OutCaptureData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_6(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",             Params_MapDimension,
+        "_BlockSize",          Params_BlockSize,
+        "_BlockCount",         Params_BlockCount,
+        "_DistanceLayerCount", Params_DistanceLayerCount,
+        "_RecordStride",       Params_RecordStride,
+        "_RecordOffset",       Params_RecordOffset
+        )
+};
+
+class FMSQHistoryApplyCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQHistoryApplyCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "HistoryBlockData", HistoryBlockData,
+        "HistoryEntryData", HistoryEntryData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_3(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelStateData",    OutVoxelStateData,
+        "OutVoxelFeatureData",  OutVoxelFeatureData,
+        "OutVoxelDistanceData", OutVoxelDistanceData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_6(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",             Params_MapDimension,
+        "_BlockSize",          Params_BlockSize,
+        "_BlockCount",         Params_BlockCount,
+        "_DistanceLayerCount", Params_DistanceLayerCount,
+        "_RecordStride",       Params_RecordStride,
+        "_PairOffset",         Params_PairOffset
+        )
+};
+
+IMPLEMENT_SHADER_TYPE(, FMSQHistoryCaptureCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresHistoryCS.usf"), TEXT("HistoryCaptureKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FMSQHistoryApplyCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresHistoryCS.usf"), TEXT("HistoryApplyKernel"), SF_Compute);
+
+typedef TResourceArray<FRULAlignedUint, VERTEXBUFFER_ALIGNMENT> FHistoryData;
+
+SIZE_T FMarchingSquaresMapHistory::FHistoryEntry::GetAllocatedSize() const
+{
+    SIZE_T Size = Blocks.GetAllocatedSize() + CPUBlocks.GetAllocatedSize() + Captures.GetAllocatedSize();
+
+    for (const FBlockDelta& BlockDelta : Blocks)
+    {
+        Size += BlockDelta.Delta.GetAllocatedSize();
+    }
+
+    for (const FBlockDelta& BlockDelta : CPUBlocks)
+    {
+        Size += BlockDelta.Delta.GetAllocatedSize();
+    }
+
+    // Capture chunks in flight hold GPU capture and staging buffers
+
+    for (const TSharedPtr<FCaptureChunk>& Chunk : Captures)
+    {
+        Size += Chunk->CaptureByteCount * 2;
+    }
+
+    return Size;
+}
+
+FIntRect FMarchingSquaresMapHistory::GetBlockVoxelRect(const FIntPoint& Block) const
+{
+    FIntRect VoxelRect;
+    VoxelRect.Min = Block * BlockSize_RT;
+    VoxelRect.Max.X = FMath::Min(VoxelRect.Min.X+BlockSize_RT, Dimension_RT.X);
+    VoxelRect.Max.Y = FMath::Min(VoxelRect.Min.Y+BlockSize_RT, Dimension_RT.Y);
+    return VoxelRect;
+}
+
+void FMarchingSquaresMapHistory::Configure_RT(const FIntPoint& Dimension, int32 BlockSize, int32 DistanceLayerCount, int32 HistoryLimit)
+{
+    check(IsInRenderingThread());
+
+    DistanceLayerCount = FMath::Max(0, DistanceLayerCount);
+    HistoryLimit = FMath::Max(0, HistoryLimit);
+
+    if (Dimension_RT != Dimension ||
+        BlockSize_RT != BlockSize ||
+        DistanceLayerCount_RT != DistanceLayerCount ||
+        HistoryLimit_RT != HistoryLimit)
+    {
+        Clear_RT();
+
+        Dimension_RT = Dimension;
+        BlockSize_RT = BlockSize;
+        DistanceLayerCount_RT = DistanceLayerCount;
+        HistoryLimit_RT = HistoryLimit;
+    }
+}
+
+void FMarchingSquaresMapHistory::Clear_RT()
+{
+    check(IsInRenderingThread());
+
+    UndoEntries.Empty();
+    RedoEntries.Empty();
+    PendingBlocks.Empty();
+    PendingCaptures.Empty();
+    PendingCPUBlocks.Empty();
+    GroupDepth_RT = 0;
+
+    UpdateCounters_RT();
+}
+
+void FMarchingSquaresMapHistory::BeginEdit_RT(FMarchingSquaresMap& Map, const FIntRect& VoxelRect)
+{
+    check(IsInRenderingThread());
+
+    if (! IsEnabled_RT() || ! Map.GetVoxelStateData().IsValid() || ! Map.GetVoxelFeatureData().IsValid())
+    {
+        return;
+    }
+
+    Update_RT();
+
+    // Distance words are owned by the even voxel of each voxel pair, grow
+    // rect to include the owner of the first written voxel
+
+    FIntRect Rect(VoxelRect);
+
+    if (DistanceLayerCount_RT > 0)
+    {
+        Rect.Min.X -= 1;
+    }
+
+    Rect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension_RT));
+
+    if (Rect.Area() <= 0)
+    {
+        return;
+    }
+
+    // Find blocks not yet captured by the pending entry
+
+    const FIntPoint BlockMin(Rect.Min / BlockSize_RT);
+    const FIntPoint BlockMax((Rect.Max.X-1) / BlockSize_RT + 1, (Rect.Max.Y-1) / BlockSize_RT + 1);
+
+    TArray<FIntRect> CaptureBlocks;
+
+    for (int32 by=BlockMin.Y; by<BlockMax.Y; ++by)
+    for (int32 bx=BlockMin.X; bx<BlockMax.X; ++bx)
+    {
+        const FIntPoint Block(bx, by);
+
+        if (! PendingBlocks.Contains(Block))
+        {
+            PendingBlocks.Emplace(Block);
+            CaptureBlocks.Emplace(GetBlockVoxelRect(Block));
+        }
+    }
+
+    // Capture voxel records before the edit, records after the edit are
+    // written to the same chunks on commit
+
+    FRHICommandListImmediate& RHICmdList(FRHICommandListExecutor::GetImmediateCommandList());
+
+    for (int32 ChunkStart=0; ChunkStart<CaptureBlocks.Num(); ChunkStart+=MAX_CAPTURE_BLOCK_COUNT)
+    {
+        const int32 ChunkBlockCount = FMath::Min(CaptureBlocks.Num()-ChunkStart, MAX_CAPTURE_BLOCK_COUNT);
+
+        TSharedPtr<FCaptureChunk> Chunk(MakeShareable(new FCaptureChunk));
+        Chunk->Blocks.Append(CaptureBlocks.GetData()+ChunkStart, ChunkBlockCount);
+
+        WriteBlockData_RT(Chunk->Blocks, Chunk->BlockData);
+
+        const int32 CaptureCount = ChunkBlockCount * GetBlockRecordSize() * 2;
+        Chunk->CaptureByteCount = CaptureCount * sizeof(uint32);
+
+        Chunk->CaptureData.Initialize(
+            sizeof(uint32),
+            CaptureCount,
+            PF_R32_UINT,
+            nullptr,
+            BUF_Static,
+            TEXT("MarchingSquaresHistoryCaptureData")
+            );
+
+        CaptureChunk_RT(RHICmdList, Map, *Chunk, false);
+
+        PendingCaptures.Emplace(Chunk);
+    }
+}
+
+void FMarchingSquaresMapHistory::EndEdit_RT(FMarchingSquaresMap& Map)
+{
+    check(IsInRenderingThread());
+
+    if (GroupDepth_RT == 0)
+    {
+        CommitPendingEntry_RT(Map);
+    }
+}
+
+void FMarchingSquaresMapHistory::AddEditCPU_RT(FMarchingSquaresMap& Map, TArray<FBlockDelta>& Blocks)
+{
+    check(IsInRenderingThread());
+
+    if (! IsEnabled_RT())
+    {
+        return;
+    }
+
+    PendingCPUBlocks.Append(MoveTemp(Blocks));
+
+    if (GroupDepth_RT == 0)
+    {
+        CommitPendingEntry_RT(Map);
+    }
+}
+
+void FMarchingSquaresMapHistory::BeginGroup_RT()
+{
+    check(IsInRenderingThread());
+
+    ++GroupDepth_RT;
+}
+
+void FMarchingSquaresMapHistory::EndGroup_RT(FMarchingSquaresMap& Map)
+{
+    check(IsInRenderingThread());
+
+    if (GroupDepth_RT > 0)
+    {
+        --GroupDepth_RT;
+    }
+
+    if (GroupDepth_RT == 0)
+    {
+        CommitPendingEntry_RT(Map);
+    }
+}
+
+void FMarchingSquaresMapHistory::CaptureChunk_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, FCaptureChunk& Chunk, bool bAfterEdit)
+{
+    const int32 BlockCount = Chunk.Blocks.Num();
+    const uint32 DistanceLayerCount = Map.HasVoxelDistanceData_RT() ? DistanceLayerCount_RT : 0;
+    const uint32 RecordOffset = bAfterEdit ? BlockCount * GetBlockRecordSize() : 0;
+
+    TShaderMap<FGlobalShaderType>* RHIShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    RHICmdList.BeginComputePass(TEXT("MarchingSquaresHistoryCapture"));
+    {
+        TShaderMapRef<FMSQHistoryCaptureCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), Map.GetVoxelStateData().SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelFeatureData"), Map.GetVoxelFeatureData().SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelDistanceData"), Map.GetVoxelDistanceData().SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("HistoryBlockData"), Chunk.BlockData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutCaptureData"), Chunk.CaptureData.UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension_RT);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockSize"), static_cast<uint32>(BlockSize_RT));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockCount"), static_cast<uint32>(BlockCount));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceLayerCount"), DistanceLayerCount);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RecordStride"), static_cast<uint32>(GetRecordStride()));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RecordOffset"), RecordOffset);
+        ComputeShader->DispatchAndClear(RHICmdList, BlockSize_RT, BlockSize_RT, BlockCount);
+    }
+    RHICmdList.EndComputePass();
+}
+
+void FMarchingSquaresMapHistory::CommitPendingEntry_RT(FMarchingSquaresMap& Map)
+{
+    if (PendingCaptures.Num() < 1 && PendingCPUBlocks.Num() < 1)
+    {
+        return;
+    }
+
+    // Voxel data has been released since the blocks were captured, discard
+
+    if (! IsEnabled_RT() || ! Map.GetVoxelStateData().IsValid() || ! Map.GetVoxelFeatureData().IsValid())
+    {
+        PendingCaptures.Empty();
+    }
+
+    FHistoryEntry Entry;
+
+    // Capture voxel records after the edit and read back both captures
+    // asynchronously, entry blocks are resolved by Update_RT()
+
+    if (PendingCaptures.Num() > 0)
+    {
+        FRHICommandListImmediate& RHICmdList(FRHICommandListExecutor::GetImmediateCommandList());
+
+        Entry.VoxelRect = PendingCaptures[0]->Blocks[0];
+
+        for (TSharedPtr<FCaptureChunk>& Chunk : PendingCaptures)
+        {
+            CaptureChunk_RT(RHICmdList, Map, *Chunk, true);
+
+            Chunk->Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("MarchingSquaresHistoryReadback"));
+            Chunk->Readback->EnqueueCopy(RHICmdList, Chunk->CaptureData.Buffer);
+
+            for (const FIntRect& BlockRect : Chunk->Blocks)
+            {
+                Entry.VoxelRect.Union(BlockRect);
+            }
+        }
+
+        Entry.Captures = MoveTemp(PendingCaptures);
+    }
+
+    // CPU voxel data block deltas are resolved on the game thread
+
+    if (PendingCPUBlocks.Num() > 0)
+    {
+        Entry.CPUVoxelRect = PendingCPUBlocks[0].VoxelRect;
+
+        for (const FBlockDelta& BlockDelta : PendingCPUBlocks)
+        {
+            Entry.CPUVoxelRect.Union(BlockDelta.VoxelRect);
+        }
+
+        Entry.CPUBlocks = MoveTemp(PendingCPUBlocks);
+    }
+
+    PendingBlocks.Empty();
+    PendingCaptures.Empty();
+    PendingCPUBlocks.Empty();
+
+    // Push entry, new entry invalidates redo entries
+
+    if (Entry.Captures.Num() > 0 || Entry.CPUBlocks.Num() > 0)
+    {
+        RedoEntries.Empty();
+        UndoEntries.Emplace(MoveTemp(Entry));
+
+        if (UndoEntries.Num() > HistoryLimit_RT)
+        {
+            UndoEntries.RemoveAt(0, UndoEntries.Num()-HistoryLimit_RT);
+        }
+    }
+
+    UpdateCounters_RT();
+}
+
+void FMarchingSquaresMapHistory::Update_RT()
+{
+    check(IsInRenderingThread());
+
+    bool bUpdated = false;
+
+    auto UpdateEntries = [this, &bUpdated](TArray<FHistoryEntry>& Entries)
+    {
+        for (int32 i=Entries.Num()-1; i>=0; --i)
+        {
+            FHistoryEntry& Entry(Entries[i]);
+
+            if (Entry.IsResolved())
+            {
+                continue;
+            }
+
+            bool bReady = true;
+
+            for (const TSharedPtr<FCaptureChunk>& Chunk : Entry.Captures)
+            {
+                bReady = bReady && Chunk->IsReadbackReady();
+            }
+
+            if (! bReady)
+            {
+                continue;
+            }
+
+            ResolveEntry_RT(Entry);
+            bUpdated = true;
+
+            // Discard entries without any changed voxel
+
+            if (Entry.Blocks.Num() < 1 && Entry.CPUBlocks.Num() < 1)
+            {
+                Entries.RemoveAt(i, 1, false);
+            }
+        }
+    };
+
+    UpdateEntries(UndoEntries);
+    UpdateEntries(RedoEntries);
+
+    if (bUpdated)
+    {
+        UpdateCounters_RT();
+    }
+}
+
+void FMarchingSquaresMapHistory::ResolveEntry_RT(FHistoryEntry& Entry)
+{
+    const int32 BlockRecordSize = GetBlockRecordSize();
+
+    bool bHasBlock = false;
+
+    for (const TSharedPtr<FCaptureChunk>& Chunk : Entry.Captures)
+    {
+        const int32 BlockCount = Chunk->Blocks.Num();
+
+        // Staging buffer fence has been reached, lock does not stall
+
+        const uint32* CapturePtr = reinterpret_cast<const uint32*>(Chunk->Readback->Lock(Chunk->CaptureByteCount));
+        const uint32* AfterPtr = CapturePtr + BlockCount*BlockRecordSize;
+
+        for (int32 i=0; i<BlockCount; ++i)
+        {
+            FBlockDelta BlockDelta;
+            BlockDelta.VoxelRect = Chunk->Blocks[i];
+
+            EncodeDelta(CapturePtr + i*BlockRecordSize, AfterPtr + i*BlockRecordSize, BlockRecordSize, BlockDelta.Delta);
+
+            if (BlockDelta.Delta.Num() > 0)
+            {
+                if (bHasBlock)
+                {
+                    Entry.VoxelRect.Union(BlockDelta.VoxelRect);
+                }
+                else
+                {
+                    Entry.VoxelRect = BlockDelta.VoxelRect;
+                    bHasBlock = true;
+                }
+
+                Entry.Blocks.Emplace(MoveTemp(BlockDelta));
+            }
+        }
+
+        Chunk->Readback->Unlock();
+    }
+
+    if (! bHasBlock)
+    {
+        Entry.VoxelRect = FIntRect();
+    }
+
+    // Release capture buffers
+
+    Entry.Captures.Empty();
+    Entry.Blocks.Shrink();
+}
+
+bool FMarchingSquaresMapHistory::ApplyEntry_RT(FMarchingSquaresMap& Map, const FHistoryEntry& Entry)
+{
+    const bool bHasGPUBlocks = Entry.Captures.Num() > 0 || Entry.Blocks.Num() > 0;
+
+    if (bHasGPUBlocks)
+    {
+        if (! Map.GetVoxelStateData().IsValid() || ! Map.GetVoxelFeatureData().IsValid())
+        {
+            UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMapHistory::ApplyEntry_RT() ABORTED - Invalid voxel data"));
+            return false;
+        }
+
+        if (DistanceLayerCount_RT > 0 && ! Map.HasVoxelDistanceData_RT())
+        {
+            UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresMapHistory::ApplyEntry_RT() ABORTED - Invalid voxel distance data"));
+            return false;
+        }
+    }
+
+    FRHICommandListImmediate& RHICmdList(FRHICommandListExecutor::GetImmediateCommandList());
+    const int32 BlockRecordSize = GetBlockRecordSize();
+
+    if (! Entry.IsResolved())
+    {
+        // Apply captures in flight directly, capture records before and
+        // after the edit are stored in the same buffer
+
+        for (const TSharedPtr<FCaptureChunk>& Chunk : Entry.Captures)
+        {
+            const int32 BlockCount = Chunk->Blocks.Num();
+            ApplyCaptureData_RT(RHICmdList, Map, Chunk->BlockData, Chunk->CaptureData, BlockCount, BlockCount * BlockRecordSize);
+        }
+    }
+    else
+    if (Entry.Blocks.Num() > 0)
+    {
+        // Decode block deltas to record deltas
+
+        TArray<FIntRect> BlockRects;
+        BlockRects.Reserve(Entry.Blocks.Num());
+
+        FHistoryData DeltaData(false);
+        DeltaData.SetNumZeroed(Entry.Blocks.Num() * BlockRecordSize);
+
+        for (int32 i=0; i<Entry.Blocks.Num(); ++i)
+        {
+            const FBlockDelta& BlockDelta(Entry.Blocks[i]);
+            ApplyDelta(BlockDelta.Delta, reinterpret_cast<uint32*>(DeltaData.GetData()) + i*BlockRecordSize, BlockRecordSize);
+            BlockRects.Emplace(BlockDelta.VoxelRect);
+        }
+
+        FRULRWBuffer BlockData;
+        FRULRWBuffer EntryData;
+
+        WriteBlockData_RT(BlockRects, BlockData);
+
+        EntryData.Initialize(
+            sizeof(FHistoryData::ElementType),
+            DeltaData.Num(),
+            PF_R32_UINT,
+            &DeltaData,
+            BUF_Static,
+            TEXT("MarchingSquaresHistoryEntryData")
+            );
+
+        ApplyCaptureData_RT(RHICmdList, Map, BlockData, EntryData, BlockRects.Num(), 0);
+
+        BlockData.Release();
+        EntryData.Release();
+    }
+
+    // Apply CPU voxel data block deltas
+
+    FMarchingSquaresCPUVoxelData& CPUVoxelData(Map.GetCPUVoxelData());
+
+    if (Entry.CPUBlocks.Num() > 0 && CPUVoxelData.IsValid() && CPUVoxelData.Dimension == Dimension_RT)
+    {
+        for (const FBlockDelta& BlockDelta : Entry.CPUBlocks)
+        {
+            ApplyBlockCPU(CPUVoxelData, BlockDelta);
+        }
+    }
+
+    return true;
+}
+
+void FMarchingSquaresMapHistory::ApplyCaptureData_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, FRULRWBuffer& BlockData, FRULRWBuffer& EntryData, int32 BlockCount, uint32 PairOffset)
+{
+    TShaderMap<FGlobalShaderType>* RHIShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    RHICmdList.BeginComputePass(TEXT("MarchingSquaresHistoryApply"));
+    {
+        TShaderMapRef<FMSQHistoryApplyCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("HistoryBlockData"), BlockData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("HistoryEntryData"), EntryData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelStateData"), Map.GetVoxelStateData().UAV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelFeatureData"), Map.GetVoxelFeatureData().UAV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelDistanceData"), Map.GetVoxelDistanceData().UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension_RT);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockSize"), static_cast<uint32>(BlockSize_RT));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockCount"), static_cast<uint32>(BlockCount));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceLayerCount"), static_cast<uint32>(DistanceLayerCount_RT));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_RecordStride"), static_cast<uint32>(GetRecordStride()));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_PairOffset"), PairOffset);
+        ComputeShader->DispatchAndClear(RHICmdList, BlockSize_RT, BlockSize_RT, BlockCount);
+    }
+    RHICmdList.EndComputePass();
+}
+
+bool FMarchingSquaresMapHistory::Undo_RT(FMarchingSquaresMap& Map, FIntRect& OutVoxelRect, FIntRect& OutCPUVoxelRect)
+{
+    check(IsInRenderingThread());
+
+    // Commit edits of an unfinished group before restoring
+    CommitPendingEntry_RT(Map);
+    Update_RT();
+
+    if (UndoEntries.Num() < 1)
+    {
+        return false;
+    }
+
+    FHistoryEntry Entry(UndoEntries.Pop(false));
+
+    if (! ApplyEntry_RT(Map, Entry))
+    {
+        Clear_RT();
+        return false;
+    }
+
+    OutVoxelRect = Entry.VoxelRect;
+    OutCPUVoxelRect = Entry.CPUVoxelRect;
+    RedoEntries.Emplace(MoveTemp(Entry));
+
+    UpdateCounters_RT();
+
+    return true;
+}
+
+bool FMarchingSquaresMapHistory::Redo_RT(FMarchingSquaresMap& Map, FIntRect& OutVoxelRect, FIntRect& OutCPUVoxelRect)
+{
+    check(IsInRenderingThread());
+
+    // Committing a pending edit invalidates redo entries
+    CommitPendingEntry_RT(Map);
+    Update_RT();
+
+    if (RedoEntries.Num() < 1)
+    {
+        return false;
+    }
+
+    FHistoryEntry Entry(RedoEntries.Pop(false));
+
+    if (! ApplyEntry_RT(Map, Entry))
+    {
+        Clear_RT();
+        return false;
+    }
+
+    OutVoxelRect = Entry.VoxelRect;
+    OutCPUVoxelRect = Entry.CPUVoxelRect;
+    UndoEntries.Emplace(MoveTemp(Entry));
+
+    UpdateCounters_RT();
+
+    return true;
+}
+
+void FMarchingSquaresMapHistory::UpdateCounters_RT()
+{
+    SIZE_T Size = UndoEntries.GetAllocatedSize() + RedoEntries.GetAllocatedSize();
+
+    for (const FHistoryEntry& Entry : UndoEntries)
+    {
+        Size += Entry.GetAllocatedSize();
+    }
+
+    for (const FHistoryEntry& Entry : RedoEntries)
+    {
+        Size += Entry.GetAllocatedSize();
+    }
+
+    UndoCount.Set(UndoEntries.Num());
+    RedoCount.Set(RedoEntries.Num());
+    AllocatedSize.Set((int32) FMath::Min<SIZE_T>(Size, MAX_int32));
+}
+
+void FMarchingSquaresMapHistory::WriteBlockData_RT(const TArray<FIntRect>& Blocks, FRULRWBuffer& OutBlockData)
+{
+    // Block voxel origins (x | y << 16)
+
+    FHistoryData BlockData(false);
+    BlockData.SetNumUninitialized(Blocks.Num());
+
+    for (int32 i=0; i<Blocks.Num(); ++i)
+    {
+        const FIntPoint& Origin(Blocks[i].Min);
+        BlockData[i] = (Origin.X & 0xFFFF) | (Origin.Y << 16);
+    }
+
+    OutBlockData.Initialize(
+        sizeof(FHistoryData::ElementType),
+        BlockData.Num(),
+        PF_R32_UINT,
+        &BlockData,
+        BUF_Static,
+        TEXT("MarchingSquaresHistoryBlockData")
+        );
+}
+
+void FMarchingSquaresMapHistory::BeginEditCPU(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& VoxelRect, int32 BlockSize)
+{
+    check(IsInGameThread());
+
+    if (! VoxelData.IsValid() || BlockSize < 1)
+    {
+        return;
+    }
+
+    // Block size change invalidates snapshots of an unfinished edit
+
+    if (CPUBlockSize != BlockSize)
+    {
+        CPUSnapshots.Empty();
+        CPUBlockSize = BlockSize;
+    }
+
+    const FIntPoint& Dimension(VoxelData.Dimension);
+
+    FIntRect Rect(VoxelRect);
+    Rect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension));
+
+    if (Rect.Area() <= 0)
+    {
+        return;
+    }
+
+    const FIntPoint BlockMin(Rect.Min / BlockSize);
+    const FIntPoint BlockMax((Rect.Max.X-1) / BlockSize + 1, (Rect.Max.Y-1) / BlockSize + 1);
+
+    for (int32 by=BlockMin.Y; by<BlockMax.Y; ++by)
+    for (int32 bx=BlockMin.X; bx<BlockMax.X; ++bx)
+    {
+        const FIntPoint Block(bx, by);
+
+        if (! CPUSnapshots.Contains(Block))
+        {
+            FIntRect BlockRect(Block*BlockSize, Block*BlockSize + BlockSize);
+            BlockRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension));
+
+            CopyBlockCPU(VoxelData, BlockRect, CPUSnapshots.Add(Block));
+        }
+    }
+}
+
+void FMarchingSquaresMapHistory::EndEditCPU(const FMarchingSquaresCPUVoxelData& VoxelData, TArray<FBlockDelta>& OutBlocks)
+{
+    check(IsInGameThread());
+
+    OutBlocks.Reset();
+
+    if (! VoxelData.IsValid())
+    {
+        CPUSnapshots.Empty();
+        return;
+    }
+
+    TArray<uint32> BlockData;
+
+    for (const auto& SnapshotPair : CPUSnapshots)
+    {
+        const FIntPoint& Block(SnapshotPair.Key);
+
+        FBlockDelta BlockDelta;
+        BlockDelta.VoxelRect = FIntRect(Block*CPUBlockSize, Block*CPUBlockSize + CPUBlockSize);
+        BlockDelta.VoxelRect.Clip(FIntRect(FIntPoint::ZeroValue, VoxelData.Dimension));
+
+        CopyBlockCPU(VoxelData, BlockDelta.VoxelRect, BlockData);
+
+        if (BlockData.Num() != SnapshotPair.Value.Num())
+        {
+            continue;
+        }
+
+        EncodeDelta(SnapshotPair.Value.GetData(), BlockData.GetData(), BlockData.Num(), BlockDelta.Delta);
+
+        if (BlockDelta.Delta.Num() > 0)
+        {
+            OutBlocks.Emplace(MoveTemp(BlockDelta));
+        }
+    }
+
+    CPUSnapshots.Empty();
+}
+
+void FMarchingSquaresMapHistory::CopyBlockCPU(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& VoxelRect, TArray<uint32>& OutRecords)
+{
+    const int32 Stride = VoxelData.Dimension.X;
+    const int32 LayerCount = VoxelData.DistanceLayerCount;
+
+    // Distance words are recorded by the even voxel of each voxel pair
+
+    const int32 PairCount = ((VoxelRect.Max.X+1)/2 - (VoxelRect.Min.X+1)/2) * VoxelRect.Height();
+
+    OutRecords.SetNumUninitialized(VoxelRect.Area() * 2 + PairCount * LayerCount, false);
+
+    uint32* RecordPtr = OutRecords.GetData();
+
+    for (int32 y=VoxelRect.Min.Y; y<VoxelRect.Max.Y; ++y)
+    for (int32 x=VoxelRect.Min.X; x<VoxelRect.Max.X; ++x)
+    {
+        const int32 VoxelIndex = x + y*Stride;
+        *RecordPtr++ = VoxelData.VoxelStateData[VoxelIndex];
+        *RecordPtr++ = VoxelData.VoxelFeatureData[VoxelIndex];
+
+        if ((x & 1) == 0)
+        {
+            for (int32 Layer=0; Layer<LayerCount; ++Layer)
+            {
+                *RecordPtr++ = VoxelData.VoxelDistanceData[VoxelData.GetDistanceIndex(x, y, Layer)];
+            }
+        }
+    }
+}
+
+void FMarchingSquaresMapHistory::ApplyBlockCPU(FMarchingSquaresCPUVoxelData& VoxelData, const FBlockDelta& BlockDelta)
+{
+    const FIntRect& VoxelRect(BlockDelta.VoxelRect);
+    const int32 Stride = VoxelData.Dimension.X;
+
+    TArray<uint32> Records;
+    CopyBlockCPU(VoxelData, VoxelRect, Records);
+    ApplyDelta(BlockDelta.Delta, Records.GetData(), Records.Num());
+
+    const uint32* RecordPtr = Records.GetData();
+
+    for (int32 y=VoxelRect.Min.Y; y<VoxelRect.Max.Y; ++y)
+    for (int32 x=VoxelRect.Min.X; x<VoxelRect.Max.X; ++x)
+    {
+        const int32 VoxelIndex = x + y*Stride;
+        VoxelData.VoxelStateData[VoxelIndex] = *RecordPtr++;
+        VoxelData.VoxelFeatureData[VoxelIndex] = *RecordPtr++;
+
+        if ((x & 1) == 0)
+        {
+            for (int32 Layer=0; Layer<VoxelData.DistanceLayerCount; ++Layer)
+            {
+                VoxelData.VoxelDistanceData[VoxelData.GetDistanceIndex(x, y, Layer)] = *RecordPtr++;
+            }
+        }
+    }
+}
+
+void FMarchingSquaresMapHistory::EncodeDelta(const uint32* Before, const uint32* After, int32 Count, TArray<uint32>& OutDelta)
+{
+    OutDelta.Reset();
+
+    int32 i = 0;
+
+    while (i < Count)
+    {
+        // Skip unchanged words
+
+        const int32 ZeroStart = i;
+
+        while (i < Count && Before[i] == After[i])
+        {
+            ++i;
+        }
+
+        if (i >= Count)
+        {
+            break;
+        }
+
+        // Write changed words. A single unchanged word between changed
+        // words is written as literal, new run header costs two words.
+
+        const int32 HeaderIndex = OutDelta.Num();
+        OutDelta.Emplace(i-ZeroStart);
+        OutDelta.Emplace(0);
+
+        int32 LiteralCount = 0;
+
+        while (i < Count)
+        {
+            const bool bChanged = Before[i] != After[i];
+            const bool bNextChanged = (i+1 < Count) && Before[i+1] != After[i+1];
+
+            if (! bChanged && ! bNextChanged)
+            {
+                break;
+            }
+
+            OutDelta.Emplace(Before[i] ^ After[i]);
+            ++LiteralCount;
+            ++i;
+        }
+
+        OutDelta[HeaderIndex+1] = LiteralCount;
+    }
+
+    OutDelta.Shrink();
+}
+
+void FMarchingSquaresMapHistory::ApplyDelta(const TArray<uint32>& Delta, uint32* Data, int32 Count)
+{
+    int32 i = 0;
+    int32 Index = 0;
+
+    while (i+1 < Delta.Num())
+    {
+        Index += Delta[i];
+
+        const int32 LiteralCount = Delta[i+1];
+        i += 2;
+
+        check(Index + LiteralCount <= Count);
+        check(i + LiteralCount <= Delta.Num());
+
+        for (int32 li=0; li<LiteralCount; ++li, ++Index, ++i)
+        {
+            Data[Index] ^= Delta[i];
+        }
+    }
+}
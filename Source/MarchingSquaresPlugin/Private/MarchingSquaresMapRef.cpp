@@ -29,6 +29,7 @@
 
 #include "GenericWorkerThread.h"
 #include "GWTTickManager.h"
+#include "PhysicsEngine/BodySetup.h"
 
 #include "MarchingSquaresPlugin.h"
 
@@ -37,6 +38,9 @@ UMarchingSquaresMapRef::UMarchingSquaresMapRef(const FObjectInitializer& ObjectI
 {
     // Register build map callback
     Map.OnBuildMapDone().AddUObject(this, &UMarchingSquaresMapRef::OnBuildMapDoneCallback);
+    Map.OnBuildMapRectDone().AddUObject(this, &UMarchingSquaresMapRef::OnBuildMapRectDoneCallback);
+    Map.OnCollisionUpdated().AddUObject(this, &UMarchingSquaresMapRef::OnCollisionUpdatedCallback);
+    Map.OnNavGraphUpdated().AddUObject(this, &UMarchingSquaresMapRef::OnNavGraphUpdatedCallback);
 }
 
 // MAP SETTINGS FUNCTIONS
@@ -50,6 +54,27 @@ void UMarchingSquaresMapRef::ApplyMapSettings()
     Map.BoundsSurfaceOverrideZ = BoundsSurfaceOverrideZ;
     Map.BoundsExtrudeOverrideZ = BoundsExtrudeOverrideZ;
 
+    Map.DistanceLayerCount = FMath::Max(0, DistanceLayerCount);
+    Map.DistanceRange = FMath::Max(1.f, DistanceRange);
+
+    Map.HistoryLimit = FMath::Max(0, HistoryLimit);
+
+    Map.bEnableVoxelMirror = bEnableVoxelMirror;
+    Map.bEnableSectionBVH = bEnableSectionBVH;
+
+    Map.bEnableCollision = bEnableCollision;
+    Map.CollisionFillType = FMath::Clamp(CollisionFillType, 0, 255);
+    Map.CollisionSimplifyTolerance = FMath::Max(0.f, CollisionSimplifyTolerance);
+    Map.CollisionMaxPolygonPointCount = FMath::Max(3, CollisionMaxPolygonPointCount);
+
+    Map.bEnableNavGraph = bEnableNavGraph;
+    Map.NavPassableFillTypes.Reset(NavPassableFillTypes.Num());
+
+    for (int32 FillType : NavPassableFillTypes)
+    {
+        Map.NavPassableFillTypes.AddUnique(static_cast<uint8>(FMath::Clamp(FillType, 0, 255)));
+    }
+
     Map.SurfaceHeightScale = SurfaceHeightScale;
     Map.ExtrudeHeightScale = ExtrudeHeightScale;
 
@@ -58,6 +83,8 @@ void UMarchingSquaresMapRef::ApplyMapSettings()
 
     Map.MeshPrefabs = MeshPrefabs;
     Map.DebugRTT = DebugRTT;
+
+    Map.CommitSettings();
 }
 
 void UMarchingSquaresMapRef::SetHeightMap(FRULShaderTextureParameterInput TextureInput)
@@ -82,6 +109,61 @@ void UMarchingSquaresMapRef::OnBuildMapDoneCallback(bool bBuildMapResult, uint32
     TickManager.EnqueueTickCallback(TickCallback);
 }
 
+void UMarchingSquaresMapRef::OnBuildMapRectDoneCallback(bool bBuildMapResult, uint32 FillType, const FIntRect& BlockRect)
+{
+    FGWTTickManager& TickManager(IGenericWorkerThread::Get().GetTickManager());
+    FGWTTickManager::FTickCallback TickCallback(
+        [this, bBuildMapResult, FillType, BlockRect]()
+        {
+            OnBuildMapRectDone.Broadcast(bBuildMapResult, FillType, BlockRect.Min, BlockRect.Max);
+        } );
+    TickManager.EnqueueTickCallback(TickCallback);
+}
+
+void UMarchingSquaresMapRef::OnVoxelStatsUpdatedCallback()
+{
+    FGWTTickManager& TickManager(IGenericWorkerThread::Get().GetTickManager());
+    FGWTTickManager::FTickCallback TickCallback(
+        [this]()
+        {
+            OnVoxelStatsUpdated.Broadcast();
+        } );
+    TickManager.EnqueueTickCallback(TickCallback);
+}
+
+void UMarchingSquaresMapRef::OnVoxelComponentsUpdatedCallback()
+{
+    FGWTTickManager& TickManager(IGenericWorkerThread::Get().GetTickManager());
+    FGWTTickManager::FTickCallback TickCallback(
+        [this]()
+        {
+            OnVoxelComponentsUpdated.Broadcast();
+        } );
+    TickManager.EnqueueTickCallback(TickCallback);
+}
+
+void UMarchingSquaresMapRef::OnCollisionUpdatedCallback(const TArray<FIntPoint>& ChangedBlocks)
+{
+    FGWTTickManager& TickManager(IGenericWorkerThread::Get().GetTickManager());
+    FGWTTickManager::FTickCallback TickCallback(
+        [this, ChangedBlocks]()
+        {
+            OnCollisionUpdated.Broadcast(ChangedBlocks);
+        } );
+    TickManager.EnqueueTickCallback(TickCallback);
+}
+
+void UMarchingSquaresMapRef::OnNavGraphUpdatedCallback(const TArray<FIntPoint>& ChangedBlocks)
+{
+    FGWTTickManager& TickManager(IGenericWorkerThread::Get().GetTickManager());
+    FGWTTickManager::FTickCallback TickCallback(
+        [this, ChangedBlocks]()
+        {
+            OnNavGraphUpdated.Broadcast(ChangedBlocks);
+        } );
+    TickManager.EnqueueTickCallback(TickCallback);
+}
+
 void UMarchingSquaresMapRef::GetMapDimensionData(FIntPoint& MapDimensionI, FVector2D& MapDimensionV, FIntPoint& VoxDimensionI, FVector2D& VoxDimensionV)
 {
     MapDimensionI = FIntPoint(DimX, DimY);
@@ -106,11 +188,549 @@ void UMarchingSquaresMapRef::BuildMap(int32 FillType, bool bGenerateWalls)
     }
 }
 
+void UMarchingSquaresMapRef::BuildMapRect(int32 FillType, bool bGenerateWalls, FIntPoint VoxelMin, FIntPoint VoxelMax)
+{
+    if (Map.HasValidDimension())
+    {
+        Map.BuildMapRect(FMath::Max(0, FillType), bGenerateWalls, FIntRect(VoxelMin, VoxelMax));
+    }
+    else
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("UMarchingSquaresMapRef::BuildMapRect() ABORTED - Invalid map dimension"));
+    }
+}
+
 void UMarchingSquaresMapRef::ClearMap()
 {
     Map.ClearMap();
 }
 
+// HISTORY FUNCTIONS
+
+void UMarchingSquaresMapRef::BeginHistoryGroup()
+{
+    Map.BeginHistoryGroup();
+}
+
+void UMarchingSquaresMapRef::EndHistoryGroup()
+{
+    Map.EndHistoryGroup();
+}
+
+void UMarchingSquaresMapRef::UndoEdit(const TArray<int32>& BuildFillTypes, bool bGenerateWalls)
+{
+    TArray<uint32> FillTypes;
+
+    for (int32 FillType : BuildFillTypes)
+    {
+        if (FillType >= 0)
+        {
+            FillTypes.AddUnique(FillType);
+        }
+    }
+
+    Map.UndoHistory(FillTypes, bGenerateWalls);
+}
+
+void UMarchingSquaresMapRef::RedoEdit(const TArray<int32>& BuildFillTypes, bool bGenerateWalls)
+{
+    TArray<uint32> FillTypes;
+
+    for (int32 FillType : BuildFillTypes)
+    {
+        if (FillType >= 0)
+        {
+            FillTypes.AddUnique(FillType);
+        }
+    }
+
+    Map.RedoHistory(FillTypes, bGenerateWalls);
+}
+
+void UMarchingSquaresMapRef::ClearHistory()
+{
+    Map.ClearHistory();
+}
+
+int32 UMarchingSquaresMapRef::GetUndoCount() const
+{
+    return Map.GetHistory().GetUndoCount();
+}
+
+int32 UMarchingSquaresMapRef::GetRedoCount() const
+{
+    return Map.GetHistory().GetRedoCount();
+}
+
+// IMPORT FUNCTIONS
+
+void UMarchingSquaresMapRef::ImportVoxelTexture(
+    FRULShaderTextureParameterInput FillTypeTexture,
+    FRULShaderTextureParameterInput EdgeTexture,
+    bool bUseEdgeTexture,
+    FIntPoint Offset,
+    EMarchingSquaresImportChannel FillTypeChannel,
+    EMarchingSquaresImportChannel EdgeChannel
+    )
+{
+    if (! Map.HasValidDimension())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("UMarchingSquaresMapRef::ImportVoxelTexture() ABORTED - Invalid map dimension"));
+        return;
+    }
+
+    FMarchingSquaresVoxelImport::FImportParameter Parameter;
+    Parameter.Map = &Map;
+    Parameter.Offset = Offset;
+    Parameter.FillTypeChannel = FillTypeChannel;
+    Parameter.EdgeChannel = EdgeChannel;
+
+    FRULShaderTextureParameterInputResource FillTypeResource(FillTypeTexture.GetResource_GT());
+    FRULShaderTextureParameterInputResource EdgeResource(EdgeTexture.GetResource_GT());
+
+    Map.InitializeVoxelData();
+
+    ENQUEUE_RENDER_COMMAND(UMarchingSquaresMapRef_ImportVoxelTexture)(
+        [Parameter, FillTypeResource, EdgeResource, bUseEdgeTexture](FRHICommandListImmediate& RHICmdList)
+        {
+            FMarchingSquaresVoxelImport::ImportTexture_RT(
+                RHICmdList,
+                Parameter,
+                FillTypeResource.GetTextureParamRef_RT(),
+                bUseEdgeTexture ? EdgeResource.GetTextureParamRef_RT() : nullptr
+                );
+        } );
+}
+
+void UMarchingSquaresMapRef::ImportVoxelImage(
+    const TArray<uint8>& FillTypes,
+    const TArray<uint8>& Edges,
+    FIntPoint ImageSize,
+    FIntPoint Offset,
+    bool bImportToCPUVoxelData
+    )
+{
+    if (! Map.HasValidDimension())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("UMarchingSquaresMapRef::ImportVoxelImage() ABORTED - Invalid map dimension"));
+        return;
+    }
+
+    FMarchingSquaresVoxelImport::FImportParameter Parameter;
+    Parameter.Map = &Map;
+    Parameter.Offset = Offset;
+    Parameter.FillTypeChannel = EMarchingSquaresImportChannel::Red;
+    Parameter.EdgeChannel = EMarchingSquaresImportChannel::Green;
+
+    FMarchingSquaresVoxelImport::FImportImage Image;
+    Image.Size = ImageSize;
+    Image.FillTypeData = FillTypes;
+    Image.EdgeData = Edges;
+
+    if (bImportToCPUVoxelData)
+    {
+        FMarchingSquaresVoxelImport::ImportImageCPU(Parameter, Image);
+    }
+    else
+    {
+        FMarchingSquaresVoxelImport::ImportImage(Parameter, Image);
+    }
+}
+
+// QUERY FUNCTIONS
+
+void UMarchingSquaresMapRef::UpdateVoxelMirror()
+{
+    Map.UpdateVoxelMirror();
+}
+
+bool UMarchingSquaresMapRef::IsVoxelMirrorSynced() const
+{
+    return Map.GetVoxelMirror().IsSynced();
+}
+
+int32 UMarchingSquaresMapRef::GetVoxelFillType(FIntPoint Voxel) const
+{
+    return Map.GetVoxelMirror().GetVoxelFillType(Voxel);
+}
+
+bool UMarchingSquaresMapRef::IsPointFilled(FVector2D Point, int32 FillType) const
+{
+    if (FillType < 0 || FillType > 0xFF)
+    {
+        return false;
+    }
+
+    return Map.GetVoxelMirror().IsPointFilled(Point, FillType);
+}
+
+bool UMarchingSquaresMapRef::RaycastBoundary(FVector2D Start, FVector2D End, int32 FillType, FVector2D& HitLocation, FVector2D& HitNormal) const
+{
+    if (FillType < 0 || FillType > 0xFF)
+    {
+        return false;
+    }
+
+    FMarchingSquaresVoxelMirror::FRaycastResult Result;
+
+    if (Map.GetVoxelMirror().Raycast(Start, End, FillType, Result))
+    {
+        HitLocation = Result.Location;
+        HitNormal = Result.Normal;
+        return true;
+    }
+
+    return false;
+}
+
+float UMarchingSquaresMapRef::GetFillFraction(FVector2D RectMin, FVector2D RectMax, int32 FillType) const
+{
+    if (FillType < 0 || FillType > 0xFF)
+    {
+        return 0.f;
+    }
+
+    return Map.GetVoxelMirror().GetFillFraction(FBox2D(RectMin, RectMax), FillType);
+}
+
+TArray<FMarchingSquaresContourPolyline> UMarchingSquaresMapRef::ExtractContours(int32 FillType, bool bCloseAtMapBorder, float SimplifyTolerance) const
+{
+    return ExtractContoursInRect(FillType, FIntPoint::ZeroValue, FIntPoint::ZeroValue, bCloseAtMapBorder, SimplifyTolerance);
+}
+
+TArray<FMarchingSquaresContourPolyline> UMarchingSquaresMapRef::ExtractContoursInRect(int32 FillType, FIntPoint CellMin, FIntPoint CellMax, bool bCloseAtMapBorder, float SimplifyTolerance) const
+{
+    TArray<FMarchingSquaresContourPolyline> Polylines;
+
+    if (FillType < 0 || FillType > 0xFF)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("UMarchingSquaresMapRef::ExtractContours() ABORTED - Invalid fill type"));
+        return Polylines;
+    }
+
+    FMarchingSquaresContour::FExtractParameter Parameter;
+    Parameter.FillType = FillType;
+    Parameter.CellRect = FIntRect(CellMin, CellMax);
+    Parameter.bCloseAtMapBorder = bCloseAtMapBorder;
+    Parameter.SimplifyTolerance = SimplifyTolerance;
+
+    TArray<FMarchingSquaresContour::FContourPolyline> ContourPolylines;
+    FMarchingSquaresContour::ExtractContours(Map.GetVoxelMirror(), Parameter, ContourPolylines);
+
+    Polylines.SetNum(ContourPolylines.Num());
+
+    for (int32 i=0; i<ContourPolylines.Num(); ++i)
+    {
+        Polylines[i].Points = MoveTemp(ContourPolylines[i].Points);
+        Polylines[i].bClosed = ContourPolylines[i].bClosed;
+    }
+
+    return Polylines;
+}
+
+// VOXEL STATISTICS FUNCTIONS
+
+bool UMarchingSquaresMapRef::UpdateVoxelStats()
+{
+    return Map.UpdateVoxelStats(
+        [this]()
+        {
+            OnVoxelStatsUpdatedCallback();
+        } );
+}
+
+void UMarchingSquaresMapRef::GetFillTypeStats(int32 FillType, float& Area, float& Perimeter, float& Coverage) const
+{
+    const FMarchingSquaresVoxelStats& Stats(Map.GetVoxelStats());
+    const FMarchingSquaresVoxelStats::FFillTypeStats FillTypeStats(Stats.GetTotalStats(FillType));
+
+    Area = FillTypeStats.Area;
+    Perimeter = FillTypeStats.Perimeter;
+    Coverage = Stats.GetCoverage(FillType);
+}
+
+FIntPoint UMarchingSquaresMapRef::GetVoxelStatsBlockCount() const
+{
+    return Map.GetVoxelStats().GetBlockCount();
+}
+
+bool UMarchingSquaresMapRef::GetBlockFillTypeStats(FIntPoint Block, int32 FillType, float& Area, float& Perimeter) const
+{
+    FMarchingSquaresVoxelStats::FBlockStats BlockStats;
+
+    Area = 0.f;
+    Perimeter = 0.f;
+
+    if (! Map.GetVoxelStats().GetBlockStats(Block, BlockStats))
+    {
+        return false;
+    }
+
+    if (const FMarchingSquaresVoxelStats::FFillTypeStats* FillTypeStats = BlockStats.FindFillType(FillType))
+    {
+        Area = FillTypeStats->Area;
+        Perimeter = FillTypeStats->Perimeter;
+    }
+
+    return true;
+}
+
+// VOXEL COMPONENT FUNCTIONS
+
+bool UMarchingSquaresMapRef::UpdateVoxelComponents()
+{
+    return Map.UpdateVoxelComponents(
+        [this]()
+        {
+            OnVoxelComponentsUpdatedCallback();
+        } );
+}
+
+int32 UMarchingSquaresMapRef::GetVoxelComponentCount() const
+{
+    return Map.GetVoxelComponents().GetComponentCount();
+}
+
+bool UMarchingSquaresMapRef::GetVoxelComponent(int32 ComponentId, int32& FillType, int32& VoxelCount, FIntPoint& BoundsMin, FIntPoint& BoundsMax) const
+{
+    FMarchingSquaresVoxelComponents::FComponent Component;
+
+    if (Map.GetVoxelComponents().GetComponent(ComponentId, Component))
+    {
+        FillType = Component.FillType;
+        VoxelCount = Component.VoxelCount;
+        BoundsMin = Component.Bounds.Min;
+        BoundsMax = Component.Bounds.Max;
+        return true;
+    }
+
+    FillType = -1;
+    VoxelCount = 0;
+    BoundsMin = FIntPoint::ZeroValue;
+    BoundsMax = FIntPoint::ZeroValue;
+    return false;
+}
+
+int32 UMarchingSquaresMapRef::GetVoxelComponentAt(FVector2D Point, int32 FillType) const
+{
+    if (FillType < 0 || FillType > 0xFF)
+    {
+        return -1;
+    }
+
+    return Map.GetVoxelComponents().GetComponentId(Map.GetVoxelMirror(), Point, FillType);
+}
+
+bool UMarchingSquaresMapRef::AreVoxelPointsConnected(FVector2D PointA, FVector2D PointB, int32 FillType) const
+{
+    const int32 ComponentA = GetVoxelComponentAt(PointA, FillType);
+    return ComponentA >= 0 && ComponentA == GetVoxelComponentAt(PointB, FillType);
+}
+
+// COLLISION FUNCTIONS
+
+bool UMarchingSquaresMapRef::UpdateCollision()
+{
+    return Map.UpdateCollision();
+}
+
+FIntPoint UMarchingSquaresMapRef::GetCollisionBlockCount() const
+{
+    return Map.GetCollision().GetBlockCount();
+}
+
+TArray<FMarchingSquaresContourPolyline> UMarchingSquaresMapRef::GetBlockCollisionPolygons(FIntPoint Block) const
+{
+    FMarchingSquaresCollision::FBlockCollision BlockCollision;
+    TArray<FMarchingSquaresContourPolyline> Polylines;
+
+    if (Map.GetCollision().GetBlockCollision(Block, BlockCollision))
+    {
+        Polylines.SetNum(BlockCollision.Polygons.Num());
+
+        for (int32 i=0; i<BlockCollision.Polygons.Num(); ++i)
+        {
+            Polylines[i].Points = MoveTemp(BlockCollision.Polygons[i].Points);
+            Polylines[i].bClosed = true;
+        }
+    }
+
+    return Polylines;
+}
+
+bool UMarchingSquaresMapRef::BuildBlockBodySetup(UBodySetup* BodySetup, FIntPoint Block, FVector2D VoxelScale, float MinZ, float MaxZ) const
+{
+    if (! IsValid(BodySetup))
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("UMarchingSquaresMapRef::BuildBlockBodySetup() ABORTED - Invalid body setup"));
+        return false;
+    }
+
+    FMarchingSquaresCollision::FBlockCollision BlockCollision;
+
+    if (! Map.GetCollision().GetBlockCollision(Block, BlockCollision))
+    {
+        return false;
+    }
+
+    BodySetup->AggGeom.ConvexElems.Reset();
+
+    FMarchingSquaresCollision::AddConvexElements(
+        BlockCollision.Polygons,
+        VoxelScale,
+        MinZ,
+        MaxZ,
+        BodySetup->AggGeom
+        );
+
+    BodySetup->InvalidatePhysicsData();
+    BodySetup->CreatePhysicsMeshes();
+
+    return true;
+}
+
+// NAVIGATION GRAPH FUNCTIONS
+
+namespace MarchingSquaresMapRefNavUtils
+{
+    FMarchingSquaresNavNode ConvertNode(const FMarchingSquaresNavGraph::FNode& Node)
+    {
+        FMarchingSquaresNavNode OutNode;
+        OutNode.Block = Node.Id.Block;
+        OutNode.Region = Node.Id.Region;
+        OutNode.VoxelCount = Node.VoxelCount;
+        OutNode.BoundsMin = Node.Bounds.Min;
+        OutNode.BoundsMax = Node.Bounds.Max;
+        OutNode.Anchor = Node.Anchor;
+        return OutNode;
+    }
+
+    TArray<FMarchingSquaresNavPortal> ConvertPortals(const TArray<FMarchingSquaresNavGraph::FPortal>& Portals)
+    {
+        TArray<FMarchingSquaresNavPortal> OutPortals;
+        OutPortals.SetNum(Portals.Num());
+
+        for (int32 i=0; i<Portals.Num(); ++i)
+        {
+            const FMarchingSquaresNavGraph::FPortal& Portal(Portals[i]);
+            FMarchingSquaresNavPortal& OutPortal(OutPortals[i]);
+
+            OutPortal.BlockA = Portal.NodeA.Block;
+            OutPortal.RegionA = Portal.NodeA.Region;
+            OutPortal.BlockB = Portal.NodeB.Block;
+            OutPortal.RegionB = Portal.NodeB.Region;
+            OutPortal.Start = Portal.Start;
+            OutPortal.End = Portal.End;
+            OutPortal.Width = Portal.Width;
+            OutPortal.Cost = Portal.Cost;
+        }
+
+        return OutPortals;
+    }
+}
+
+bool UMarchingSquaresMapRef::UpdateNavGraph()
+{
+    return Map.UpdateNavGraph();
+}
+
+FIntPoint UMarchingSquaresMapRef::GetNavGraphBlockCount() const
+{
+    return Map.GetNavGraph().GetBlockCount();
+}
+
+TArray<FMarchingSquaresNavNode> UMarchingSquaresMapRef::GetNavBlockNodes(FIntPoint Block) const
+{
+    TArray<FMarchingSquaresNavGraph::FNode> Nodes;
+    TArray<FMarchingSquaresNavNode> OutNodes;
+
+    if (Map.GetNavGraph().GetBlockNodes(Block, Nodes))
+    {
+        OutNodes.Reserve(Nodes.Num());
+
+        for (const FMarchingSquaresNavGraph::FNode& Node : Nodes)
+        {
+            OutNodes.Emplace(MarchingSquaresMapRefNavUtils::ConvertNode(Node));
+        }
+    }
+
+    return OutNodes;
+}
+
+TArray<FMarchingSquaresNavPortal> UMarchingSquaresMapRef::GetNavBlockPortals(FIntPoint Block) const
+{
+    TArray<FMarchingSquaresNavGraph::FPortal> Portals;
+    Map.GetNavGraph().GetBlockPortals(Block, Portals);
+    return MarchingSquaresMapRefNavUtils::ConvertPortals(Portals);
+}
+
+bool UMarchingSquaresMapRef::GetNavNodeAt(FIntPoint Voxel, FMarchingSquaresNavNode& OutNode) const
+{
+    const FMarchingSquaresNavGraph& NavGraph(Map.GetNavGraph());
+    const FMarchingSquaresNavGraph::FNodeId NodeId(NavGraph.GetNodeAt(Voxel));
+
+    FMarchingSquaresNavGraph::FNode Node;
+
+    if (NodeId.IsValid() && NavGraph.GetNode(NodeId, Node))
+    {
+        OutNode = MarchingSquaresMapRefNavUtils::ConvertNode(Node);
+        return true;
+    }
+
+    OutNode = FMarchingSquaresNavNode();
+    return false;
+}
+
+TArray<FMarchingSquaresNavPortal> UMarchingSquaresMapRef::GetNavNodePortals(FIntPoint Block, int32 Region) const
+{
+    FMarchingSquaresNavGraph::FNodeId NodeId;
+    NodeId.Block = Block;
+    NodeId.Region = Region;
+
+    TArray<FMarchingSquaresNavGraph::FPortal> Portals;
+    Map.GetNavGraph().GetNodePortals(NodeId, Portals);
+    return MarchingSquaresMapRefNavUtils::ConvertPortals(Portals);
+}
+
+// SECTION TRACE FUNCTIONS
+
+bool UMarchingSquaresMapRef::RaycastSections(FVector Origin, FVector Direction, float MaxDistance, int32 FillType, FVector& HitLocation, FVector& HitNormal, float& HitDistance, int32& HitSectionIndex) const
+{
+    FMarchingSquaresSectionBVH::FTraceResult Result;
+
+    if (Map.GetSectionBVH().Raycast(Origin, Direction, MaxDistance, FillType, Result))
+    {
+        HitLocation = Result.Location;
+        HitNormal = Result.Normal;
+        HitDistance = Result.Distance;
+        HitSectionIndex = Result.SectionIndex;
+        return true;
+    }
+
+    return false;
+}
+
+bool UMarchingSquaresMapRef::SegmentTraceSections(FVector Start, FVector End, int32 FillType, FVector& HitLocation, FVector& HitNormal, float& HitDistance, int32& HitSectionIndex) const
+{
+    FMarchingSquaresSectionBVH::FTraceResult Result;
+
+    if (Map.GetSectionBVH().SegmentTrace(Start, End, FillType, Result))
+    {
+        HitLocation = Result.Location;
+        HitNormal = Result.Normal;
+        HitDistance = Result.Distance;
+        HitSectionIndex = Result.SectionIndex;
+        return true;
+    }
+
+    return false;
+}
+
+bool UMarchingSquaresMapRef::IsSegmentBlockedBySections(FVector Start, FVector End, int32 FillType) const
+{
+    return Map.GetSectionBVH().IsSegmentBlocked(Start, End, FillType);
+}
+
 // SECTION FUNCTIONS
 
 bool UMarchingSquaresMapRef::HasSection(int32 FillType, int32 Index) const
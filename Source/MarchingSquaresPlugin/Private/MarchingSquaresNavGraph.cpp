@@ -0,0 +1,807 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresNavGraph.h"
+
+#include "Async/ParallelFor.h"
+
+namespace MarchingSquaresNavGraphUtils
+{
+    FORCEINLINE int32 FindRoot(TArray<int32>& Parents, int32 i)
+    {
+        while (Parents[i] != i)
+        {
+            Parents[i] = Parents[Parents[i]];
+            i = Parents[i];
+        }
+
+        return i;
+    }
+
+    FORCEINLINE void Union(TArray<int32>& Parents, int32 A, int32 B)
+    {
+        A = FindRoot(Parents, A);
+        B = FindRoot(Parents, B);
+
+        if (A < B)
+        {
+            Parents[B] = A;
+        }
+        else
+        if (B < A)
+        {
+            Parents[A] = B;
+        }
+    }
+
+    // Connect diagonal corners of a saddle cell with a passable center,
+    // corners are in build case code order
+    template<typename FConnectFunc>
+    FORCEINLINE void ConnectDiagonals(bool p0, bool p1, bool p2, bool p3, bool pc, FConnectFunc Connect)
+    {
+        if (p0 && p3 && ! p1 && ! p2 && pc) Connect(0, 3);
+        if (p1 && p2 && ! p0 && ! p3 && pc) Connect(1, 2);
+    }
+
+    // Connect passable corner voxels of a cell, corner states are in build
+    // case code order. Diagonal corners of a saddle cell are connected if
+    // the cell center is passable, see FMarchingSquaresVoxelComponents.
+    template<typename FConnectFunc>
+    FORCEINLINE void ConnectCell(const uint32 States[4], const bool bPassable[256], FConnectFunc Connect)
+    {
+        const bool p0 = bPassable[States[0] & 0xFF];
+        const bool p1 = bPassable[States[1] & 0xFF];
+        const bool p2 = bPassable[States[2] & 0xFF];
+        const bool p3 = bPassable[States[3] & 0xFF];
+        const bool pc = bPassable[(States[0] >> 8) & 0xFF];
+
+        if (p0 && p1) Connect(0, 1);
+        if (p0 && p2) Connect(0, 2);
+        if (p1 && p3) Connect(1, 3);
+        if (p2 && p3) Connect(2, 3);
+
+        ConnectDiagonals(p0, p1, p2, p3, pc, Connect);
+    }
+}
+
+bool FMarchingSquaresNavGraph::FGraphParameter::operator==(const FGraphParameter& Other) const
+{
+    return PassableFillTypes == Other.PassableFillTypes;
+}
+
+FMarchingSquaresNavGraph::~FMarchingSquaresNavGraph()
+{
+    // Wait for in-flight update, the task references this object
+
+    if (UpdateTask.IsValid() && ! UpdateTask->IsComplete())
+    {
+        FTaskGraphInterface::Get().WaitUntilTaskCompletes(UpdateTask);
+    }
+}
+
+void FMarchingSquaresNavGraph::LabelBlock(const TArray<uint32>& States, const bool bPassable[256], FBlockGraph& Block)
+{
+    using namespace MarchingSquaresNavGraphUtils;
+
+    const FIntPoint Size(Block.VoxelRect.Size());
+    const int32 VoxelCount = Size.X * Size.Y;
+
+    Block.Labels.Reset();
+    Block.Nodes.Reset();
+
+    if (States.Num() != VoxelCount)
+    {
+        return;
+    }
+
+    // Connect passable voxels of cells within the block, regions across
+    // block borders are connected by portals
+
+    TArray<int32> Parents;
+    Parents.SetNumUninitialized(VoxelCount);
+
+    for (int32 i=0; i<VoxelCount; ++i)
+    {
+        Parents[i] = i;
+    }
+
+    for (int32 y=0; y<Size.Y-1; ++y)
+    for (int32 x=0; x<Size.X-1; ++x)
+    {
+        const int32 i0 = x + y*Size.X;
+        const int32 Indices[4] = { i0, i0+1, i0+Size.X, i0+Size.X+1 };
+        const uint32 CellStates[4] = {
+            States[Indices[0]],
+            States[Indices[1]],
+            States[Indices[2]],
+            States[Indices[3]]
+            };
+
+        ConnectCell(CellStates, bPassable, [&](int32 A, int32 B)
+        {
+            Union(Parents, Indices[A], Indices[B]);
+        } );
+    }
+
+    // Compact root voxels of passable voxels to region labels
+
+    TArray<int32> RootLabels;
+    RootLabels.Init(-1, VoxelCount);
+
+    TArray<FVector2D> Centroids;
+
+    Block.Labels.Init(INVALID_LABEL, VoxelCount);
+
+    for (int32 i=0; i<VoxelCount; ++i)
+    {
+        if (! bPassable[States[i] & 0xFF])
+        {
+            continue;
+        }
+
+        const FIntPoint Voxel(Block.VoxelRect.Min + FIntPoint(i % Size.X, i / Size.X));
+        int32& Label(RootLabels[FindRoot(Parents, i)]);
+
+        if (Label < 0)
+        {
+            Label = Block.Nodes.Num();
+
+            FNode& Node(Block.Nodes[Block.Nodes.AddDefaulted()]);
+            Node.Id.Block = Block.Block;
+            Node.Id.Region = Label;
+            Node.Bounds = FIntRect(Voxel, Voxel + FIntPoint(1,1));
+            Node.Anchor = Voxel;
+
+            Centroids.Emplace(FVector2D::ZeroVector);
+        }
+
+        FNode& Node(Block.Nodes[Label]);
+        Node.Bounds.Min = Node.Bounds.Min.ComponentMin(Voxel);
+        Node.Bounds.Max = Node.Bounds.Max.ComponentMax(Voxel + FIntPoint(1,1));
+        ++Node.VoxelCount;
+
+        Centroids[Label] += FVector2D(Voxel);
+        Block.Labels[i] = static_cast<uint16>(Label);
+    }
+
+    // Record passable centers of border cells, border cells are connected
+    // when linking blocks
+
+    Block.BorderCenters[0].Init(false, Size.Y);
+    Block.BorderCenters[1].Init(false, Size.X);
+
+    for (int32 y=0; y<Size.Y; ++y)
+    {
+        Block.BorderCenters[0][y] = bPassable[(States[(Size.X-1) + y*Size.X] >> 8) & 0xFF];
+    }
+
+    for (int32 x=0; x<Size.X; ++x)
+    {
+        Block.BorderCenters[1][x] = bPassable[(States[x + (Size.Y-1)*Size.X] >> 8) & 0xFF];
+    }
+
+    // Anchor each region on the region voxel nearest to its centroid
+
+    TArray<float> AnchorDistances;
+    AnchorDistances.Init(BIG_NUMBER, Block.Nodes.Num());
+
+    for (int32 i=0; i<Block.Nodes.Num(); ++i)
+    {
+        Centroids[i] /= Block.Nodes[i].VoxelCount;
+    }
+
+    for (int32 i=0; i<VoxelCount; ++i)
+    {
+        const int32 Label = Block.Labels[i];
+
+        if (Label == INVALID_LABEL)
+        {
+            continue;
+        }
+
+        const FIntPoint Voxel(Block.VoxelRect.Min + FIntPoint(i % Size.X, i / Size.X));
+        const float DistSq = FVector2D::DistSquared(FVector2D(Voxel), Centroids[Label]);
+
+        if (DistSq < AnchorDistances[Label])
+        {
+            AnchorDistances[Label] = DistSq;
+            Block.Nodes[Label].Anchor = Voxel;
+        }
+    }
+}
+
+void FMarchingSquaresNavGraph::LinkBlocks(const FBlockGraph& BlockA, const FBlockGraph& BlockB, int32 Axis, TArray<FPortal>& OutPortals)
+{
+    using namespace MarchingSquaresNavGraphUtils;
+
+    OutPortals.Reset();
+
+    const FIntPoint SizeA(BlockA.VoxelRect.Size());
+    const FIntPoint SizeB(BlockB.VoxelRect.Size());
+
+    if (BlockA.Labels.Num() != SizeA.X*SizeA.Y || BlockB.Labels.Num() != SizeB.X*SizeB.Y)
+    {
+        return;
+    }
+
+    // Border voxel pairs, last column or row of block A against the first
+    // column or row of block B
+
+    const int32 PairCount = (Axis == 0) ? SizeA.Y : SizeA.X;
+    const float BorderLine = ((Axis == 0) ? BlockA.VoxelRect.Max.X : BlockA.VoxelRect.Max.Y) - .5f;
+    const int32 BorderOrigin = (Axis == 0) ? BlockA.VoxelRect.Min.Y : BlockA.VoxelRect.Min.X;
+
+    auto GetPairLabels = [&](int32 i, int32& OutLabelA, int32& OutLabelB)
+    {
+        if (Axis == 0)
+        {
+            OutLabelA = BlockA.Labels[(SizeA.X-1) + i*SizeA.X];
+            OutLabelB = BlockB.Labels[i*SizeB.X];
+        }
+        else
+        {
+            OutLabelA = BlockA.Labels[i + (SizeA.Y-1)*SizeA.X];
+            OutLabelB = BlockB.Labels[i];
+        }
+    };
+
+    auto AddPortal = [&](int32 LabelA, int32 LabelB, float First, float Last, int32 Width)
+    {
+        const FNode& NodeA(BlockA.Nodes[LabelA]);
+        const FNode& NodeB(BlockB.Nodes[LabelB]);
+
+        FPortal Portal;
+        Portal.NodeA = NodeA.Id;
+        Portal.NodeB = NodeB.Id;
+
+        if (Axis == 0)
+        {
+            Portal.Start = FVector2D(BorderLine, BorderOrigin + First);
+            Portal.End   = FVector2D(BorderLine, BorderOrigin + Last);
+        }
+        else
+        {
+            Portal.Start = FVector2D(BorderOrigin + First, BorderLine);
+            Portal.End   = FVector2D(BorderOrigin + Last,  BorderLine);
+        }
+
+        const FVector2D Center((Portal.Start + Portal.End) * .5f);
+
+        Portal.Width = Width;
+        Portal.Cost  = FVector2D::Distance(FVector2D(NodeA.Anchor), Center) + FVector2D::Distance(Center, FVector2D(NodeB.Anchor));
+
+        OutPortals.Emplace(Portal);
+    };
+
+    // Emit runs of passable pairs with the same region labels
+
+    int32 RunLabelA = INVALID_LABEL;
+    int32 RunLabelB = INVALID_LABEL;
+    int32 RunFirst = -1;
+
+    for (int32 i=0; i<=PairCount; ++i)
+    {
+        int32 LabelA = INVALID_LABEL;
+        int32 LabelB = INVALID_LABEL;
+
+        if (i < PairCount)
+        {
+            GetPairLabels(i, LabelA, LabelB);
+        }
+
+        const bool bOpen = LabelA != INVALID_LABEL && LabelB != INVALID_LABEL;
+
+        if (RunFirst >= 0 && (! bOpen || LabelA != RunLabelA || LabelB != RunLabelB))
+        {
+            AddPortal(RunLabelA, RunLabelB, RunFirst, i-1, i-RunFirst);
+            RunFirst = -1;
+        }
+
+        if (bOpen && RunFirst < 0)
+        {
+            RunLabelA = LabelA;
+            RunLabelB = LabelB;
+            RunFirst = i;
+        }
+    }
+
+    // Link diagonals of saddle cells straddling the border. The last
+    // border cell lies on the block corner, see LinkCorner().
+
+    const TBitArray<>& BorderCenters(BlockA.BorderCenters[Axis]);
+
+    if (BorderCenters.Num() != PairCount)
+    {
+        return;
+    }
+
+    for (int32 i=0; i<PairCount-1; ++i)
+    {
+        int32 LabelA0, LabelB0, LabelA1, LabelB1;
+        GetPairLabels(i,   LabelA0, LabelB0);
+        GetPairLabels(i+1, LabelA1, LabelB1);
+
+        // Cell corners in build case code order, block B corners are the
+        // next x corners on the x axis and the next y corners on the y axis
+
+        const int32 Labels[4] = {
+            LabelA0,
+            (Axis == 0) ? LabelB0 : LabelA1,
+            (Axis == 0) ? LabelA1 : LabelB0,
+            LabelB1
+            };
+
+        ConnectDiagonals(
+            Labels[0] != INVALID_LABEL,
+            Labels[1] != INVALID_LABEL,
+            Labels[2] != INVALID_LABEL,
+            Labels[3] != INVALID_LABEL,
+            BorderCenters[i],
+            [&](int32 CornerA, int32 CornerB)
+            {
+                // Corner zero is always on block A and corner three on
+                // block B, corner one is on block B on the x axis only
+
+                const bool bSwap = (CornerA == 1) && (Axis == 0);
+                AddPortal(
+                    Labels[bSwap ? CornerB : CornerA],
+                    Labels[bSwap ? CornerA : CornerB],
+                    i + .5f,
+                    i + .5f,
+                    1
+                    );
+            } );
+    }
+}
+
+void FMarchingSquaresNavGraph::LinkCorner(const FBlockGraph& BlockA, const FBlockGraph& BlockB, const FBlockGraph& BlockC, const FBlockGraph& BlockD, TArray<FPortal>& OutPortals)
+{
+    using namespace MarchingSquaresNavGraphUtils;
+
+    OutPortals.Reset();
+
+    const FBlockGraph* CornerBlocks[4] = { &BlockA, &BlockB, &BlockC, &BlockD };
+    int32 Labels[4];
+
+    for (int32 i=0; i<4; ++i)
+    {
+        const FBlockGraph& Block(*CornerBlocks[i]);
+        const FIntPoint Size(Block.VoxelRect.Size());
+
+        if (Block.Labels.Num() != Size.X*Size.Y)
+        {
+            return;
+        }
+
+        // Corner voxel of each block nearest to the shared block corner
+
+        const int32 x = (i & 1) ? 0 : Size.X-1;
+        const int32 y = (i & 2) ? 0 : Size.Y-1;
+
+        Labels[i] = Block.Labels[x + y*Size.X];
+    }
+
+    const TBitArray<>& BorderCenters(BlockA.BorderCenters[0]);
+
+    if (BorderCenters.Num() < 1)
+    {
+        return;
+    }
+
+    const FVector2D Center(FVector2D(BlockA.VoxelRect.Max) - FVector2D(.5f, .5f));
+
+    ConnectDiagonals(
+        Labels[0] != INVALID_LABEL,
+        Labels[1] != INVALID_LABEL,
+        Labels[2] != INVALID_LABEL,
+        Labels[3] != INVALID_LABEL,
+        BorderCenters[BorderCenters.Num()-1],
+        [&](int32 CornerA, int32 CornerB)
+        {
+            const FNode& NodeA(CornerBlocks[CornerA]->Nodes[Labels[CornerA]]);
+            const FNode& NodeB(CornerBlocks[CornerB]->Nodes[Labels[CornerB]]);
+
+            FPortal Portal;
+            Portal.NodeA = NodeA.Id;
+            Portal.NodeB = NodeB.Id;
+            Portal.Start = Center;
+            Portal.End   = Center;
+            Portal.Width = 1;
+            Portal.Cost  = FVector2D::Distance(FVector2D(NodeA.Anchor), Center) + FVector2D::Distance(Center, FVector2D(NodeB.Anchor));
+
+            OutPortals.Emplace(Portal);
+        } );
+}
+
+void FMarchingSquaresNavGraph::Build(const FMarchingSquaresVoxelMirror& Mirror)
+{
+    TArray<uint32> BlockRevisions;
+    FIntPoint MirrorBlockCount;
+
+    const uint32 Revision = Mirror.GetBlockRevisions(BlockRevisions, MirrorBlockCount);
+    const FIntPoint MirrorDimension(Mirror.GetDimension());
+
+    FGraphParameter BuildParameter;
+    bool bReset;
+    uint32 PrevRevision;
+
+    {
+        FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+
+        BuildParameter = Parameter;
+        PrevRevision = MirrorRevision;
+
+        bReset  = (BuildParameter != GraphParameter) || (MirrorDimension != Dimension) || (MirrorBlockCount != BlockCount);
+        bReset |= (Revision < PrevRevision) || (Blocks.Num() != BlockRevisions.Num());
+    }
+
+    bool bPassable[256] = { false };
+
+    for (uint8 FillType : BuildParameter.PassableFillTypes)
+    {
+        bPassable[FillType] = true;
+    }
+
+    // Relabel blocks written since the previous update
+
+    TArray<FBlockGraph> DirtyBlocks;
+
+    for (int32 by=0; by<MirrorBlockCount.Y; ++by)
+    for (int32 bx=0; bx<MirrorBlockCount.X; ++bx)
+    {
+        if (bReset || BlockRevisions[bx + by*MirrorBlockCount.X] > PrevRevision)
+        {
+            const FIntPoint VoxelMin(bx*BLOCK_SIZE, by*BLOCK_SIZE);
+            const FIntPoint VoxelMax((VoxelMin + FIntPoint(BLOCK_SIZE, BLOCK_SIZE)).ComponentMin(MirrorDimension));
+
+            FBlockGraph& Block(DirtyBlocks[DirtyBlocks.AddDefaulted()]);
+            Block.Block = FIntPoint(bx, by);
+            Block.VoxelRect = FIntRect(VoxelMin, VoxelMax);
+        }
+    }
+
+    ParallelFor(DirtyBlocks.Num(), [&](int32 i)
+    {
+        FBlockGraph& Block(DirtyBlocks[i]);
+        TArray<uint32> States;
+
+        if (Mirror.CopyVoxelStates(Block.VoxelRect, States))
+        {
+            LabelBlock(States, bPassable, Block);
+        }
+    } );
+
+    FRWScopeLock ScopeLock(GraphLock, SLT_Write);
+
+    if (bReset)
+    {
+        Blocks.Reset();
+        Blocks.SetNum(BlockRevisions.Num());
+        GraphParameter = BuildParameter;
+        Dimension = MirrorDimension;
+        BlockCount = MirrorBlockCount;
+    }
+
+    // Relink portals on both sides of relabeled blocks, portals are owned
+    // by the lower block of each border
+
+    TBitArray<> LinkBorders[3] = {
+        TBitArray<>(false, Blocks.Num()),
+        TBitArray<>(false, Blocks.Num()),
+        TBitArray<>(false, Blocks.Num())
+        };
+
+    ChangedBlocks.Reset();
+
+    for (FBlockGraph& DirtyBlock : DirtyBlocks)
+    {
+        const FIntPoint& Block(DirtyBlock.Block);
+        const int32 BlockIndex = Block.X + Block.Y*BlockCount.X;
+
+        Blocks[BlockIndex] = MoveTemp(DirtyBlock);
+        ChangedBlocks.Emplace(Block);
+
+        LinkBorders[0][BlockIndex] = true;
+        LinkBorders[1][BlockIndex] = true;
+        LinkBorders[2][BlockIndex] = true;
+
+        if (Block.X > 0)
+        {
+            LinkBorders[0][BlockIndex-1] = true;
+            LinkBorders[2][BlockIndex-1] = true;
+        }
+
+        if (Block.Y > 0)
+        {
+            LinkBorders[1][BlockIndex-BlockCount.X] = true;
+            LinkBorders[2][BlockIndex-BlockCount.X] = true;
+        }
+
+        if (Block.X > 0 && Block.Y > 0)
+        {
+            LinkBorders[2][BlockIndex-BlockCount.X-1] = true;
+        }
+    }
+
+    for (int32 Axis=0; Axis<2; ++Axis)
+    {
+        for (TConstSetBitIterator<> It(LinkBorders[Axis]); It; ++It)
+        {
+            const int32 BlockIndex = It.GetIndex();
+            FBlockGraph& Block(Blocks[BlockIndex]);
+
+            const FIntPoint NextBlock(Block.Block + ((Axis == 0) ? FIntPoint(1,0) : FIntPoint(0,1)));
+
+            if (NextBlock.X < BlockCount.X && NextBlock.Y < BlockCount.Y)
+            {
+                LinkBlocks(Block, Blocks[NextBlock.X + NextBlock.Y*BlockCount.X], Axis, Block.Portals[Axis]);
+            }
+            else
+            {
+                Block.Portals[Axis].Reset();
+            }
+        }
+    }
+
+    // Relink diagonals of block corner cells
+
+    for (TConstSetBitIterator<> It(LinkBorders[2]); It; ++It)
+    {
+        const int32 BlockIndex = It.GetIndex();
+        FBlockGraph& Block(Blocks[BlockIndex]);
+
+        if ((Block.Block.X+1) < BlockCount.X && (Block.Block.Y+1) < BlockCount.Y)
+        {
+            LinkCorner(
+                Block,
+                Blocks[BlockIndex+1],
+                Blocks[BlockIndex+BlockCount.X],
+                Blocks[BlockIndex+BlockCount.X+1],
+                Block.Portals[2]
+                );
+        }
+        else
+        {
+            Block.Portals[2].Reset();
+        }
+    }
+
+    MirrorRevision = Revision;
+}
+
+void FMarchingSquaresNavGraph::Update(const FMarchingSquaresVoxelMirror& Mirror, const FGraphParameter& InParameter)
+{
+    {
+        FRWScopeLock ScopeLock(GraphLock, SLT_Write);
+        Parameter = InParameter;
+    }
+
+    Build(Mirror);
+}
+
+bool FMarchingSquaresNavGraph::UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, const FGraphParameter& InParameter, TFunction<void()> OnComplete)
+{
+    {
+        FRWScopeLock ScopeLock(GraphLock, SLT_Write);
+        Parameter = InParameter;
+    }
+
+    // Request an update, an in-flight update picks up the request on
+    // completion
+
+    bUpdateRequested = true;
+
+    if (bUpdating.AtomicSet(true))
+    {
+        return false;
+    }
+
+    const FMarchingSquaresVoxelMirror* MirrorPtr(&Mirror);
+
+    UpdateTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this, MirrorPtr, OnComplete]()
+        {
+            do
+            {
+                bUpdateRequested = false;
+                Build(*MirrorPtr);
+                bUpdating = false;
+
+                if (OnComplete)
+                {
+                    OnComplete();
+                }
+            }
+            while (bUpdateRequested && ! bUpdating.AtomicSet(true));
+        },
+        TStatId(),
+        nullptr,
+        ENamedThreads::AnyBackgroundThreadNormalTask
+        );
+
+    return true;
+}
+
+void FMarchingSquaresNavGraph::Reset()
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_Write);
+
+    GraphParameter = FGraphParameter();
+    Dimension = FIntPoint::ZeroValue;
+    BlockCount = FIntPoint::ZeroValue;
+    MirrorRevision = 0;
+
+    Blocks.Empty();
+    ChangedBlocks.Empty();
+}
+
+// QUERY FUNCTIONS
+
+const FMarchingSquaresNavGraph::FBlockGraph* FMarchingSquaresNavGraph::FindBlockUnlocked(const FIntPoint& Block) const
+{
+    if (Block.X < 0 || Block.Y < 0 || Block.X >= BlockCount.X || Block.Y >= BlockCount.Y || Blocks.Num() != BlockCount.X*BlockCount.Y)
+    {
+        return nullptr;
+    }
+
+    return &Blocks[Block.X + Block.Y*BlockCount.X];
+}
+
+void FMarchingSquaresNavGraph::GetBlockPortalsUnlocked(const FIntPoint& Block, TArray<FPortal>& OutPortals) const
+{
+    OutPortals.Reset();
+
+    if (const FBlockGraph* BlockGraph = FindBlockUnlocked(Block))
+    {
+        OutPortals.Append(BlockGraph->Portals[0]);
+        OutPortals.Append(BlockGraph->Portals[1]);
+        OutPortals.Append(BlockGraph->Portals[2]);
+    }
+
+    if (const FBlockGraph* PrevBlockX = FindBlockUnlocked(Block - FIntPoint(1,0)))
+    {
+        OutPortals.Append(PrevBlockX->Portals[0]);
+        OutPortals.Append(PrevBlockX->Portals[2]);
+    }
+
+    if (const FBlockGraph* PrevBlockY = FindBlockUnlocked(Block - FIntPoint(0,1)))
+    {
+        OutPortals.Append(PrevBlockY->Portals[1]);
+        OutPortals.Append(PrevBlockY->Portals[2]);
+    }
+
+    if (const FBlockGraph* PrevBlockXY = FindBlockUnlocked(Block - FIntPoint(1,1)))
+    {
+        OutPortals.Append(PrevBlockXY->Portals[2]);
+    }
+
+    // Corner cells link blocks diagonally, remove corner links between
+    // the other blocks sharing the corner
+
+    OutPortals.RemoveAllSwap([&Block](const FPortal& Portal)
+    {
+        return Portal.NodeA.Block != Block && Portal.NodeB.Block != Block;
+    } );
+}
+
+uint32 FMarchingSquaresNavGraph::GetMirrorRevision() const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+    return MirrorRevision;
+}
+
+FIntPoint FMarchingSquaresNavGraph::GetBlockCount() const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+    return BlockCount;
+}
+
+TArray<FIntPoint> FMarchingSquaresNavGraph::GetChangedBlocks() const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+    return ChangedBlocks;
+}
+
+bool FMarchingSquaresNavGraph::GetBlockNodes(const FIntPoint& Block, TArray<FNode>& OutNodes) const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+
+    if (const FBlockGraph* BlockGraph = FindBlockUnlocked(Block))
+    {
+        OutNodes = BlockGraph->Nodes;
+        return true;
+    }
+
+    OutNodes.Reset();
+    return false;
+}
+
+bool FMarchingSquaresNavGraph::GetBlockPortals(const FIntPoint& Block, TArray<FPortal>& OutPortals) const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+
+    GetBlockPortalsUnlocked(Block, OutPortals);
+    return FindBlockUnlocked(Block) != nullptr;
+}
+
+bool FMarchingSquaresNavGraph::GetNode(const FNodeId& NodeId, FNode& OutNode) const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+
+    const FBlockGraph* BlockGraph = FindBlockUnlocked(NodeId.Block);
+
+    if (BlockGraph && BlockGraph->Nodes.IsValidIndex(NodeId.Region))
+    {
+        OutNode = BlockGraph->Nodes[NodeId.Region];
+        return true;
+    }
+
+    return false;
+}
+
+void FMarchingSquaresNavGraph::GetNodePortals(const FNodeId& NodeId, TArray<FPortal>& OutPortals) const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+
+    GetBlockPortalsUnlocked(NodeId.Block, OutPortals);
+
+    OutPortals.RemoveAllSwap([&NodeId](const FPortal& Portal)
+    {
+        return ! (Portal.NodeA == NodeId) && ! (Portal.NodeB == NodeId);
+    } );
+}
+
+FMarchingSquaresNavGraph::FNodeId FMarchingSquaresNavGraph::GetNodeAt(const FIntPoint& Voxel) const
+{
+    FRWScopeLock ScopeLock(GraphLock, SLT_ReadOnly);
+
+    FNodeId NodeId;
+
+    if (Voxel.X < 0 || Voxel.Y < 0 || Voxel.X >= Dimension.X || Voxel.Y >= Dimension.Y)
+    {
+        return NodeId;
+    }
+
+    const FIntPoint Block(Voxel.X / BLOCK_SIZE, Voxel.Y / BLOCK_SIZE);
+    const FBlockGraph* BlockGraph = FindBlockUnlocked(Block);
+
+    if (! BlockGraph || BlockGraph->Labels.Num() != BlockGraph->VoxelRect.Area())
+    {
+        return NodeId;
+    }
+
+    const FIntPoint Local(Voxel - BlockGraph->VoxelRect.Min);
+    const uint16 Label = BlockGraph->Labels[Local.X + Local.Y*BlockGraph->VoxelRect.Width()];
+
+    if (Label != INVALID_LABEL)
+    {
+        NodeId.Block = Block;
+        NodeId.Region = Label;
+    }
+
+    return NodeId;
+}
@@ -28,6 +28,7 @@
 #include "MarchingSquaresPlugin.h"
 #include "Interfaces/IPluginManager.h"
 #include "Misc/Paths.h"
+#include "MarchingSquaresStencilTexturePool.h"
 
 #define LOCTEXT_NAMESPACE "IMarchingSquaresPlugin"
 
@@ -50,6 +51,8 @@ public:
         // This function may be called during shutdown to clean up your module.
         // For modules that support dynamic reloading,
         // we call this function before unloading the module.
+
+        FMarchingSquaresStencilTexturePool::Get().ReleaseResources();
     }
 };
 
@@ -0,0 +1,588 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresSectionBVH.h"
+
+#include "Async/ParallelFor.h"
+
+namespace MarchingSquaresSectionBVHUtils
+{
+    struct FBuildTriangle
+    {
+        int32   IndexOffset;
+        FVector Centroid;
+    };
+
+    struct FBuildTask
+    {
+        int32 Parent;
+        int32 Begin;
+        int32 Num;
+        bool  bSecondChild;
+    };
+
+    // Ray box slab test, returns entry distance clamped to zero
+    FORCEINLINE bool IntersectBox(
+        const FVector& Min,
+        const FVector& Max,
+        const FVector& Origin,
+        const FVector& InvDirection,
+        float MaxDistance,
+        float& OutEnter
+        )
+    {
+        const FVector T0((Min - Origin) * InvDirection);
+        const FVector T1((Max - Origin) * InvDirection);
+
+        const float Enter = FMath::Max(T0.ComponentMin(T1).GetMax(), 0.f);
+        const float Exit  = FMath::Min(T0.ComponentMax(T1).GetMin(), MaxDistance);
+
+        OutEnter = Enter;
+
+        return Enter <= Exit;
+    }
+
+    // Two-sided ray triangle intersection (Moller-Trumbore)
+    FORCEINLINE bool IntersectTriangle(
+        const FVector& Origin,
+        const FVector& Direction,
+        const FVector& V0,
+        const FVector& V1,
+        const FVector& V2,
+        float MaxDistance,
+        float& OutDistance
+        )
+    {
+        const FVector E1(V1 - V0);
+        const FVector E2(V2 - V0);
+        const FVector P(Direction ^ E2);
+        const float Det = E1 | P;
+
+        if (FMath::Abs(Det) < SMALL_NUMBER)
+        {
+            return false;
+        }
+
+        const float InvDet = 1.f / Det;
+        const FVector S(Origin - V0);
+        const float U = (S | P) * InvDet;
+
+        if (U < 0.f || U > 1.f)
+        {
+            return false;
+        }
+
+        const FVector Q(S ^ E1);
+        const float V = (Direction | Q) * InvDet;
+
+        if (V < 0.f || (U+V) > 1.f)
+        {
+            return false;
+        }
+
+        const float T = (E2 | Q) * InvDet;
+
+        if (T < 0.f || T > MaxDistance)
+        {
+            return false;
+        }
+
+        OutDistance = T;
+
+        return true;
+    }
+}
+
+void FMarchingSquaresSectionBVH::BuildTree(const FPMUMeshSection& Section, FSectionTree& OutTree)
+{
+    using namespace MarchingSquaresSectionBVHUtils;
+
+    OutTree.Nodes.Reset();
+    OutTree.Vertices.Reset();
+
+    const TArray<FVector>& Positions(Section.Positions);
+    const TArray<uint32>& Indices(Section.Indices);
+    const uint32 PositionCount = Positions.Num();
+
+    // Gather valid non-degenerate triangles
+
+    TArray<FBuildTriangle> Triangles;
+    Triangles.Reserve(Indices.Num() / 3);
+
+    for (int32 i=0; (i+2)<Indices.Num(); i+=3)
+    {
+        const uint32 i0 = Indices[i  ];
+        const uint32 i1 = Indices[i+1];
+        const uint32 i2 = Indices[i+2];
+
+        if (i0 >= PositionCount || i1 >= PositionCount || i2 >= PositionCount)
+        {
+            continue;
+        }
+
+        const FVector& V0(Positions[i0]);
+        const FVector& V1(Positions[i1]);
+        const FVector& V2(Positions[i2]);
+
+        if (((V1-V0) ^ (V2-V0)).SizeSquared() < SMALL_NUMBER)
+        {
+            continue;
+        }
+
+        FBuildTriangle& Triangle(Triangles[Triangles.AddUninitialized()]);
+        Triangle.IndexOffset = i;
+        Triangle.Centroid = (V0 + V1 + V2) / 3.f;
+    }
+
+    if (Triangles.Num() < 1)
+    {
+        return;
+    }
+
+    // Build nodes depth first, the first child of an interior node is
+    // built immediately after the node. Interior nodes split triangles at
+    // the centroid median of the longest centroid bounds axis.
+
+    OutTree.Nodes.Reserve((Triangles.Num() / MAX_LEAF_TRIANGLE_COUNT) * 2 + 1);
+
+    TArray<FBuildTask> Tasks;
+    Tasks.Emplace(FBuildTask { INDEX_NONE, 0, Triangles.Num(), false });
+
+    while (Tasks.Num() > 0)
+    {
+        const FBuildTask Task(Tasks.Pop(false));
+        const int32 NodeIndex = OutTree.Nodes.AddUninitialized();
+
+        if (Task.bSecondChild)
+        {
+            OutTree.Nodes[Task.Parent].Offset = NodeIndex;
+        }
+
+        FBox Bounds(ForceInit);
+        FBox CentroidBounds(ForceInit);
+
+        for (int32 i=Task.Begin; i<(Task.Begin+Task.Num); ++i)
+        {
+            const FBuildTriangle& Triangle(Triangles[i]);
+
+            Bounds += Positions[Indices[Triangle.IndexOffset  ]];
+            Bounds += Positions[Indices[Triangle.IndexOffset+1]];
+            Bounds += Positions[Indices[Triangle.IndexOffset+2]];
+            CentroidBounds += Triangle.Centroid;
+        }
+
+        const FVector CentroidExtent(CentroidBounds.GetSize());
+        const float MaxExtent = CentroidExtent.GetMax();
+
+        FNode& Node(OutTree.Nodes[NodeIndex]);
+        Node.Min = Bounds.Min;
+        Node.Max = Bounds.Max;
+
+        // Leaf node
+
+        if (Task.Num <= MAX_LEAF_TRIANGLE_COUNT || MaxExtent < KINDA_SMALL_NUMBER)
+        {
+            Node.Offset = Task.Begin;
+            Node.TriangleCount = Task.Num;
+            continue;
+        }
+
+        // Interior node, offset is assigned when the second child is built
+
+        Node.Offset = INDEX_NONE;
+        Node.TriangleCount = 0;
+
+        const int32 Axis = (CentroidExtent.X == MaxExtent) ? 0 : ((CentroidExtent.Y == MaxExtent) ? 1 : 2);
+
+        Sort(
+            Triangles.GetData() + Task.Begin,
+            Task.Num,
+            [Axis](const FBuildTriangle& A, const FBuildTriangle& B)
+            {
+                return A.Centroid[Axis] < B.Centroid[Axis];
+            } );
+
+        const int32 HalfNum = Task.Num / 2;
+
+        Tasks.Emplace(FBuildTask { NodeIndex, Task.Begin+HalfNum, Task.Num-HalfNum, true });
+        Tasks.Emplace(FBuildTask { NodeIndex, Task.Begin, HalfNum, false });
+    }
+
+    // Copy triangle vertices in leaf order
+
+    OutTree.Vertices.SetNumUninitialized(Triangles.Num() * 3);
+
+    for (int32 i=0; i<Triangles.Num(); ++i)
+    {
+        const int32 IndexOffset = Triangles[i].IndexOffset;
+
+        OutTree.Vertices[i*3  ] = Positions[Indices[IndexOffset  ]];
+        OutTree.Vertices[i*3+1] = Positions[Indices[IndexOffset+1]];
+        OutTree.Vertices[i*3+2] = Positions[Indices[IndexOffset+2]];
+    }
+
+    // Cull bounds, section local box may not contain the geometry if the
+    // section bounds z is overridden
+
+    const FNode& Root(OutTree.Nodes[0]);
+
+    OutTree.Bounds  = FBox(Section.SectionLocalBox.Min, Section.SectionLocalBox.Max);
+    OutTree.Bounds += FBox(Root.Min, Root.Max);
+}
+
+bool FMarchingSquaresSectionBVH::TraceTree(
+    const FSectionTree& Tree,
+    const FVector& Origin,
+    const FVector& Direction,
+    const FVector& InvDirection,
+    float MaxDistance,
+    bool bAnyHit,
+    float& OutDistance,
+    FVector& OutNormal
+    )
+{
+    using namespace MarchingSquaresSectionBVHUtils;
+
+    const TArray<FNode>& Nodes(Tree.Nodes);
+    const TArray<FVector>& Vertices(Tree.Vertices);
+
+    float BestDistance = MaxDistance;
+    int32 HitTriangle = INDEX_NONE;
+    float Enter;
+
+    if (! IntersectBox(Nodes[0].Min, Nodes[0].Max, Origin, InvDirection, BestDistance, Enter))
+    {
+        return false;
+    }
+
+    int32 Stack[MAX_TRAVERSAL_DEPTH];
+    int32 StackSize = 0;
+
+    Stack[StackSize++] = 0;
+
+    while (StackSize > 0)
+    {
+        const int32 NodeIndex = Stack[--StackSize];
+        const FNode& Node(Nodes[NodeIndex]);
+
+        // Leaf node, test triangles
+
+        if (Node.TriangleCount > 0)
+        {
+            for (int32 t=Node.Offset; t<(Node.Offset+Node.TriangleCount); ++t)
+            {
+                float Distance;
+
+                if (IntersectTriangle(Origin, Direction, Vertices[t*3], Vertices[t*3+1], Vertices[t*3+2], BestDistance, Distance))
+                {
+                    BestDistance = Distance;
+                    HitTriangle = t;
+
+                    if (bAnyHit)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            if (bAnyHit && HitTriangle != INDEX_NONE)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        // Interior node, visit the nearer child first
+
+        const int32 ChildA = NodeIndex+1;
+        const int32 ChildB = Node.Offset;
+
+        float EnterA;
+        float EnterB;
+
+        const bool bHitA = IntersectBox(Nodes[ChildA].Min, Nodes[ChildA].Max, Origin, InvDirection, BestDistance, EnterA);
+        const bool bHitB = IntersectBox(Nodes[ChildB].Min, Nodes[ChildB].Max, Origin, InvDirection, BestDistance, EnterB);
+
+        check((StackSize+2) <= MAX_TRAVERSAL_DEPTH);
+
+        if (bHitA && bHitB)
+        {
+            const bool bNearA = EnterA <= EnterB;
+            Stack[StackSize++] = bNearA ? ChildB : ChildA;
+            Stack[StackSize++] = bNearA ? ChildA : ChildB;
+        }
+        else
+        if (bHitA)
+        {
+            Stack[StackSize++] = ChildA;
+        }
+        else
+        if (bHitB)
+        {
+            Stack[StackSize++] = ChildB;
+        }
+    }
+
+    if (HitTriangle == INDEX_NONE)
+    {
+        return false;
+    }
+
+    const FVector& V0(Vertices[HitTriangle*3  ]);
+    const FVector& V1(Vertices[HitTriangle*3+1]);
+    const FVector& V2(Vertices[HitTriangle*3+2]);
+
+    OutDistance = BestDistance;
+    OutNormal = ((V1-V0) ^ (V2-V0)).GetSafeNormal();
+
+    if ((OutNormal | Direction) > 0.f)
+    {
+        OutNormal = -OutNormal;
+    }
+
+    return true;
+}
+
+void FMarchingSquaresSectionBVH::UpdateSections(int32 FillType, const TArray<FPMUMeshSection>& Sections, const TArray<int32>& SectionIndices)
+{
+    if (FillType < 0)
+    {
+        return;
+    }
+
+    bool bRebuildAll;
+
+    {
+        FRWScopeLock ScopeLock(TreeLock, SLT_ReadOnly);
+        bRebuildAll = ! TreeGroups.IsValidIndex(FillType) || TreeGroups[FillType].Num() != Sections.Num();
+    }
+
+    TArray<int32> BuildIndices;
+
+    if (bRebuildAll)
+    {
+        BuildIndices.SetNumUninitialized(Sections.Num());
+
+        for (int32 i=0; i<Sections.Num(); ++i)
+        {
+            BuildIndices[i] = i;
+        }
+    }
+    else
+    {
+        BuildIndices.Reserve(SectionIndices.Num());
+
+        for (int32 SectionIndex : SectionIndices)
+        {
+            if (Sections.IsValidIndex(SectionIndex))
+            {
+                BuildIndices.AddUnique(SectionIndex);
+            }
+        }
+    }
+
+    // Build section trees outside of the tree lock
+
+    TArray<FSectionTree> BuiltTrees;
+    BuiltTrees.SetNum(BuildIndices.Num());
+
+    ParallelFor(BuildIndices.Num(), [&](int32 i)
+    {
+        BuildTree(Sections[BuildIndices[i]], BuiltTrees[i]);
+    } );
+
+    FRWScopeLock ScopeLock(TreeLock, SLT_Write);
+
+    if (! TreeGroups.IsValidIndex(FillType))
+    {
+        TreeGroups.SetNum(FillType+1);
+    }
+
+    TArray<FSectionTree>& Trees(TreeGroups[FillType]);
+
+    // Group may have been cleared since the section count check
+
+    if (bRebuildAll || Trees.Num() != Sections.Num())
+    {
+        Trees.Reset(Sections.Num());
+        Trees.SetNum(Sections.Num());
+    }
+
+    for (int32 i=0; i<BuildIndices.Num(); ++i)
+    {
+        Trees[BuildIndices[i]] = MoveTemp(BuiltTrees[i]);
+    }
+}
+
+void FMarchingSquaresSectionBVH::ClearGroup(int32 FillType)
+{
+    FRWScopeLock ScopeLock(TreeLock, SLT_Write);
+
+    if (TreeGroups.IsValidIndex(FillType))
+    {
+        TreeGroups[FillType].Empty();
+    }
+}
+
+void FMarchingSquaresSectionBVH::Clear()
+{
+    FRWScopeLock ScopeLock(TreeLock, SLT_Write);
+    TreeGroups.Empty();
+}
+
+// QUERY FUNCTIONS
+
+bool FMarchingSquaresSectionBVH::Trace(const FVector& Origin, const FVector& Direction, float MaxDistance, int32 FillType, bool bAnyHit, FTraceResult& OutResult) const
+{
+    using namespace MarchingSquaresSectionBVHUtils;
+
+    struct FCandidate
+    {
+        float Enter;
+        int32 FillType;
+        int32 SectionIndex;
+    };
+
+    const FVector InvDirection(
+        FMath::Abs(Direction.X) > SMALL_NUMBER ? 1.f/Direction.X : BIG_NUMBER,
+        FMath::Abs(Direction.Y) > SMALL_NUMBER ? 1.f/Direction.Y : BIG_NUMBER,
+        FMath::Abs(Direction.Z) > SMALL_NUMBER ? 1.f/Direction.Z : BIG_NUMBER
+        );
+
+    FRWScopeLock ScopeLock(TreeLock, SLT_ReadOnly);
+
+    // Cull sections by section bounds and sort by entry distance
+
+    const int32 GroupBegin = (FillType < 0) ? 0 : FillType;
+    const int32 GroupEnd   = (FillType < 0) ? TreeGroups.Num() : FMath::Min(FillType+1, TreeGroups.Num());
+
+    TArray<FCandidate, TInlineAllocator<16>> Candidates;
+
+    for (int32 g=GroupBegin; g<GroupEnd; ++g)
+    {
+        const TArray<FSectionTree>& Trees(TreeGroups[g]);
+
+        for (int32 s=0; s<Trees.Num(); ++s)
+        {
+            const FSectionTree& Tree(Trees[s]);
+            float Enter;
+
+            if (Tree.IsValid() && IntersectBox(Tree.Bounds.Min, Tree.Bounds.Max, Origin, InvDirection, MaxDistance, Enter))
+            {
+                Candidates.Emplace(FCandidate { Enter, g, s });
+            }
+        }
+    }
+
+    Candidates.Sort([](const FCandidate& A, const FCandidate& B)
+    {
+        return A.Enter < B.Enter;
+    } );
+
+    // Traverse candidate sections until the nearest hit is closer than the
+    // next section entry
+
+    float BestDistance = MaxDistance;
+    bool bHit = false;
+
+    for (const FCandidate& Candidate : Candidates)
+    {
+        if (Candidate.Enter > BestDistance)
+        {
+            break;
+        }
+
+        const FSectionTree& Tree(TreeGroups[Candidate.FillType][Candidate.SectionIndex]);
+
+        float Distance;
+        FVector Normal;
+
+        if (TraceTree(Tree, Origin, Direction, InvDirection, BestDistance, bAnyHit, Distance, Normal))
+        {
+            BestDistance = Distance;
+            bHit = true;
+
+            OutResult.Distance = Distance;
+            OutResult.Normal = Normal;
+            OutResult.FillType = Candidate.FillType;
+            OutResult.SectionIndex = Candidate.SectionIndex;
+
+            if (bAnyHit)
+            {
+                break;
+            }
+        }
+    }
+
+    if (bHit)
+    {
+        OutResult.Location = Origin + Direction * OutResult.Distance;
+    }
+
+    return bHit;
+}
+
+bool FMarchingSquaresSectionBVH::Raycast(const FVector& Origin, const FVector& Direction, float MaxDistance, int32 FillType, FTraceResult& OutResult) const
+{
+    const FVector UnitDirection(Direction.GetSafeNormal());
+
+    if (UnitDirection.IsZero() || MaxDistance <= 0.f)
+    {
+        return false;
+    }
+
+    return Trace(Origin, UnitDirection, MaxDistance, FillType, false, OutResult);
+}
+
+bool FMarchingSquaresSectionBVH::SegmentTrace(const FVector& Start, const FVector& End, int32 FillType, FTraceResult& OutResult) const
+{
+    const FVector Delta(End - Start);
+    const float Length = Delta.Size();
+
+    if (Length < KINDA_SMALL_NUMBER)
+    {
+        return false;
+    }
+
+    return Trace(Start, Delta / Length, Length, FillType, false, OutResult);
+}
+
+bool FMarchingSquaresSectionBVH::IsSegmentBlocked(const FVector& Start, const FVector& End, int32 FillType) const
+{
+    const FVector Delta(End - Start);
+    const float Length = Delta.Size();
+
+    if (Length < KINDA_SMALL_NUMBER)
+    {
+        return false;
+    }
+
+    FTraceResult Result;
+
+    return Trace(Start, Delta / Length, Length, FillType, true, Result);
+}
@@ -27,122 +27,233 @@
 
 #include "MarchingSquaresStencilPoly.h"
 
-#include "PipelineStateCache.h"
-#include "RHIStaticStates.h"
 #include "ShaderParameters.h"
 #include "ShaderCore.h"
 #include "ShaderParameterUtils.h"
 #include "UniformBuffer.h"
 
 #include "MarchingSquaresPlugin.h"
-#include "RHI/RULRHIUtilityLibrary.h"
+#include "MarchingSquaresMap.h"
+#include "MarchingSquaresMapRef.h"
+#include "MarchingSquaresGeometryUtils.h"
 #include "Shaders/RULShaderDefinitions.h"
 
 #include "EarcutTypes.h"
 
-// VERTEX SHADER DEFINITIONS
+// COMPUTE SHADER DEFINITIONS
 
-class FMSQStencilPolyDrawMaskVS : public FRULBaseVertexShader
+class FMSQStencilPolyRasterizeCS : public FRULBaseComputeShader<16,16,1>
 {
-    typedef FRULBaseVertexShader FBaseType;
-
-    DECLARE_SHADER_TYPE(FMSQStencilPolyDrawMaskVS, Global);
-
-public:
-
-    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
-    {
-        return true;
-    }
-
-    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
-    {
-        FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-        OutEnvironment.SetRenderTargetOutputFormat(0, PF_R16_UINT);
-    }
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(FMSQStencilPolyDrawMaskVS)
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilPolyRasterizeCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
 
-    RUL_DECLARE_SHADER_PARAMETERS_0(SRV,,)
-    RUL_DECLARE_SHADER_PARAMETERS_0(UAV,,)
+    RUL_DECLARE_SHADER_PARAMETERS_4(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "DrawVertexData",      DrawVertexData,
+        "DrawIndexData",       DrawIndexData,
+        "TileBinOffsetData", TileBinOffsetData,
+        "TileBinItemData",   TileBinItemData
+        )
 
     RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutStencilTexture", OutStencilTexture
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_7(
         Value,
         FShaderParameter,
         FParameterId,
-        "_DrawExts", Params_DrawSize
+        "_DispatchOffset",    Params_DispatchOffset,
+        "_DispatchDim",       Params_DispatchDim,
+        "_StencilOffset",     Params_StencilOffset,
+        "_LineTransform",     Params_LineTransform,
+        "_LineTranslation",   Params_LineTranslation,
+        "_TileCountX",        Params_TileCountX,
+        "_DrawOffset",        Params_DrawOffset
         )
 };
 
-class FMSQStencilPolyDrawEdgeVS : public FRULBaseVertexShader
+class FMSQStencilPolyWriteVoxelStateCS : public FRULBaseComputeShader<16,16,1>
 {
-    typedef FRULBaseVertexShader FBaseType;
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilPolyWriteVoxelStateCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
 
-    DECLARE_SHADER_TYPE(FMSQStencilPolyDrawEdgeVS, Global);
+    RUL_DECLARE_SHADER_PARAMETERS_3(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "StencilTexture", StencilTexture,
+        "LineGeomData",   LineGeomData,
+        "LineStateData",  LineStateData
+        )
 
-public:
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelStateData", OutVoxelStateData,
+        "OutDebugTexture",   OutDebugTexture
+        )
 
-    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
-    {
-        return true;
-    }
+    RUL_DECLARE_SHADER_PARAMETERS_11(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",          Params_MapDimension,
+        "_DispatchOffset",  Params_DispatchOffset,
+        "_DispatchDim",     Params_DispatchDim,
+        "_StencilRect",     Params_StencilRect,
+        "_StencilOffset",   Params_StencilOffset,
+        "_StencilOp",       Params_StencilOp,
+        "_FillType",        Params_FillType,
+        "_OpFillType",      Params_OpFillType,
+        "_LineTransform",   Params_LineTransform,
+        "_LineTranslation", Params_LineTranslation,
+        "_LineOffset",      Params_LineOffset
+        )
+};
 
-    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
-    {
-        FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-        OutEnvironment.SetRenderTargetOutputFormat(0, PF_R16_UINT);
-    }
+class FMSQStencilPolyWriteVoxelFeatureCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilPolyWriteVoxelFeatureCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(FMSQStencilPolyDrawEdgeVS)
+    RUL_DECLARE_SHADER_PARAMETERS_3(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "VoxelStateData", VoxelStateData,
+        "LineGeomData",   LineGeomData,
+        "LineStateData",  LineStateData
+        )
 
-    RUL_DECLARE_SHADER_PARAMETERS_0(SRV,,)
-    RUL_DECLARE_SHADER_PARAMETERS_0(UAV,,)
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelFeatureData", OutVoxelFeatureData,
+        "OutDebugTexture",     OutDebugTexture
+        )
 
-    RUL_DECLARE_SHADER_PARAMETERS_1(
+    RUL_DECLARE_SHADER_PARAMETERS_9(
         Value,
         FShaderParameter,
         FParameterId,
-        "_DrawExts", Params_DrawSize
+        "_MapDim",          Params_MapDimension,
+        "_DispatchOffset",  Params_DispatchOffset,
+        "_DispatchDim",     Params_DispatchDim,
+        "_StencilOp",       Params_StencilOp,
+        "_FillType",        Params_FillType,
+        "_OpFillType",      Params_OpFillType,
+        "_LineTransform",   Params_LineTransform,
+        "_LineTranslation", Params_LineTranslation,
+        "_LineOffset",      Params_LineOffset
         )
 };
 
-IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyDrawMaskVS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyVSPS.usf"), TEXT("DrawStencilMaskVS"), SF_Vertex);
-
-IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyDrawEdgeVS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyVSPS.usf"), TEXT("DrawStencilEdgeVS"), SF_Vertex);
+class FMSQStencilPolyWriteVoxelDistanceCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
 
-// PIXEL SHADER DEFINITIONS
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilPolyWriteVoxelDistanceCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
 
-class FMSQStencilPolyDrawMaskPS : public FRULBasePixelShader
-{
-    typedef FRULBasePixelShader FBaseType;
+    RUL_DECLARE_SHADER_PARAMETERS_6(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "StencilTexture",    StencilTexture,
+        "VoxelStateData",    VoxelStateData,
+        "LineGeomData",      LineGeomData,
+        "LineStateData",     LineStateData,
+        "TileBinOffsetData", TileBinOffsetData,
+        "TileBinItemData",   TileBinItemData
+        )
 
-    DECLARE_SHADER_TYPE(FMSQStencilPolyDrawMaskPS, Global);
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelDistanceData", OutVoxelDistanceData
+        )
 
-public:
+    RUL_DECLARE_SHADER_PARAMETERS_14(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",             Params_MapDimension,
+        "_DispatchOffset",     Params_DispatchOffset,
+        "_DispatchDim",        Params_DispatchDim,
+        "_StencilRect",        Params_StencilRect,
+        "_StencilOffset",      Params_StencilOffset,
+        "_StencilOp",          Params_StencilOp,
+        "_FillType",           Params_FillType,
+        "_OpFillType",         Params_OpFillType,
+        "_LineTransform",      Params_LineTransform,
+        "_LineTranslation",    Params_LineTranslation,
+        "_DistanceLayerCount", Params_DistanceLayerCount,
+        "_DistanceRange",      Params_DistanceRange,
+        "_TileCountX",         Params_TileCountX,
+        "_LineOffset",         Params_LineOffset
+        )
+};
 
-    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
-    {
-        return true;
-    }
+class FMSQStencilPolyTileBinClearCS : public FRULBaseComputeShader<256,1,1>
+{
+    typedef FRULBaseComputeShader<256,1,1> FBaseType;
 
-    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
-    {
-        FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-        OutEnvironment.SetRenderTargetOutputFormat(0, PF_R16_UINT);
-    }
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilPolyTileBinClearCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(FMSQStencilPolyDrawMaskPS)
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutTileBinCursorData", OutTileBinCursorData
+        )
 
-    RUL_DECLARE_SHADER_PARAMETERS_0(SRV,,)
-    RUL_DECLARE_SHADER_PARAMETERS_0(UAV,,)
-    RUL_DECLARE_SHADER_PARAMETERS_0(Value,,)
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_BinTileCount", Params_BinTileCount
+        )
 };
 
-class FMSQStencilPolyDrawEdgePS : public FRULBasePixelShader
+template<uint32 BinSource>
+class TMSQStencilPolyTileBinCountCS : public FRULBaseComputeShader<256,1,1>
 {
-    typedef FRULBasePixelShader FBaseType;
+public:
 
-    DECLARE_SHADER_TYPE(FMSQStencilPolyDrawEdgePS, Global);
+    typedef FRULBaseComputeShader<256,1,1> FBaseType;
+
+    DECLARE_SHADER_TYPE(TMSQStencilPolyTileBinCountCS, Global);
 
 public:
 
@@ -154,107 +265,162 @@ public:
     static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
     {
         FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
-        OutEnvironment.SetRenderTargetOutputFormat(0, PF_R16_UINT);
+        OutEnvironment.SetDefine(TEXT("TILE_BIN_SOURCE"), BinSource);
     }
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(FMSQStencilPolyDrawEdgePS)
-
-    RUL_DECLARE_SHADER_PARAMETERS_0(SRV,,)
-    RUL_DECLARE_SHADER_PARAMETERS_0(UAV,,)
-    RUL_DECLARE_SHADER_PARAMETERS_0(Value,,)
-};
+    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(TMSQStencilPolyTileBinCountCS)
 
-IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyDrawMaskPS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyVSPS.usf"), TEXT("DrawStencilMaskPS"), SF_Pixel);
+    RUL_DECLARE_SHADER_PARAMETERS_4(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "DrawVertexData", DrawVertexData,
+        "DrawIndexData",  DrawIndexData,
+        "LineGeomData",   LineGeomData,
+        "LineStateData",  LineStateData
+        )
 
-IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyDrawEdgePS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyVSPS.usf"), TEXT("DrawStencilEdgePS"), SF_Pixel);
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutTileBinCursorData", OutTileBinCursorData
+        )
 
-// COMPUTE SHADER DEFINITIONS
+    RUL_DECLARE_SHADER_PARAMETERS_9(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_BinTileCount",    Params_BinTileCount,
+        "_BinTileSize",     Params_BinTileSize,
+        "_BinOrigin",       Params_BinOrigin,
+        "_BinRange",        Params_BinRange,
+        "_BinItemCount",    Params_BinItemCount,
+        "_LineTransform",   Params_LineTransform,
+        "_LineTranslation", Params_LineTranslation,
+        "_LineOffset",      Params_LineOffset,
+        "_DrawOffset",      Params_DrawOffset
+        )
+};
 
-class FMSQStencilPolyWriteVoxelStateCS : public FRULBaseComputeShader<16,16,1>
+class FMSQStencilPolyTileBinScanCS : public FRULBaseComputeShader<256,1,1>
 {
-    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+    typedef FRULBaseComputeShader<256,1,1> FBaseType;
 
     RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
-        FMSQStencilPolyWriteVoxelStateCS,
+        FMSQStencilPolyTileBinScanCS,
         Global,
         RHISupportsComputeShaders(Parameters.Platform)
         )
 
-    RUL_DECLARE_SHADER_PARAMETERS_2(
-        SRV,
-        FShaderResourceParameter,
-        FResourceId,
-        "StencilTexture", StencilTexture,
-        "LineGeomData", LineGeomData
-        )
-
     RUL_DECLARE_SHADER_PARAMETERS_2(
         UAV,
         FShaderResourceParameter,
         FResourceId,
-        "OutVoxelStateData", OutVoxelStateData,
-        "OutDebugTexture",   OutDebugTexture
+        "OutTileBinOffsetData", OutTileBinOffsetData,
+        "OutTileBinCursorData", OutTileBinCursorData
         )
 
     RUL_DECLARE_SHADER_PARAMETERS_2(
         Value,
         FShaderParameter,
         FParameterId,
-        "_MapDim",   Params_MapDimension,
-        "_FillType", Params_FillType
+        "_BinTileCount", Params_BinTileCount,
+        "_BinCapacity",  Params_BinCapacity
         )
 };
 
-class FMSQStencilPolyWriteVoxelFeatureCS : public FRULBaseComputeShader<16,16,1>
+template<uint32 BinSource>
+class TMSQStencilPolyTileBinScatterCS : public FRULBaseComputeShader<256,1,1>
 {
-    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+public:
 
-    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
-        FMSQStencilPolyWriteVoxelFeatureCS,
-        Global,
-        RHISupportsComputeShaders(Parameters.Platform)
-        )
+    typedef FRULBaseComputeShader<256,1,1> FBaseType;
 
-    RUL_DECLARE_SHADER_PARAMETERS_2(
+    DECLARE_SHADER_TYPE(TMSQStencilPolyTileBinScatterCS, Global);
+
+public:
+
+    static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return RHISupportsComputeShaders(Parameters.Platform);
+    }
+
+    static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+    {
+        FBaseType::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+        OutEnvironment.SetDefine(TEXT("TILE_BIN_SOURCE"), BinSource);
+    }
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_SERIALIZER(TMSQStencilPolyTileBinScatterCS)
+
+    RUL_DECLARE_SHADER_PARAMETERS_4(
         SRV,
         FShaderResourceParameter,
         FResourceId,
-        "VoxelStateData", VoxelStateData,
-        "LineGeomData", LineGeomData
+        "DrawVertexData", DrawVertexData,
+        "DrawIndexData",  DrawIndexData,
+        "LineGeomData",   LineGeomData,
+        "LineStateData",  LineStateData
         )
 
     RUL_DECLARE_SHADER_PARAMETERS_2(
         UAV,
         FShaderResourceParameter,
         FResourceId,
-        "OutVoxelFeatureData", OutVoxelFeatureData,
-        "OutDebugTexture",     OutDebugTexture
+        "OutTileBinCursorData", OutTileBinCursorData,
+        "OutTileBinItemData",   OutTileBinItemData
         )
 
-    RUL_DECLARE_SHADER_PARAMETERS_2(
+    RUL_DECLARE_SHADER_PARAMETERS_10(
         Value,
         FShaderParameter,
         FParameterId,
-        "_MapDim",   Params_MapDimension,
-        "_FillType", Params_FillType
+        "_BinTileCount",    Params_BinTileCount,
+        "_BinTileSize",     Params_BinTileSize,
+        "_BinOrigin",       Params_BinOrigin,
+        "_BinRange",        Params_BinRange,
+        "_BinItemCount",    Params_BinItemCount,
+        "_BinCapacity",     Params_BinCapacity,
+        "_LineTransform",   Params_LineTransform,
+        "_LineTranslation", Params_LineTranslation,
+        "_LineOffset",      Params_LineOffset,
+        "_DrawOffset",      Params_DrawOffset
         )
 };
 
+IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyTileBinClearCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("TileBinClearKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(template<>, TMSQStencilPolyTileBinCountCS<0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("TileBinCountKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMSQStencilPolyTileBinCountCS<1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("TileBinCountKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyTileBinScanCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("TileBinScanKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(template<>, TMSQStencilPolyTileBinScatterCS<0>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("TileBinScatterKernel"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(template<>, TMSQStencilPolyTileBinScatterCS<1>, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("TileBinScatterKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyRasterizeCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("RasterizeStencilKernel"), SF_Compute);
+
 IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyWriteVoxelStateCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("VoxelWriteStateKernel"), SF_Compute);
 
 IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyWriteVoxelFeatureCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("VoxelWriteFeatureKernel"), SF_Compute);
 
-void FMarchingSquaresStencilPoly::DrawStencilMask_RT()
+IMPLEMENT_SHADER_TYPE(, FMSQStencilPolyWriteVoxelDistanceCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilPolyCS.usf"), TEXT("VoxelWriteDistanceKernel"), SF_Compute);
+
+// Returns tile bin shader permutation for triangle or edge segment items
+template<template<uint32> class TShaderType>
+typename TShaderType<0>::FBaseType* GetStencilTileBinShader(TShaderMap<FGlobalShaderType>* ShaderMap, bool bEdgeSource)
 {
-    check(IsInRenderingThread());
-    check(RHICmdListPtr != nullptr);
-    check(Dimension.X > 1);
-    check(Dimension.Y > 1);
+    return bEdgeSource
+        ? static_cast<typename TShaderType<0>::FBaseType*>(*TShaderMapRef<TShaderType<1>>(ShaderMap))
+        : static_cast<typename TShaderType<0>::FBaseType*>(*TShaderMapRef<TShaderType<0>>(ShaderMap));
+}
 
-    FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
-    const TArray<FVector2D>& Points(StencilPoints);
+void FMarchingSquaresStencilPoly::BuildStencilMask(const FStencilPolyData& Poly, int32 MaskId, TArray<FVector>& Vertices, TArray<int32>& Indices) const
+{
+    const TArray<FVector2D>& Points(Poly.StencilPoints);
 
-    // No valid rtt or not enough geometry to form a poly, abort
+    // Not enough geometry to form a poly, abort
     if (Points.Num() < 3)
     {
         return;
@@ -262,105 +428,69 @@ void FMarchingSquaresStencilPoly::DrawStencilMask_RT()
 
     // Construct poly faces
 
-    TArray<int32> Indices;
-    FECUtils::Earcut(Points, Indices, false);
+    TArray<int32> PolyIndices;
+    FECUtils::Earcut(Points, PolyIndices, false);
 
-    const int32 TriCount = Indices.Num() / 3;
+    const int32 VertexOffset = Vertices.Num();
 
 #if 0
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::DrawStencilMask_RT() TriCount: %d"), TriCount);
+    const int32 TriCount = PolyIndices.Num() / 3;
+
+    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::BuildStencilMask() TriCount: %d"), TriCount);
 
     for (int32 ti=0; ti<TriCount; ++ti)
     {
         int32 i = ti*3;
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::DrawStencilMask_RT() Tri[%d]: %d, %d, %d"), ti, Indices[i], Indices[i+1], Indices[i+2]);
+        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::BuildStencilMask() Tri[%d]: %d, %d, %d"), ti, PolyIndices[i], PolyIndices[i+1], PolyIndices[i+2]);
     }
 #endif
 
-    // Prepare graphics pipeline
+    // Assign vertex position:
+    // - XY: Vertex position
+    // - Z : Mask id (poly line header id)
 
-    TShaderMapRef<FMSQStencilPolyDrawMaskVS> VSShader(RHIShaderMap);
-    TShaderMapRef<FMSQStencilPolyDrawMaskPS> PSShader(RHIShaderMap);
+    Vertices.Reserve(VertexOffset + Points.Num());
 
-    FGraphicsPipelineStateInitializer GraphicsPSOInit;
-    GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
-    GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
-    GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-    GraphicsPSOInit.PrimitiveType = PT_TriangleList;
-    GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GetVertexDeclarationFVector2();
-    GraphicsPSOInit.BoundShaderState.VertexShaderRHI = GETSAFERHISHADER_VERTEX(*VSShader);
-    GraphicsPSOInit.BoundShaderState.PixelShaderRHI = GETSAFERHISHADER_PIXEL(*PSShader);
-
-    // Render pass
-
-    RHICmdList.SetViewport(0, 0, 0.f, Dimension.X, Dimension.Y, 1.f);
-
-    FRHIRenderPassInfo RPInfo(StencilTextureRTV, ERenderTargetActions::Load_Store);
-    RHICmdList.BeginRenderPass(RPInfo, TEXT("DrawStencilMask"));
+    for (const FVector2D& Point : Points)
     {
-        RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
-        SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
-
-        // Draw render target
-
-        FVector2D DrawExts = FVector2D(Dimension.X, Dimension.Y) / 2.f;
-        VSShader->SetParameter(RHICmdList, TEXT("_DrawExts"), DrawExts);
-
-        //FRULRHIUtilityLibrary::DrawIndexedPrimitiveVolatile(
-        //    RHICmdList,
-        //    PT_TriangleList,
-        //    0,
-        //    Points.Num(),
-        //    TriCount,
-        //    Indices.GetData(),
-        //    Indices.GetTypeSize(),
-        //    Points.GetData(),
-        //    Points.GetTypeSize()
-        //    );
+        Vertices.Emplace(Point.X, Point.Y, MaskId);
+    }
 
-        FRULRHIUtilityLibrary::DrawTriangleList(RHICmdList, Points, Indices);
+    Indices.Reserve(Indices.Num() + PolyIndices.Num());
 
-        VSShader->UnbindBuffers(RHICmdList);
+    for (int32 Index : PolyIndices)
+    {
+        Indices.Emplace(VertexOffset + Index);
     }
-    RHICmdList.EndRenderPass();
 }
 
-void FMarchingSquaresStencilPoly::DrawStencilEdge_RT()
+void FMarchingSquaresStencilPoly::BuildStencilEdge(
+    const FStencilPolyData& Poly,
+    int32 LineOffset,
+    TArray<FVector>& Vertices,
+    TArray<int32>& Indices,
+    FLineGeomData& LineGeomArr
+    ) const
 {
-    check(IsInRenderingThread());
-    check(RHICmdListPtr != nullptr);
-    check(Dimension.X > 1);
-    check(Dimension.Y > 1);
-    check(VoxelCount > 1);
-
-    FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
-
-    const TArray<FVector2D>& Points(StencilPoints);
+    const TArray<FVector2D>& Points(Poly.StencilPoints);
     const int32 PointCount = Points.Num();
 
-    const float LineWidth = StencilEdgeRadius;
+    const float LineWidth = Poly.StencilEdgeRadius;
     const float MiterLimit = LineWidth * 5;
 
-    // No valid rtt target or not enough geometry to form a poly, abort
+    // Not enough geometry to form a poly, abort
     if (PointCount < 3 || LineWidth < KINDA_SMALL_NUMBER)
     {
         return;
     }
 
-    const int32 VCount = PointCount * 4;
-    const int32 ICount = PointCount * 6;
-    const int32 TCount = ICount / 3;
-    const int32 LineDataCount = PointCount + 1;
-
-    TArray<FVector> Vertices;
-    TArray<int32> Indices;
+    check(LineGeomArr.Num() >= (LineOffset+PointCount+1));
 
-    Vertices.SetNumUninitialized(VCount);
-    Indices.SetNumUninitialized(ICount);
+    const int32 VOffset = Vertices.Num();
+    const int32 IOffset = Indices.Num();
 
-    FLineGeomData LineGeomArr;
-    LineGeomArr.SetNumUninitialized(LineDataCount, true);
-    LineGeomArr[0] = FAlignedLineGeom();
+    Vertices.SetNumUninitialized(VOffset + PointCount*4);
+    Indices.SetNumUninitialized(IOffset + PointCount*6);
 
     for (int32 i=0; i<PointCount; ++i)
     {
@@ -413,9 +543,9 @@ void FMarchingSquaresStencilPoly::DrawStencilEdge_RT()
         FVector2D lp2 = p2 + TailNormal *  TailWidth;
         FVector2D lp3 = p2 + TailNormal * -TailWidth;
 
-        int32 lid = i+1;
+        int32 lid = LineOffset+i+1;
 
-        int32 vi0 = i*4;
+        int32 vi0 = VOffset+i*4;
         int32 vi1 = vi0+1;
         int32 vi2 = vi0+2;
         int32 vi3 = vi0+3;
@@ -431,7 +561,7 @@ void FMarchingSquaresStencilPoly::DrawStencilEdge_RT()
 
         // Assign geometry indices
 
-        int32 ti = i*6;
+        int32 ti = IOffset+i*6;
         Indices[ti+0] = vi0;
         Indices[ti+1] = vi3;
         Indices[ti+2] = vi1;
@@ -464,167 +594,954 @@ void FMarchingSquaresStencilPoly::DrawStencilEdge_RT()
 
     for (int32 i=0; i<PointCount; ++i)
     {
-        int32 lid = i+1;
+        int32 lid = LineOffset+i+1;
         int32 li0 = (i>0) ? (i-1) : (PointCount-1);
         int32 li1 = (i+1) % PointCount;
-        li0 = (li0+1);
-        li1 = (li1+1);
+        li0 = LineOffset+(li0+1);
+        li1 = LineOffset+(li1+1);
         FAlignedLineGeom& lg(LineGeomArr[lid]);
         lg.E2 = LineGeomArr[li0].E0;
         lg.E3 = LineGeomArr[li1].E1;
-        LineGeomArr[lid] = lg;
     }
+}
 
-    // Construct line geom data
-
-    LineGeomData.Release();
-    LineGeomData.Initialize(
-        sizeof(FLineGeomData::ElementType),
-        LineGeomArr.Num(),
-        &LineGeomArr,
-        BUF_Static,
-        TEXT("LineGeomData")
-        );
+bool FMarchingSquaresStencilPoly::BuildPolylineOutline(const FStencilPolylineData& Polyline, FStencilPolyData& OutPoly)
+{
+    // Miter length limit relative to the half width
+    const float MITER_LIMIT = 4.f;
 
-    // Prepare graphics pipeline
+    // Round cap arc segment length in voxel unit
+    const float CAP_SEGMENT_LENGTH = 1.f;
+    const int32 MAX_CAP_SEGMENT_COUNT = 32;
 
-    TShaderMapRef<FMSQStencilPolyDrawEdgeVS> VSShader(RHIShaderMap);
-    TShaderMapRef<FMSQStencilPolyDrawEdgePS> PSShader(RHIShaderMap);
+    // Filter out coincident points and resolve point half widths
 
-    FGraphicsPipelineStateInitializer GraphicsPSOInit;
-    GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
-    GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
-    GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-    GraphicsPSOInit.PrimitiveType = PT_TriangleList;
-    GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GetVertexDeclarationFVector3();
-    GraphicsPSOInit.BoundShaderState.VertexShaderRHI = GETSAFERHISHADER_VERTEX(*VSShader);
-    GraphicsPSOInit.BoundShaderState.PixelShaderRHI = GETSAFERHISHADER_PIXEL(*PSShader);
+    TArray<FVector2D> Points;
+    TArray<float> HalfWidths;
 
-    // Render pass
+    Points.Reserve(Polyline.Points.Num());
+    HalfWidths.Reserve(Polyline.Points.Num());
 
-    RHICmdList.SetViewport(0, 0, 0.f, Dimension.X, Dimension.Y, 1.f);
+    float MaxHalfWidth = 0.f;
 
-    FRHIRenderPassInfo RPInfo(StencilTextureRTV, ERenderTargetActions::Load_Store);
-    RHICmdList.BeginRenderPass(RPInfo, TEXT("DrawStencilEdge"));
+    for (int32 i=0; i<Polyline.Points.Num(); ++i)
     {
-        RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
-        SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
+        const FVector2D& Point(Polyline.Points[i]);
 
-        // Draw render target
-
-        FVector2D DrawExts = FVector2D(Dimension.X, Dimension.Y) / 2.f;
-        VSShader->SetParameter(RHICmdList, TEXT("_DrawExts"), DrawExts);
+        if (Points.Num() > 0 && FVector2D::DistSquared(Points.Last(), Point) < KINDA_SMALL_NUMBER)
+        {
+            continue;
+        }
 
-        //FPMURHIUtilityLibrary::DrawIndexedPrimitiveVolatile(
-        //    RHICmdList,
-        //    PT_TriangleList,
-        //    0,
-        //    Vertices.Num(),
-        //    TCount,
-        //    Indices.GetData(),
-        //    Indices.GetTypeSize(),
-        //    Vertices.GetData(),
-        //    Vertices.GetTypeSize()
-        //    );
+        const bool bHasPointWidth = Polyline.Widths.IsValidIndex(i) && Polyline.Widths[i] > 0.f;
+        const float HalfWidth = FMath::Max(0.f, bHasPointWidth ? Polyline.Widths[i] : Polyline.Width) * .5f;
 
-        FRULRHIUtilityLibrary::DrawTriangleList(RHICmdList, Vertices, Indices);
+        Points.Emplace(Point);
+        HalfWidths.Emplace(HalfWidth);
 
-        VSShader->UnbindBuffers(RHICmdList);
+        MaxHalfWidth = FMath::Max(MaxHalfWidth, HalfWidth);
     }
-    RHICmdList.EndRenderPass();
-}
 
-void FMarchingSquaresStencilPoly::ResolveStencilTexture_RT()
-{
-    check(IsInRenderingThread());
-    check(RHICmdListPtr != nullptr);
-    check(IsValidRef(StencilTextureRTV));
-    check(IsValidRef(StencilTextureRSV));
+    const int32 PointCount = Points.Num();
 
-    FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
+    // Not enough geometry to form a stroke, abort
+    if (PointCount < 2 || MaxHalfWidth < KINDA_SMALL_NUMBER)
+    {
+        return false;
+    }
 
-    RHICmdList.CopyToResolveTarget(
-        StencilTextureRTV,
-        StencilTextureRSV,
-        FResolveParams()
-        );
+    TArray<FVector2D> Dirs;
+    TArray<float> Lengths;
 
-    UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::ResolveStencilTexture_RT() CopyToResolveTarget()"));
-}
+    Dirs.SetNumUninitialized(PointCount-1);
+    Lengths.SetNumUninitialized(PointCount-1);
 
-void FMarchingSquaresStencilPoly::ReleaseResources_RT()
-{
-    if (IsValidRef(StencilTextureRTV) || IsValidRef(StencilTextureRSV) || IsValidRef(StencilTextureSRV))
+    for (int32 i=0; i<(PointCount-1); ++i)
     {
-        StencilTextureRTV.SafeRelease();
-        StencilTextureRSV.SafeRelease();
-        StencilTextureSRV.SafeRelease();
-
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::ReleaseResources_RT() RELEASE RESOURCES"));
+        const FVector2D Delta(Points[i+1]-Points[i]);
+        Lengths[i] = Delta.Size();
+        Dirs[i] = Delta / Lengths[i];
     }
-}
 
-void FMarchingSquaresStencilPoly::GenerateVoxelFeatures_RT(FRHICommandListImmediate& RHICmdList, const FGenerateVoxelFeatureParameter& Parameter)
-{
-    check(IsInRenderingThread());
-    check(Parameter.Map != nullptr);
-    check(Parameter.Map->HasValidDimension_RT());
+    // Construct left and right stroke points in polyline order. Interior
+    // points are offset along the miter of the adjacent segment normals.
+    // Joins exceeding the miter limit are beveled on the outer side, the
+    // inner offset is limited by the adjacent segment lengths so the
+    // outline does not self-intersect.
 
-    RHICmdListPtr = &RHICmdList;
-    RHIShaderMap  = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+    TArray<FVector2D> LeftPoints;
+    TArray<FVector2D> RightPoints;
 
-    FMarchingSquaresMap& Map(*Parameter.Map);
+    LeftPoints.Reserve(PointCount*2);
+    RightPoints.Reserve(PointCount*2);
 
-    if (Dimension != Map.GetDimension_RT())
+    for (int32 i=0; i<PointCount; ++i)
     {
-        ReleaseResources_RT();
+        const int32 i0 = FMath::Max(i-1, 0);
+        const int32 i1 = FMath::Min(i, PointCount-2);
 
-        Dimension  = Map.GetDimension_RT();
-        VoxelCount = Map.GetVoxelCount_RT();
-    }
+        const FVector2D& Dir0(Dirs[i0]);
+        const FVector2D& Dir1(Dirs[i1]);
 
-    FillType          = Parameter.FillType;
-    StencilPoints     = Parameter.StencilPoints;
-    StencilEdgeRadius = Parameter.StencilEdgeRadius;
-
-    // Create resolve targetable texture if required
-
-    if (! StencilTextureRTV || ! StencilTextureRSV)
-    {
-        // Make sure if one the render resource is invalid then all of them are
-        check(! IsValidRef(StencilTextureRTV));
-        check(! IsValidRef(StencilTextureRSV));
-        check(! IsValidRef(StencilTextureSRV));
-
-        FClearValueBinding ClearValue(FLinearColor(0,0,0,0));
-        FRHIResourceCreateInfo CreateInfo(ClearValue);
-        RHICreateTargetableShaderResource2D(
-            Dimension.X,
-            Dimension.Y,
-            PF_R16_UINT,
-            1,
-            TexCreate_None,
-            TexCreate_RenderTargetable,
-            false,
-            CreateInfo,
-            StencilTextureRTV,
-            StencilTextureRSV
+        const FVector2D Normal0(-Dir0.Y, Dir0.X);
+        const FVector2D Normal1(-Dir1.Y, Dir1.X);
+
+        const FVector2D& Point(Points[i]);
+        const float HalfWidth = HalfWidths[i];
+
+        FVector2D Miter((Normal0+Normal1).GetSafeNormal());
+
+        // Segments fold back onto each other, use the incoming normal
+        if (Miter.IsNearlyZero())
+        {
+            Miter = Normal0;
+        }
+
+        const float MiterCos = Miter | Normal0;
+
+        // Miter join
+
+        if (MiterCos >= 1.f/MITER_LIMIT)
+        {
+            const FVector2D Offset(Miter * (HalfWidth / MiterCos));
+
+            LeftPoints.Emplace(Point + Offset);
+            RightPoints.Emplace(Point - Offset);
+            continue;
+        }
+
+        // Bevel join, outer side is the left side on clockwise turns
+
+        const bool bLeftOuter = (Dir0 ^ Dir1) < 0.f;
+        const float OuterSign = bLeftOuter ? 1.f : -1.f;
+
+        const float SegmentLength = FMath::Min(Lengths[i0], Lengths[i1]);
+        const float InnerLength = FMath::Min(HalfWidth * MITER_LIMIT, FMath::Sqrt(HalfWidth*HalfWidth + SegmentLength*SegmentLength));
+        const FVector2D InnerPoint(Point - Miter * (OuterSign * InnerLength));
+
+        TArray<FVector2D>& OuterPoints(bLeftOuter ? LeftPoints : RightPoints);
+        TArray<FVector2D>& InnerPoints(bLeftOuter ? RightPoints : LeftPoints);
+
+        OuterPoints.Emplace(Point + Normal0 * (OuterSign * HalfWidth));
+        OuterPoints.Emplace(Point + Normal1 * (OuterSign * HalfWidth));
+        InnerPoints.Emplace(InnerPoint);
+    }
+
+    // Extend square caps beyond the end points
+
+    if (Polyline.StartCap == STENCIL_CAP_SQUARE)
+    {
+        const FVector2D CapOffset(Dirs[0] * HalfWidths[0]);
+        LeftPoints[0]  -= CapOffset;
+        RightPoints[0] -= CapOffset;
+    }
+
+    if (Polyline.EndCap == STENCIL_CAP_SQUARE)
+    {
+        const FVector2D CapOffset(Dirs.Last() * HalfWidths.Last());
+        LeftPoints.Last()  += CapOffset;
+        RightPoints.Last() += CapOffset;
+    }
+
+    // Round cap arc from the right side to the left side of the cap
+    // direction, excluding the stroke side points
+
+    auto AppendCapArc = [&](const FVector2D& Center, const FVector2D& Dir, float HalfWidth)
+    {
+        const FVector2D Normal(-Dir.Y, Dir.X);
+        const int32 SegmentCount = FMath::Clamp(FMath::CeilToInt(PI*HalfWidth/CAP_SEGMENT_LENGTH), 2, MAX_CAP_SEGMENT_COUNT);
+
+        for (int32 k=1; k<SegmentCount; ++k)
+        {
+            float S, C;
+            FMath::SinCos(&S, &C, -HALF_PI + PI*k/SegmentCount);
+            OutPoly.StencilPoints.Emplace(Center + (Dir*C + Normal*S) * HalfWidth);
+        }
+    };
+
+    // Construct counter-clockwise outline:
+    //
+    // [Right 0..N-1] [End Cap Arc] [Left N-1..0] [Start Cap Arc]
+
+    TArray<FVector2D>& Outline(OutPoly.StencilPoints);
+
+    Outline.Reset();
+    Outline.Append(RightPoints);
+
+    if (Polyline.EndCap == STENCIL_CAP_ROUND)
+    {
+        AppendCapArc(Points.Last(), Dirs.Last(), HalfWidths.Last());
+    }
+
+    for (int32 i=LeftPoints.Num()-1; i>=0; --i)
+    {
+        Outline.Emplace(LeftPoints[i]);
+    }
+
+    if (Polyline.StartCap == STENCIL_CAP_ROUND)
+    {
+        AppendCapArc(Points[0], -Dirs[0], HalfWidths[0]);
+    }
+
+    OutPoly.FillType = Polyline.FillType;
+    OutPoly.StencilEdgeRadius = Polyline.StencilEdgeRadius;
+
+    return true;
+}
+
+FVector4 FMarchingSquaresStencilPoly::FStencilTransform::GetMatrix() const
+{
+    float S, C;
+    FMath::SinCos(&S, &C, FMath::DegreesToRadians(Rotation));
+
+    return FVector4(
+        C*Scale.X, -S*Scale.Y,
+        S*Scale.X,  C*Scale.Y
+        );
+}
+
+FVector2D FMarchingSquaresStencilPoly::FStencilTransform::TransformPoint(const FVector2D& Point) const
+{
+    const FVector4 M(GetMatrix());
+
+    return FVector2D(
+        M.X*Point.X + M.Y*Point.Y,
+        M.Z*Point.X + M.W*Point.Y
+        ) + Translation;
+}
+
+bool FMarchingSquaresStencilPoly::FilterStencilPoly(const FStencilPolyData& Poly, float SimplifyTolerance, FStencilPolyData& OutPoly) const
+{
+    if (Poly.StencilPoints.Num() < 3)
+    {
+        return false;
+    }
+
+    // Simplify stencil points, outline detail below voxel resolution
+    // does not contribute to the rasterized stencil
+
+    if (SimplifyTolerance > 0.f)
+    {
+        OutPoly.FillType = Poly.FillType;
+        OutPoly.StencilEdgeRadius = Poly.StencilEdgeRadius;
+
+        FMarchingSquaresGeometryUtils::SimplifyPolyline(
+            Poly.StencilPoints,
+            OutPoly.StencilPoints,
+            SimplifyTolerance,
+            true
+            );
+    }
+    else
+    {
+        OutPoly = Poly;
+    }
+
+    return OutPoly.StencilPoints.Num() >= 3;
+}
+
+void FMarchingSquaresStencilPoly::FilterStencilPolys(const TArray<FStencilPolyData>& Polys, float SimplifyTolerance, TArray<FStencilPolyData>& OutPolys) const
+{
+    // Filter out polys that would not produce any geometry and limit the
+    // total line count to what the 16-bit line id is able to address
+
+    OutPolys.Reset(Polys.Num());
+
+    int32 LineCount = 0;
+
+    for (const FStencilPolyData& Poly : Polys)
+    {
+        FStencilPolyData PolyData;
+
+        if (! FilterStencilPoly(Poly, SimplifyTolerance, PolyData))
+        {
+            continue;
+        }
+
+        const int32 PointCount = PolyData.StencilPoints.Num();
+
+        if ((LineCount+PointCount+1) > (MAX_LINE_ID+1))
+        {
+            UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::FilterStencilPolys() Stencil batch exceeds maximum line count, remaining polys are skipped"));
+            break;
+        }
+
+        OutPolys.Emplace(MoveTemp(PolyData));
+        LineCount += PointCount + 1;
+    }
+}
+
+void FMarchingSquaresStencilPoly::BuildStencilGeometry(
+    const TArray<FStencilPolyData>& Polys,
+    TArray<FVector>& Vertices,
+    TArray<int32>& Indices,
+    FLineGeomData& LineGeomArr,
+    FLineStateData& LineStateArr
+    ) const
+{
+    // Line geometry layout, each poly occupies a contiguous range:
+    //
+    // [Poly 0 Header] [Poly 0 Line 1..N] [Poly 1 Header] [Poly 1 Line 1..M] ...
+    //
+    // The header entry has no line geometry and is used as the poly mask id.
+
+    const int32 LineDataCount = GetLineDataCount(Polys);
+
+    LineGeomArr.SetNumZeroed(FMath::Max(1, LineDataCount));
+    LineStateArr.SetNumZeroed(LineGeomArr.Num());
+
+    Vertices.Reset();
+    Indices.Reset();
+
+    // Construct mask and edge geometry in poly order so that later polys
+    // overwrite earlier ones within the same rasterization
+
+    int32 LineOffset = 0;
+
+    for (const FStencilPolyData& Poly : Polys)
+    {
+        BuildStencilMask(Poly, LineOffset, Vertices, Indices);
+        BuildStencilEdge(Poly, LineOffset, Vertices, Indices, LineGeomArr);
+
+        LineOffset += Poly.StencilPoints.Num() + 1;
+    }
+
+    BuildLineStateData(Polys, LineStateArr);
+}
+
+void FMarchingSquaresStencilPoly::BuildLineStateData(const TArray<FStencilPolyData>& Polys, FLineStateData& LineStateArr) const
+{
+    int32 LineOffset = 0;
+
+    for (const FStencilPolyData& Poly : Polys)
+    {
+        const int32 PointCount = Poly.StencilPoints.Num();
+        const uint32 FillType = Poly.FillType & LINE_STATE_FILL_TYPE_MASK;
+
+        check(LineStateArr.Num() >= (LineOffset+PointCount+1));
+
+        LineStateArr[LineOffset] = FillType;
+
+        for (int32 i=1; i<=PointCount; ++i)
+        {
+            LineStateArr[LineOffset+i] = FillType | LINE_STATE_EDGE_FLAG;
+        }
+
+        LineOffset += PointCount + 1;
+    }
+}
+
+FMarchingSquaresStencilPoly::FSpanSum FMarchingSquaresStencilPoly::GetTriangleSpanSum(const TArray<FVector>& Vertices, const TArray<int32>& Indices)
+{
+    FSpanSum SpanSum;
+
+    for (int32 i=2; i<Indices.Num(); i+=3)
+    {
+        const FVector& V0(Vertices[Indices[i-2]]);
+        const FVector& V1(Vertices[Indices[i-1]]);
+        const FVector& V2(Vertices[Indices[i  ]]);
+
+        const float SpanX = FMath::Max3(V0.X, V1.X, V2.X) - FMath::Min3(V0.X, V1.X, V2.X);
+        const float SpanY = FMath::Max3(V0.Y, V1.Y, V2.Y) - FMath::Min3(V0.Y, V1.Y, V2.Y);
+        const float Span  = SpanX + SpanY;
+
+        SpanSum.Sum   += Span;
+        SpanSum.SqSum += Span*Span;
+    }
+
+    return SpanSum;
+}
+
+FMarchingSquaresStencilPoly::FSpanSum FMarchingSquaresStencilPoly::GetEdgeSpanSum(const FLineGeomData& LineGeomArr, const FLineStateData& LineStateArr)
+{
+    check(LineGeomArr.Num() == LineStateArr.Num());
+
+    FSpanSum SpanSum;
+
+    for (int32 i=0; i<LineGeomArr.Num(); ++i)
+    {
+        if (LineStateArr[i] & LINE_STATE_EDGE_FLAG)
+        {
+            // Edge segment spans line points p1 and p2
+            const FAlignedLineGeom& Line(LineGeomArr[i]);
+            const float Span = FMath::Abs(Line.P2.X-Line.P1.X) + FMath::Abs(Line.P2.Y-Line.P1.Y);
+
+            SpanSum.Sum   += Span;
+            SpanSum.SqSum += Span*Span;
+        }
+    }
+
+    return SpanSum;
+}
+
+int32 FMarchingSquaresStencilPoly::GetTileBinEntryBound(
+    const FSpanSum& SpanSum,
+    int32 ItemCount,
+    float Scale,
+    float Range,
+    FIntPoint TileSize,
+    FIntPoint TileCount
+    )
+{
+    // Transformed item bounds extent is at most the transform scale times
+    // the local bounds span on each axis, grown by the bin range on both
+    // sides. An extent overlaps at most (extent / tile size + 2) tiles per
+    // axis, summed over all items from the span sums.
+
+    const double S = FMath::Abs(Scale);
+    const double R = Range;
+    const double N = ItemCount;
+    const double TX = TileSize.X;
+    const double TY = TileSize.Y;
+
+    const double ExtentSum   = S*SpanSum.Sum + 2.0*R*N;
+    const double ExtentSqSum = S*S*SpanSum.SqSum + 4.0*S*R*SpanSum.Sum + 4.0*R*R*N;
+
+    const double EntryBound = ExtentSqSum/(TX*TY) + 2.0*ExtentSum*(1.0/TX + 1.0/TY) + 4.0*N;
+    const double EntryLimit = N * double(TileCount.X) * double(TileCount.Y);
+
+    return FMath::Max(1, int32(FMath::Min3<double>(EntryBound, EntryLimit, MAX_int32/2)));
+}
+
+bool FMarchingSquaresStencilPoly::CalculateStencilRect(const FBox2D& Bounds)
+{
+    // Grow stencil bounds by a single voxel to account for pixel center
+    // coverage, clamped to map dimension
+
+    StencilRect.Min.X = FMath::Clamp(FMath::FloorToInt(Bounds.Min.X)-1, 0, Dimension.X);
+    StencilRect.Min.Y = FMath::Clamp(FMath::FloorToInt(Bounds.Min.Y)-1, 0, Dimension.Y);
+    StencilRect.Max.X = FMath::Clamp(FMath::CeilToInt(Bounds.Max.X)+1, 0, Dimension.X);
+    StencilRect.Max.Y = FMath::Clamp(FMath::CeilToInt(Bounds.Max.Y)+1, 0, Dimension.Y);
+
+    return StencilRect.Area() > 0;
+}
+
+bool FMarchingSquaresStencilPoly::DrawStencil_RT()
+{
+    check(IsInRenderingThread());
+    check(RHICmdListPtr != nullptr);
+    check(Dimension.X > 1);
+    check(Dimension.Y > 1);
+    check(VoxelCount > 1);
+
+    TArray<FVector> Vertices;
+    TArray<int32> Indices;
+    FLineGeomData LineGeomArr;
+    FLineStateData LineStateArr;
+
+    BuildStencilGeometry(StencilPolys, Vertices, Indices, LineGeomArr, LineStateArr);
+
+    // Upload line geom and line state data
+
+    UploadLineData_RT(LineGeomArr, LineStateArr);
+
+    // No geometry to draw, abort
+    if (Indices.Num() < 3)
+    {
+        StencilRect = FIntRect();
+        return false;
+    }
+
+    // Calculate stencil bounds from the generated geometry
+
+    FBox2D StencilBounds(ForceInitToZero);
+
+    for (const FVector& Vertex : Vertices)
+    {
+        StencilBounds += FVector2D(Vertex);
+    }
+
+    // Stencil is completely outside the map, abort
+    if (! CalculateStencilRect(StencilBounds))
+    {
+        return false;
+    }
+
+    // Upload and rasterize stencil geometry
+
+    FDrawDataRef DrawData;
+    UploadDrawData_RT(Vertices, Indices, DrawData);
+
+    RasterizeStencil_RT(DrawData, FStencilTransform());
+
+    return true;
+}
+
+bool FMarchingSquaresStencilPoly::DrawCachedStencil_RT(const FStencilTransform& Transform)
+{
+    check(IsInRenderingThread());
+    check(RHICmdListPtr != nullptr);
+    check(Dimension.X > 1);
+    check(Dimension.Y > 1);
+    check(CachedVertexData.IsValid());
+    check(CachedIndexData.IsValid());
+
+    // Calculate stencil bounds from transformed local bounds
+
+    const FVector2D& BMin(CachedBounds.Min);
+    const FVector2D& BMax(CachedBounds.Max);
+
+    FBox2D StencilBounds(ForceInitToZero);
+    StencilBounds += Transform.TransformPoint(FVector2D(BMin.X, BMin.Y));
+    StencilBounds += Transform.TransformPoint(FVector2D(BMax.X, BMin.Y));
+    StencilBounds += Transform.TransformPoint(FVector2D(BMin.X, BMax.Y));
+    StencilBounds += Transform.TransformPoint(FVector2D(BMax.X, BMax.Y));
+
+    // Stencil is completely outside the map, abort
+    if (! CalculateStencilRect(StencilBounds))
+    {
+        return false;
+    }
+
+    // Rasterize cached geometry with stencil transform
+
+    FDrawDataRef DrawData;
+    DrawData.VertexSRV     = CachedVertexData.SRV;
+    DrawData.IndexSRV      = CachedIndexData.SRV;
+    DrawData.TriangleCount = CachedIndexCount/3;
+    DrawData.SpanSum       = CachedSpanSum;
+
+    RasterizeStencil_RT(DrawData, Transform);
+
+    return true;
+}
+
+void FMarchingSquaresStencilPoly::RasterizeStencil_RT(const FDrawDataRef& DrawData, const FStencilTransform& Transform)
+{
+    check(IsInRenderingThread());
+    check(RHICmdListPtr != nullptr);
+    check(DrawData.TriangleCount > 0);
+    check(StencilRect.Area() > 0);
+
+    FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
+
+    BorrowStencilTexture_RT();
+
+    // Bin stencil triangles to the stencil tiles covered by their bounds
+
+    const FIntPoint DispatchOffset = StencilRect.Min;
+    const FIntPoint DispatchDim    = StencilRect.Size();
+
+    const int32 TileCountX = FMath::DivideAndRoundUp<int32>(DispatchDim.X, STENCIL_TILE_SIZE);
+    const int32 TileCountY = FMath::DivideAndRoundUp<int32>(DispatchDim.Y, STENCIL_TILE_SIZE);
+
+    FTileBinParameter BinParameter;
+    BinParameter.Source     = TILE_BIN_SOURCE_TRIANGLE;
+    BinParameter.ItemCount  = DrawData.TriangleCount;
+    BinParameter.TileCount  = FIntPoint(TileCountX, TileCountY);
+    BinParameter.TileSize   = FIntPoint(STENCIL_TILE_SIZE, STENCIL_TILE_SIZE);
+    BinParameter.Origin     = FVector2D(DispatchOffset.X+.5f, DispatchOffset.Y+.5f);
+    BinParameter.EntryBound = GetTileBinEntryBound(
+        DrawData.SpanSum,
+        DrawData.TriangleCount,
+        Transform.Scale.GetAbsMax(),
+        0.f,
+        BinParameter.TileSize,
+        BinParameter.TileCount
+        );
+
+    BinParameter.ItemDataSRV0    = DrawData.VertexSRV;
+    BinParameter.ItemDataSRV1    = DrawData.IndexSRV;
+    BinParameter.ItemDataOffset0 = DrawData.VertexOffset;
+    BinParameter.ItemDataOffset1 = DrawData.IndexOffset;
+
+    BinTileItems_RT(StencilTileBin, BinParameter, Transform);
+
+    // Rasterize stencil geometry within the stencil bounds. Each thread
+    // group covers a single stencil tile and only reads the triangle list
+    // binned to the tile. The kernel writes every texel within the stencil
+    // bounds, clearing texels left uncovered.
+
+    const FVector4  DrawTransform   = Transform.GetMatrix();
+    const FVector2D DrawTranslation = Transform.Translation;
+    const uint32    DrawTileCountX  = TileCountX;
+    const FIntPoint DrawOffset(DrawData.VertexOffset, DrawData.IndexOffset);
+
+    RHICmdList.BeginComputePass(TEXT("RasterizeStencil"));
+    {
+        TShaderMapRef<FMSQStencilPolyRasterizeCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("DrawVertexData"), DrawData.VertexSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("DrawIndexData"), DrawData.IndexSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("TileBinOffsetData"), StencilTileBin.OffsetData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("TileBinItemData"), StencilTileBin.ItemData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutStencilTexture"), StencilTexture.UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), DispatchOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), DispatchDim);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_StencilOffset"), StencilTextureOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineTransform"), DrawTransform);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineTranslation"), DrawTranslation);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_TileCountX"), DrawTileCountX);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DrawOffset"), DrawOffset);
+        ComputeShader->DispatchAndClear(RHICmdList, DispatchDim.X, DispatchDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+}
+
+void FMarchingSquaresStencilPoly::BinTileItems_RT(FTileBinData& TileBin, const FTileBinParameter& Parameter, const FStencilTransform& Transform)
+{
+    check(IsInRenderingThread());
+    check(RHICmdListPtr != nullptr);
+    check(Parameter.ItemCount > 0);
+    check(Parameter.TileCount.X > 0);
+    check(Parameter.TileCount.Y > 0);
+
+    FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
+
+    const FIntPoint TileCount    = Parameter.TileCount;
+    const int32     TileBinCount = TileCount.X * TileCount.Y;
+
+    // Grow tile bin buffers if the bin exceeds the current capacity
+
+    if ((TileBinCount+1) > TileBin.OffsetCapacity || ! TileBin.OffsetData.IsValid())
+    {
+        TileBin.OffsetCapacity = FMath::Max<int32>(FMath::RoundUpToPowerOfTwo(TileBinCount+1), MIN_TILE_BIN_COUNT);
+
+        TileBin.OffsetData.Release();
+        TileBin.OffsetData.Initialize(
+            sizeof(uint32),
+            TileBin.OffsetCapacity,
+            PF_R32_UINT,
+            BUF_Static,
+            TEXT("TileBinOffsetData")
+            );
+
+        TileBin.CursorData.Release();
+        TileBin.CursorData.Initialize(
+            sizeof(uint32),
+            TileBin.OffsetCapacity,
+            PF_R32_UINT,
+            BUF_Static,
+            TEXT("TileBinCursorData")
+            );
+    }
+
+    if (Parameter.EntryBound > TileBin.ItemCapacity || ! TileBin.ItemData.IsValid())
+    {
+        TileBin.ItemCapacity = FMath::Max<int32>(FMath::RoundUpToPowerOfTwo(Parameter.EntryBound), MIN_TILE_BIN_COUNT);
+
+        TileBin.ItemData.Release();
+        TileBin.ItemData.Initialize(
+            sizeof(uint32),
+            TileBin.ItemCapacity,
+            PF_R32_UINT,
+            BUF_Static,
+            TEXT("TileBinItemData")
             );
+    }
+
+    // Items are read from draw vertex and index data for triangle bins,
+    // line geom and line state data for edge segment bins
+
+    const bool bEdgeSource = (Parameter.Source == TILE_BIN_SOURCE_EDGE);
+
+    const TCHAR* ItemDataName0 = bEdgeSource ? TEXT("LineGeomData")  : TEXT("DrawVertexData");
+    const TCHAR* ItemDataName1 = bEdgeSource ? TEXT("LineStateData") : TEXT("DrawIndexData");
+    const TCHAR* ItemOffsetName = bEdgeSource ? TEXT("_LineOffset") : TEXT("_DrawOffset");
+
+    const FIntPoint ItemDataOffset(Parameter.ItemDataOffset0, Parameter.ItemDataOffset1);
+
+    const uint32    BinItemCount = Parameter.ItemCount;
+    const uint32    BinCapacity  = TileBin.ItemCapacity;
+    const FVector4  BinTransform   = Transform.GetMatrix();
+    const FVector2D BinTranslation = Transform.Translation;
+
+    RHICmdList.BeginComputePass(TEXT("BinTileItems"));
+    {
+        TShaderMapRef<FMSQStencilPolyTileBinClearCS> ClearCS(RHIShaderMap);
+        ClearCS->SetShader(RHICmdList);
+        ClearCS->BindUAV(RHICmdList, TEXT("OutTileBinCursorData"), TileBin.CursorData.UAV);
+        ClearCS->SetParameter(RHICmdList, TEXT("_BinTileCount"), TileCount);
+        ClearCS->DispatchAndClear(RHICmdList, TileBinCount, 1, 1);
+
+        TMSQStencilPolyTileBinCountCS<0>::FBaseType* CountCS;
+        CountCS = GetStencilTileBinShader<TMSQStencilPolyTileBinCountCS>(RHIShaderMap, bEdgeSource);
+
+        CountCS->SetShader(RHICmdList);
+        CountCS->BindSRV(RHICmdList, ItemDataName0, Parameter.ItemDataSRV0);
+        CountCS->BindSRV(RHICmdList, ItemDataName1, Parameter.ItemDataSRV1);
+        CountCS->BindUAV(RHICmdList, TEXT("OutTileBinCursorData"), TileBin.CursorData.UAV);
+        CountCS->SetParameter(RHICmdList, TEXT("_BinTileCount"), TileCount);
+        CountCS->SetParameter(RHICmdList, TEXT("_BinTileSize"), Parameter.TileSize);
+        CountCS->SetParameter(RHICmdList, TEXT("_BinOrigin"), Parameter.Origin);
+        CountCS->SetParameter(RHICmdList, TEXT("_BinRange"), Parameter.Range);
+        CountCS->SetParameter(RHICmdList, TEXT("_BinItemCount"), BinItemCount);
+        CountCS->SetParameter(RHICmdList, TEXT("_LineTransform"), BinTransform);
+        CountCS->SetParameter(RHICmdList, TEXT("_LineTranslation"), BinTranslation);
+        CountCS->SetParameter(RHICmdList, ItemOffsetName, ItemDataOffset);
+        CountCS->DispatchAndClear(RHICmdList, Parameter.ItemCount, 1, 1);
+
+        // Scan kernel is dispatched as a single group
+
+        TShaderMapRef<FMSQStencilPolyTileBinScanCS> ScanCS(RHIShaderMap);
+        ScanCS->SetShader(RHICmdList);
+        ScanCS->BindUAV(RHICmdList, TEXT("OutTileBinOffsetData"), TileBin.OffsetData.UAV);
+        ScanCS->BindUAV(RHICmdList, TEXT("OutTileBinCursorData"), TileBin.CursorData.UAV);
+        ScanCS->SetParameter(RHICmdList, TEXT("_BinTileCount"), TileCount);
+        ScanCS->SetParameter(RHICmdList, TEXT("_BinCapacity"), BinCapacity);
+        ScanCS->DispatchAndClear(RHICmdList, 1, 1, 1);
+
+        TMSQStencilPolyTileBinScatterCS<0>::FBaseType* ScatterCS;
+        ScatterCS = GetStencilTileBinShader<TMSQStencilPolyTileBinScatterCS>(RHIShaderMap, bEdgeSource);
+
+        ScatterCS->SetShader(RHICmdList);
+        ScatterCS->BindSRV(RHICmdList, ItemDataName0, Parameter.ItemDataSRV0);
+        ScatterCS->BindSRV(RHICmdList, ItemDataName1, Parameter.ItemDataSRV1);
+        ScatterCS->BindUAV(RHICmdList, TEXT("OutTileBinCursorData"), TileBin.CursorData.UAV);
+        ScatterCS->BindUAV(RHICmdList, TEXT("OutTileBinItemData"), TileBin.ItemData.UAV);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_BinTileCount"), TileCount);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_BinTileSize"), Parameter.TileSize);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_BinOrigin"), Parameter.Origin);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_BinRange"), Parameter.Range);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_BinItemCount"), BinItemCount);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_BinCapacity"), BinCapacity);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_LineTransform"), BinTransform);
+        ScatterCS->SetParameter(RHICmdList, TEXT("_LineTranslation"), BinTranslation);
+        ScatterCS->SetParameter(RHICmdList, ItemOffsetName, ItemDataOffset);
+        ScatterCS->DispatchAndClear(RHICmdList, Parameter.ItemCount, 1, 1);
+    }
+    RHICmdList.EndComputePass();
+}
+
+void FMarchingSquaresStencilPoly::UploadLineData_RT(const FLineGeomData& LineGeomArr, const FLineStateData& LineStateArr)
+{
+    check(IsInRenderingThread());
+    check(LineGeomArr.Num() > 0);
+    check(LineGeomArr.Num() == LineStateArr.Num());
+
+    const int32 LineDataCount = LineGeomArr.Num();
+
+    LineGeomRing.Reserve(LineDataCount, MIN_UPLOAD_LINE_COUNT, sizeof(FLineGeomData::ElementType), PF_Unknown);
+    LineStateRing.Reserve(LineDataCount, MIN_UPLOAD_LINE_COUNT, sizeof(FLineStateData::ElementType), PF_R32_UINT);
+
+    // Write line data at the ring write offsets. Line ids drawn to the
+    // stencil texture are relative to the uploaded line data offsets.
+
+    UploadLineData.GeomSRV     = LineGeomRing.SRV;
+    UploadLineData.StateSRV    = LineStateRing.SRV;
+    UploadLineData.GeomOffset  = LineGeomRing.Write(LineGeomArr.GetResourceData(), LineDataCount);
+    UploadLineData.StateOffset = LineStateRing.Write(LineStateArr.GetResourceData(), LineDataCount);
+    UploadLineData.Count       = LineDataCount;
+    UploadLineData.EdgeSpanSum = GetEdgeSpanSum(LineGeomArr, LineStateArr);
+}
+
+void FMarchingSquaresStencilPoly::UploadLineStateData_RT(const FLineStateData& LineStateArr)
+{
+    check(IsInRenderingThread());
+    check(LineStateRing.IsValid());
+    check(LineStateArr.Num() == UploadLineData.Count);
+
+    // Line state is written to a new ring segment, previous line state may
+    // still be read by voxel kernels of the previous map
+
+    LineStateRing.Reserve(LineStateArr.Num(), MIN_UPLOAD_LINE_COUNT, sizeof(FLineStateData::ElementType), PF_R32_UINT);
+
+    UploadLineData.StateSRV    = LineStateRing.SRV;
+    UploadLineData.StateOffset = LineStateRing.Write(LineStateArr.GetResourceData(), LineStateArr.Num());
+}
+
+void FMarchingSquaresStencilPoly::UploadDrawData_RT(const TArray<FVector>& Vertices, const TArray<int32>& Indices, FDrawDataRef& OutDrawData)
+{
+    check(IsInRenderingThread());
+    check(Vertices.Num() > 0);
+    check(Indices.Num() > 0);
+
+    static_assert(sizeof(int32) == sizeof(uint32), "Index data is uploaded as 32-bit index");
+
+    // Vertices are read by the rasterizer as packed float3
+
+    const int32 VertexFloatCount = Vertices.Num()*3;
+    const int32 IndexCount = Indices.Num();
+
+    DrawVertexRing.Reserve(VertexFloatCount, MIN_UPLOAD_VERTEX_COUNT*3, sizeof(float), PF_R32_FLOAT);
+    DrawIndexRing.Reserve(IndexCount, MIN_UPLOAD_INDEX_COUNT, sizeof(uint32), PF_R32_UINT);
+
+    OutDrawData.VertexSRV     = DrawVertexRing.SRV;
+    OutDrawData.IndexSRV      = DrawIndexRing.SRV;
+    OutDrawData.VertexOffset  = DrawVertexRing.Write(Vertices.GetData(), VertexFloatCount);
+    OutDrawData.IndexOffset   = DrawIndexRing.Write(Indices.GetData(), IndexCount);
+    OutDrawData.TriangleCount = IndexCount/3;
+    OutDrawData.SpanSum       = GetTriangleSpanSum(Vertices, Indices);
+}
+
+void FMarchingSquaresStencilPoly::FUploadRing::Reserve(int32 Count, int32 MinCount, int32 InStride, EPixelFormat Format)
+{
+    check(Count > 0);
+    check(InStride > 0);
+
+    if (IsValid() && Stride == InStride && (Count*UPLOAD_RING_SEGMENT_COUNT) <= Capacity)
+    {
+        return;
+    }
+
+    Release();
+
+    Stride   = InStride;
+    Capacity = FMath::Max<int32>(FMath::RoundUpToPowerOfTwo(Count), MinCount) * UPLOAD_RING_SEGMENT_COUNT;
+
+    FRHIResourceCreateInfo CreateInfo;
+    const uint32 Usage = BUF_Dynamic | BUF_ShaderResource;
+
+    if (Format == PF_Unknown)
+    {
+        StructuredBuffer = RHICreateStructuredBuffer(Stride, Capacity*Stride, Usage, CreateInfo);
+        SRV = RHICreateShaderResourceView(StructuredBuffer);
+    }
+    else
+    {
+        Buffer = RHICreateVertexBuffer(Capacity*Stride, Usage, CreateInfo);
+        SRV = RHICreateShaderResourceView(Buffer, Stride, Format);
+    }
+}
+
+int32 FMarchingSquaresStencilPoly::FUploadRing::Write(const void* Data, int32 Count)
+{
+    check(IsValid());
+    check(Count > 0);
+    check(Count <= Capacity);
+
+    // Wrap to the ring start if the upload does not fit the remaining capacity
+
+    if ((WriteOffset+Count) > Capacity)
+    {
+        WriteOffset = 0;
+    }
+
+    const int32  Offset     = WriteOffset;
+    const uint32 ByteOffset = Offset * Stride;
+    const uint32 ByteCount  = Count * Stride;
+
+    if (StructuredBuffer.IsValid())
+    {
+        void* DataPtr = RHILockStructuredBuffer(StructuredBuffer, ByteOffset, ByteCount, RLM_WriteOnly);
+        FMemory::Memcpy(DataPtr, Data, ByteCount);
+        RHIUnlockStructuredBuffer(StructuredBuffer);
+    }
+    else
+    {
+        void* DataPtr = RHILockVertexBuffer(Buffer, ByteOffset, ByteCount, RLM_WriteOnly);
+        FMemory::Memcpy(DataPtr, Data, ByteCount);
+        RHIUnlockVertexBuffer(Buffer);
+    }
+
+    WriteOffset += Count;
+
+    return Offset;
+}
+
+void FMarchingSquaresStencilPoly::FUploadRing::Release()
+{
+    SRV.SafeRelease();
+    Buffer.SafeRelease();
+    StructuredBuffer.SafeRelease();
+    Stride      = 0;
+    Capacity    = 0;
+    WriteOffset = 0;
+}
 
-        // Create shader resourve view
-        StencilTextureSRV = RHICreateShaderResourceView(StencilTextureRSV, 0);
+void FMarchingSquaresStencilPoly::FTileBinData::Release()
+{
+    OffsetData.Release();
+    CursorData.Release();
+    ItemData.Release();
+    OffsetCapacity = 0;
+    ItemCapacity   = 0;
+}
 
-        UE_LOG(UntMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::GenerateVoxelFeatures_RT() CREATE TEXTURE"));
+void FMarchingSquaresStencilPoly::ReleaseResources_RT()
+{
+    ReturnStencilTexture_RT();
+}
+
+void FMarchingSquaresStencilPoly::ReleaseUploadResources_RT()
+{
+    LineGeomRing.Release();
+    LineStateRing.Release();
+    DrawVertexRing.Release();
+    DrawIndexRing.Release();
+    UploadLineData = FLineDataRef();
+
+    StencilTileBin.Release();
+    DistanceTileBin.Release();
+}
+
+void FMarchingSquaresStencilPoly::PrepareStencil_RT(FMarchingSquaresMap& Map)
+{
+    check(IsInRenderingThread());
+    check(Map.HasValidDimension_RT());
+
+    if (Dimension != Map.GetDimension_RT())
+    {
+        ReleaseResources_RT();
+
+        Dimension  = Map.GetDimension_RT();
+        VoxelCount = Map.GetVoxelCount_RT();
     }
+}
+
+void FMarchingSquaresStencilPoly::BorrowStencilTexture_RT()
+{
+    check(IsInRenderingThread());
+    check(StencilRect.Area() > 0);
 
-    // Draw stencil texture
+    // Tile scratch texture covers only the stencil rect, map-sized
+    // texture shares texel coordinates with the map
 
-    DrawStencilMask_RT();
-    DrawStencilEdge_RT();
+    const FIntPoint TextureSize = bTileScratchTexture_RT
+        ? FMarchingSquaresStencilTexturePool::GetTileScratchSize(StencilRect.Size())
+        : Dimension;
 
-    // Resolve stencil texture
+    StencilTextureOffset = bTileScratchTexture_RT ? StencilRect.Min : FIntPoint::ZeroValue;
 
-    ResolveStencilTexture_RT();
+    // Keep already borrowed texture if it matches the required size
+
+    if (StencilTexture.IsValid() && StencilTexture.Size == TextureSize)
+    {
+        return;
+    }
+
+    FMarchingSquaresStencilTexturePool& TexturePool(FMarchingSquaresStencilTexturePool::Get());
+    TexturePool.Return_RT(StencilTexture);
+    TexturePool.Borrow_RT(TextureSize, PF_R16_UINT, StencilTexture);
+}
+
+void FMarchingSquaresStencilPoly::ReturnStencilTexture_RT()
+{
+    if (StencilTexture.IsValid())
+    {
+        FMarchingSquaresStencilTexturePool::Get().Return_RT(StencilTexture);
+    }
+
+    StencilTextureOffset = FIntPoint::ZeroValue;
+}
+
+void FMarchingSquaresStencilPoly::WriteVoxelData_RT(
+    FMarchingSquaresMap& Map,
+    const FLineDataRef& LineData,
+    uint32 FillType,
+    const FStencilTransform& Transform,
+    const FStencilOp& Op
+    )
+{
+    check(IsInRenderingThread());
+    check(RHICmdListPtr != nullptr);
+    check(LineData.Count > 0);
+
+    FRHICommandListImmediate& RHICmdList(*RHICmdListPtr);
+
+    // Voxel kernels only dispatch over the stencil bounds. Intersect
+    // operation also modifies voxels outside the stencil, voxel state,
+    // feature and distance kernels are all dispatched over the whole map
+    // instead. Voxels outside of all stencil polys use the given fill type.
+
+    const bool bDispatchFullMap = (Op.Mode == STENCIL_OP_INTERSECT);
+
+    const FIntPoint VoxelDispatchOffset = bDispatchFullMap ? FIntPoint::ZeroValue : StencilRect.Min;
+    const FIntPoint VoxelDispatchDim    = bDispatchFullMap ? Dimension : StencilRect.Size();
+
+    const uint32 StencilOp  = Op.Mode;
+    const uint32 OpFillType = Op.OpFillType;
+    const uint32 StencilFillType = FillType & LINE_STATE_FILL_TYPE_MASK;
 
     // Get data SRV & UAV
 
@@ -634,46 +1551,395 @@ void FMarchingSquaresStencilPoly::GenerateVoxelFeatures_RT(FRHICommandListImmedi
     FShaderResourceViewRHIParamRef  VoxelStateDataSRV = VoxelStateData.SRV;
     FUnorderedAccessViewRHIParamRef VoxelStateDataUAV = VoxelStateData.UAV;
 
-    FShaderResourceViewRHIParamRef  VoxelFeatureDataSRV = VoxelFeatureData.SRV;
-    FUnorderedAccessViewRHIParamRef VoxelFeatureDataUAV = VoxelFeatureData.UAV;
+    FShaderResourceViewRHIParamRef  VoxelFeatureDataSRV = VoxelFeatureData.SRV;
+    FUnorderedAccessViewRHIParamRef VoxelFeatureDataUAV = VoxelFeatureData.UAV;
+
+    FUnorderedAccessViewRHIRef& DebugTextureUAV(Map.GetDebugRTTUAV());
+
+    const FVector4  LineTransform   = Transform.GetMatrix();
+    const FVector2D LineTranslation = Transform.Translation;
+    const FIntPoint LineOffset(LineData.GeomOffset, LineData.StateOffset);
+
+    // Voxel distance kernel also writes voxels within distance range of
+    // the stencil edges, dispatched over the voxel rect grown by the
+    // distance range
+
+    FIntRect DistanceRect(VoxelDispatchOffset, VoxelDispatchOffset+VoxelDispatchDim);
+
+    if (Map.HasVoxelDistanceData_RT())
+    {
+        DistanceRect.InflateRect(FMath::CeilToInt(Map.GetDistanceRange_RT()));
+        DistanceRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension));
+    }
+
+    const FIntPoint DistanceDispatchOffset = DistanceRect.Min;
+    const FIntPoint DistanceDispatchDim    = DistanceRect.Size();
+
+    // Record voxel blocks written by the voxel kernels, distance rect
+    // always contains the voxel rect
+
+    Map.BeginVoxelEdit_RT(DistanceRect);
+
+    // Write voxel state data
+
+    RHICmdList.BeginComputePass(TEXT("WriteVoxelState"));
+    {
+        TShaderMapRef<FMSQStencilPolyWriteVoxelStateCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("StencilTexture"), StencilTexture.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("LineGeomData"), LineData.GeomSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("LineStateData"), LineData.StateSRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelStateData"), VoxelStateDataUAV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutDebugTexture"), DebugTextureUAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), VoxelDispatchOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), VoxelDispatchDim);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_StencilRect"), StencilRect);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_StencilOffset"), StencilTextureOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_StencilOp"), StencilOp);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), StencilFillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_OpFillType"), OpFillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineTransform"), LineTransform);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineTranslation"), LineTranslation);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineOffset"), LineOffset);
+        ComputeShader->DispatchAndClear(RHICmdList, VoxelDispatchDim.X, VoxelDispatchDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+
+    // Write cell feature data
+
+    RHICmdList.BeginComputePass(TEXT("WriteVoxelFeature"));
+    {
+        TShaderMapRef<FMSQStencilPolyWriteVoxelFeatureCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateDataSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("LineGeomData"), LineData.GeomSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("LineStateData"), LineData.StateSRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelFeatureData"), VoxelFeatureDataUAV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutDebugTexture"), DebugTextureUAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), VoxelDispatchOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), VoxelDispatchDim);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_StencilOp"), StencilOp);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), StencilFillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_OpFillType"), OpFillType);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineTransform"), LineTransform);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineTranslation"), LineTranslation);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_LineOffset"), LineOffset);
+        ComputeShader->DispatchAndClear(RHICmdList, VoxelDispatchDim.X, VoxelDispatchDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+
+    // Write voxel distance data, dispatched per packed voxel pair
+
+    if (Map.HasVoxelDistanceData_RT())
+    {
+        const int32  PairDispatchX = (DistanceDispatchOffset.X+DistanceDispatchDim.X+1)/2 - DistanceDispatchOffset.X/2;
+        const uint32 DistanceLayerCount = Map.GetDistanceLayerCount_RT();
+        const float  DistanceRange = Map.GetDistanceRange_RT();
+
+        FUnorderedAccessViewRHIParamRef VoxelDistanceDataUAV = Map.GetVoxelDistanceData().UAV;
+
+        // Bin stencil edge segments to the voxel tiles of each distance
+        // kernel group, grown by the distance range. Group tiles start at
+        // the voxel pair dispatch origin. Group size must match the distance
+        // kernel thread count.
+
+        const FIntPoint DistanceGroupSize(16, 16);
+
+        FTileBinParameter BinParameter;
+        BinParameter.Source    = TILE_BIN_SOURCE_EDGE;
+        BinParameter.ItemCount = LineData.Count;
+        BinParameter.TileSize  = FIntPoint(DistanceGroupSize.X*2, DistanceGroupSize.Y);
+        BinParameter.Origin    = FVector2D((DistanceDispatchOffset.X/2)*2, DistanceDispatchOffset.Y);
+        BinParameter.Range     = DistanceRange;
+        BinParameter.TileCount = FIntPoint(
+            FMath::DivideAndRoundUp<int32>(PairDispatchX, DistanceGroupSize.X),
+            FMath::DivideAndRoundUp<int32>(DistanceDispatchDim.Y, DistanceGroupSize.Y)
+            );
+        BinParameter.EntryBound = GetTileBinEntryBound(
+            LineData.EdgeSpanSum,
+            LineData.Count,
+            Transform.Scale.GetAbsMax(),
+            DistanceRange,
+            BinParameter.TileSize,
+            BinParameter.TileCount
+            );
+
+        BinParameter.ItemDataSRV0    = LineData.GeomSRV;
+        BinParameter.ItemDataSRV1    = LineData.StateSRV;
+        BinParameter.ItemDataOffset0 = LineData.GeomOffset;
+        BinParameter.ItemDataOffset1 = LineData.StateOffset;
+
+        BinTileItems_RT(DistanceTileBin, BinParameter, Transform);
+
+        const uint32 DistanceTileCountX = BinParameter.TileCount.X;
+
+        RHICmdList.BeginComputePass(TEXT("WriteVoxelDistance"));
+        {
+            TShaderMapRef<FMSQStencilPolyWriteVoxelDistanceCS> ComputeShader(RHIShaderMap);
+            ComputeShader->SetShader(RHICmdList);
+            ComputeShader->BindSRV(RHICmdList, TEXT("StencilTexture"), StencilTexture.SRV);
+            ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateDataSRV);
+            ComputeShader->BindSRV(RHICmdList, TEXT("LineGeomData"), LineData.GeomSRV);
+            ComputeShader->BindSRV(RHICmdList, TEXT("LineStateData"), LineData.StateSRV);
+            ComputeShader->BindSRV(RHICmdList, TEXT("TileBinOffsetData"), DistanceTileBin.OffsetData.SRV);
+            ComputeShader->BindSRV(RHICmdList, TEXT("TileBinItemData"), DistanceTileBin.ItemData.SRV);
+            ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelDistanceData"), VoxelDistanceDataUAV);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), DistanceDispatchOffset);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), DistanceDispatchDim);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_StencilRect"), StencilRect);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_StencilOffset"), StencilTextureOffset);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_StencilOp"), StencilOp);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), StencilFillType);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_OpFillType"), OpFillType);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_LineTransform"), LineTransform);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_LineTranslation"), LineTranslation);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceLayerCount"), DistanceLayerCount);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceRange"), DistanceRange);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_TileCountX"), DistanceTileCountX);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_LineOffset"), LineOffset);
+            ComputeShader->DispatchAndClear(RHICmdList, PairDispatchX, DistanceDispatchDim.Y, 1);
+        }
+        RHICmdList.EndComputePass();
+    }
+
+    Map.EndVoxelEdit_RT();
+}
+
+void FMarchingSquaresStencilPoly::ReleaseCachedResources_RT()
+{
+    CachedVertexData.Release();
+    CachedIndexData.Release();
+    CachedVertexCount = 0;
+    CachedIndexCount  = 0;
+    CachedLineCount   = 0;
+    CachedFillType    = 0;
+    CachedBounds = FBox2D(ForceInitToZero);
+    CachedSpanSum = FSpanSum();
+    CachedEdgeSpanSum = FSpanSum();
+
+    CachedLineGeomData.Release();
+    CachedLineStateData.Release();
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeatures_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, const FStencilOp& Op)
+{
+    check(IsInRenderingThread());
+    check(Map.HasValidDimension_RT());
+
+    RHICmdListPtr = &RHICmdList;
+    RHIShaderMap  = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    PrepareStencil_RT(Map);
+
+    // Intersect operation modifies voxels outside of the stencil, each fill
+    // type of the batch is intersected only with polys of the same fill
+    // type. Other operations draw the whole batch at once.
+
+    const bool bSplitFillTypes = (Op.Mode == STENCIL_OP_INTERSECT);
+
+    TArray<FStencilPolyData> BatchPolys;
+    Swap(BatchPolys, StencilPolys);
+
+    while (BatchPolys.Num() > 0)
+    {
+        const uint32 FillType = BatchPolys[0].FillType & LINE_STATE_FILL_TYPE_MASK;
+
+        if (bSplitFillTypes)
+        {
+            // Move polys of the fill type while keeping the draw order
+
+            for (int32 i=0; i<BatchPolys.Num(); )
+            {
+                if ((BatchPolys[i].FillType & LINE_STATE_FILL_TYPE_MASK) == FillType)
+                {
+                    StencilPolys.Emplace(MoveTemp(BatchPolys[i]));
+                    BatchPolys.RemoveAt(i, 1, false);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+        else
+        {
+            Swap(StencilPolys, BatchPolys);
+        }
+
+        // Draw stencil texture, skip voxel write if stencil does not cover the map
+
+        if (DrawStencil_RT())
+        {
+            WriteVoxelData_RT(Map, UploadLineData, FillType, FStencilTransform(), Op);
+        }
+
+        StencilPolys.Reset();
+    }
+
+    ReturnStencilTexture_RT();
+
+    StencilPolys.Reset();
+
+    RHICmdListPtr = nullptr;
+    RHIShaderMap  = nullptr;
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeaturesMulti_RT(
+    FRHICommandListImmediate& RHICmdList,
+    const TArray<FMarchingSquaresMap*>& Maps,
+    const TArray<uint32>& FillTypes,
+    const FStencilOp& Op
+    )
+{
+    check(IsInRenderingThread());
+    check(Maps.Num() > 0);
+    check(Maps.Num() == FillTypes.Num());
+    check(Maps[0]->HasValidDimension_RT());
+
+    RHICmdListPtr = &RHICmdList;
+    RHIShaderMap  = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    PrepareStencil_RT(*Maps[0]);
+
+    // Draw stencil texture and line geometry once with the first map fill
+    // type, then write voxel data of each map sharing the stencil texture
+
+    uint32 LineFillType = FillTypes[0];
+
+    for (FStencilPolyData& Poly : StencilPolys)
+    {
+        Poly.FillType = LineFillType;
+    }
+
+    if (DrawStencil_RT())
+    {
+        for (int32 i=0; i<Maps.Num(); ++i)
+        {
+            FMarchingSquaresMap& Map(*Maps[i]);
+
+            // Skip maps that no longer share the stencil dimension
+            if (! Map.HasValidDimension_RT() || Map.GetDimension_RT() != Dimension)
+            {
+                continue;
+            }
+
+            // Only line fill types differ between maps, rewrite line state
+            // data if the map fill type differs from the uploaded one
+
+            if (FillTypes[i] != LineFillType)
+            {
+                LineFillType = FillTypes[i];
+
+                for (FStencilPolyData& Poly : StencilPolys)
+                {
+                    Poly.FillType = LineFillType;
+                }
+
+                FLineStateData LineStateArr;
+                LineStateArr.SetNumZeroed(FMath::Max(1, GetLineDataCount(StencilPolys)));
+                BuildLineStateData(StencilPolys, LineStateArr);
+                UploadLineStateData_RT(LineStateArr);
+            }
+
+            WriteVoxelData_RT(Map, UploadLineData, LineFillType, FStencilTransform(), Op);
+        }
+    }
+
+    ReturnStencilTexture_RT();
+
+    StencilPolys.Reset();
+
+    RHICmdListPtr = nullptr;
+    RHIShaderMap  = nullptr;
+}
+
+void FMarchingSquaresStencilPoly::CacheStencilGeometry_RT(FCachedGeometryData& Geometry)
+{
+    check(IsInRenderingThread());
+
+    ReleaseCachedResources_RT();
+
+    CachedVertexCount = Geometry.Vertices.Num();
+    CachedIndexCount  = Geometry.Indices.Num();
+    CachedLineCount   = Geometry.LineGeomArr.Num();
+    CachedFillType    = Geometry.LineStateArr[0] & LINE_STATE_FILL_TYPE_MASK;
+    CachedBounds = Geometry.Bounds;
+    CachedSpanSum = Geometry.SpanSum;
+    CachedEdgeSpanSum = Geometry.EdgeSpanSum;
+
+    // Create vertex and index data, vertices are read as packed float3
+
+    CachedVertexData.Initialize(
+        sizeof(float),
+        Geometry.Vertices.Num()*3,
+        PF_R32_FLOAT,
+        &Geometry.Vertices,
+        BUF_Static,
+        TEXT("CachedVertexData")
+        );
+
+    CachedIndexData.Initialize(
+        sizeof(uint32),
+        Geometry.Indices.Num(),
+        PF_R32_UINT,
+        &Geometry.Indices,
+        BUF_Static,
+        TEXT("CachedIndexData")
+        );
 
-    FUnorderedAccessViewRHIRef& DebugTextureUAV(Map.GetDebugRTTUAV());
+    // Create line geom and line state data
+
+    CachedLineGeomData.Initialize(
+        sizeof(FLineGeomData::ElementType),
+        Geometry.LineGeomArr.Num(),
+        &Geometry.LineGeomArr,
+        BUF_Static,
+        TEXT("CachedLineGeomData")
+        );
 
-    FShaderResourceViewRHIParamRef LineGeomDataSRV = LineGeomData.SRV;
+    CachedLineStateData.Initialize(
+        sizeof(FLineStateData::ElementType),
+        Geometry.LineStateArr.Num(),
+        PF_R32_UINT,
+        &Geometry.LineStateArr,
+        BUF_Static,
+        TEXT("CachedLineStateData")
+        );
+}
 
-    // Write voxel state data
+void FMarchingSquaresStencilPoly::ApplyCachedStencil_RT(FRHICommandListImmediate& RHICmdList, FMarchingSquaresMap& Map, const FStencilTransform& Transform, const FStencilOp& Op)
+{
+    check(IsInRenderingThread());
+    check(Map.HasValidDimension_RT());
 
-    RHICmdList.BeginComputePass(TEXT("WriteVoxelState"));
+    if (! CachedVertexData.IsValid() || ! CachedIndexData.IsValid() || ! CachedLineGeomData.IsValid())
     {
-        TShaderMapRef<FMSQStencilPolyWriteVoxelStateCS> ComputeShader(RHIShaderMap);
-        ComputeShader->SetShader(RHICmdList);
-        ComputeShader->BindSRV(RHICmdList, TEXT("StencilTexture"), StencilTextureSRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("LineGeomData"), LineGeomDataSRV);
-        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelStateData"), VoxelStateDataUAV);
-        ComputeShader->BindUAV(RHICmdList, TEXT("OutDebugTexture"), DebugTextureUAV);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), FillType);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
-        ComputeShader->DispatchAndClear(RHICmdList, Dimension.X, Dimension.Y, 1);
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::ApplyCachedStencil_RT() ABORTED - No cached stencil geometry"));
+        return;
     }
-    RHICmdList.EndComputePass();
 
-    // Write cell feature data
+    RHICmdListPtr = &RHICmdList;
+    RHIShaderMap  = GetGlobalShaderMap(GMaxRHIFeatureLevel);
 
-    RHICmdList.BeginComputePass(TEXT("WriteVoxelFeature"));
+    PrepareStencil_RT(Map);
+
+    // Draw stencil texture, skip voxel write if stencil does not cover the map
+
+    if (DrawCachedStencil_RT(Transform))
     {
-        TShaderMapRef<FMSQStencilPolyWriteVoxelFeatureCS> ComputeShader(RHIShaderMap);
-        ComputeShader->SetShader(RHICmdList);
-        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateDataSRV);
-        ComputeShader->BindSRV(RHICmdList, TEXT("LineGeomData"), LineGeomDataSRV);
-        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelFeatureData"), VoxelFeatureDataUAV);
-        ComputeShader->BindUAV(RHICmdList, TEXT("OutDebugTexture"), DebugTextureUAV);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_FillType"), FillType);
-        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
-        ComputeShader->DispatchAndClear(RHICmdList, Dimension.X, Dimension.Y, 1);
+        FLineDataRef LineData;
+        LineData.GeomSRV     = CachedLineGeomData.SRV;
+        LineData.StateSRV    = CachedLineStateData.SRV;
+        LineData.Count       = CachedLineCount;
+        LineData.EdgeSpanSum = CachedEdgeSpanSum;
+
+        WriteVoxelData_RT(Map, LineData, CachedFillType, Transform, Op);
     }
-    RHICmdList.EndComputePass();
 
-    LineGeomData.Release();
+    ReturnStencilTexture_RT();
 
     RHICmdListPtr = nullptr;
     RHIShaderMap  = nullptr;
@@ -685,25 +1951,136 @@ void FMarchingSquaresStencilPoly::ClearStencil_RT(FRHICommandListImmediate& RHIC
     VoxelCount = 0;
 
     ReleaseResources_RT();
+    ReleaseUploadResources_RT();
+    ReleaseCachedResources_RT();
 }
 
 void FMarchingSquaresStencilPoly::GenerateVoxelFeatures(const FGenerateVoxelFeatureParameter& Parameter)
+{
+    FGenerateVoxelFeatureBatchParameter BatchParameter;
+    BatchParameter.Map = Parameter.Map;
+    BatchParameter.SimplifyTolerance = Parameter.SimplifyTolerance;
+    BatchParameter.Op = Parameter.Op;
+    BatchParameter.Polys.Emplace(FStencilPolyData({ Parameter.FillType, Parameter.StencilPoints, Parameter.StencilEdgeRadius }));
+
+    GenerateVoxelFeatures(BatchParameter);
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeatures(const FGenerateVoxelFeatureBatchParameter& Parameter)
 {
     check(Parameter.Map != nullptr);
     check(Parameter.Map->HasValidDimension());
 
-    Parameter.Map->InitializeVoxelData();
+    TArray<FStencilPolyData> Polys;
+    FilterStencilPolys(Parameter.Polys, Parameter.SimplifyTolerance, Polys);
+
+    if (Polys.Num() < 1)
+    {
+        return;
+    }
+
+    FMarchingSquaresMap* Map(Parameter.Map);
+    Map->InitializeVoxelData();
 
     FMarchingSquaresStencilPoly* Stencil(this);
+    FStencilOp Op(Parameter.Op);
+    bool bTileScratch = bTileScratchTexture;
     ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_GenerateVoxelFeatures)(
-        [Stencil, Parameter](FRHICommandListImmediate& RHICmdList)
+        [Stencil, Map, Polys, Op, bTileScratch](FRHICommandListImmediate& RHICmdList)
+        {
+            Stencil->StencilPolys = Polys;
+            Stencil->bTileScratchTexture_RT = bTileScratch;
+            Stencil->GenerateVoxelFeatures_RT(RHICmdList, *Map, Op);
+        } );
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeatures(const FGenerateVoxelFeaturePolylineParameter& Parameter)
+{
+    // Polylines are applied as a batch of stroke band outline polys
+
+    FGenerateVoxelFeatureBatchParameter BatchParameter;
+    BatchParameter.Map = Parameter.Map;
+    BatchParameter.Op = Parameter.Op;
+    BatchParameter.Polys.Reserve(Parameter.Polylines.Num());
+
+    for (const FStencilPolylineData& Polyline : Parameter.Polylines)
+    {
+        FStencilPolyData Poly;
+
+        if (BuildPolylineOutline(Polyline, Poly))
+        {
+            BatchParameter.Polys.Emplace(MoveTemp(Poly));
+        }
+    }
+
+    if (BatchParameter.Polys.Num() > 0)
+    {
+        GenerateVoxelFeatures(BatchParameter);
+    }
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeatures(const FGenerateVoxelFeatureMultiParameter& Parameter)
+{
+    check(Parameter.Maps.Num() == Parameter.FillTypes.Num());
+
+    TArray<FStencilPolyData> Polys;
+    TArray<FStencilPolyData> SourcePolys;
+    SourcePolys.Emplace(FStencilPolyData({ 0, Parameter.StencilPoints, Parameter.StencilEdgeRadius }));
+    FilterStencilPolys(SourcePolys, Parameter.SimplifyTolerance, Polys);
+
+    if (Polys.Num() < 1)
+    {
+        return;
+    }
+
+    // Filter out invalid maps and maps that do not match the first map
+    // dimension, all target maps share the same stencil texture
+
+    TArray<FMarchingSquaresMap*> Maps;
+    TArray<uint32> FillTypes;
+
+    for (int32 i=0; i<Parameter.Maps.Num(); ++i)
+    {
+        FMarchingSquaresMap* Map(Parameter.Maps[i]);
+
+        if (! Map || ! Map->HasValidDimension())
+        {
+            continue;
+        }
+
+        if (Maps.Num() > 0 && Map->GetDimension() != Maps[0]->GetDimension())
+        {
+            UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::GenerateVoxelFeatures() Target map dimension does not match the first target map, map is skipped"));
+            continue;
+        }
+
+        Map->InitializeVoxelData();
+
+        Maps.Emplace(Map);
+        FillTypes.Emplace(Parameter.FillTypes[i]);
+    }
+
+    if (Maps.Num() < 1)
+    {
+        return;
+    }
+
+    FMarchingSquaresStencilPoly* Stencil(this);
+    FStencilOp Op(Parameter.Op);
+    bool bTileScratch = bTileScratchTexture;
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_GenerateVoxelFeaturesMulti)(
+        [Stencil, Maps, FillTypes, Polys, Op, bTileScratch](FRHICommandListImmediate& RHICmdList)
         {
-            Stencil->GenerateVoxelFeatures_RT(RHICmdList, Parameter);
+            Stencil->StencilPolys = Polys;
+            Stencil->bTileScratchTexture_RT = bTileScratch;
+            Stencil->GenerateVoxelFeaturesMulti_RT(RHICmdList, Maps, FillTypes, Op);
         } );
 }
 
 void FMarchingSquaresStencilPoly::ClearStencil()
 {
+    bHasCachedGeometry = false;
+
     FMarchingSquaresStencilPoly* Stencil(this);
     ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_GenerateVoxelFeatures)(
         [Stencil](FRHICommandListImmediate& RHICmdList)
@@ -712,6 +2089,149 @@ void FMarchingSquaresStencilPoly::ClearStencil()
         } );
 }
 
+void FMarchingSquaresStencilPoly::CacheStencilGeometry(const FStencilPolyData& Poly, float SimplifyTolerance)
+{
+    FStencilPolyData PolyData;
+
+    if (! FilterStencilPoly(Poly, SimplifyTolerance, PolyData))
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::CacheStencilGeometry() ABORTED - Invalid stencil points"));
+        return;
+    }
+
+    const int32 PointCount = PolyData.StencilPoints.Num();
+    const int32 LineDataCount = PointCount + 1;
+
+    if (LineDataCount > (MAX_LINE_ID+1))
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::CacheStencilGeometry() ABORTED - Stencil exceeds maximum line count"));
+        return;
+    }
+
+    // Construct local space stencil geometry, uses the same line layout as
+    // a single poly batch: [Header] [Line 1..N]
+
+    FCachedGeometryData Geometry;
+    Geometry.LineGeomArr.SetNumZeroed(LineDataCount);
+    Geometry.LineStateArr.SetNumZeroed(LineDataCount);
+
+    TArray<FVector> Vertices;
+    TArray<int32> Indices;
+
+    BuildStencilMask(PolyData, 0, Vertices, Indices);
+    BuildStencilEdge(PolyData, 0, Vertices, Indices, Geometry.LineGeomArr);
+
+    // No geometry to draw, abort
+    if (Indices.Num() < 3)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::CacheStencilGeometry() ABORTED - Empty stencil geometry"));
+        return;
+    }
+
+    const uint32 FillType = PolyData.FillType & LINE_STATE_FILL_TYPE_MASK;
+
+    Geometry.LineStateArr[0] = FillType;
+
+    for (int32 i=1; i<=PointCount; ++i)
+    {
+        Geometry.LineStateArr[i] = FillType | LINE_STATE_EDGE_FLAG;
+    }
+
+    Geometry.Bounds = FBox2D(ForceInitToZero);
+    Geometry.SpanSum = GetTriangleSpanSum(Vertices, Indices);
+    Geometry.EdgeSpanSum = GetEdgeSpanSum(Geometry.LineGeomArr, Geometry.LineStateArr);
+    Geometry.Vertices.Reserve(Vertices.Num());
+    Geometry.Indices.Reserve(Indices.Num());
+
+    for (const FVector& Vertex : Vertices)
+    {
+        Geometry.Vertices.Emplace(Vertex);
+        Geometry.Bounds += FVector2D(Vertex);
+    }
+
+    for (int32 Index : Indices)
+    {
+        Geometry.Indices.Emplace(Index);
+    }
+
+    bHasCachedGeometry = true;
+
+    FMarchingSquaresStencilPoly* Stencil(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_CacheStencilGeometry)(
+        [Stencil, Geometry](FRHICommandListImmediate& RHICmdList) mutable
+        {
+            Stencil->CacheStencilGeometry_RT(Geometry);
+        } );
+}
+
+void FMarchingSquaresStencilPoly::ApplyCachedStencil(const FApplyCachedStencilParameter& Parameter)
+{
+    check(Parameter.Map != nullptr);
+    check(Parameter.Map->HasValidDimension());
+
+    if (! bHasCachedGeometry)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::ApplyCachedStencil() ABORTED - No cached stencil geometry"));
+        return;
+    }
+
+    FMarchingSquaresMap* Map(Parameter.Map);
+    Map->InitializeVoxelData();
+
+    FMarchingSquaresStencilPoly* Stencil(this);
+    FStencilTransform Transform(Parameter.Transform);
+    FStencilOp Op(Parameter.Op);
+    bool bTileScratch = bTileScratchTexture;
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_ApplyCachedStencil)(
+        [Stencil, Map, Transform, Op, bTileScratch](FRHICommandListImmediate& RHICmdList)
+        {
+            Stencil->bTileScratchTexture_RT = bTileScratch;
+            Stencil->ApplyCachedStencil_RT(RHICmdList, *Map, Transform, Op);
+        } );
+}
+
+void FMarchingSquaresStencilPoly::ClearCachedStencil()
+{
+    bHasCachedGeometry = false;
+
+    FMarchingSquaresStencilPoly* Stencil(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_ClearCachedStencil)(
+        [Stencil](FRHICommandListImmediate& RHICmdList)
+        {
+            Stencil->ReleaseCachedResources_RT();
+        } );
+}
+
+FMarchingSquaresStencilPoly::FStencilOp UMarchingSquaresStencilPolyRef::GetStencilOp() const
+{
+    typedef FMarchingSquaresStencilPoly FStencilType;
+
+    FStencilType::FStencilOp Op;
+    Op.OpFillType = FMath::Clamp(OpFillType, 0, 255);
+
+    switch (StencilOp)
+    {
+        case EMarchingSquaresStencilOp::Subtract:
+            Op.Mode = FStencilType::STENCIL_OP_SUBTRACT;
+            break;
+
+        case EMarchingSquaresStencilOp::Intersect:
+            Op.Mode = FStencilType::STENCIL_OP_INTERSECT;
+            break;
+
+        case EMarchingSquaresStencilOp::Replace:
+            Op.Mode = FStencilType::STENCIL_OP_REPLACE;
+            break;
+
+        case EMarchingSquaresStencilOp::Union:
+        default:
+            Op.Mode = FStencilType::STENCIL_OP_UNION;
+            break;
+    }
+
+    return Op;
+}
+
 void UMarchingSquaresStencilPolyRef::ClearStencil()
 {
     Stencil.ClearStencil();
@@ -731,7 +2251,200 @@ void UMarchingSquaresStencilPolyRef::ApplyStencilToMap(UMarchingSquaresMapRef* M
 
         typedef FMarchingSquaresStencilPoly::FGenerateVoxelFeatureParameter FParameterType;
 
-        FParameterType Parameter( { &Map, uFillType, StencilPoints, StencilEdgeRadius } );
+        FParameterType Parameter( { &Map, uFillType, StencilPoints, StencilEdgeRadius, SimplifyTolerance, GetStencilOp() } );
+        Stencil.SetTileScratchTexture(bUseTileScratchTexture);
+        Stencil.GenerateVoxelFeatures(Parameter);
+    }
+}
+
+void UMarchingSquaresStencilPolyRef::ApplyStencilToMaps(const TArray<UMarchingSquaresMapRef*>& MapRefs, const TArray<int32>& FillTypes)
+{
+    if (StencilPoints.Num() < 1 || StencilEdgeRadius <= KINDA_SMALL_NUMBER || FillTypes.Num() < 1)
+    {
+        return;
+    }
+
+    typedef FMarchingSquaresStencilPoly::FGenerateVoxelFeatureMultiParameter FParameterType;
+
+    FParameterType Parameter;
+    Parameter.StencilPoints = StencilPoints;
+    Parameter.StencilEdgeRadius = StencilEdgeRadius;
+    Parameter.SimplifyTolerance = SimplifyTolerance;
+    Parameter.Op = GetStencilOp();
+
+    // Single fill type is applied to all maps, otherwise fill types are
+    // matched to maps by index
+
+    for (int32 i=0; i<MapRefs.Num(); ++i)
+    {
+        UMarchingSquaresMapRef* MapRef(MapRefs[i]);
+        const int32 FillType = (FillTypes.Num() == 1) ? FillTypes[0] : (FillTypes.IsValidIndex(i) ? FillTypes[i] : -1);
+
+        if (FillType >= 0 && IsValid(MapRef) && MapRef->HasValidMap())
+        {
+            Parameter.Maps.Emplace(&MapRef->GetMap());
+            Parameter.FillTypes.Emplace(FillType);
+        }
+    }
+
+    if (Parameter.Maps.Num() > 0)
+    {
+        Stencil.SetTileScratchTexture(bUseTileScratchTexture);
+        Stencil.GenerateVoxelFeatures(Parameter);
+    }
+}
+
+void UMarchingSquaresStencilPolyRef::ApplyStencilToMapCPU(UMarchingSquaresMapRef* MapRef, int32 FillType)
+{
+    if (FillType >= 0                           &&
+        StencilPoints.Num() > 0                 &&
+        StencilEdgeRadius > KINDA_SMALL_NUMBER  &&
+        IsValid(MapRef)                         &&
+        MapRef->HasValidMap()
+        )
+    {
+        FMarchingSquaresMap& Map(MapRef->GetMap());
+        uint32 uFillType = FMath::Max(0, FillType);
+
+        typedef FMarchingSquaresStencilPoly::FGenerateVoxelFeatureParameter FParameterType;
+
+        FParameterType Parameter( { &Map, uFillType, StencilPoints, StencilEdgeRadius, SimplifyTolerance, GetStencilOp() } );
+        Stencil.GenerateVoxelFeaturesCPU(Parameter);
+    }
+}
+
+void UMarchingSquaresStencilPolyRef::ApplyStencilBatchToMap(UMarchingSquaresMapRef* MapRef, const TArray<FMarchingSquaresStencilPolyEntry>& Entries)
+{
+    if (! IsValid(MapRef) || ! MapRef->HasValidMap())
+    {
+        return;
+    }
+
+    typedef FMarchingSquaresStencilPoly::FGenerateVoxelFeatureBatchParameter FParameterType;
+    typedef FMarchingSquaresStencilPoly::FStencilPolyData FPolyType;
+
+    FParameterType Parameter;
+    Parameter.Map = &MapRef->GetMap();
+    Parameter.Polys.Reserve(Entries.Num());
+    Parameter.SimplifyTolerance = SimplifyTolerance;
+    Parameter.Op = GetStencilOp();
+
+    for (const FMarchingSquaresStencilPolyEntry& Entry : Entries)
+    {
+        if (Entry.FillType >= 0                         &&
+            Entry.StencilPoints.Num() > 0               &&
+            Entry.StencilEdgeRadius > KINDA_SMALL_NUMBER
+            )
+        {
+            uint32 uFillType = FMath::Max(0, Entry.FillType);
+            Parameter.Polys.Emplace(FPolyType({ uFillType, Entry.StencilPoints, Entry.StencilEdgeRadius }));
+        }
+    }
+
+    if (Parameter.Polys.Num() > 0)
+    {
+        Stencil.SetTileScratchTexture(bUseTileScratchTexture);
+        Stencil.GenerateVoxelFeatures(Parameter);
+    }
+}
+
+void UMarchingSquaresStencilPolyRef::ApplyPolylineStencilToMap(UMarchingSquaresMapRef* MapRef, const TArray<FMarchingSquaresStencilPolylineEntry>& Entries)
+{
+    if (StencilEdgeRadius <= KINDA_SMALL_NUMBER || ! IsValid(MapRef) || ! MapRef->HasValidMap())
+    {
+        return;
+    }
+
+    typedef FMarchingSquaresStencilPoly FStencilType;
+    typedef FMarchingSquaresStencilPoly::FGenerateVoxelFeaturePolylineParameter FParameterType;
+    typedef FMarchingSquaresStencilPoly::FStencilPolylineData FPolylineType;
+
+    auto GetCapMode = [](EMarchingSquaresStencilCap Cap)
+    {
+        switch (Cap)
+        {
+            case EMarchingSquaresStencilCap::Square: return FStencilType::STENCIL_CAP_SQUARE;
+            case EMarchingSquaresStencilCap::Round:  return FStencilType::STENCIL_CAP_ROUND;
+
+            case EMarchingSquaresStencilCap::Butt:
+            default:
+                return FStencilType::STENCIL_CAP_BUTT;
+        }
+    };
+
+    FParameterType Parameter;
+    Parameter.Map = &MapRef->GetMap();
+    Parameter.Polylines.Reserve(Entries.Num());
+    Parameter.Op = GetStencilOp();
+
+    for (const FMarchingSquaresStencilPolylineEntry& Entry : Entries)
+    {
+        if (Entry.FillType >= 0 && Entry.Points.Num() > 1)
+        {
+            FPolylineType Polyline;
+            Polyline.FillType = FMath::Max(0, Entry.FillType);
+            Polyline.Points = Entry.Points;
+            Polyline.Widths = Entry.Widths;
+            Polyline.Width = Entry.Width;
+            Polyline.StartCap = GetCapMode(Entry.StartCap);
+            Polyline.EndCap = GetCapMode(Entry.EndCap);
+            Polyline.StencilEdgeRadius = StencilEdgeRadius;
+
+            Parameter.Polylines.Emplace(MoveTemp(Polyline));
+        }
+    }
+
+    if (Parameter.Polylines.Num() > 0)
+    {
+        Stencil.SetTileScratchTexture(bUseTileScratchTexture);
         Stencil.GenerateVoxelFeatures(Parameter);
     }
 }
+
+void UMarchingSquaresStencilPolyRef::CacheStencil(int32 FillType)
+{
+    if (FillType >= 0                           &&
+        StencilPoints.Num() >= 3                &&
+        StencilEdgeRadius > KINDA_SMALL_NUMBER
+        )
+    {
+        uint32 uFillType = FMath::Max(0, FillType);
+
+        typedef FMarchingSquaresStencilPoly::FStencilPolyData FPolyType;
+
+        FPolyType Poly( { uFillType, StencilPoints, StencilEdgeRadius } );
+        Stencil.CacheStencilGeometry(Poly, SimplifyTolerance);
+    }
+}
+
+void UMarchingSquaresStencilPolyRef::ClearCachedStencil()
+{
+    Stencil.ClearCachedStencil();
+}
+
+bool UMarchingSquaresStencilPolyRef::HasCachedStencil() const
+{
+    return Stencil.HasCachedStencil();
+}
+
+void UMarchingSquaresStencilPolyRef::ApplyCachedStencilToMap(UMarchingSquaresMapRef* MapRef, FVector2D Location, float Rotation, FVector2D Scale)
+{
+    if (Stencil.HasCachedStencil()  &&
+        IsValid(MapRef)             &&
+        MapRef->HasValidMap()
+        )
+    {
+        typedef FMarchingSquaresStencilPoly::FApplyCachedStencilParameter FParameterType;
+
+        FParameterType Parameter;
+        Parameter.Map = &MapRef->GetMap();
+        Parameter.Transform.Translation = Location;
+        Parameter.Transform.Rotation = Rotation;
+        Parameter.Transform.Scale.X = FMath::Max(FMath::Abs(Scale.X), KINDA_SMALL_NUMBER);
+        Parameter.Transform.Scale.Y = FMath::Max(FMath::Abs(Scale.Y), KINDA_SMALL_NUMBER);
+        Parameter.Op = GetStencilOp();
+
+        Stencil.SetTileScratchTexture(bUseTileScratchTexture);
+        Stencil.ApplyCachedStencil(Parameter);
+    }
+}
@@ -0,0 +1,1546 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresStencilPoly.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderingThread.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+
+// CPU stencil implementation
+//
+// Follows the stencil rasterizer, VoxelWriteStateKernel,
+// VoxelWriteFeatureKernel and VoxelWriteDistanceKernel of
+// MarchingSquaresStencilPolyCS.usf in kernel operation order. Row bands are
+// processed in parallel, voxels within a row are processed four lanes at a
+// time with engine vector registers.
+//
+// Voxel state and feature words are identical to the GPU path. Coverage,
+// line side and edge crossing terms are evaluated with the same operation
+// order as the kernels, which evaluate them without contraction, and edge
+// features are quantized without division or transcendental functions,
+// see MarchingSquaresStencilCommon.ush. Voxel distance words follow the
+// distance kernel but are not guaranteed to be identical.
+
+namespace MarchingSquaresStencilPolyCPU
+{
+    // Number of voxel rows processed per parallel task
+    enum { ROW_BAND_SIZE = 16 };
+
+    // Number of voxels processed per vector register
+    enum { LANE_COUNT = 4 };
+
+    // Voxel distance tile width, edge segments are binned per tile
+    enum { DISTANCE_TILE_SIZE = 16 };
+
+    // Stencil fill flag of the state pass fill data, stored along with the
+    // voxel fill type for the distance pass
+    enum { STENCIL_FILL_FLAG = 0x100 };
+
+    // Voxel line sign tests, origin (xy) and orthogonal direction (zw).
+    // See VoxelWriteStateKernel for the line points layout.
+    //
+    // 0: L12, 1: L41, 2: L25, 3: AL1, 4: A41, 5: LB2 (voxel, origin L2),
+    // 6: B25, 7: LB2 (cell center, origin B2)
+    struct FLineSignData
+    {
+        FVector4 Tests[8];
+    };
+
+    // Line segments A1-L1, L1-L2 and L2-B2, start (xy) and end (zw)
+    struct FLineSegmentData
+    {
+        FVector4 Segments[3];
+    };
+
+    enum { FEATURE_APPLY_X = 1 };
+    enum { FEATURE_APPLY_Y = 2 };
+
+    FORCEINLINE int32 GetRowBandCount(int32 RowCount)
+    {
+        return (RowCount + ROW_BAND_SIZE - 1) / ROW_BAND_SIZE;
+    }
+
+    FORCEINLINE int32 GetLaneMask(int32 LaneCount)
+    {
+        return (1 << FMath::Min<int32>(LaneCount, LANE_COUNT)) - 1;
+    }
+
+    FORCEINLINE VectorRegister GetLaneOffsets()
+    {
+        return MakeVectorRegister(0.f, 1.f, 2.f, 3.f);
+    }
+
+    FORCEINLINE FVector2D Ortho(const FVector2D& V)
+    {
+        return FVector2D(-V.Y, V.X);
+    }
+
+    // Transpose lane records into per-component registers
+    FORCEINLINE void TransposeLanes(
+        const FVector4& R0,
+        const FVector4& R1,
+        const FVector4& R2,
+        const FVector4& R3,
+        VectorRegister& OutX,
+        VectorRegister& OutY,
+        VectorRegister& OutZ,
+        VectorRegister& OutW
+        )
+    {
+        const VectorRegister V0 = VectorLoad(&R0);
+        const VectorRegister V1 = VectorLoad(&R1);
+        const VectorRegister V2 = VectorLoad(&R2);
+        const VectorRegister V3 = VectorLoad(&R3);
+
+        const VectorRegister T0 = VectorShuffle(V0, V1, 0, 1, 0, 1);
+        const VectorRegister T1 = VectorShuffle(V2, V3, 0, 1, 0, 1);
+        const VectorRegister T2 = VectorShuffle(V0, V1, 2, 3, 2, 3);
+        const VectorRegister T3 = VectorShuffle(V2, V3, 2, 3, 2, 3);
+
+        OutX = VectorShuffle(T0, T1, 0, 2, 0, 2);
+        OutY = VectorShuffle(T0, T1, 1, 3, 1, 3);
+        OutZ = VectorShuffle(T2, T3, 0, 2, 0, 2);
+        OutW = VectorShuffle(T2, T3, 1, 3, 1, 3);
+    }
+
+    // Returns lane mask of dot(P-Origin, OrthoDir) >= 0
+    FORCEINLINE int32 GetOrthoSgnMask(
+        const VectorRegister& PX,
+        const VectorRegister& PY,
+        const VectorRegister& OX,
+        const VectorRegister& OY,
+        const VectorRegister& NX,
+        const VectorRegister& NY
+        )
+    {
+        const VectorRegister Dot = VectorAdd(
+            VectorMultiply(VectorSubtract(PX, OX), NX),
+            VectorMultiply(VectorSubtract(PY, OY), NY)
+            );
+        return VectorMaskBits(VectorCompareGE(Dot, VectorZero()));
+    }
+
+    // Returns voxel edge crossing lane mask of lane line segments, see
+    // GetEdgeCrossing() of MarchingSquaresStencilPolyCS.usf. Voxel edge
+    // starts at (PX, PY) along the unit axis (0: x, 1: y). Crossing
+    // fraction is written as numerator over positive denominator.
+    FORCEINLINE VectorRegister GetEdgeCrossing(
+        const VectorRegister& PX,
+        const VectorRegister& PY,
+        int32 Axis,
+        const VectorRegister& SX,
+        const VectorRegister& SY,
+        const VectorRegister& EX,
+        const VectorRegister& EY,
+        VectorRegister& OutNum,
+        VectorRegister& OutDen
+        )
+    {
+        const VectorRegister Zero = VectorZero();
+
+        const VectorRegister VX = VectorSubtract(EX, SX);
+        const VectorRegister VY = VectorSubtract(EY, SY);
+        const VectorRegister DX = VectorSubtract(PX, SX);
+        const VectorRegister DY = VectorSubtract(PY, SY);
+
+        // Cross products of the unit axis with the segment and start delta
+
+        VectorRegister Den  = Axis ? VectorNegate(VX) : VY;
+        VectorRegister SNum = Axis ? VectorNegate(DX) : DY;
+        VectorRegister TNum = VectorSubtract(VectorMultiply(VX, DY), VectorMultiply(VY, DX));
+
+        const VectorRegister bNegative = VectorCompareGT(Zero, Den);
+
+        Den  = VectorSelect(bNegative, VectorNegate(Den), Den);
+        SNum = VectorSelect(bNegative, VectorNegate(SNum), SNum);
+        TNum = VectorSelect(bNegative, VectorNegate(TNum), TNum);
+
+        // Parallel segments are invalidated as if cross product is zero
+
+        const VectorRegister bValidDen = VectorCompareGE(Den, VectorSetFloat1(.0001f));
+        const VectorRegister bCrossS = VectorBitwiseAnd(VectorCompareGE(SNum, Zero), VectorCompareGE(Den, SNum));
+        const VectorRegister bCrossT = VectorBitwiseAnd(VectorCompareGE(TNum, Zero), VectorCompareGE(Den, TNum));
+
+        OutNum = TNum;
+        OutDen = Den;
+
+        return VectorBitwiseAnd(bValidDen, VectorBitwiseAnd(bCrossS, bCrossT));
+    }
+
+    // Finds the nearest voxel edge crossing of the line segments of each
+    // lane, see FindEdgeCrossing(). Writes UN8 crossing alpha and line
+    // segment index per lane and returns the crossing lane mask.
+    int32 FindEdgeCrossing(
+        const VectorRegister& PX,
+        const VectorRegister& PY,
+        int32 Axis,
+        const FLineSegmentData* const Lines[LANE_COUNT],
+        uint32 OutAlpha[LANE_COUNT],
+        int32 OutSegment[LANE_COUNT]
+        )
+    {
+        VectorRegister Num = VectorZero();
+        VectorRegister Den = VectorOne();
+        VectorRegister Hit = VectorZero();
+
+        for (int32 i=0; i<LANE_COUNT; ++i)
+        {
+            OutSegment[i] = 0;
+        }
+
+        for (int32 k=0; k<3; ++k)
+        {
+            VectorRegister SX, SY, EX, EY;
+
+            TransposeLanes(
+                Lines[0]->Segments[k],
+                Lines[1]->Segments[k],
+                Lines[2]->Segments[k],
+                Lines[3]->Segments[k],
+                SX, SY, EX, EY
+                );
+
+            VectorRegister SegmentNum;
+            VectorRegister SegmentDen;
+            const VectorRegister SegmentHit = GetEdgeCrossing(PX, PY, Axis, SX, SY, EX, EY, SegmentNum, SegmentDen);
+
+            // Take the first crossing or a nearer one, crossing fractions
+            // are compared by cross multiplication
+
+            const VectorRegister bNoHit   = VectorCompareEQ(Hit, VectorZero());
+            const VectorRegister bNearer  = VectorCompareGT(VectorMultiply(Num, SegmentDen), VectorMultiply(SegmentNum, Den));
+            const VectorRegister bTake    = VectorBitwiseAnd(SegmentHit, VectorBitwiseOr(bNearer, bNoHit));
+            const int32 TakeMask = VectorMaskBits(bTake);
+
+            Num = VectorSelect(bTake, SegmentNum, Num);
+            Den = VectorSelect(bTake, SegmentDen, Den);
+            Hit = VectorBitwiseOr(Hit, SegmentHit);
+
+            for (int32 i=0; i<LANE_COUNT; ++i)
+            {
+                OutSegment[i] = ((TakeMask >> i) & 1) ? k : OutSegment[i];
+            }
+        }
+
+        // Quantize crossing alpha, see QuantizeCrossingAlphaUN8()
+
+        const VectorRegister ScaledNum = VectorMultiply(VectorSetFloat1(255.f), Num);
+
+        VectorRegister Alpha = VectorZero();
+
+        for (int32 Step=128; Step>0; Step>>=1)
+        {
+            const VectorRegister A = VectorAdd(Alpha, VectorSetFloat1(float(Step)));
+            const VectorRegister ScaledDen = VectorMultiply(A, Den);
+            Alpha = VectorSelect(VectorCompareGE(ScaledNum, ScaledDen), A, Alpha);
+        }
+
+        float LaneAlpha[LANE_COUNT];
+        VectorStore(Alpha, LaneAlpha);
+
+        for (int32 i=0; i<LANE_COUNT; ++i)
+        {
+            OutAlpha[i] = uint32(LaneAlpha[i]);
+        }
+
+        return VectorMaskBits(Hit);
+    }
+
+    // Returns squared distance of point P to each lane segment, see
+    // ClosestPointOnSegment() of MarchingSquaresStencilPolyCS.usf
+    FORCEINLINE VectorRegister GetSegmentDistanceSquared(
+        const VectorRegister& PX,
+        const VectorRegister& PY,
+        const VectorRegister& SX,
+        const VectorRegister& SY,
+        const VectorRegister& EX,
+        const VectorRegister& EY
+        )
+    {
+        const VectorRegister P01X = VectorSubtract(EX, SX);
+        const VectorRegister P01Y = VectorSubtract(EY, SY);
+        const VectorRegister P0TX = VectorSubtract(PX, SX);
+        const VectorRegister P0TY = VectorSubtract(PY, SY);
+
+        const VectorRegister Dot1 = VectorAdd(VectorMultiply(P0TX, P01X), VectorMultiply(P0TY, P01Y));
+        const VectorRegister Dot2 = VectorAdd(VectorMultiply(P01X, P01X), VectorMultiply(P01Y, P01Y));
+        const VectorRegister Ratio = VectorDivide(Dot1, Dot2);
+
+        VectorRegister SPX = VectorAdd(SX, VectorMultiply(P01X, Ratio));
+        VectorRegister SPY = VectorAdd(SY, VectorMultiply(P01Y, Ratio));
+
+        // Clamp to the segment end points, start point takes precedence
+
+        const VectorRegister bEnd   = VectorCompareGE(Dot1, Dot2);
+        const VectorRegister bStart = VectorCompareGE(VectorZero(), Dot1);
+
+        SPX = VectorSelect(bStart, SX, VectorSelect(bEnd, EX, SPX));
+        SPY = VectorSelect(bStart, SY, VectorSelect(bEnd, EY, SPY));
+
+        const VectorRegister DX = VectorSubtract(PX, SPX);
+        const VectorRegister DY = VectorSubtract(PY, SPY);
+
+        return VectorAdd(VectorMultiply(DX, DX), VectorMultiply(DY, DY));
+    }
+
+    // Stencil operation functions, see MarchingSquaresStencilCommon.ush
+
+    uint32 ApplyStencilOpState(uint32 LastState, bool bInside, uint32 FillType, uint32 Op, uint32 OpFillType)
+    {
+        uint32 State = LastState;
+
+        switch (Op)
+        {
+            case FMarchingSquaresStencilPoly::STENCIL_OP_UNION:
+                State = bInside ? FillType : LastState;
+                break;
+
+            case FMarchingSquaresStencilPoly::STENCIL_OP_SUBTRACT:
+                State = (bInside && LastState == FillType) ? OpFillType : LastState;
+                break;
+
+            case FMarchingSquaresStencilPoly::STENCIL_OP_INTERSECT:
+                State = (! bInside && LastState == FillType) ? OpFillType : LastState;
+                break;
+
+            case FMarchingSquaresStencilPoly::STENCIL_OP_REPLACE:
+                State = (bInside && LastState == OpFillType) ? FillType : LastState;
+                break;
+        }
+
+        return State;
+    }
+
+    FORCEINLINE uint32 GetStencilOpEdgeFillType(uint32 Op, uint32 FillType, uint32 OpFillType)
+    {
+        return (Op == FMarchingSquaresStencilPoly::STENCIL_OP_SUBTRACT || Op == FMarchingSquaresStencilPoly::STENCIL_OP_INTERSECT) ? OpFillType : FillType;
+    }
+
+    bool IsStencilOpEdge(uint32 s0, uint32 s1, uint32 Op, uint32 FillType, uint32 OpFillType)
+    {
+        bool bIsOpEdge = true;
+
+        if (Op == FMarchingSquaresStencilPoly::STENCIL_OP_SUBTRACT || Op == FMarchingSquaresStencilPoly::STENCIL_OP_INTERSECT)
+        {
+            bIsOpEdge = (s0 == FillType) || (s1 == FillType);
+        }
+        else
+        if (Op == FMarchingSquaresStencilPoly::STENCIL_OP_REPLACE)
+        {
+            bIsOpEdge = (s0 == OpFillType) || (s1 == OpFillType);
+        }
+
+        return bIsOpEdge;
+    }
+
+    bool ShouldApplyEdgeCrossing(uint32 uEdge, uint32 s0, uint32 s1, uint32 FillType, uint32 Alpha)
+    {
+        bool bApply = false;
+
+        if (s0 != s1)
+        {
+            if (s0 == FillType)
+            {
+                bApply = (uEdge == 0xFFFF) || ((uEdge & 0xFF) < Alpha);
+            }
+            else
+            if (s1 == FillType)
+            {
+                bApply = (uEdge == 0xFFFF) || ((uEdge & 0xFF) > Alpha);
+            }
+        }
+
+        return bApply;
+    }
+
+    float CombineStencilOpDistance(float vd, float vdFill, float vdOp, float d, bool bFillLayer, bool bOpLayer, uint32 Op)
+    {
+        float cd = vd;
+
+        switch (Op)
+        {
+            case FMarchingSquaresStencilPoly::STENCIL_OP_UNION:
+                cd = bFillLayer ? FMath::Min(vd, d) : FMath::Max(vd, -d);
+                break;
+
+            case FMarchingSquaresStencilPoly::STENCIL_OP_SUBTRACT:
+                cd = bFillLayer ? FMath::Max(vd, -d) : (bOpLayer ? FMath::Min(vd, FMath::Max(vdFill, d)) : vd);
+                break;
+
+            case FMarchingSquaresStencilPoly::STENCIL_OP_INTERSECT:
+                cd = bFillLayer ? FMath::Max(vd, d) : (bOpLayer ? FMath::Min(vd, FMath::Max(vdFill, -d)) : vd);
+                break;
+
+            case FMarchingSquaresStencilPoly::STENCIL_OP_REPLACE:
+                cd = bFillLayer ? FMath::Min(vd, FMath::Max(vdOp, d)) : (bOpLayer ? FMath::Max(vd, -d) : vd);
+                break;
+        }
+
+        return cd;
+    }
+
+    FORCEINLINE uint32 PackEdgeFeature(uint32 AlphaUN8, uint32 HeadingSN8)
+    {
+        return (AlphaUN8 & 0xFF) | ((HeadingSN8 & 0xFF) << 8);
+    }
+
+    // Deterministic heading quantization, see QuantizeHeadingSN8() of
+    // MarchingSquaresStencilCommon.ush. Table and function must match.
+
+    // tan(k * PI/512) * 32768, k = [0, 127]
+    static const uint32 HeadingTanTable[128] = {
+            0,   201,   402,   603,   804,  1006,  1207,  1408,
+         1610,  1811,  2013,  2215,  2417,  2619,  2822,  3024,
+         3227,  3431,  3634,  3838,  4042,  4246,  4450,  4655,
+         4861,  5066,  5272,  5479,  5686,  5893,  6101,  6309,
+         6518,  6727,  6937,  7147,  7358,  7570,  7782,  7995,
+         8208,  8422,  8637,  8852,  9068,  9285,  9503,  9721,
+         9940, 10160, 10381, 10603, 10825, 11049, 11273, 11498,
+        11725, 11952, 12180, 12410, 12640, 12872, 13104, 13338,
+        13573, 13809, 14046, 14285, 14525, 14766, 15009, 15253,
+        15498, 15745, 15993, 16243, 16494, 16747, 17001, 17257,
+        17515, 17774, 18035, 18298, 18563, 18829, 19098, 19368,
+        19640, 19915, 20191, 20470, 20750, 21033, 21318, 21605,
+        21895, 22187, 22481, 22778, 23078, 23380, 23685, 23992,
+        24302, 24615, 24931, 25250, 25572, 25897, 26226, 26557,
+        26892, 27230, 27572, 27917, 28266, 28618, 28975, 29335,
+        29699, 30067, 30440, 30817, 31198, 31583, 31973, 32368
+        };
+
+    uint32 QuantizeHeadingSN8(float DirX, float DirY)
+    {
+        const uint32 FixedX = uint32(FMath::Min(FMath::Abs(DirX), 32767.f) * 65536.f);
+        const uint32 FixedY = uint32(FMath::Min(FMath::Abs(DirY), 32767.f) * 65536.f);
+
+        uint32 Major = FMath::Max(FixedX, FixedY);
+        uint32 Minor = FMath::Min(FixedX, FixedY);
+
+        // Zero direction, zero heading angle
+        if (Major == 0)
+        {
+            return 127;
+        }
+
+        // Reduce fixed-point precision to keep table products within 32 bits
+
+        const uint32 Shift = uint32(FMath::Max(int32(FMath::FloorLog2(Major)) - 14, 0));
+        Major >>= Shift;
+        Minor >>= Shift;
+
+        // Octant angle, number of table tangents within minor / major
+
+        uint32 OctantAngle = 128;
+
+        if (Minor < Major)
+        {
+            OctantAngle = 0;
+
+            for (uint32 Step=64; Step>0; Step>>=1)
+            {
+                const uint32 k = OctantAngle + Step;
+                OctantAngle = ((Minor << 15) >= Major * HeadingTanTable[k]) ? k : OctantAngle;
+            }
+        }
+
+        // Unfold octant and quadrant, angle is in [-512, 512] with 512 as PI
+
+        int32 Angle = (FixedY <= FixedX) ? int32(OctantAngle) : (256 - int32(OctantAngle));
+        Angle = (DirX < 0.f) ? (512 - Angle) : Angle;
+        Angle = (DirY < 0.f) ? -Angle : Angle;
+
+        return (uint32(Angle + 512) * 127) >> 9;
+    }
+
+    // Voxel distance encoding, see MarchingSquaresCommon.ush
+
+    FORCEINLINE float UnpackVoxelDistance(uint32 v, float Range, int32 Lane)
+    {
+        const int32 sn = int16(uint16((v >> (Lane*16)) & 0xFFFF));
+        return (FMath::Max(sn, -32767) / 32767.f) * Range;
+    }
+
+    FORCEINLINE uint32 PackVoxelDistance2(float d0, float d1, float Range)
+    {
+        const int32 sn0 = int32(FMath::RoundHalfToEven(FMath::Clamp(d0 / Range, -1.f, 1.f) * 32767.f));
+        const int32 sn1 = int32(FMath::RoundHalfToEven(FMath::Clamp(d1 / Range, -1.f, 1.f) * 32767.f));
+        return (uint32(sn0) & 0xFFFF) | (uint32(sn1) << 16);
+    }
+
+    // Returns voxel state rect, intersect operation also modifies voxels
+    // outside the stencil and covers the whole map
+    FORCEINLINE FIntRect GetStateRect(const FIntPoint& Dimension, const FIntRect& Rect, uint32 Op)
+    {
+        return (Op == FMarchingSquaresStencilPoly::STENCIL_OP_INTERSECT) ? FIntRect(FIntPoint::ZeroValue, Dimension) : Rect;
+    }
+
+    // Returns voxel state rect grown by the distance range
+    FORCEINLINE FIntRect GetDistanceRect(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& StateRect)
+    {
+        FIntRect DistanceRect(StateRect);
+
+        if (VoxelData.HasDistanceData())
+        {
+            DistanceRect.InflateRect(FMath::CeilToInt(VoxelData.DistanceRange));
+            DistanceRect.Clip(FIntRect(FIntPoint::ZeroValue, VoxelData.Dimension));
+        }
+
+        return DistanceRect;
+    }
+}
+
+void FMarchingSquaresStencilPoly::RasterizeStencilCPU(
+    const TArray<FVector>& Vertices,
+    const TArray<int32>& Indices,
+    const FIntRect& Rect,
+    TArray<uint32>& OutStencilData
+    )
+{
+    using namespace MarchingSquaresStencilPolyCPU;
+
+    check(Rect.Area() > 0);
+
+    struct FTriangle
+    {
+        FVector2D P0;
+        FVector2D P1;
+        FVector2D P2;
+        FIntRect  TexelRect;
+        uint32    Id;
+
+        // Point on triangle test terms, see IsPointOnTri()
+        float dX21;
+        float dY12;
+        float dY20;
+        float dX02;
+        float D;
+    };
+
+    const FIntPoint RectDim(Rect.Size());
+
+    // Construct triangles with texel bounds, texel is covered if its
+    // center is covered. Degenerate and out-of-bounds triangles are skipped.
+
+    const int32 TriangleCount = Indices.Num() / 3;
+
+    TArray<FTriangle> Triangles;
+    Triangles.Reserve(TriangleCount);
+
+    for (int32 ti=0; ti<TriangleCount; ++ti)
+    {
+        const FVector& V0(Vertices[Indices[ti*3  ]]);
+        const FVector& V1(Vertices[Indices[ti*3+1]]);
+        const FVector& V2(Vertices[Indices[ti*3+2]]);
+
+        FTriangle Tri;
+        Tri.P0 = FVector2D(V0);
+        Tri.P1 = FVector2D(V1);
+        Tri.P2 = FVector2D(V2);
+
+        // Vertex z holds the line id, poly line header id for poly mask
+        Tri.Id = uint32(FMath::Max(V0.Z+1.5f, 0.f));
+
+        const FVector2D E01(Tri.P1-Tri.P0);
+        const FVector2D E02(Tri.P2-Tri.P0);
+
+        if (FMath::Abs(E01.X*E02.Y - E01.Y*E02.X) <= 1e-8f)
+        {
+            continue;
+        }
+
+        Tri.dX21 = Tri.P2.X-Tri.P1.X;
+        Tri.dY12 = Tri.P1.Y-Tri.P2.Y;
+        Tri.dY20 = Tri.P2.Y-Tri.P0.Y;
+        Tri.dX02 = Tri.P0.X-Tri.P2.X;
+        Tri.D    = Tri.dY12*(Tri.P0.X-Tri.P2.X) + Tri.dX21*(Tri.P0.Y-Tri.P2.Y);
+
+        const float MinX = FMath::Min3(Tri.P0.X, Tri.P1.X, Tri.P2.X);
+        const float MinY = FMath::Min3(Tri.P0.Y, Tri.P1.Y, Tri.P2.Y);
+        const float MaxX = FMath::Max3(Tri.P0.X, Tri.P1.X, Tri.P2.X);
+        const float MaxY = FMath::Max3(Tri.P0.Y, Tri.P1.Y, Tri.P2.Y);
+
+        Tri.TexelRect.Min.X = FMath::Max(FMath::CeilToInt(MinX-.5f), Rect.Min.X);
+        Tri.TexelRect.Min.Y = FMath::Max(FMath::CeilToInt(MinY-.5f), Rect.Min.Y);
+        Tri.TexelRect.Max.X = FMath::Min(FMath::FloorToInt(MaxX-.5f)+1, Rect.Max.X);
+        Tri.TexelRect.Max.Y = FMath::Min(FMath::FloorToInt(MaxY-.5f)+1, Rect.Max.Y);
+
+        if (Tri.TexelRect.Min.X < Tri.TexelRect.Max.X && Tri.TexelRect.Min.Y < Tri.TexelRect.Max.Y)
+        {
+            Triangles.Emplace(Tri);
+        }
+    }
+
+    OutStencilData.Reset(RectDim.X * RectDim.Y);
+    OutStencilData.SetNumZeroed(RectDim.X * RectDim.Y);
+
+    // Rasterize triangles per row band in draw order, later triangles
+    // overwrite earlier ones. Each row is scan converted to the triangle
+    // span, texel center coverage of the span is then tested four texels
+    // at a time.
+
+    const int32 BandCount = GetRowBandCount(RectDim.Y);
+
+    ParallelFor(BandCount, [&](int32 BandIndex)
+    {
+        const int32 BandMinY = Rect.Min.Y + BandIndex*ROW_BAND_SIZE;
+        const int32 BandMaxY = FMath::Min(BandMinY+ROW_BAND_SIZE, Rect.Max.Y);
+
+        const VectorRegister LaneOffsets = GetLaneOffsets();
+        const VectorRegister Zero = VectorZero();
+
+        for (const FTriangle& Tri : Triangles)
+        {
+            const int32 MinY = FMath::Max(Tri.TexelRect.Min.Y, BandMinY);
+            const int32 MaxY = FMath::Min(Tri.TexelRect.Max.Y, BandMaxY);
+
+            const VectorRegister P2X  = VectorSetFloat1(Tri.P2.X);
+            const VectorRegister dY12 = VectorSetFloat1(Tri.dY12);
+            const VectorRegister dY20 = VectorSetFloat1(Tri.dY20);
+            const VectorRegister D    = VectorSetFloat1(Tri.D);
+            const bool bNegativeD = Tri.D < 0.f;
+
+            for (int32 y=MinY; y<MaxY; ++y)
+            {
+                const float cy = y + .5f;
+
+                // Find triangle span on the texel center row
+
+                const FVector2D* Points[3] = { &Tri.P0, &Tri.P1, &Tri.P2 };
+
+                float SpanMin = BIG_NUMBER;
+                float SpanMax = -BIG_NUMBER;
+
+                for (int32 ei=0; ei<3; ++ei)
+                {
+                    const FVector2D& A(*Points[ei]);
+                    const FVector2D& B(*Points[(ei+1)%3]);
+
+                    if (cy < FMath::Min(A.Y, B.Y) || cy > FMath::Max(A.Y, B.Y))
+                    {
+                        continue;
+                    }
+
+                    if (A.Y == B.Y)
+                    {
+                        SpanMin = FMath::Min3(SpanMin, A.X, B.X);
+                        SpanMax = FMath::Max3(SpanMax, A.X, B.X);
+                    }
+                    else
+                    {
+                        const float x = A.X + (cy-A.Y) * (B.X-A.X) / (B.Y-A.Y);
+                        SpanMin = FMath::Min(SpanMin, x);
+                        SpanMax = FMath::Max(SpanMax, x);
+                    }
+                }
+
+                if (SpanMin > SpanMax)
+                {
+                    continue;
+                }
+
+                // Grow span by a single texel, the coverage test decides
+                // texels on the span boundary
+
+                const int32 MinX = FMath::Max(FMath::CeilToInt(SpanMin-.5f)-1, Tri.TexelRect.Min.X);
+                const int32 MaxX = FMath::Min(FMath::FloorToInt(SpanMax-.5f)+2, Tri.TexelRect.Max.X);
+
+                uint32* RowData = OutStencilData.GetData() + (y-Rect.Min.Y)*RectDim.X - Rect.Min.X;
+
+                // Row terms of the point on triangle test
+
+                const float dY = cy - Tri.P2.Y;
+                const VectorRegister sY = VectorSetFloat1(Tri.dX21*dY);
+                const VectorRegister tY = VectorSetFloat1(Tri.dX02*dY);
+
+                for (int32 x=MinX; x<MaxX; x+=LANE_COUNT)
+                {
+                    const VectorRegister cx = VectorAdd(VectorSetFloat1(x+.5f), LaneOffsets);
+                    const VectorRegister dX = VectorSubtract(cx, P2X);
+
+                    const VectorRegister s  = VectorAdd(VectorMultiply(dY12, dX), sY);
+                    const VectorRegister t  = VectorAdd(VectorMultiply(dY20, dX), tY);
+                    const VectorRegister st = VectorAdd(s, t);
+
+                    const VectorRegister bOnTri = bNegativeD
+                        ? VectorBitwiseAnd(VectorBitwiseAnd(VectorCompareGE(Zero, s), VectorCompareGE(Zero, t)), VectorCompareGE(st, D))
+                        : VectorBitwiseAnd(VectorBitwiseAnd(VectorCompareGE(s, Zero), VectorCompareGE(t, Zero)), VectorCompareGE(D, st));
+
+                    const int32 CoverMask = VectorMaskBits(bOnTri) & GetLaneMask(MaxX-x);
+
+                    for (int32 i=0; i<LANE_COUNT; ++i)
+                    {
+                        if ((CoverMask >> i) & 1)
+                        {
+                            RowData[x+i] = Tri.Id;
+                        }
+                    }
+                }
+            }
+        }
+    } );
+}
+
+void FMarchingSquaresStencilPoly::WriteVoxelDataCPU(
+    FMarchingSquaresCPUVoxelData& VoxelData,
+    const TArray<uint32>& StencilData,
+    const FIntRect& Rect,
+    const FLineGeomData& LineGeomArr,
+    const FLineStateData& LineStateArr,
+    uint32 FillType,
+    const FStencilOp& Op
+    )
+{
+    using namespace MarchingSquaresStencilPolyCPU;
+
+    check(VoxelData.IsValid());
+    check(LineGeomArr.Num() > 0);
+    check(LineGeomArr.Num() == LineStateArr.Num());
+
+    const FIntPoint Dimension(VoxelData.Dimension);
+    const FIntPoint RectDim(Rect.Size());
+
+    const uint32 StencilOp  = Op.Mode;
+    const uint32 OpFillType = Op.OpFillType;
+
+    // Construct per line sign tests and line segments
+
+    const int32 LineCount = LineGeomArr.Num();
+
+    TArray<FLineSignData> LineSigns;
+    TArray<FLineSegmentData> LineSegments;
+    TArray<uint32> LineStates;
+
+    LineSigns.SetNumUninitialized(LineCount);
+    LineSegments.SetNumUninitialized(LineCount);
+    LineStates.SetNumUninitialized(LineCount);
+
+    for (int32 i=0; i<LineCount; ++i)
+    {
+        const FAlignedLineGeom& lg(LineGeomArr[i]);
+
+        const FVector2D& lpL1(lg.P1);
+        const FVector2D& lpL2(lg.P2);
+        const FVector2D& lpL4(lg.E0);
+        const FVector2D& lpL5(lg.E1);
+
+        const FVector2D& lpA1(lg.P0);
+        const FVector2D& lpA4(lg.E2);
+        const FVector2D& lpB2(lg.P3);
+        const FVector2D& lpB5(lg.E3);
+
+        auto MakeTest = [](const FVector2D& Origin, const FVector2D& OrthoDir)
+        {
+            return FVector4(Origin.X, Origin.Y, OrthoDir.X, OrthoDir.Y);
+        };
+
+        FVector4* Tests = LineSigns[i].Tests;
+        Tests[0] = MakeTest(lpL1, Ortho(lpL2-lpL1));
+        Tests[1] = MakeTest(lpL4, Ortho(lpL1-lpL4));
+        Tests[2] = MakeTest(lpL2, Ortho(lpL5-lpL2));
+        Tests[3] = MakeTest(lpA1, Ortho(lpL1-lpA1));
+        Tests[4] = MakeTest(lpA4, Ortho(lpA1-lpA4));
+        Tests[5] = MakeTest(lpL2, Ortho(lpB2-lpL2));
+        Tests[6] = MakeTest(lpB2, Ortho(lpB5-lpB2));
+        Tests[7] = MakeTest(lpB2, Ortho(lpB2-lpL2));
+
+        FVector4* Segments = LineSegments[i].Segments;
+        Segments[0] = FVector4(lpA1.X, lpA1.Y, lpL1.X, lpL1.Y);
+        Segments[1] = FVector4(lpL1.X, lpL1.Y, lpL2.X, lpL2.Y);
+        Segments[2] = FVector4(lpL2.X, lpL2.Y, lpB2.X, lpB2.Y);
+
+        LineStates[i] = LineStateArr[i];
+    }
+
+    uint32* VoxelStateData    = VoxelData.VoxelStateData.GetData();
+    uint32* VoxelFeatureData  = VoxelData.VoxelFeatureData.GetData();
+    uint32* VoxelDistanceData = VoxelData.VoxelDistanceData.GetData();
+
+    const FIntRect StateRect(GetStateRect(Dimension, Rect, StencilOp));
+    const int32 StateStride = StateRect.Width();
+
+    // Stencil fill of the state rect, kept for the distance pass
+
+    const bool bWriteDistance = VoxelData.HasDistanceData();
+
+    TArray<uint32> StencilFillData;
+
+    if (bWriteDistance)
+    {
+        StencilFillData.SetNumUninitialized(StateRect.Area());
+    }
+
+    // Write voxel state, see VoxelWriteStateKernel. Voxels outside of the
+    // stencil use the explicit fill type.
+
+    ParallelFor(GetRowBandCount(StateRect.Height()), [&](int32 BandIndex)
+    {
+        const int32 BandMinY = StateRect.Min.Y + BandIndex*ROW_BAND_SIZE;
+        const int32 BandMaxY = FMath::Min(BandMinY+ROW_BAND_SIZE, StateRect.Max.Y);
+
+        const VectorRegister LaneOffsets = GetLaneOffsets();
+        const VectorRegister Half = VectorSetFloat1(.5f);
+
+        for (int32 y=BandMinY; y<BandMaxY; ++y)
+        for (int32 x=StateRect.Min.X; x<StateRect.Max.X; x+=LANE_COUNT)
+        {
+            const int32 LaneMask = GetLaneMask(StateRect.Max.X-x);
+
+            // Stencil line of each lane, lanes outside of the stencil
+            // read line zero
+
+            uint32 lid[LANE_COUNT];
+            uint32 lineState[LANE_COUNT];
+
+            int32 PolyMask = 0;
+            int32 EdgeMask = 0;
+
+            for (int32 i=0; i<LANE_COUNT; ++i)
+            {
+                const FIntPoint tid(x+i, y);
+                const bool bInStencilRect = ((LaneMask >> i) & 1) && Rect.Contains(tid);
+
+                const uint32 polyId = bInStencilRect ? (StencilData[(tid.X-Rect.Min.X) + (tid.Y-Rect.Min.Y)*RectDim.X] & 0xFFFF) : 0;
+                const bool bIsPoly = polyId != 0;
+
+                lid[i] = bIsPoly ? (polyId-1) : 0;
+                lineState[i] = bIsPoly ? LineStates[lid[i]] : FillType;
+
+                PolyMask |= (bIsPoly ? 1 : 0) << i;
+                EdgeMask |= ((bIsPoly && (lineState[i] & LINE_STATE_EDGE_FLAG)) ? 1 : 0) << i;
+            }
+
+            // Calculate voxel line signs of edge lanes, voxel point is
+            // tested against L2 and cell center against B2 for LB2
+
+            int32 FilledMask[2] = { PolyMask, PolyMask };
+
+            if (EdgeMask)
+            {
+                const VectorRegister vPosX = VectorAdd(VectorSetFloat1(float(x)), LaneOffsets);
+                const VectorRegister vPosY = VectorSetFloat1(float(y));
+                const VectorRegister cPosX = VectorAdd(vPosX, Half);
+                const VectorRegister cPosY = VectorAdd(vPosY, Half);
+
+                int32 SgnV[8];
+                int32 SgnC[8];
+
+                for (int32 k=0; k<8; ++k)
+                {
+                    VectorRegister OX, OY, NX, NY;
+
+                    TransposeLanes(
+                        LineSigns[lid[0]].Tests[k],
+                        LineSigns[lid[1]].Tests[k],
+                        LineSigns[lid[2]].Tests[k],
+                        LineSigns[lid[3]].Tests[k],
+                        OX, OY, NX, NY
+                        );
+
+                    SgnV[k] = GetOrthoSgnMask(vPosX, vPosY, OX, OY, NX, NY);
+                    SgnC[k] = GetOrthoSgnMask(cPosX, cPosY, OX, OY, NX, NY);
+                }
+
+                for (int32 i=0; i<2; ++i)
+                {
+                    const int32* Sgn = i ? SgnC : SgnV;
+                    const int32 SgnLB2 = i ? SgnC[7] : SgnV[5];
+
+                    const int32 bSgn0 =  Sgn[1] & Sgn[0] &  Sgn[2];
+                    const int32 bSgnA =  Sgn[4] & Sgn[3] & ~Sgn[1];
+                    const int32 bSgnB = ~Sgn[2] & SgnLB2 & Sgn[6];
+
+                    FilledMask[i] = PolyMask & (~EdgeMask | bSgn0 | bSgnA | bSgnB);
+                }
+            }
+
+            // Write state
+
+            for (int32 i=0; i<LANE_COUNT; ++i)
+            {
+                if (((LaneMask >> i) & 1) == 0)
+                {
+                    continue;
+                }
+
+                const int32 tidx = (x+i) + y*Dimension.X;
+
+                const uint32 fillType = lineState[i] & LINE_STATE_FILL_TYPE_MASK;
+                const bool bFilledV = (FilledMask[0] >> i) & 1;
+                const bool bFilledC = (FilledMask[1] >> i) & 1;
+
+                const uint32 lastState  = VoxelStateData[tidx];
+                const uint32 lastVState = lastState & 0xFF;
+                const uint32 lastCState = (lastState >> 8) & 0xFF;
+
+                const uint32 vState = ApplyStencilOpState(lastVState, bFilledV, fillType, StencilOp, OpFillType);
+                const uint32 cState = ApplyStencilOpState(lastCState, bFilledC, fillType, StencilOp, OpFillType);
+
+                VoxelStateData[tidx] = vState | (cState << 8) | (lid[i] << 16);
+
+                if (bWriteDistance)
+                {
+                    const int32 fidx = (x+i-StateRect.Min.X) + (y-StateRect.Min.Y)*StateStride;
+                    StencilFillData[fidx] = fillType | (bFilledV ? STENCIL_FILL_FLAG : 0);
+                }
+            }
+        }
+    } );
+
+    // Write voxel feature, see VoxelWriteFeatureKernel. Feature pass reads
+    // neighbour voxel state and starts after all voxel state is written.
+
+    const FIntPoint CDim(Dimension.X-1, Dimension.Y-1);
+    const FIntRect FeatureRect(StateRect.Min, FIntPoint(FMath::Min(StateRect.Max.X, CDim.X), FMath::Min(StateRect.Max.Y, CDim.Y)));
+
+    if (FeatureRect.Width() > 0 && FeatureRect.Height() > 0)
+    {
+        ParallelFor(GetRowBandCount(FeatureRect.Height()), [&](int32 BandIndex)
+        {
+            const int32 BandMinY = FeatureRect.Min.Y + BandIndex*ROW_BAND_SIZE;
+            const int32 BandMaxY = FMath::Min(BandMinY+ROW_BAND_SIZE, FeatureRect.Max.Y);
+
+            const VectorRegister LaneOffsets = GetLaneOffsets();
+
+            for (int32 y=BandMinY; y<BandMaxY; ++y)
+            for (int32 x=FeatureRect.Min.X; x<FeatureRect.Max.X; x+=LANE_COUNT)
+            {
+                const int32 LaneMask = GetLaneMask(FeatureRect.Max.X-x);
+
+                // Line of each lane, invalid lanes repeat the last lane
+
+                uint32 vMinGeomId[LANE_COUNT];
+                const FLineSegmentData* Lines[LANE_COUNT];
+
+                for (int32 i=0; i<LANE_COUNT; ++i)
+                {
+                    const int32 tidx = FMath::Min(x+i, FeatureRect.Max.X-1) + y*Dimension.X;
+
+                    uint32 GeomId = (VoxelStateData[tidx]>>16) & 0xFFFF;
+
+                    // Line id written by a previous stencil with more lines,
+                    // unreachable since all voxels within the rect are rewritten
+                    if (! LineSegments.IsValidIndex(GeomId))
+                    {
+                        GeomId = 0;
+                    }
+
+                    vMinGeomId[i] = GeomId;
+                    Lines[i] = &LineSegments[GeomId];
+                }
+
+                // Calculate edge crossings
+
+                const VectorRegister vMinX = VectorAdd(VectorSetFloat1(float(x)), LaneOffsets);
+                const VectorRegister vMinY = VectorSetFloat1(float(y));
+
+                uint32 alphaX[LANE_COUNT];
+                uint32 alphaY[LANE_COUNT];
+                int32 segmentX[LANE_COUNT];
+                int32 segmentY[LANE_COUNT];
+
+                const int32 HitMaskX = FindEdgeCrossing(vMinX, vMinY, 0, Lines, alphaX, segmentX);
+                const int32 HitMaskY = FindEdgeCrossing(vMinX, vMinY, 1, Lines, alphaY, segmentY);
+
+                // SN8 heading angle of a line segment, see VoxelWriteFeatureKernel
+
+                auto GetHeadingSN8 = [](const FLineSegmentData& Line, int32 Segment)
+                {
+                    const FVector4& s(Line.Segments[Segment]);
+                    return QuantizeHeadingSN8(s.Z-s.X, s.W-s.Y);
+                };
+
+                for (int32 i=0; i<LANE_COUNT; ++i)
+                {
+                    if (((LaneMask >> i) & 1) == 0)
+                    {
+                        continue;
+                    }
+
+                    const int32 tidx = (x+i) + y*Dimension.X;
+
+                    const uint32 Feature = VoxelFeatureData[tidx];
+                    uint32 uEdgeX = Feature & 0xFFFF;
+                    uint32 uEdgeY = (Feature >> 16) & 0xFFFF;
+
+                    const uint32 vMinState = VoxelStateData[tidx] & 0xFF;
+                    const uint32 xMaxState = VoxelStateData[tidx+1] & 0xFF;
+                    const uint32 yMaxState = VoxelStateData[tidx+Dimension.X] & 0xFF;
+
+                    const uint32 fillType = (vMinGeomId[i] ? LineStates[vMinGeomId[i]] : FillType) & LINE_STATE_FILL_TYPE_MASK;
+                    const uint32 edgeFillType = GetStencilOpEdgeFillType(StencilOp, fillType, OpFillType);
+
+                    uint32 applyEdge = 0;
+
+                    if (((HitMaskX >> i) & 1) &&
+                        IsStencilOpEdge(vMinState, xMaxState, StencilOp, fillType, OpFillType) &&
+                        ShouldApplyEdgeCrossing(uEdgeX, vMinState, xMaxState, edgeFillType, alphaX[i]))
+                    {
+                        applyEdge |= FEATURE_APPLY_X;
+                    }
+
+                    if (((HitMaskY >> i) & 1) &&
+                        IsStencilOpEdge(vMinState, yMaxState, StencilOp, fillType, OpFillType) &&
+                        ShouldApplyEdgeCrossing(uEdgeY, vMinState, yMaxState, edgeFillType, alphaY[i]))
+                    {
+                        applyEdge |= FEATURE_APPLY_Y;
+                    }
+
+                    // Apply feature case
+
+                    if (applyEdge & FEATURE_APPLY_X)
+                    {
+                        uEdgeX = PackEdgeFeature(alphaX[i], GetHeadingSN8(*Lines[i], segmentX[i]));
+                    }
+
+                    if (applyEdge & FEATURE_APPLY_Y)
+                    {
+                        uEdgeY = PackEdgeFeature(alphaY[i], GetHeadingSN8(*Lines[i], segmentY[i]));
+                    }
+
+                    // Write feature data
+
+                    VoxelFeatureData[tidx] = (uEdgeX & 0xFFFF) | ((uEdgeY & 0xFFFF) << 16);
+                }
+            }
+        } );
+    }
+
+    // Write voxel distance, see VoxelWriteDistanceKernel. Distance pass
+    // reads the final voxel state and covers the state rect grown by the
+    // distance range. Edge segments are binned per row band and distance
+    // tile, voxel distance is evaluated against four segments at a time.
+
+    if (! bWriteDistance)
+    {
+        return;
+    }
+
+    const FIntRect DistanceRect(GetDistanceRect(VoxelData, StateRect));
+    const float DistanceRange = VoxelData.DistanceRange;
+    const uint32 DistanceLayerCount = VoxelData.DistanceLayerCount;
+
+    const int32 PairMinX = DistanceRect.Min.X / 2;
+    const int32 PairMaxX = (DistanceRect.Max.X+1) / 2;
+
+    TArray<int32> EdgeLines;
+
+    for (int32 i=0; i<LineCount; ++i)
+    {
+        if (LineStates[i] & LINE_STATE_EDGE_FLAG)
+        {
+            EdgeLines.Emplace(i);
+        }
+    }
+
+    ParallelFor(GetRowBandCount(DistanceRect.Height()), [&](int32 BandIndex)
+    {
+        const int32 BandMinY = DistanceRect.Min.Y + BandIndex*ROW_BAND_SIZE;
+        const int32 BandMaxY = FMath::Min(BandMinY+ROW_BAND_SIZE, DistanceRect.Max.Y);
+
+        // Edge segments L1-L2 within range of the band rows
+
+        TArray<int32> BandLines;
+
+        for (int32 li : EdgeLines)
+        {
+            const FVector4& s(LineSegments[li].Segments[1]);
+
+            if (FMath::Max(s.Y, s.W) >= (BandMinY-DistanceRange) &&
+                FMath::Min(s.Y, s.W) <= (BandMaxY-1+DistanceRange))
+            {
+                BandLines.Emplace(li);
+            }
+        }
+
+        // Tile edge segments, padded to the lane count with segments of
+        // no fill type
+
+        TArray<float> TileSX;
+        TArray<float> TileSY;
+        TArray<float> TileEX;
+        TArray<float> TileEY;
+        TArray<float> TileFillType;
+
+        for (int32 TilePairMinX=PairMinX; TilePairMinX<PairMaxX; TilePairMinX+=DISTANCE_TILE_SIZE/2)
+        {
+            const int32 TilePairMaxX = FMath::Min(TilePairMinX+DISTANCE_TILE_SIZE/2, PairMaxX);
+
+            const float TileMinX = TilePairMinX*2 - DistanceRange;
+            const float TileMaxX = TilePairMaxX*2-1 + DistanceRange;
+
+            TileSX.Reset();
+            TileSY.Reset();
+            TileEX.Reset();
+            TileEY.Reset();
+            TileFillType.Reset();
+
+            for (int32 li : BandLines)
+            {
+                const FVector4& s(LineSegments[li].Segments[1]);
+
+                if (FMath::Max(s.X, s.Z) >= TileMinX && FMath::Min(s.X, s.Z) <= TileMaxX)
+                {
+                    TileSX.Emplace(s.X);
+                    TileSY.Emplace(s.Y);
+                    TileEX.Emplace(s.Z);
+                    TileEY.Emplace(s.W);
+                    TileFillType.Emplace(float(LineStates[li] & LINE_STATE_FILL_TYPE_MASK));
+                }
+            }
+
+            while (TileFillType.Num() % LANE_COUNT)
+            {
+                TileSX.Emplace(0.f);
+                TileSY.Emplace(0.f);
+                TileEX.Emplace(0.f);
+                TileEY.Emplace(0.f);
+                TileFillType.Emplace(-1.f);
+            }
+
+            const int32 TileSegmentCount = TileFillType.Num();
+
+            for (int32 y=BandMinY; y<BandMaxY; ++y)
+            for (int32 px=TilePairMinX; px<TilePairMaxX; ++px)
+            {
+                const int32 x0 = px*2;
+
+                bool   bInBounds[2];
+                bool   bFilled[2];
+                uint32 f[2];
+                float  d[2];
+
+                for (int32 i=0; i<2; ++i)
+                {
+                    const int32 x = x0+i;
+
+                    bInBounds[i] = x >= DistanceRect.Min.X && x < DistanceRect.Max.X;
+
+                    // Stencil fill of the state pass, voxels outside of the
+                    // state rect are outside of the stencil
+
+                    const uint32 Fill = StateRect.Contains(FIntPoint(x, y))
+                        ? StencilFillData[(x-StateRect.Min.X) + (y-StateRect.Min.Y)*StateStride]
+                        : FillType;
+
+                    bFilled[i] = (Fill & STENCIL_FILL_FLAG) != 0;
+                    f[i] = Fill & LINE_STATE_FILL_TYPE_MASK;
+
+                    // Unsigned distance to the nearest edge segment of the
+                    // voxel fill type
+
+                    float ud = DistanceRange;
+
+                    if (bInBounds[i] && TileSegmentCount > 0)
+                    {
+                        const VectorRegister PX = VectorSetFloat1(float(x));
+                        const VectorRegister PY = VectorSetFloat1(float(y));
+                        const VectorRegister FV = VectorSetFloat1(float(f[i]));
+                        const VectorRegister MaxDistance = VectorSetFloat1(BIG_NUMBER);
+
+                        VectorRegister MinDistanceSq = MaxDistance;
+
+                        for (int32 si=0; si<TileSegmentCount; si+=LANE_COUNT)
+                        {
+                            const VectorRegister DistanceSq = GetSegmentDistanceSquared(
+                                PX,
+                                PY,
+                                VectorLoad(&TileSX[si]),
+                                VectorLoad(&TileSY[si]),
+                                VectorLoad(&TileEX[si]),
+                                VectorLoad(&TileEY[si])
+                                );
+
+                            const VectorRegister bFillType = VectorCompareEQ(VectorLoad(&TileFillType[si]), FV);
+                            MinDistanceSq = VectorMin(MinDistanceSq, VectorSelect(bFillType, DistanceSq, MaxDistance));
+                        }
+
+                        float LaneDistanceSq[LANE_COUNT];
+                        VectorStore(MinDistanceSq, LaneDistanceSq);
+
+                        const float DistanceSq = FMath::Min(
+                            FMath::Min(LaneDistanceSq[0], LaneDistanceSq[1]),
+                            FMath::Min(LaneDistanceSq[2], LaneDistanceSq[3])
+                            );
+
+                        ud = FMath::Min(ud, FMath::Sqrt(DistanceSq));
+                    }
+
+                    // Stencil signed distance, sign taken from the stencil fill
+                    d[i] = bFilled[i] ? -ud : ud;
+                }
+
+                // Load fill type and op fill type layer distances prior to
+                // combination, fill types without distance layer are
+                // treated as fully outside
+
+                float vdFill[2] = { DistanceRange, DistanceRange };
+                float vdOp[2]   = { DistanceRange, DistanceRange };
+
+                for (int32 i=0; i<2; ++i)
+                {
+                    if (f[i] < DistanceLayerCount)
+                    {
+                        const uint32 v = VoxelDistanceData[VoxelData.GetDistanceIndex(x0, y, f[i])];
+                        vdFill[i] = UnpackVoxelDistance(v, DistanceRange, i);
+                    }
+                }
+
+                if (OpFillType < DistanceLayerCount)
+                {
+                    const uint32 v = VoxelDistanceData[VoxelData.GetDistanceIndex(x0, y, OpFillType)];
+                    vdOp[0] = UnpackVoxelDistance(v, DistanceRange, 0);
+                    vdOp[1] = UnpackVoxelDistance(v, DistanceRange, 1);
+                }
+
+                // Final voxel state written by the state pass
+
+                const uint32 vState[2] = {
+                    VoxelStateData[x0 + y*Dimension.X] & 0xFF,
+                    ((x0+1) < Dimension.X) ? (VoxelStateData[x0+1 + y*Dimension.X] & 0xFF) : 0xFF
+                    };
+
+                for (uint32 layer=0; layer<DistanceLayerCount; ++layer)
+                {
+                    const int32 didx = VoxelData.GetDistanceIndex(x0, y, layer);
+                    const uint32 v = VoxelDistanceData[didx];
+
+                    float cd[2];
+
+                    for (int32 i=0; i<2; ++i)
+                    {
+                        const float vd = UnpackVoxelDistance(v, DistanceRange, i);
+                        const float c  = CombineStencilOpDistance(vd, vdFill[i], vdOp[i], d[i], f[i] == layer, OpFillType == layer, StencilOp);
+
+                        // Force distance sign to agree with the final voxel
+                        // state, keep out-of-bounds voxel of the pair
+
+                        const float ad = FMath::Max(FMath::Abs(c), 1e-3f);
+                        cd[i] = bInBounds[i] ? ((vState[i] == layer) ? -ad : ad) : vd;
+                    }
+
+                    VoxelDistanceData[didx] = PackVoxelDistance2(cd[0], cd[1], DistanceRange);
+                }
+            }
+        }
+    } );
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeaturesCPU(const FGenerateVoxelFeatureParameter& Parameter)
+{
+    FGenerateVoxelFeatureBatchParameter BatchParameter;
+    BatchParameter.Map = Parameter.Map;
+    BatchParameter.SimplifyTolerance = Parameter.SimplifyTolerance;
+    BatchParameter.Op = Parameter.Op;
+    BatchParameter.Polys.Emplace(FStencilPolyData({ Parameter.FillType, Parameter.StencilPoints, Parameter.StencilEdgeRadius }));
+
+    GenerateVoxelFeaturesCPU(BatchParameter);
+}
+
+void FMarchingSquaresStencilPoly::GenerateVoxelFeaturesCPU(const FGenerateVoxelFeatureBatchParameter& Parameter)
+{
+    check(Parameter.Map != nullptr);
+    check(Parameter.Map->HasValidDimension());
+
+    TArray<FStencilPolyData> BatchPolys;
+    FilterStencilPolys(Parameter.Polys, Parameter.SimplifyTolerance, BatchPolys);
+
+    if (BatchPolys.Num() < 1)
+    {
+        return;
+    }
+
+    FMarchingSquaresMap& Map(*Parameter.Map);
+    Map.InitializeCPUVoxelData();
+
+    // Intersect operation modifies voxels outside of the stencil, each fill
+    // type of the batch is intersected only with polys of the same fill
+    // type, see GenerateVoxelFeatures_RT()
+
+    const bool bSplitFillTypes = (Parameter.Op.Mode == STENCIL_OP_INTERSECT);
+
+    if (bSplitFillTypes)
+    {
+        Map.BeginHistoryGroup();
+    }
+
+    TArray<FStencilPolyData> Polys;
+
+    while (BatchPolys.Num() > 0)
+    {
+        const uint32 FillType = BatchPolys[0].FillType & LINE_STATE_FILL_TYPE_MASK;
+
+        if (bSplitFillTypes)
+        {
+            // Move polys of the fill type while keeping the draw order
+
+            for (int32 i=0; i<BatchPolys.Num(); )
+            {
+                if ((BatchPolys[i].FillType & LINE_STATE_FILL_TYPE_MASK) == FillType)
+                {
+                    Polys.Emplace(MoveTemp(BatchPolys[i]));
+                    BatchPolys.RemoveAt(i, 1, false);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+        else
+        {
+            Swap(Polys, BatchPolys);
+        }
+
+        ApplyStencilPolysCPU(Map, Polys, FillType, Parameter.Op);
+
+        Polys.Reset();
+    }
+
+    if (bSplitFillTypes)
+    {
+        Map.EndHistoryGroup();
+    }
+}
+
+void FMarchingSquaresStencilPoly::ApplyStencilPolysCPU(FMarchingSquaresMap& Map, const TArray<FStencilPolyData>& Polys, uint32 FillType, const FStencilOp& Op) const
+{
+    using namespace MarchingSquaresStencilPolyCPU;
+
+    FMarchingSquaresCPUVoxelData& VoxelData(Map.GetCPUVoxelData());
+    const FIntPoint Dimension(VoxelData.Dimension);
+
+    // Construct stencil geometry
+
+    TArray<FVector> Vertices;
+    TArray<int32> Indices;
+    FLineGeomData LineGeomArr;
+    FLineStateData LineStateArr;
+
+    BuildStencilGeometry(Polys, Vertices, Indices, LineGeomArr, LineStateArr);
+
+    // No geometry to draw, abort
+    if (Indices.Num() < 3)
+    {
+        return;
+    }
+
+    // Calculate stencil bounds, see CalculateStencilRect()
+
+    FBox2D StencilBounds(ForceInitToZero);
+
+    for (const FVector& Vertex : Vertices)
+    {
+        StencilBounds += FVector2D(Vertex);
+    }
+
+    FIntRect Rect;
+    Rect.Min.X = FMath::Clamp(FMath::FloorToInt(StencilBounds.Min.X)-1, 0, Dimension.X);
+    Rect.Min.Y = FMath::Clamp(FMath::FloorToInt(StencilBounds.Min.Y)-1, 0, Dimension.Y);
+    Rect.Max.X = FMath::Clamp(FMath::CeilToInt(StencilBounds.Max.X)+1, 0, Dimension.X);
+    Rect.Max.Y = FMath::Clamp(FMath::CeilToInt(StencilBounds.Max.Y)+1, 0, Dimension.Y);
+
+    // Stencil is completely outside the map, abort
+    if (Rect.Area() <= 0)
+    {
+        return;
+    }
+
+    TArray<uint32> StencilData;
+
+    RasterizeStencilCPU(Vertices, Indices, Rect, StencilData);
+
+    // Edit rect covers all voxels written by the state, feature and
+    // distance passes
+
+    const FIntRect StateRect(GetStateRect(Dimension, Rect, Op.Mode));
+    const FIntRect EditRect(GetDistanceRect(VoxelData, StateRect));
+
+    Map.BeginVoxelEditCPU(EditRect);
+    WriteVoxelDataCPU(VoxelData, StencilData, Rect, LineGeomArr, LineStateArr, FillType, Op);
+    Map.EndVoxelEditCPU();
+
+    Map.UpdateVoxelMirrorCPU(StateRect);
+}
+
+bool FMarchingSquaresStencilPoly::VerifyCPUStencilFixture()
+{
+    check(IsInGameThread());
+
+    // Fixture maps, one written by the GPU path and one by the CPU path
+
+    const FIntPoint Dimension(128, 96);
+
+    FMarchingSquaresMap GPUMap;
+    FMarchingSquaresMap CPUMap;
+
+    for (FMarchingSquaresMap* Map : { &GPUMap, &CPUMap })
+    {
+        Map->BlockSize = 32;
+        Map->SetDimension(Dimension);
+    }
+
+    GPUMap.InitializeVoxelData();
+    CPUMap.InitializeCPUVoxelData();
+
+    // Fixture polys with off-grid points, concave corners, edge radius and
+    // steep and shallow edges in every quadrant
+
+    auto MakeCircle = [](const FVector2D& Center, float Radius, int32 PointCount)
+    {
+        TArray<FVector2D> Points;
+
+        for (int32 i=0; i<PointCount; ++i)
+        {
+            const float Angle = (2.f*PI*i) / PointCount + .137f;
+            Points.Emplace(Center + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius);
+        }
+
+        return Points;
+    };
+
+    const FStencilPolyData QuadPoly = { 1, { { 10.3f, 12.7f }, { 70.2f, 12.1f }, { 68.6f, 60.4f }, { 11.9f, 58.8f } }, 2.f };
+    const FStencilPolyData NotchPoly = { 2, { { 40.1f, 30.6f }, { 100.4f, 20.2f }, { 90.7f, 80.3f }, { 70.5f, 50.9f }, { 45.2f, 75.1f } }, 1.5f };
+    const FStencilPolyData CirclePoly = { 1, MakeCircle(FVector2D(80.7f, 60.2f), 24.3f, 37), 1.f };
+    const FStencilPolyData HolePoly = { 1, MakeCircle(FVector2D(38.4f, 36.9f), 11.1f, 23), 1.f };
+    const FStencilPolyData SliverPoly = { 2, { { 3.2f, 90.1f }, { 120.6f, 70.4f }, { 121.3f, 73.8f } }, .5f };
+
+    TArray<FGenerateVoxelFeatureBatchParameter> Batches;
+    Batches.SetNum(4);
+
+    Batches[0].Polys = { QuadPoly, NotchPoly, CirclePoly };
+    Batches[0].Op.Mode = STENCIL_OP_UNION;
+
+    Batches[1].Polys = { HolePoly, SliverPoly };
+    Batches[1].Op.Mode = STENCIL_OP_SUBTRACT;
+    Batches[1].Op.OpFillType = 0;
+
+    Batches[2].Polys = { CirclePoly, NotchPoly };
+    Batches[2].Op.Mode = STENCIL_OP_INTERSECT;
+    Batches[2].Op.OpFillType = 0;
+
+    Batches[3].Polys = { SliverPoly, QuadPoly };
+    Batches[3].Op.Mode = STENCIL_OP_REPLACE;
+    Batches[3].Op.OpFillType = 0;
+
+    FMarchingSquaresStencilPoly GPUStencil;
+    FMarchingSquaresStencilPoly CPUStencil;
+
+    for (FGenerateVoxelFeatureBatchParameter& Batch : Batches)
+    {
+        Batch.Map = &GPUMap;
+        GPUStencil.GenerateVoxelFeatures(Batch);
+
+        Batch.Map = &CPUMap;
+        CPUStencil.GenerateVoxelFeaturesCPU(Batch);
+    }
+
+    // Read back GPU voxel data
+
+    TArray<uint32> GPUStateData;
+    TArray<uint32> GPUFeatureData;
+
+    FMarchingSquaresMap* Map(&GPUMap);
+    TArray<uint32>* StateData(&GPUStateData);
+    TArray<uint32>* FeatureData(&GPUFeatureData);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilPoly_VerifyCPUStencilFixture)(
+        [Map, StateData, FeatureData](FRHICommandListImmediate& RHICmdList)
+        {
+            const int32 VoxelCount = Map->GetVoxelCount_RT();
+            const uint32 ByteCount = VoxelCount * sizeof(uint32);
+
+            FRULRWBuffer* Buffers[2] = { &Map->GetVoxelStateData(), &Map->GetVoxelFeatureData() };
+            TArray<uint32>* Outputs[2] = { StateData, FeatureData };
+
+            for (int32 i=0; i<2; ++i)
+            {
+                Outputs[i]->SetNumUninitialized(VoxelCount);
+                void* DataPtr = RHILockVertexBuffer(Buffers[i]->Buffer, 0, ByteCount, RLM_ReadOnly);
+                FMemory::Memcpy(Outputs[i]->GetData(), DataPtr, ByteCount);
+                RHIUnlockVertexBuffer(Buffers[i]->Buffer);
+            }
+        } );
+
+    GPUStencil.ClearStencil();
+    GPUMap.ClearMap();
+    FlushRenderingCommands();
+
+    // Compare voxel words
+
+    const FMarchingSquaresCPUVoxelData& VoxelData(CPUMap.GetCPUVoxelData());
+
+    int32 StateMismatchCount = 0;
+    int32 FeatureMismatchCount = 0;
+    int32 FirstMismatchIndex = INDEX_NONE;
+
+    for (int32 i=0; i<VoxelData.GetVoxelCount(); ++i)
+    {
+        const bool bStateMismatch = GPUStateData[i] != VoxelData.VoxelStateData[i];
+        const bool bFeatureMismatch = GPUFeatureData[i] != VoxelData.VoxelFeatureData[i];
+
+        StateMismatchCount += bStateMismatch ? 1 : 0;
+        FeatureMismatchCount += bFeatureMismatch ? 1 : 0;
+
+        if ((bStateMismatch || bFeatureMismatch) && FirstMismatchIndex == INDEX_NONE)
+        {
+            FirstMismatchIndex = i;
+        }
+    }
+
+    if (FirstMismatchIndex != INDEX_NONE)
+    {
+        const int32 i = FirstMismatchIndex;
+
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilPoly::VerifyCPUStencilFixture() FAILED, %d state and %d feature mismatches. First mismatch (%d, %d): GPU (0x%08x, 0x%08x) CPU (0x%08x, 0x%08x)"),
+            StateMismatchCount,
+            FeatureMismatchCount,
+            i % Dimension.X,
+            i / Dimension.X,
+            GPUStateData[i],
+            GPUFeatureData[i],
+            VoxelData.VoxelStateData[i],
+            VoxelData.VoxelFeatureData[i]
+            );
+
+        return false;
+    }
+
+    UE_LOG(LogMSQ,Log, TEXT("FMarchingSquaresStencilPoly::VerifyCPUStencilFixture() CPU and GPU voxel state and feature words match"));
+
+    return true;
+}
+
+static FAutoConsoleCommand GMarchingSquaresVerifyCPUStencilCommand(
+    TEXT("msq.VerifyCPUStencil"),
+    TEXT("Applies fixture stencils through the GPU and CPU stencil paths and compares voxel state and feature words."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        FMarchingSquaresStencilPoly::VerifyCPUStencilFixture();
+    } )
+    );
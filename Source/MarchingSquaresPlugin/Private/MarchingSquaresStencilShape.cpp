@@ -0,0 +1,478 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresStencilShape.h"
+
+#include "ShaderParameters.h"
+#include "ShaderCore.h"
+#include "ShaderParameterUtils.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+#include "MarchingSquaresMapRef.h"
+#include "Shaders/RULShaderDefinitions.h"
+
+// COMPUTE SHADER DEFINITIONS
+
+class FMSQStencilShapeWriteVoxelCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilShapeWriteVoxelCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "ShapeGeomData", ShapeGeomData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelStateData",   OutVoxelStateData,
+        "OutVoxelFeatureData", OutVoxelFeatureData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_4(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",         Params_MapDimension,
+        "_DispatchOffset", Params_DispatchOffset,
+        "_DispatchDim",    Params_DispatchDim,
+        "_ShapeCount",     Params_ShapeCount
+        )
+};
+
+class FMSQStencilShapeWriteDistanceCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQStencilShapeWriteDistanceCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "ShapeGeomData", ShapeGeomData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelDistanceData", OutVoxelDistanceData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_6(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",             Params_MapDimension,
+        "_DispatchOffset",     Params_DispatchOffset,
+        "_DispatchDim",        Params_DispatchDim,
+        "_ShapeCount",         Params_ShapeCount,
+        "_DistanceLayerCount", Params_DistanceLayerCount,
+        "_DistanceRange",      Params_DistanceRange
+        )
+};
+
+IMPLEMENT_SHADER_TYPE(, FMSQStencilShapeWriteVoxelCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilShapeCS.usf"), TEXT("VoxelWriteShapeKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMSQStencilShapeWriteDistanceCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresStencilShapeCS.usf"), TEXT("VoxelWriteShapeDistanceKernel"), SF_Compute);
+
+bool FMarchingSquaresStencilShape::GetShapeBounds(const FStencilShapeData& Shape, FBox2D& OutBounds)
+{
+    const FVector2D& P0(Shape.Location);
+    const float Radius = Shape.Radius;
+
+    switch (Shape.ShapeType)
+    {
+        case SHAPE_TYPE_CAPSULE:
+        {
+            const FVector2D& P1(Shape.EndLocation);
+            const float EndRadius = (Shape.EndRadius > 0.f) ? Shape.EndRadius : Radius;
+            const FVector2D Exts0(Radius, Radius);
+            const FVector2D Exts1(EndRadius, EndRadius);
+            OutBounds = FBox2D(
+                FVector2D::Min(P0-Exts0, P1-Exts1),
+                FVector2D::Max(P0+Exts0, P1+Exts1)
+                );
+            return Radius > KINDA_SMALL_NUMBER;
+        }
+
+        case SHAPE_TYPE_RECT:
+        {
+            float S, C;
+            FMath::SinCos(&S, &C, FMath::DegreesToRadians(Shape.Rotation));
+            S = FMath::Abs(S);
+            C = FMath::Abs(C);
+
+            const FVector2D& HalfExts(Shape.Extents);
+            const FVector2D Exts(
+                C*HalfExts.X + S*HalfExts.Y,
+                S*HalfExts.X + C*HalfExts.Y
+                );
+            OutBounds = FBox2D(P0-Exts, P0+Exts);
+            return HalfExts.X > KINDA_SMALL_NUMBER && HalfExts.Y > KINDA_SMALL_NUMBER;
+        }
+
+        case SHAPE_TYPE_RING:
+        {
+            const FVector2D Exts(Radius, Radius);
+            OutBounds = FBox2D(P0-Exts, P0+Exts);
+            return Radius > KINDA_SMALL_NUMBER && Shape.InnerRadius < Radius;
+        }
+
+        case SHAPE_TYPE_CIRCLE:
+        default:
+        {
+            const FVector2D Exts(Radius, Radius);
+            OutBounds = FBox2D(P0-Exts, P0+Exts);
+            return Radius > KINDA_SMALL_NUMBER;
+        }
+    }
+}
+
+void FMarchingSquaresStencilShape::GetShapeGeom(const FStencilShapeData& Shape, const FBox2D& Bounds, FAlignedShapeGeom& OutGeom)
+{
+    float S, C;
+    FMath::SinCos(&S, &C, FMath::DegreesToRadians(Shape.Rotation));
+
+    const bool bIsRect = Shape.ShapeType == SHAPE_TYPE_RECT;
+    const FVector2D& P1(bIsRect ? Shape.Extents : Shape.EndLocation);
+
+    OutGeom.Geom = FVector4(Shape.Location.X, Shape.Location.Y, P1.X, P1.Y);
+    // Params.w holds capsule end radius or ring inner radius
+
+    float ParamW = FMath::Max(0.f, Shape.InnerRadius);
+
+    if (Shape.ShapeType == SHAPE_TYPE_CAPSULE)
+    {
+        ParamW = (Shape.EndRadius > 0.f) ? Shape.EndRadius : Shape.Radius;
+    }
+
+    OutGeom.Params = FVector4(Shape.Radius, C, S, ParamW);
+    OutGeom.Bounds = FVector4(Bounds.Min.X, Bounds.Min.Y, Bounds.Max.X, Bounds.Max.Y);
+    OutGeom.Type = Shape.ShapeType;
+    OutGeom.FillType = Shape.FillType & 0xFF;
+    OutGeom.Padding0 = 0;
+    OutGeom.Padding1 = 0;
+}
+
+void FMarchingSquaresStencilShape::GenerateVoxelFeatures_RT(
+    FRHICommandListImmediate& RHICmdList,
+    FMarchingSquaresMap& Map,
+    FShapeGeomData& ShapeGeomArr,
+    const FBox2D& Bounds
+    )
+{
+    check(IsInRenderingThread());
+    check(Map.HasValidDimension_RT());
+    check(ShapeGeomArr.Num() > 0);
+
+    const FIntPoint Dimension(Map.GetDimension_RT());
+
+    // Calculate dispatch bounds from shape bounds, grown by a single voxel
+    // to include edge crossing of voxels just outside the shapes
+
+    FIntRect StencilRect;
+    StencilRect.Min.X = FMath::Clamp(FMath::FloorToInt(Bounds.Min.X)-1, 0, Dimension.X);
+    StencilRect.Min.Y = FMath::Clamp(FMath::FloorToInt(Bounds.Min.Y)-1, 0, Dimension.Y);
+    StencilRect.Max.X = FMath::Clamp(FMath::CeilToInt(Bounds.Max.X)+1, 0, Dimension.X);
+    StencilRect.Max.Y = FMath::Clamp(FMath::CeilToInt(Bounds.Max.Y)+1, 0, Dimension.Y);
+
+    // Shapes are completely outside the map, abort
+    if (StencilRect.Area() <= 0)
+    {
+        return;
+    }
+
+    const FIntPoint DispatchOffset = StencilRect.Min;
+    const FIntPoint DispatchDim    = StencilRect.Size();
+    const uint32    ShapeCount     = ShapeGeomArr.Num();
+
+    UploadShapeGeom_RT(ShapeGeomArr);
+
+    FRULRWBuffer VoxelStateData(Map.GetVoxelStateData());
+    FRULRWBuffer VoxelFeatureData(Map.GetVoxelFeatureData());
+
+    TShaderMap<FGlobalShaderType>* RHIShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    // Voxel distance kernel also writes voxels within distance range of
+    // the shapes, dispatched over the stencil rect grown by the range
+
+    FIntRect DistanceRect(StencilRect);
+
+    if (Map.HasVoxelDistanceData_RT())
+    {
+        DistanceRect.InflateRect(FMath::CeilToInt(Map.GetDistanceRange_RT()));
+        DistanceRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension));
+    }
+
+    // Record voxel blocks written by the shape kernels, distance rect
+    // always contains the stencil rect
+
+    Map.BeginVoxelEdit_RT(DistanceRect);
+
+    // Write voxel state and feature data. Each thread group only evaluates
+    // shapes whose bounds overlap the group voxels.
+
+    RHICmdList.BeginComputePass(TEXT("WriteVoxelShape"));
+    {
+        TShaderMapRef<FMSQStencilShapeWriteVoxelCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("ShapeGeomData"), ShapeGeomData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelStateData"), VoxelStateData.UAV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelFeatureData"), VoxelFeatureData.UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), DispatchOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), DispatchDim);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_ShapeCount"), ShapeCount);
+        ComputeShader->DispatchAndClear(RHICmdList, DispatchDim.X, DispatchDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+
+    // Write voxel distance data, dispatched per packed voxel pair
+
+    if (Map.HasVoxelDistanceData_RT())
+    {
+        const FIntPoint DistanceDispatchOffset = DistanceRect.Min;
+        const FIntPoint DistanceDispatchDim    = DistanceRect.Size();
+
+        const int32  PairDispatchX = (DistanceDispatchOffset.X+DistanceDispatchDim.X+1)/2 - DistanceDispatchOffset.X/2;
+        const uint32 DistanceLayerCount = Map.GetDistanceLayerCount_RT();
+        const float  DistanceRange = Map.GetDistanceRange_RT();
+
+        FRULRWBuffer VoxelDistanceData(Map.GetVoxelDistanceData());
+
+        RHICmdList.BeginComputePass(TEXT("WriteVoxelShapeDistance"));
+        {
+            TShaderMapRef<FMSQStencilShapeWriteDistanceCS> ComputeShader(RHIShaderMap);
+            ComputeShader->SetShader(RHICmdList);
+            ComputeShader->BindSRV(RHICmdList, TEXT("ShapeGeomData"), ShapeGeomData.SRV);
+            ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelDistanceData"), VoxelDistanceData.UAV);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), DistanceDispatchOffset);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), DistanceDispatchDim);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_ShapeCount"), ShapeCount);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceLayerCount"), DistanceLayerCount);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceRange"), DistanceRange);
+            ComputeShader->DispatchAndClear(RHICmdList, PairDispatchX, DistanceDispatchDim.Y, 1);
+        }
+        RHICmdList.EndComputePass();
+    }
+
+    Map.EndVoxelEdit_RT();
+}
+
+void FMarchingSquaresStencilShape::UploadShapeGeom_RT(const FShapeGeomData& ShapeGeomArr)
+{
+    check(IsInRenderingThread());
+    check(ShapeGeomArr.Num() > 0);
+
+    // Grow shape geometry buffer if the upload exceeds the current capacity
+
+    if (ShapeGeomArr.Num() > ShapeGeomCapacity || ! ShapeGeomData.IsValid())
+    {
+        ShapeGeomCapacity = FMath::Max<int32>(FMath::RoundUpToPowerOfTwo(ShapeGeomArr.Num()), MIN_UPLOAD_SHAPE_COUNT);
+
+        ShapeGeomData.Release();
+        ShapeGeomData.Initialize(
+            sizeof(FShapeGeomData::ElementType),
+            ShapeGeomCapacity,
+            nullptr,
+            BUF_Static,
+            TEXT("ShapeGeomData")
+            );
+    }
+
+    // Write shape geometry, kernels only read entries below the shape count
+
+    const uint32 ShapeGeomByteCount = ShapeGeomArr.GetResourceDataSize();
+
+    void* ShapeGeomDataPtr = RHILockStructuredBuffer(ShapeGeomData.Buffer, 0, ShapeGeomByteCount, RLM_WriteOnly);
+    FMemory::Memcpy(ShapeGeomDataPtr, ShapeGeomArr.GetResourceData(), ShapeGeomByteCount);
+    RHIUnlockStructuredBuffer(ShapeGeomData.Buffer);
+}
+
+void FMarchingSquaresStencilShape::ClearStencil_RT(FRHICommandListImmediate& RHICmdList)
+{
+    ShapeGeomData.Release();
+    ShapeGeomCapacity = 0;
+}
+
+void FMarchingSquaresStencilShape::GenerateVoxelFeatures(const FGenerateVoxelFeatureParameter& Parameter)
+{
+    check(Parameter.Map != nullptr);
+    check(Parameter.Map->HasValidDimension());
+
+    // Construct shape geometry, filter out shapes without area
+
+    FShapeGeomData ShapeGeomArr;
+    ShapeGeomArr.Reserve(Parameter.Shapes.Num());
+
+    FBox2D Bounds(ForceInitToZero);
+
+    for (const FStencilShapeData& Shape : Parameter.Shapes)
+    {
+        FBox2D ShapeBounds;
+
+        if (! GetShapeBounds(Shape, ShapeBounds))
+        {
+            continue;
+        }
+
+        FAlignedShapeGeom ShapeGeom;
+        GetShapeGeom(Shape, ShapeBounds, ShapeGeom);
+
+        ShapeGeomArr.Emplace(ShapeGeom);
+        Bounds += ShapeBounds;
+    }
+
+    if (ShapeGeomArr.Num() < 1)
+    {
+        return;
+    }
+
+    FMarchingSquaresMap* Map(Parameter.Map);
+    Map->InitializeVoxelData();
+
+    FMarchingSquaresStencilShape* Stencil(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilShape_GenerateVoxelFeatures)(
+        [Stencil, Map, ShapeGeomArr, Bounds](FRHICommandListImmediate& RHICmdList) mutable
+        {
+            Stencil->GenerateVoxelFeatures_RT(RHICmdList, *Map, ShapeGeomArr, Bounds);
+        } );
+}
+
+void FMarchingSquaresStencilShape::ClearStencil()
+{
+    FMarchingSquaresStencilShape* Stencil(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilShape_ClearStencil)(
+        [Stencil](FRHICommandListImmediate& RHICmdList)
+        {
+            Stencil->ClearStencil_RT(RHICmdList);
+        } );
+}
+
+bool UMarchingSquaresStencilShapeRef::ConvertShapeEntry(const FMarchingSquaresStencilShapeEntry& Entry, FMarchingSquaresStencilShape::FStencilShapeData& OutShape)
+{
+    typedef FMarchingSquaresStencilShape FShapeType;
+
+    if (Entry.FillType < 0)
+    {
+        return false;
+    }
+
+    switch (Entry.ShapeType)
+    {
+        case EMarchingSquaresStencilShapeType::Capsule:
+            OutShape.ShapeType = FShapeType::SHAPE_TYPE_CAPSULE;
+            break;
+
+        case EMarchingSquaresStencilShapeType::Rectangle:
+            OutShape.ShapeType = FShapeType::SHAPE_TYPE_RECT;
+            break;
+
+        case EMarchingSquaresStencilShapeType::Ring:
+            OutShape.ShapeType = FShapeType::SHAPE_TYPE_RING;
+            break;
+
+        case EMarchingSquaresStencilShapeType::Circle:
+        default:
+            OutShape.ShapeType = FShapeType::SHAPE_TYPE_CIRCLE;
+            break;
+    }
+
+    OutShape.FillType    = FMath::Max(0, Entry.FillType);
+    OutShape.Location    = Entry.Location;
+    OutShape.EndLocation = Entry.EndLocation;
+    OutShape.Extents     = Entry.Extents;
+    OutShape.Radius      = Entry.Radius;
+    OutShape.EndRadius   = Entry.EndRadius;
+    OutShape.InnerRadius = Entry.InnerRadius;
+    OutShape.Rotation    = Entry.Rotation;
+
+    return true;
+}
+
+void UMarchingSquaresStencilShapeRef::ClearStencil()
+{
+    Stencil.ClearStencil();
+}
+
+void UMarchingSquaresStencilShapeRef::ApplyStencilToMap(UMarchingSquaresMapRef* MapRef, int32 FillType)
+{
+    FMarchingSquaresStencilShapeEntry Entry(Shape);
+    Entry.FillType = FillType;
+
+    TArray<FMarchingSquaresStencilShapeEntry> Entries;
+    Entries.Emplace(Entry);
+
+    ApplyStencilBatchToMap(MapRef, Entries);
+}
+
+void UMarchingSquaresStencilShapeRef::ApplyStencilBatchToMap(UMarchingSquaresMapRef* MapRef, const TArray<FMarchingSquaresStencilShapeEntry>& Entries)
+{
+    if (! IsValid(MapRef) || ! MapRef->HasValidMap())
+    {
+        return;
+    }
+
+    typedef FMarchingSquaresStencilShape::FGenerateVoxelFeatureParameter FParameterType;
+    typedef FMarchingSquaresStencilShape::FStencilShapeData FShapeType;
+
+    FParameterType Parameter;
+    Parameter.Map = &MapRef->GetMap();
+    Parameter.Shapes.Reserve(Entries.Num());
+
+    for (const FMarchingSquaresStencilShapeEntry& Entry : Entries)
+    {
+        FShapeType ShapeData;
+
+        if (ConvertShapeEntry(Entry, ShapeData))
+        {
+            Parameter.Shapes.Emplace(ShapeData);
+        }
+    }
+
+    if (Parameter.Shapes.Num() > 0)
+    {
+        Stencil.GenerateVoxelFeatures(Parameter);
+    }
+}
@@ -0,0 +1,256 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresStencilStroke.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+#include "MarchingSquaresMapRef.h"
+
+void FMarchingSquaresStencilStroke::AddPendingShape(const FShapeData& Shape)
+{
+    FBox2D ShapeBounds;
+
+    if (FMarchingSquaresStencilShape::GetShapeBounds(Shape, ShapeBounds))
+    {
+        PendingShapes.Emplace(Shape);
+        PendingBounds += ShapeBounds;
+    }
+}
+
+void FMarchingSquaresStencilStroke::BeginStroke(const FBeginStrokeParameter& Parameter)
+{
+    check(Parameter.Map != nullptr);
+
+    // Flush previous stroke if still active
+    if (bStrokeActive)
+    {
+        EndStroke();
+    }
+
+    if (! Parameter.Map->HasValidDimension())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresStencilStroke::BeginStroke() ABORTED - Invalid map dimension"));
+        return;
+    }
+
+    Map = Parameter.Map;
+    FillType = Parameter.FillType;
+    BuildFillTypes = Parameter.BuildFillTypes;
+    bGenerateWalls = Parameter.bGenerateWalls;
+    SampleSpacing = FMath::Max(0.f, Parameter.SampleSpacing);
+
+    bStrokeActive = true;
+    bHasLastSample = false;
+
+    PendingShapes.Reset();
+    PendingBounds = FBox2D(ForceInitToZero);
+
+    // Record all stroke stamps as a single history entry
+    Map->BeginHistoryGroup();
+}
+
+void FMarchingSquaresStencilStroke::AddSample(const FVector2D& Location, float Radius)
+{
+    if (! bStrokeActive || Radius <= KINDA_SMALL_NUMBER)
+    {
+        return;
+    }
+
+    FShapeData Shape;
+    Shape.FillType    = FillType;
+    Shape.Location    = Location;
+    Shape.EndLocation = Location;
+    Shape.Extents     = FVector2D::ZeroVector;
+    Shape.Radius      = Radius;
+    Shape.EndRadius   = Radius;
+    Shape.InnerRadius = 0.f;
+    Shape.Rotation    = 0.f;
+
+    // First sample, stamp brush circle
+
+    if (! bHasLastSample)
+    {
+        Shape.ShapeType = FMarchingSquaresStencilShape::SHAPE_TYPE_CIRCLE;
+        AddPendingShape(Shape);
+    }
+    else
+    {
+        // Skip samples too close to the last sample, sweep continues
+        // from the last stamped sample
+
+        const float MinRadius = FMath::Min(Radius, LastSampleRadius);
+        const float MinSpacing = SampleSpacing * MinRadius;
+
+        if (FVector2D::DistSquared(LastSampleLocation, Location) < (MinSpacing*MinSpacing))
+        {
+            return;
+        }
+
+        // Sweep brush from last sample to the current sample
+
+        Shape.ShapeType = FMarchingSquaresStencilShape::SHAPE_TYPE_CAPSULE;
+        Shape.Location  = LastSampleLocation;
+        Shape.Radius    = LastSampleRadius;
+        AddPendingShape(Shape);
+    }
+
+    bHasLastSample = true;
+    LastSampleLocation = Location;
+    LastSampleRadius = Radius;
+}
+
+void FMarchingSquaresStencilStroke::FlushStroke()
+{
+    if (! bStrokeActive || PendingShapes.Num() < 1)
+    {
+        return;
+    }
+
+    check(Map != nullptr);
+
+    // Stamp pending shapes
+
+    FMarchingSquaresStencilShape::FGenerateVoxelFeatureParameter Parameter;
+    Parameter.Map = Map;
+    Parameter.Shapes = MoveTemp(PendingShapes);
+
+    ShapeStencil.GenerateVoxelFeatures(Parameter);
+
+    // Rebuild blocks covered by the stamped bounds, grown by the distance
+    // range if the stamp also updated voxel distance around the shapes
+
+    const int32 RectPadding = (Map->DistanceLayerCount > 0) ? FMath::CeilToInt(Map->DistanceRange)+1 : 1;
+
+    FIntRect VoxelRect;
+    VoxelRect.Min.X = FMath::FloorToInt(PendingBounds.Min.X)-RectPadding;
+    VoxelRect.Min.Y = FMath::FloorToInt(PendingBounds.Min.Y)-RectPadding;
+    VoxelRect.Max.X = FMath::CeilToInt(PendingBounds.Max.X)+RectPadding;
+    VoxelRect.Max.Y = FMath::CeilToInt(PendingBounds.Max.Y)+RectPadding;
+
+    for (uint32 BuildFillType : BuildFillTypes)
+    {
+        Map->BuildMapRect(BuildFillType, bGenerateWalls, VoxelRect);
+    }
+
+    PendingShapes.Reset();
+    PendingBounds = FBox2D(ForceInitToZero);
+}
+
+void FMarchingSquaresStencilStroke::EndStroke()
+{
+    FlushStroke();
+
+    if (bStrokeActive && Map != nullptr)
+    {
+        Map->EndHistoryGroup();
+    }
+
+    bStrokeActive = false;
+    bHasLastSample = false;
+    Map = nullptr;
+}
+
+void FMarchingSquaresStencilStroke::ClearStencil()
+{
+    if (bStrokeActive && Map != nullptr)
+    {
+        Map->EndHistoryGroup();
+    }
+
+    bStrokeActive = false;
+    bHasLastSample = false;
+    Map = nullptr;
+
+    PendingShapes.Reset();
+    PendingBounds = FBox2D(ForceInitToZero);
+
+    ShapeStencil.ClearStencil();
+}
+
+void UMarchingSquaresStencilStrokeRef::BeginStroke(UMarchingSquaresMapRef* MapRef, int32 FillType, const TArray<int32>& BuildFillTypes)
+{
+    if (FillType < 0 || ! IsValid(MapRef) || ! MapRef->HasValidMap())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("UMarchingSquaresStencilStrokeRef::BeginStroke() ABORTED - Invalid map or fill type"));
+        return;
+    }
+
+    FMarchingSquaresStencilStroke::FBeginStrokeParameter Parameter;
+    Parameter.Map = &MapRef->GetMap();
+    Parameter.FillType = FMath::Max(0, FillType);
+    Parameter.bGenerateWalls = bGenerateWalls;
+    Parameter.SampleSpacing = SampleSpacing;
+
+    for (int32 BuildFillType : BuildFillTypes)
+    {
+        if (BuildFillType >= 0)
+        {
+            Parameter.BuildFillTypes.AddUnique(BuildFillType);
+        }
+    }
+
+    StrokeMapRef = MapRef;
+    Stencil.BeginStroke(Parameter);
+}
+
+void UMarchingSquaresStencilStrokeRef::AddStrokeSample(FVector2D Location, float Radius)
+{
+    if (IsValid(StrokeMapRef))
+    {
+        Stencil.AddSample(Location, Radius);
+    }
+}
+
+void UMarchingSquaresStencilStrokeRef::FlushStroke()
+{
+    if (IsValid(StrokeMapRef))
+    {
+        Stencil.FlushStroke();
+    }
+}
+
+void UMarchingSquaresStencilStrokeRef::EndStroke()
+{
+    if (IsValid(StrokeMapRef))
+    {
+        Stencil.EndStroke();
+    }
+
+    StrokeMapRef = nullptr;
+}
+
+bool UMarchingSquaresStencilStrokeRef::IsStrokeActive() const
+{
+    return IsValid(StrokeMapRef) && Stencil.IsStrokeActive();
+}
+
+void UMarchingSquaresStencilStrokeRef::ClearStencil()
+{
+    Stencil.ClearStencil();
+    StrokeMapRef = nullptr;
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresStencilTexturePool.h"
+
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+
+#include "MarchingSquaresPlugin.h"
+
+void FMarchingSquaresStencilTexture::Release()
+{
+    UAV.SafeRelease();
+    SRV.SafeRelease();
+    Texture.SafeRelease();
+    Size   = FIntPoint::ZeroValue;
+    Format = PF_Unknown;
+}
+
+FMarchingSquaresStencilTexturePool& FMarchingSquaresStencilTexturePool::Get()
+{
+    static FMarchingSquaresStencilTexturePool Pool;
+    return Pool;
+}
+
+FIntPoint FMarchingSquaresStencilTexturePool::GetTileScratchSize(const FIntPoint& RectSize)
+{
+    return FIntPoint(
+        FMath::DivideAndRoundUp(FMath::Max(RectSize.X, 1), (int32) TILE_SIZE_GRANULARITY) * TILE_SIZE_GRANULARITY,
+        FMath::DivideAndRoundUp(FMath::Max(RectSize.Y, 1), (int32) TILE_SIZE_GRANULARITY) * TILE_SIZE_GRANULARITY
+        );
+}
+
+void FMarchingSquaresStencilTexturePool::Borrow_RT(const FIntPoint& Size, EPixelFormat Format, FMarchingSquaresStencilTexture& OutTexture)
+{
+    check(IsInRenderingThread());
+    check(Size.X > 0);
+    check(Size.Y > 0);
+    check(! OutTexture.IsValid());
+
+    // Reuse most recently returned texture with matching size and format
+
+    for (int32 i=FreeTextures.Num()-1; i>=0; --i)
+    {
+        const FMarchingSquaresStencilTexture& FreeTexture(FreeTextures[i]);
+
+        if (FreeTexture.Size == Size && FreeTexture.Format == Format)
+        {
+            OutTexture = FreeTexture;
+            FreeTextures.RemoveAt(i, 1, false);
+            return;
+        }
+    }
+
+    // No matching idle texture, create new texture
+
+    FRHIResourceCreateInfo CreateInfo;
+    OutTexture.Texture = RHICreateTexture2D(
+        Size.X,
+        Size.Y,
+        Format,
+        1,
+        1,
+        TexCreate_ShaderResource | TexCreate_UAV,
+        CreateInfo
+        );
+
+    OutTexture.UAV = RHICreateUnorderedAccessView(OutTexture.Texture);
+    OutTexture.SRV = RHICreateShaderResourceView(OutTexture.Texture, 0);
+    OutTexture.Size   = Size;
+    OutTexture.Format = Format;
+
+    UE_LOG(LogMSQ,Verbose, TEXT("FMarchingSquaresStencilTexturePool::Borrow_RT() Created pool texture (%d, %d)"), Size.X, Size.Y);
+}
+
+void FMarchingSquaresStencilTexturePool::Return_RT(FMarchingSquaresStencilTexture& Texture)
+{
+    check(IsInRenderingThread());
+
+    if (! Texture.IsValid())
+    {
+        Texture.Release();
+        return;
+    }
+
+    // Release least recently returned texture if the pool is full
+
+    if (FreeTextures.Num() >= MAX_FREE_TEXTURE_COUNT)
+    {
+        FreeTextures[0].Release();
+        FreeTextures.RemoveAt(0, 1, false);
+    }
+
+    FreeTextures.Emplace(Texture);
+
+    Texture = FMarchingSquaresStencilTexture();
+}
+
+void FMarchingSquaresStencilTexturePool::ReleaseResources_RT()
+{
+    check(IsInRenderingThread());
+
+    for (FMarchingSquaresStencilTexture& FreeTexture : FreeTextures)
+    {
+        FreeTexture.Release();
+    }
+
+    FreeTextures.Empty();
+}
+
+void FMarchingSquaresStencilTexturePool::ReleaseResources()
+{
+    FMarchingSquaresStencilTexturePool* Pool(this);
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresStencilTexturePool_ReleaseResources)(
+        [Pool](FRHICommandListImmediate& RHICmdList)
+        {
+            Pool->ReleaseResources_RT();
+        } );
+}
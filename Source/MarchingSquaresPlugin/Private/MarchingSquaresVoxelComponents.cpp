@@ -0,0 +1,528 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresVoxelComponents.h"
+
+#include "Async/ParallelFor.h"
+#include "MarchingSquaresVoxelMirror.h"
+
+namespace MarchingSquaresVoxelComponentsUtils
+{
+    FORCEINLINE int32 FindRoot(TArray<int32>& Parents, int32 i)
+    {
+        while (Parents[i] != i)
+        {
+            Parents[i] = Parents[Parents[i]];
+            i = Parents[i];
+        }
+
+        return i;
+    }
+
+    FORCEINLINE void Union(TArray<int32>& Parents, int32 A, int32 B)
+    {
+        A = FindRoot(Parents, A);
+        B = FindRoot(Parents, B);
+
+        // Lower index is kept as root for deterministic component order
+
+        if (A < B)
+        {
+            Parents[B] = A;
+        }
+        else
+        if (B < A)
+        {
+            Parents[A] = B;
+        }
+    }
+
+    // Connect corner voxels of a cell. Corner states are in build case code
+    // order. Diagonal corners of a saddle cell are connected if the cell
+    // center is resolved to their fill type, see CellWriteCaseKernel.
+    template<typename FConnectFunc>
+    FORCEINLINE void ConnectCell(const uint32 States[4], FConnectFunc Connect)
+    {
+        const uint32 f0 = States[0] & 0xFF;
+        const uint32 f1 = States[1] & 0xFF;
+        const uint32 f2 = States[2] & 0xFF;
+        const uint32 f3 = States[3] & 0xFF;
+        const uint32 fc = (States[0] >> 8) & 0xFF;
+
+        if (f0 == f1) Connect(0, 1);
+        if (f0 == f2) Connect(0, 2);
+        if (f1 == f3) Connect(1, 3);
+        if (f2 == f3) Connect(2, 3);
+
+        if (f0 == f3 && f1 != f0 && f2 != f0 && fc == f0) Connect(0, 3);
+        if (f1 == f2 && f0 != f1 && f3 != f1 && fc == f1) Connect(1, 2);
+    }
+}
+
+FMarchingSquaresVoxelComponents::~FMarchingSquaresVoxelComponents()
+{
+    // Wait for in-flight update, the task references this object
+
+    if (UpdateTask.IsValid() && ! UpdateTask->IsComplete())
+    {
+        FTaskGraphInterface::Get().WaitUntilTaskCompletes(UpdateTask);
+    }
+}
+
+void FMarchingSquaresVoxelComponents::LabelBlock(FBlockLabels& Block)
+{
+    using namespace MarchingSquaresVoxelComponentsUtils;
+
+    const FIntPoint Size(Block.VoxelRect.Size());
+    const int32 VoxelCount = Size.X * Size.Y;
+
+    Block.Labels.Reset();
+    Block.LabelFillTypes.Reset();
+    Block.LabelSizes.Reset();
+    Block.LabelBounds.Reset();
+    Block.LabelComponents.Reset();
+
+    if (Block.States.Num() != VoxelCount)
+    {
+        return;
+    }
+
+    // Connect voxels of cells within the block, cells across block borders
+    // are connected on merge
+
+    TArray<int32> Parents;
+    Parents.SetNumUninitialized(VoxelCount);
+
+    for (int32 i=0; i<VoxelCount; ++i)
+    {
+        Parents[i] = i;
+    }
+
+    for (int32 y=0; y<Size.Y-1; ++y)
+    for (int32 x=0; x<Size.X-1; ++x)
+    {
+        const int32 i0 = x + y*Size.X;
+        const int32 Indices[4] = { i0, i0+1, i0+Size.X, i0+Size.X+1 };
+        const uint32 States[4] = {
+            Block.States[Indices[0]],
+            Block.States[Indices[1]],
+            Block.States[Indices[2]],
+            Block.States[Indices[3]]
+            };
+
+        ConnectCell(States, [&](int32 A, int32 B)
+        {
+            Union(Parents, Indices[A], Indices[B]);
+        } );
+    }
+
+    // Compact root voxels to local labels
+
+    TArray<int32> RootLabels;
+    RootLabels.Init(-1, VoxelCount);
+
+    Block.Labels.SetNumUninitialized(VoxelCount);
+
+    for (int32 i=0; i<VoxelCount; ++i)
+    {
+        const FIntPoint Voxel(Block.VoxelRect.Min + FIntPoint(i % Size.X, i / Size.X));
+        int32& Label(RootLabels[FindRoot(Parents, i)]);
+
+        if (Label < 0)
+        {
+            Label = Block.LabelSizes.Num();
+            Block.LabelFillTypes.Emplace(static_cast<uint8>(Block.States[i] & 0xFF));
+            Block.LabelSizes.Emplace(0);
+            Block.LabelBounds.Emplace(Voxel, Voxel + FIntPoint(1,1));
+        }
+
+        FIntRect& Bounds(Block.LabelBounds[Label]);
+        Bounds.Min = Bounds.Min.ComponentMin(Voxel);
+        Bounds.Max = Bounds.Max.ComponentMax(Voxel + FIntPoint(1,1));
+
+        Block.Labels[i] = static_cast<uint16>(Label);
+        ++Block.LabelSizes[Label];
+    }
+}
+
+void FMarchingSquaresVoxelComponents::MergeBlocks()
+{
+    using namespace MarchingSquaresVoxelComponentsUtils;
+
+    enum { BLOCK_SIZE = FMarchingSquaresVoxelMirror::BLOCK_SIZE };
+
+    Components.Reset();
+
+    // Global label offset of each block
+
+    TArray<int32> LabelOffsets;
+    LabelOffsets.SetNumUninitialized(Blocks.Num());
+
+    int32 LabelCount = 0;
+
+    for (int32 i=0; i<Blocks.Num(); ++i)
+    {
+        LabelOffsets[i] = LabelCount;
+        LabelCount += Blocks[i].LabelSizes.Num();
+    }
+
+    TArray<int32> Parents;
+    Parents.SetNumUninitialized(LabelCount);
+
+    for (int32 i=0; i<LabelCount; ++i)
+    {
+        Parents[i] = i;
+    }
+
+    // Returns global label and voxel state, -1 if the block has no labels
+
+    auto GetVoxelLabel = [&](const FIntPoint& Voxel, uint32& OutState) -> int32
+    {
+        const int32 BlockIndex = (Voxel.X / BLOCK_SIZE) + (Voxel.Y / BLOCK_SIZE) * BlockCount.X;
+        const FBlockLabels& Block(Blocks[BlockIndex]);
+
+        if (Block.Labels.Num() == 0)
+        {
+            OutState = 0;
+            return -1;
+        }
+
+        const FIntPoint Local(Voxel - Block.VoxelRect.Min);
+        const int32 LocalIndex = Local.X + Local.Y * Block.VoxelRect.Width();
+
+        OutState = Block.States[LocalIndex];
+        return LabelOffsets[BlockIndex] + Block.Labels[LocalIndex];
+    };
+
+    auto ConnectBorderCell = [&](int32 x, int32 y)
+    {
+        int32 Labels[4];
+        uint32 States[4];
+
+        Labels[0] = GetVoxelLabel(FIntPoint(x  , y  ), States[0]);
+        Labels[1] = GetVoxelLabel(FIntPoint(x+1, y  ), States[1]);
+        Labels[2] = GetVoxelLabel(FIntPoint(x  , y+1), States[2]);
+        Labels[3] = GetVoxelLabel(FIntPoint(x+1, y+1), States[3]);
+
+        ConnectCell(States, [&](int32 A, int32 B)
+        {
+            if (Labels[A] >= 0 && Labels[B] >= 0)
+            {
+                Union(Parents, Labels[A], Labels[B]);
+            }
+        } );
+    };
+
+    // Connect labels of cells across block borders
+
+    for (int32 by=0; by<BlockCount.Y; ++by)
+    for (int32 bx=0; bx<BlockCount.X; ++bx)
+    {
+        const FIntRect& VoxelRect(Blocks[bx + by*BlockCount.X].VoxelRect);
+
+        if (bx+1 < BlockCount.X)
+        {
+            const int32 x = VoxelRect.Max.X-1;
+
+            for (int32 y=VoxelRect.Min.Y; y<FMath::Min(VoxelRect.Max.Y, Dimension.Y-1); ++y)
+            {
+                ConnectBorderCell(x, y);
+            }
+        }
+
+        if (by+1 < BlockCount.Y)
+        {
+            const int32 y = VoxelRect.Max.Y-1;
+
+            for (int32 x=VoxelRect.Min.X; x<FMath::Min(VoxelRect.Max.X, Dimension.X-1); ++x)
+            {
+                ConnectBorderCell(x, y);
+            }
+        }
+    }
+
+    // Assign component ids and accumulate component data
+
+    TArray<int32> RootComponents;
+    RootComponents.Init(-1, LabelCount);
+
+    for (int32 i=0; i<Blocks.Num(); ++i)
+    {
+        FBlockLabels& Block(Blocks[i]);
+        const int32 BlockLabelCount = Block.LabelSizes.Num();
+
+        Block.LabelComponents.SetNumUninitialized(BlockLabelCount);
+
+        for (int32 Label=0; Label<BlockLabelCount; ++Label)
+        {
+            int32& ComponentId(RootComponents[FindRoot(Parents, LabelOffsets[i] + Label)]);
+
+            if (ComponentId < 0)
+            {
+                ComponentId = Components.Num();
+
+                FComponent& Component(Components[Components.AddDefaulted()]);
+                Component.FillType = Block.LabelFillTypes[Label];
+                Component.Bounds = Block.LabelBounds[Label];
+            }
+
+            FComponent& Component(Components[ComponentId]);
+            Component.VoxelCount += Block.LabelSizes[Label];
+            Component.Bounds.Min = Component.Bounds.Min.ComponentMin(Block.LabelBounds[Label].Min);
+            Component.Bounds.Max = Component.Bounds.Max.ComponentMax(Block.LabelBounds[Label].Max);
+
+            Block.LabelComponents[Label] = ComponentId;
+        }
+    }
+}
+
+void FMarchingSquaresVoxelComponents::Update(const FMarchingSquaresVoxelMirror& Mirror)
+{
+    enum { BLOCK_SIZE = FMarchingSquaresVoxelMirror::BLOCK_SIZE };
+
+    TArray<uint32> BlockRevisions;
+    FIntPoint MirrorBlockCount;
+
+    const uint32 Revision = Mirror.GetBlockRevisions(BlockRevisions, MirrorBlockCount);
+    const FIntPoint MirrorDimension(Mirror.GetDimension());
+
+    bool bReset;
+    uint32 PrevRevision;
+
+    {
+        FRWScopeLock ScopeLock(LabelLock, SLT_ReadOnly);
+        bReset = (BlockCount != MirrorBlockCount) || (Dimension != MirrorDimension) || (Blocks.Num() != BlockRevisions.Num());
+        PrevRevision = MirrorRevision;
+    }
+
+    // Copy and label blocks written since the previous update
+
+    TArray<FBlockLabels> DirtyBlocks;
+    TArray<int32> DirtyBlockIndices;
+
+    for (int32 by=0; by<MirrorBlockCount.Y; ++by)
+    for (int32 bx=0; bx<MirrorBlockCount.X; ++bx)
+    {
+        const int32 BlockIndex = bx + by*MirrorBlockCount.X;
+
+        if (bReset || BlockRevisions[BlockIndex] > PrevRevision)
+        {
+            const FIntPoint VoxelMin(bx*BLOCK_SIZE, by*BLOCK_SIZE);
+            const FIntPoint VoxelMax(VoxelMin + FIntPoint(BLOCK_SIZE, BLOCK_SIZE));
+
+            FBlockLabels& Block(DirtyBlocks[DirtyBlocks.AddDefaulted()]);
+            Block.VoxelRect = FIntRect(VoxelMin, VoxelMax.ComponentMin(MirrorDimension));
+            DirtyBlockIndices.Emplace(BlockIndex);
+        }
+    }
+
+    ParallelFor(DirtyBlocks.Num(), [&](int32 i)
+    {
+        FBlockLabels& Block(DirtyBlocks[i]);
+
+        if (Mirror.CopyVoxelStates(Block.VoxelRect, Block.States))
+        {
+            LabelBlock(Block);
+        }
+    } );
+
+    FRWScopeLock ScopeLock(LabelLock, SLT_Write);
+
+    if (bReset)
+    {
+        Blocks.Reset();
+        Blocks.SetNum(BlockRevisions.Num());
+        BlockCount = MirrorBlockCount;
+        Dimension = MirrorDimension;
+    }
+
+    for (int32 i=0; i<DirtyBlocks.Num(); ++i)
+    {
+        Blocks[DirtyBlockIndices[i]] = MoveTemp(DirtyBlocks[i]);
+    }
+
+    MirrorRevision = Revision;
+
+    MergeBlocks();
+}
+
+bool FMarchingSquaresVoxelComponents::UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, TFunction<void()> OnComplete)
+{
+    if (bUpdating.AtomicSet(true))
+    {
+        return false;
+    }
+
+    const FMarchingSquaresVoxelMirror* MirrorPtr(&Mirror);
+
+    UpdateTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this, MirrorPtr, OnComplete]()
+        {
+            Update(*MirrorPtr);
+            bUpdating = false;
+
+            if (OnComplete)
+            {
+                OnComplete();
+            }
+        },
+        TStatId(),
+        nullptr,
+        ENamedThreads::AnyBackgroundThreadNormalTask
+        );
+
+    return true;
+}
+
+void FMarchingSquaresVoxelComponents::Reset()
+{
+    FRWScopeLock ScopeLock(LabelLock, SLT_Write);
+
+    Dimension = FIntPoint::ZeroValue;
+    BlockCount = FIntPoint::ZeroValue;
+    MirrorRevision = 0;
+
+    Blocks.Empty();
+    Components.Empty();
+}
+
+// QUERY FUNCTIONS
+
+int32 FMarchingSquaresVoxelComponents::GetComponentCount() const
+{
+    FRWScopeLock ScopeLock(LabelLock, SLT_ReadOnly);
+    return Components.Num();
+}
+
+bool FMarchingSquaresVoxelComponents::GetComponent(int32 ComponentId, FComponent& OutComponent) const
+{
+    FRWScopeLock ScopeLock(LabelLock, SLT_ReadOnly);
+
+    if (! Components.IsValidIndex(ComponentId))
+    {
+        return false;
+    }
+
+    OutComponent = Components[ComponentId];
+    return true;
+}
+
+TArray<FMarchingSquaresVoxelComponents::FComponent> FMarchingSquaresVoxelComponents::GetComponents() const
+{
+    FRWScopeLock ScopeLock(LabelLock, SLT_ReadOnly);
+    return Components;
+}
+
+int32 FMarchingSquaresVoxelComponents::GetComponentIdUnlocked(const FIntPoint& Voxel) const
+{
+    enum { BLOCK_SIZE = FMarchingSquaresVoxelMirror::BLOCK_SIZE };
+
+    if (Voxel.X < 0 || Voxel.Y < 0 || Voxel.X >= Dimension.X || Voxel.Y >= Dimension.Y)
+    {
+        return -1;
+    }
+
+    const FBlockLabels& Block(Blocks[(Voxel.X / BLOCK_SIZE) + (Voxel.Y / BLOCK_SIZE) * BlockCount.X]);
+
+    if (Block.Labels.Num() == 0)
+    {
+        return -1;
+    }
+
+    const FIntPoint Local(Voxel - Block.VoxelRect.Min);
+    return Block.LabelComponents[Block.Labels[Local.X + Local.Y * Block.VoxelRect.Width()]];
+}
+
+int32 FMarchingSquaresVoxelComponents::GetComponentId(const FIntPoint& Voxel) const
+{
+    FRWScopeLock ScopeLock(LabelLock, SLT_ReadOnly);
+    return GetComponentIdUnlocked(Voxel);
+}
+
+int32 FMarchingSquaresVoxelComponents::GetComponentId(const FMarchingSquaresVoxelMirror& Mirror, const FVector2D& Point, uint8 FillType) const
+{
+    const FIntPoint MirrorDimension(Mirror.GetDimension());
+
+    if (Point.X < 0.f || Point.Y < 0.f || Point.X > (MirrorDimension.X-1) || Point.Y > (MirrorDimension.Y-1))
+    {
+        return -1;
+    }
+
+    const FIntPoint Cell(
+        FMath::Min(FMath::FloorToInt(Point.X), MirrorDimension.X-2),
+        FMath::Min(FMath::FloorToInt(Point.Y), MirrorDimension.Y-2)
+        );
+    const FVector2D LocalPoint(Point - FVector2D(Cell));
+
+    FMarchingSquaresVoxelMirror::FCellGeometry Geometry;
+
+    if (! Mirror.GetCellGeometry(Cell, FillType, Geometry) || ! FMarchingSquaresVoxelMirror::IsCellPointFilled(Geometry, LocalPoint))
+    {
+        return -1;
+    }
+
+    // The nearest filled corner belongs to the cell region containing the
+    // point, saddle corner regions are separated by the cell diagonal
+
+    int32 NearestCorner = -1;
+    float NearestDistSq = BIG_NUMBER;
+
+    for (int32 Corner=0; Corner<4; ++Corner)
+    {
+        if (Geometry.IsCornerFilled(Corner))
+        {
+            const FVector2D CornerPoint(Corner & 1, Corner >> 1);
+            const float DistSq = FVector2D::DistSquared(CornerPoint, LocalPoint);
+
+            if (DistSq < NearestDistSq)
+            {
+                NearestCorner = Corner;
+                NearestDistSq = DistSq;
+            }
+        }
+    }
+
+    if (NearestCorner < 0)
+    {
+        return -1;
+    }
+
+    const FIntPoint Voxel(Cell + FIntPoint(NearestCorner & 1, NearestCorner >> 1));
+
+    FRWScopeLock ScopeLock(LabelLock, SLT_ReadOnly);
+
+    const int32 ComponentId = GetComponentIdUnlocked(Voxel);
+
+    // Labels may lag mirror data, reject stale labels of other fill types
+
+    if (ComponentId >= 0 && Components[ComponentId].FillType != FillType)
+    {
+        return -1;
+    }
+
+    return ComponentId;
+}
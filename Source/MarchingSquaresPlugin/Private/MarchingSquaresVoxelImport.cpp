@@ -0,0 +1,605 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresVoxelImport.h"
+
+#include "Async/ParallelFor.h"
+#include "ShaderParameters.h"
+#include "ShaderCore.h"
+#include "ShaderParameterUtils.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+#include "Shaders/RULShaderDefinitions.h"
+
+// COMPUTE SHADER DEFINITIONS
+
+class FMSQVoxelImportCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQVoxelImportCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "FillTypeTexture", FillTypeTexture,
+        "EdgeTexture",     EdgeTexture
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelStateData",   OutVoxelStateData,
+        "OutVoxelFeatureData", OutVoxelFeatureData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_8(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",          Params_MapDimension,
+        "_DispatchOffset",  Params_DispatchOffset,
+        "_DispatchDim",     Params_DispatchDim,
+        "_ImportOffset",    Params_ImportOffset,
+        "_ImportRect",      Params_ImportRect,
+        "_FillTypeMask",    Params_FillTypeMask,
+        "_EdgeMask",        Params_EdgeMask,
+        "_bUseEdgeTexture", Params_bUseEdgeTexture
+        )
+};
+
+class FMSQVoxelImportDistanceCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQVoxelImportDistanceCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_2(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "VoxelStateData",   VoxelStateData,
+        "VoxelFeatureData", VoxelFeatureData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutVoxelDistanceData", OutVoxelDistanceData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_5(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",             Params_MapDimension,
+        "_DispatchOffset",     Params_DispatchOffset,
+        "_DispatchDim",        Params_DispatchDim,
+        "_DistanceLayerCount", Params_DistanceLayerCount,
+        "_DistanceRange",      Params_DistanceRange
+        )
+};
+
+IMPLEMENT_SHADER_TYPE(, FMSQVoxelImportCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresVoxelImportCS.usf"), TEXT("VoxelImportKernel"), SF_Compute);
+
+IMPLEMENT_SHADER_TYPE(, FMSQVoxelImportDistanceCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresVoxelImportCS.usf"), TEXT("VoxelImportDistanceKernel"), SF_Compute);
+
+// CPU import implementation
+//
+// Mirrors VoxelImportKernel of MarchingSquaresVoxelImportCS.usf
+
+namespace MarchingSquaresVoxelImportCPU
+{
+    typedef FMarchingSquaresVoxelImport::FImportImage FImportImage;
+
+    // Number of voxel rows processed per parallel task
+    enum { ROW_BAND_SIZE = 16 };
+
+    static const float EDGE_GRADIENT_EPSILON = 1e-3f;
+
+    struct FImportContext
+    {
+        const FImportImage& Image;
+        const FMarchingSquaresCPUVoxelData& VoxelData;
+        FIntPoint Offset;
+        FIntRect  ImportRect;
+        bool      bUseEdgeData;
+
+        FORCEINLINE bool IsImportVoxel(const FIntPoint& p) const
+        {
+            return p.X >= ImportRect.Min.X && p.Y >= ImportRect.Min.Y
+                && p.X <  ImportRect.Max.X && p.Y <  ImportRect.Max.Y;
+        }
+
+        FORCEINLINE uint32 LoadFillType(const FIntPoint& p) const
+        {
+            const FIntPoint t(p - Offset);
+            return Image.FillTypeData[t.X + t.Y*Image.Size.X];
+        }
+
+        // Returns edge coverage, coordinate is clamped to the import rect
+        FORCEINLINE float LoadEdge(const FIntPoint& p) const
+        {
+            const FIntPoint c(
+                FMath::Clamp(p.X, ImportRect.Min.X, ImportRect.Max.X-1),
+                FMath::Clamp(p.Y, ImportRect.Min.Y, ImportRect.Max.Y-1)
+                );
+            const FIntPoint t(c - Offset);
+            return Image.EdgeData[t.X + t.Y*Image.Size.X] / 255.f;
+        }
+
+        FORCEINLINE uint32 GetVoxelState(const FIntPoint& p) const
+        {
+            return IsImportVoxel(p)
+                ? LoadFillType(p)
+                : (VoxelData.VoxelStateData[p.X + p.Y*VoxelData.Dimension.X] & 0xFF);
+        }
+
+        FORCEINLINE FVector2D GetEdgeGradient(const FIntPoint& p) const
+        {
+            return .5f * FVector2D(
+                LoadEdge(p+FIntPoint(1,0)) - LoadEdge(p-FIntPoint(1,0)),
+                LoadEdge(p+FIntPoint(0,1)) - LoadEdge(p-FIntPoint(0,1))
+                );
+        }
+    };
+
+    FORCEINLINE uint32 EncodeEdgeFeature(float Alpha, float HeadingAngle)
+    {
+        const uint32 UN8 = uint32(FMath::Clamp(Alpha, 0.f, 1.f) * 255.f) & 0xFF;
+        const uint32 SN8 = uint32((HeadingAngle+1.0f) * 127.f);
+        return UN8 | (SN8 << 8);
+    }
+
+    uint32 GetImportEdgeFeature(const FImportContext& Context, const FIntPoint& p0, const FIntPoint& p1, uint32 s0, uint32 s1)
+    {
+        const FVector2D Axis(p1.X-p0.X, p1.Y-p0.Y);
+        FVector2D n = (s0 > s1) ? Axis : -Axis;
+        float Alpha = .5f;
+
+        if (Context.bUseEdgeData && Context.IsImportVoxel(p0) && Context.IsImportVoxel(p1))
+        {
+            const float f0 = Context.LoadEdge(p0) - .5f;
+            const float f1 = Context.LoadEdge(p1) - .5f;
+
+            if ((f0 < 0.f) != (f1 < 0.f))
+            {
+                Alpha = FMath::Clamp(f0 / (f0-f1), 0.f, 1.f);
+            }
+
+            const FVector2D g = FMath::Lerp(Context.GetEdgeGradient(p0), Context.GetEdgeGradient(p1), Alpha);
+
+            if (FMath::Min(s0, s1) == 0 && g.Size() > EDGE_GRADIENT_EPSILON)
+            {
+                n = -g;
+            }
+        }
+
+        return EncodeEdgeFeature(Alpha, FMath::Atan2(n.X, -n.Y) * INV_PI);
+    }
+}
+
+FIntRect FMarchingSquaresVoxelImport::GetImportRect(const FIntPoint& Dimension, const FIntPoint& Offset, const FIntPoint& ImageSize)
+{
+    FIntRect ImportRect;
+    ImportRect.Min.X = FMath::Clamp(Offset.X, 0, Dimension.X);
+    ImportRect.Min.Y = FMath::Clamp(Offset.Y, 0, Dimension.Y);
+    ImportRect.Max.X = FMath::Clamp(Offset.X+ImageSize.X, 0, Dimension.X);
+    ImportRect.Max.Y = FMath::Clamp(Offset.Y+ImageSize.Y, 0, Dimension.Y);
+    return ImportRect;
+}
+
+FVector4 FMarchingSquaresVoxelImport::GetChannelMask(EMarchingSquaresImportChannel Channel)
+{
+    switch (Channel)
+    {
+        case EMarchingSquaresImportChannel::Green: return FVector4(0.f, 1.f, 0.f, 0.f);
+        case EMarchingSquaresImportChannel::Blue:  return FVector4(0.f, 0.f, 1.f, 0.f);
+        case EMarchingSquaresImportChannel::Alpha: return FVector4(0.f, 0.f, 0.f, 1.f);
+
+        case EMarchingSquaresImportChannel::Red:
+        default:
+            return FVector4(1.f, 0.f, 0.f, 0.f);
+    }
+}
+
+void FMarchingSquaresVoxelImport::ImportTextureSRV_RT(
+    FRHICommandListImmediate& RHICmdList,
+    FMarchingSquaresMap& Map,
+    const FIntPoint& Offset,
+    const FIntPoint& ImageSize,
+    const FVector4& FillTypeMask,
+    const FVector4& EdgeMask,
+    FShaderResourceViewRHIParamRef FillTypeSRV,
+    FShaderResourceViewRHIParamRef EdgeSRV
+    )
+{
+    check(IsInRenderingThread());
+    check(Map.HasValidDimension_RT());
+    check(FillTypeSRV != nullptr);
+
+    const FIntPoint Dimension(Map.GetDimension_RT());
+    const FIntRect ImportRect(GetImportRect(Dimension, Offset, ImageSize));
+
+    // Image is completely outside the map, abort
+    if (ImportRect.Area() <= 0)
+    {
+        return;
+    }
+
+    // Dispatch rect is grown by a single voxel towards the rect min to
+    // update edge features of voxels just before the import rect
+
+    FIntRect DispatchRect(ImportRect);
+    DispatchRect.Min.X = FMath::Max(0, DispatchRect.Min.X-1);
+    DispatchRect.Min.Y = FMath::Max(0, DispatchRect.Min.Y-1);
+
+    // Voxel distance is regenerated over the dispatch rect grown by the
+    // distance range, covering every voxel within range of a changed edge
+
+    FIntRect DistanceRect(DispatchRect);
+
+    if (Map.HasVoxelDistanceData_RT())
+    {
+        DistanceRect.InflateRect(FMath::CeilToInt(Map.GetDistanceRange_RT()));
+        DistanceRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension));
+    }
+
+    const FIntPoint DispatchOffset = DispatchRect.Min;
+    const FIntPoint DispatchDim    = DispatchRect.Size();
+    const FUintVector4 ImportRectParam(ImportRect.Min.X, ImportRect.Min.Y, ImportRect.Max.X, ImportRect.Max.Y);
+    const uint32 bUseEdgeTexture = (EdgeSRV != nullptr) ? 1 : 0;
+
+    FRULRWBuffer VoxelStateData(Map.GetVoxelStateData());
+    FRULRWBuffer VoxelFeatureData(Map.GetVoxelFeatureData());
+
+    TShaderMap<FGlobalShaderType>* RHIShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    Map.BeginVoxelEdit_RT(DistanceRect);
+
+    RHICmdList.BeginComputePass(TEXT("VoxelImport"));
+    {
+        TShaderMapRef<FMSQVoxelImportCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("FillTypeTexture"), FillTypeSRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("EdgeTexture"), bUseEdgeTexture ? EdgeSRV : FillTypeSRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelStateData"), VoxelStateData.UAV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelFeatureData"), VoxelFeatureData.UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), DispatchOffset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), DispatchDim);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_ImportOffset"), Offset);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_ImportRect"), ImportRectParam);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_FillTypeMask"), FillTypeMask);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_EdgeMask"), EdgeMask);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_bUseEdgeTexture"), bUseEdgeTexture);
+        ComputeShader->DispatchAndClear(RHICmdList, DispatchDim.X, DispatchDim.Y, 1);
+    }
+    RHICmdList.EndComputePass();
+
+    // Regenerate voxel distance from the imported voxel state and feature
+
+    if (Map.HasVoxelDistanceData_RT())
+    {
+        const FIntPoint DistanceDispatchOffset = DistanceRect.Min;
+        const FIntPoint DistanceDispatchDim    = DistanceRect.Size();
+
+        const int32  PairDispatchX = (DistanceDispatchOffset.X+DistanceDispatchDim.X+1)/2 - DistanceDispatchOffset.X/2;
+        const uint32 DistanceLayerCount = Map.GetDistanceLayerCount_RT();
+        const float  DistanceRange = Map.GetDistanceRange_RT();
+
+        FRULRWBuffer VoxelDistanceData(Map.GetVoxelDistanceData());
+
+        RHICmdList.BeginComputePass(TEXT("VoxelImportDistance"));
+        {
+            TShaderMapRef<FMSQVoxelImportDistanceCS> ComputeShader(RHIShaderMap);
+            ComputeShader->SetShader(RHICmdList);
+            ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), VoxelStateData.SRV);
+            ComputeShader->BindSRV(RHICmdList, TEXT("VoxelFeatureData"), VoxelFeatureData.SRV);
+            ComputeShader->BindUAV(RHICmdList, TEXT("OutVoxelDistanceData"), VoxelDistanceData.UAV);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchOffset"), DistanceDispatchOffset);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DispatchDim"), DistanceDispatchDim);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceLayerCount"), DistanceLayerCount);
+            ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceRange"), DistanceRange);
+            ComputeShader->DispatchAndClear(RHICmdList, PairDispatchX, DistanceDispatchDim.Y, 1);
+        }
+        RHICmdList.EndComputePass();
+    }
+
+    Map.EndVoxelEdit_RT();
+}
+
+void FMarchingSquaresVoxelImport::ImportTexture_RT(
+    FRHICommandListImmediate& RHICmdList,
+    const FImportParameter& Parameter,
+    FTexture2DRHIParamRef FillTypeTexture,
+    FTexture2DRHIParamRef EdgeTexture
+    )
+{
+    check(IsInRenderingThread());
+    check(Parameter.Map != nullptr);
+
+    if (! FillTypeTexture)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresVoxelImport::ImportTexture_RT() ABORTED - Invalid fill type texture"));
+        return;
+    }
+
+    const FIntPoint ImageSize(FillTypeTexture->GetSizeX(), FillTypeTexture->GetSizeY());
+
+    // Edge texture is only used if it matches fill type texture size
+
+    if (EdgeTexture && FIntPoint(EdgeTexture->GetSizeX(), EdgeTexture->GetSizeY()) != ImageSize)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresVoxelImport::ImportTexture_RT() Edge texture size does not match fill type texture size, edge texture is ignored"));
+        EdgeTexture = nullptr;
+    }
+
+    FShaderResourceViewRHIRef FillTypeSRV = RHICreateShaderResourceView(FillTypeTexture, 0);
+    FShaderResourceViewRHIRef EdgeSRV;
+
+    if (EdgeTexture)
+    {
+        EdgeSRV = RHICreateShaderResourceView(EdgeTexture, 0);
+    }
+
+    ImportTextureSRV_RT(
+        RHICmdList,
+        *Parameter.Map,
+        Parameter.Offset,
+        ImageSize,
+        GetChannelMask(Parameter.FillTypeChannel),
+        GetChannelMask(Parameter.EdgeChannel),
+        FillTypeSRV,
+        EdgeSRV
+        );
+}
+
+void FMarchingSquaresVoxelImport::ImportImage_RT(
+    FRHICommandListImmediate& RHICmdList,
+    const FImportParameter& Parameter,
+    const FImportImage& Image
+    )
+{
+    check(IsInRenderingThread());
+    check(Parameter.Map != nullptr);
+    check(Image.IsValid());
+
+    const FIntPoint& Size(Image.Size);
+    const bool bHasEdgeData = Image.HasEdgeData();
+
+    // Upload image to a transient texture, fill type on the red channel and
+    // edge coverage on the green channel if available
+
+    FRHIResourceCreateInfo CreateInfo;
+    FTexture2DRHIRef ImageTexture = RHICreateTexture2D(
+        Size.X,
+        Size.Y,
+        bHasEdgeData ? PF_R8G8 : PF_G8,
+        1,
+        1,
+        TexCreate_ShaderResource,
+        CreateInfo
+        );
+
+    const FUpdateTextureRegion2D Region(0, 0, 0, 0, Size.X, Size.Y);
+
+    if (bHasEdgeData)
+    {
+        TArray<uint8> TexelData;
+        TexelData.SetNumUninitialized(Image.GetTexelCount()*2);
+
+        for (int32 i=0; i<Image.GetTexelCount(); ++i)
+        {
+            TexelData[i*2  ] = Image.FillTypeData[i];
+            TexelData[i*2+1] = Image.EdgeData[i];
+        }
+
+        RHIUpdateTexture2D(ImageTexture, 0, Region, Size.X*2, TexelData.GetData());
+    }
+    else
+    {
+        RHIUpdateTexture2D(ImageTexture, 0, Region, Size.X, Image.FillTypeData.GetData());
+    }
+
+    FShaderResourceViewRHIRef ImageSRV = RHICreateShaderResourceView(ImageTexture, 0);
+
+    ImportTextureSRV_RT(
+        RHICmdList,
+        *Parameter.Map,
+        Parameter.Offset,
+        Size,
+        GetChannelMask(EMarchingSquaresImportChannel::Red),
+        GetChannelMask(EMarchingSquaresImportChannel::Green),
+        ImageSRV,
+        bHasEdgeData ? ImageSRV.GetReference() : nullptr
+        );
+}
+
+void FMarchingSquaresVoxelImport::ImportImage(const FImportParameter& Parameter, const FImportImage& Image)
+{
+    check(Parameter.Map != nullptr);
+    check(Parameter.Map->HasValidDimension());
+
+    if (! Image.IsValid())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresVoxelImport::ImportImage() ABORTED - Invalid image data"));
+        return;
+    }
+
+    FMarchingSquaresMap* Map(Parameter.Map);
+    Map->InitializeVoxelData();
+
+    ENQUEUE_RENDER_COMMAND(FMarchingSquaresVoxelImport_ImportImage)(
+        [Parameter, Image](FRHICommandListImmediate& RHICmdList)
+        {
+            FMarchingSquaresVoxelImport::ImportImage_RT(RHICmdList, Parameter, Image);
+        } );
+}
+
+void FMarchingSquaresVoxelImport::ImportImageCPU(const FImportParameter& Parameter, const FImportImage& Image)
+{
+    using namespace MarchingSquaresVoxelImportCPU;
+
+    check(Parameter.Map != nullptr);
+    check(Parameter.Map->HasValidDimension());
+
+    if (! Image.IsValid())
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresVoxelImport::ImportImageCPU() ABORTED - Invalid image data"));
+        return;
+    }
+
+    FMarchingSquaresMap& Map(*Parameter.Map);
+
+    // CPU voxel data holds no voxel distance, importing would leave map
+    // distance layers out of sync with the imported voxel state
+    if (Map.DistanceLayerCount > 0)
+    {
+        UE_LOG(LogMSQ,Warning, TEXT("FMarchingSquaresVoxelImport::ImportImageCPU() ABORTED - CPU import does not support maps with distance layers, use ImportImage()"));
+        return;
+    }
+
+    Map.InitializeCPUVoxelData();
+
+    FMarchingSquaresCPUVoxelData& VoxelData(Map.GetCPUVoxelData());
+    const FIntPoint Dimension(VoxelData.Dimension);
+    const FIntRect ImportRect(GetImportRect(Dimension, Parameter.Offset, Image.Size));
+
+    // Image is completely outside the map, abort
+    if (ImportRect.Area() <= 0)
+    {
+        return;
+    }
+
+    FIntRect DispatchRect(ImportRect);
+    DispatchRect.Min.X = FMath::Max(0, DispatchRect.Min.X-1);
+    DispatchRect.Min.Y = FMath::Max(0, DispatchRect.Min.Y-1);
+
+    const FImportContext Context = {
+        Image,
+        VoxelData,
+        Parameter.Offset,
+        ImportRect,
+        Image.HasEdgeData()
+        };
+
+    uint32* StateData   = VoxelData.VoxelStateData.GetData();
+    uint32* FeatureData = VoxelData.VoxelFeatureData.GetData();
+
+    // Voxels outside the import rect are never written, each voxel only
+    // writes its own state and feature which allows a single parallel pass
+
+    const int32 BandCount = (DispatchRect.Height()+ROW_BAND_SIZE-1) / ROW_BAND_SIZE;
+
+    Map.BeginVoxelEditCPU(DispatchRect);
+
+    ParallelFor(BandCount, [&](int32 BandIndex)
+    {
+        const int32 BandMinY = DispatchRect.Min.Y + BandIndex*ROW_BAND_SIZE;
+        const int32 BandMaxY = FMath::Min(BandMinY+ROW_BAND_SIZE, DispatchRect.Max.Y);
+
+        for (int32 y=BandMinY; y<BandMaxY; ++y)
+        for (int32 x=DispatchRect.Min.X; x<DispatchRect.Max.X; ++x)
+        {
+            const FIntPoint tid(x, y);
+            const int32 tidx = x + y*Dimension.X;
+
+            const FIntPoint xid(tid + FIntPoint(1,0));
+            const FIntPoint yid(tid + FIntPoint(0,1));
+
+            const bool bImportVoxel = Context.IsImportVoxel(tid);
+            const bool bValidCellX = x < (Dimension.X-1);
+            const bool bValidCellY = y < (Dimension.Y-1);
+
+            const uint32 vState = Context.GetVoxelState(tid);
+            const uint32 xState = bValidCellX ? Context.GetVoxelState(xid) : vState;
+            const uint32 yState = bValidCellY ? Context.GetVoxelState(yid) : vState;
+
+            // Write state
+
+            if (bImportVoxel)
+            {
+                uint32 cState = vState;
+
+                if (Context.bUseEdgeData && bValidCellX && bValidCellY)
+                {
+                    const FIntPoint xyid(tid + FIntPoint(1,1));
+                    const uint32 xyState = Context.GetVoxelState(xyid);
+
+                    const float c = .25f * (
+                        Context.LoadEdge(tid) +
+                        Context.LoadEdge(xid) +
+                        Context.LoadEdge(yid) +
+                        Context.LoadEdge(xyid)
+                        );
+                    const uint32 sMax = FMath::Max(FMath::Max(vState, xState), FMath::Max(yState, xyState));
+                    const uint32 sMin = FMath::Min(FMath::Min(vState, xState), FMath::Min(yState, xyState));
+
+                    cState = (c >= .5f) ? sMax : sMin;
+                }
+
+                StateData[tidx] = (vState & 0xFF) | ((cState & 0xFF) << 8);
+            }
+
+            // Write feature
+
+            const uint32 Feature = bImportVoxel ? 0xFFFFFFFF : FeatureData[tidx];
+            uint32 uEdgeX = Feature & 0xFFFF;
+            uint32 uEdgeY = Feature >> 16;
+
+            if (bValidCellX && (bImportVoxel || Context.IsImportVoxel(xid)))
+            {
+                uEdgeX = (vState != xState) ? GetImportEdgeFeature(Context, tid, xid, vState, xState) : 0xFFFF;
+            }
+
+            if (bValidCellY && (bImportVoxel || Context.IsImportVoxel(yid)))
+            {
+                uEdgeY = (vState != yState) ? GetImportEdgeFeature(Context, tid, yid, vState, yState) : 0xFFFF;
+            }
+
+            FeatureData[tidx] = (uEdgeX & 0xFFFF) | (uEdgeY << 16);
+        }
+    } );
+
+    Map.EndVoxelEditCPU();
+
+    Map.UpdateVoxelMirrorCPU(DispatchRect);
+}
@@ -0,0 +1,1336 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresVoxelMirror.h"
+
+#include "ShaderParameters.h"
+#include "ShaderCore.h"
+#include "ShaderParameterUtils.h"
+
+#include "MarchingSquaresPlugin.h"
+#include "MarchingSquaresMap.h"
+#include "Shaders/RULShaderDefinitions.h"
+
+// COMPUTE SHADER DEFINITIONS
+
+class FMSQVoxelMirrorCopyCS : public FRULBaseComputeShader<16,16,1>
+{
+    typedef FRULBaseComputeShader<16,16,1> FBaseType;
+
+    RUL_DECLARE_SHADER_CONSTRUCTOR_DEFAULT_STATICS(
+        FMSQVoxelMirrorCopyCS,
+        Global,
+        RHISupportsComputeShaders(Parameters.Platform)
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_4(
+        SRV,
+        FShaderResourceParameter,
+        FResourceId,
+        "VoxelStateData",    VoxelStateData,
+        "VoxelFeatureData",  VoxelFeatureData,
+        "VoxelDistanceData", VoxelDistanceData,
+        "ReadbackBlockData", ReadbackBlockData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_1(
+        UAV,
+        FShaderResourceParameter,
+        FResourceId,
+        "OutReadbackData", OutReadbackData
+        )
+
+    RUL_DECLARE_SHADER_PARAMETERS_3(
+        Value,
+        FShaderParameter,
+        FParameterId,
+        "_MapDim",             Params_MapDimension,
+        "_BlockCount",         Params_BlockCount,
+        "_DistanceLayerCount", Params_DistanceLayerCount
+        )
+};
+
+IMPLEMENT_SHADER_TYPE(, FMSQVoxelMirrorCopyCS, TEXT("/Plugin/MarchingSquaresPlugin/Private/MarchingSquaresVoxelMirrorCS.usf"), TEXT("VoxelMirrorCopyKernel"), SF_Compute);
+
+// Cell polygon utility
+//
+// Filled area of a cell is made of at most two convex polygons built by
+// walking the cell perimeter counter-clockwise. Polygon edges between two
+// edge crossings are fill type boundary segments.
+
+namespace MarchingSquaresVoxelMirrorCell
+{
+    typedef FMarchingSquaresVoxelMirror::FCellGeometry FCellGeometry;
+    typedef FMarchingSquaresVoxelMirror::FCellSegment  FCellSegment;
+
+    enum { MAX_POLY_POINTS = 8 };
+
+    struct FCellPoly
+    {
+        FVector2D Points[MAX_POLY_POINTS];
+        int32     Features[MAX_POLY_POINTS];
+        int32     Num = 0;
+
+        FORCEINLINE void Add(const FVector2D& Point, int32 Feature)
+        {
+            check(Num < MAX_POLY_POINTS);
+            Points[Num] = Point;
+            Features[Num] = Feature;
+            ++Num;
+        }
+
+        FORCEINLINE bool IsCrossing(int32 i) const
+        {
+            return Features[i] < FMarchingSquaresVoxelMirror::CELL_FEATURE_CORNER;
+        }
+    };
+
+    // Counter-clockwise corner order and the edge following each corner
+
+    static const int32 WALK_CORNERS[4] = { 0, 1, 3, 2 };
+    static const int32 WALK_EDGES[4]   = { 0, 3, 1, 2 };
+
+    static const FVector2D CORNER_POINTS[4] = {
+        FVector2D(0.f, 0.f),
+        FVector2D(1.f, 0.f),
+        FVector2D(0.f, 1.f),
+        FVector2D(1.f, 1.f)
+        };
+
+    FORCEINLINE bool IsSaddle(uint32 CaseCode)
+    {
+        return CaseCode == 0x06 || CaseCode == 0x09;
+    }
+
+    FORCEINLINE float Cross(const FVector2D& A, const FVector2D& B)
+    {
+        return A.X * B.Y - A.Y * B.X;
+    }
+
+    // Returns number of cell polygons
+    int32 BuildCellPolys(const FCellGeometry& Geometry, FCellPoly OutPolys[2])
+    {
+        const uint32 CaseCode = Geometry.CaseCode;
+
+        if (CaseCode == 0)
+        {
+            return 0;
+        }
+
+        // Saddle with empty center, each filled corner forms a triangle
+
+        if (IsSaddle(CaseCode) && ! Geometry.bFilledCenter)
+        {
+            int32 PolyCount = 0;
+
+            for (int32 i=0; i<4; ++i)
+            {
+                const int32 Corner = WALK_CORNERS[i];
+
+                if (Geometry.IsCornerFilled(Corner))
+                {
+                    FCellPoly& Poly(OutPolys[PolyCount++]);
+                    Poly.Add(Geometry.Crossings[WALK_EDGES[(i+3)%4]], WALK_EDGES[(i+3)%4]);
+                    Poly.Add(CORNER_POINTS[Corner], FMarchingSquaresVoxelMirror::CELL_FEATURE_CORNER + Corner);
+                    Poly.Add(Geometry.Crossings[WALK_EDGES[i]], WALK_EDGES[i]);
+                }
+            }
+
+            return PolyCount;
+        }
+
+        // Single polygon of filled corners and edge crossings
+
+        FCellPoly& Poly(OutPolys[0]);
+
+        for (int32 i=0; i<4; ++i)
+        {
+            const int32 Corner = WALK_CORNERS[i];
+            const int32 NextCorner = WALK_CORNERS[(i+1)%4];
+            const bool bFilled = Geometry.IsCornerFilled(Corner);
+
+            if (bFilled)
+            {
+                Poly.Add(CORNER_POINTS[Corner], FMarchingSquaresVoxelMirror::CELL_FEATURE_CORNER + Corner);
+            }
+
+            if (bFilled != Geometry.IsCornerFilled(NextCorner))
+            {
+                Poly.Add(Geometry.Crossings[WALK_EDGES[i]], WALK_EDGES[i]);
+            }
+        }
+
+        return 1;
+    }
+
+    float GetPolyArea(const FVector2D* Points, int32 Num)
+    {
+        float Area = 0.f;
+
+        for (int32 i=0, j=Num-1; i<Num; j=i++)
+        {
+            Area += Cross(Points[j], Points[i]);
+        }
+
+        return FMath::Abs(Area) * .5f;
+    }
+
+    bool IsPointInPoly(const FCellPoly& Poly, const FVector2D& Point)
+    {
+        // Polygons are convex and counter-clockwise
+
+        for (int32 i=0, j=Poly.Num-1; i<Poly.Num; j=i++)
+        {
+            if (Cross(Poly.Points[i]-Poly.Points[j], Point-Poly.Points[j]) < 0.f)
+            {
+                return false;
+            }
+        }
+
+        return Poly.Num > 2;
+    }
+
+    // Clip polygon to a single axis-aligned boundary, returns output count
+    int32 ClipPoly(const FVector2D* InPoints, int32 InNum, FVector2D* OutPoints, int32 Axis, float Bound, bool bKeepGreater)
+    {
+        int32 OutNum = 0;
+
+        for (int32 i=0, j=InNum-1; i<InNum; j=i++)
+        {
+            const FVector2D& P0(InPoints[j]);
+            const FVector2D& P1(InPoints[i]);
+            const float D0 = bKeepGreater ? (P0[Axis]-Bound) : (Bound-P0[Axis]);
+            const float D1 = bKeepGreater ? (P1[Axis]-Bound) : (Bound-P1[Axis]);
+
+            if ((D0 >= 0.f) != (D1 >= 0.f))
+            {
+                OutPoints[OutNum++] = P0 + (P1-P0) * (D0 / (D0-D1));
+            }
+
+            if (D1 >= 0.f)
+            {
+                OutPoints[OutNum++] = P1;
+            }
+        }
+
+        return OutNum;
+    }
+
+    // Returns polygon area clipped to the cell local rect
+    float GetClippedPolyArea(const FCellPoly& Poly, const FBox2D& Rect)
+    {
+        // Clipping a convex polygon against each rect side adds at most a
+        // single point per side
+
+        FVector2D Buffer0[MAX_POLY_POINTS+4];
+        FVector2D Buffer1[MAX_POLY_POINTS+4];
+
+        int32 Num = Poly.Num;
+        FMemory::Memcpy(Buffer0, Poly.Points, Num * sizeof(FVector2D));
+
+        Num = ClipPoly(Buffer0, Num, Buffer1, 0, Rect.Min.X, true);
+        Num = ClipPoly(Buffer1, Num, Buffer0, 0, Rect.Max.X, false);
+        Num = ClipPoly(Buffer0, Num, Buffer1, 1, Rect.Min.Y, true);
+        Num = ClipPoly(Buffer1, Num, Buffer0, 1, Rect.Max.Y, false);
+
+        return (Num > 2) ? GetPolyArea(Buffer0, Num) : 0.f;
+    }
+}
+
+// RENDER THREAD FUNCTIONS
+
+void FMarchingSquaresVoxelMirror::ResetData(const FIntPoint& InDimension, int32 InDistanceLayerCount, float InDistanceRange)
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_Write);
+
+    const int32 VoxelCount = InDimension.X * InDimension.Y;
+    const int32 DistanceCount = ((InDimension.X+1) / 2) * InDimension.Y * InDistanceLayerCount;
+
+    Dimension = InDimension;
+    DistanceLayerCount = InDistanceLayerCount;
+    DistanceRange = InDistanceRange;
+
+    VoxelStateData.Reset(VoxelCount);
+    VoxelStateData.SetNumZeroed(VoxelCount);
+
+    VoxelFeatureData.Reset(VoxelCount);
+    VoxelFeatureData.SetNumUninitialized(VoxelCount);
+    FMemory::Memset(VoxelFeatureData.GetData(), 0xFF, VoxelCount * VoxelFeatureData.GetTypeSize());
+
+    VoxelDistanceData.Reset(DistanceCount);
+    VoxelDistanceData.SetNumZeroed(DistanceCount);
+
+    ResetBlockRevisions();
+}
+
+void FMarchingSquaresVoxelMirror::ResetBlockRevisions()
+{
+    ++Revision;
+
+    BlockCount.X = FMath::DivideAndRoundUp<int32>(Dimension.X, BLOCK_SIZE);
+    BlockCount.Y = FMath::DivideAndRoundUp<int32>(Dimension.Y, BLOCK_SIZE);
+
+    BlockRevisions.Reset();
+    BlockRevisions.Init(Revision, BlockCount.X * BlockCount.Y);
+
+    CPUBlockRevisions.Reset();
+    CPUBlockRevisions.Init(0, BlockCount.X * BlockCount.Y);
+}
+
+void FMarchingSquaresVoxelMirror::MarkBlockRevisions(const FIntRect& VoxelRect)
+{
+    const FIntPoint BlockMin(VoxelRect.Min / BLOCK_SIZE);
+    const FIntPoint BlockMax((VoxelRect.Max - FIntPoint(1,1)) / BLOCK_SIZE);
+
+    for (int32 by=BlockMin.Y; by<=BlockMax.Y; ++by)
+    for (int32 bx=BlockMin.X; bx<=BlockMax.X; ++bx)
+    {
+        BlockRevisions[bx + by*BlockCount.X] = Revision;
+        CPUBlockRevisions[bx + by*BlockCount.X] = Revision;
+    }
+}
+
+void FMarchingSquaresVoxelMirror::Configure_RT(const FIntPoint& InDimension, int32 InDistanceLayerCount, float InDistanceRange, bool bInEnabled)
+{
+    check(IsInRenderingThread());
+
+    const bool bEnabled = bInEnabled && InDimension.X > 0 && InDimension.Y > 0;
+
+    if (! bEnabled)
+    {
+        Release_RT();
+        return;
+    }
+
+    // Mirror is up to date, no reset required
+
+    if (bEnabled_RT
+        && Dimension_RT == InDimension
+        && DistanceLayerCount_RT == InDistanceLayerCount
+        && DistanceRange_RT == InDistanceRange)
+    {
+        return;
+    }
+
+    Release_RT();
+
+    bEnabled_RT = true;
+    Dimension_RT = InDimension;
+    DistanceLayerCount_RT = InDistanceLayerCount;
+    DistanceRange_RT = InDistanceRange;
+    BlockCount_RT.X = FMath::DivideAndRoundUp<int32>(InDimension.X, BLOCK_SIZE);
+    BlockCount_RT.Y = FMath::DivideAndRoundUp<int32>(InDimension.Y, BLOCK_SIZE);
+
+    ResetData(InDimension, InDistanceLayerCount, InDistanceRange);
+
+    // Existing GPU voxel data is read back over subsequent updates
+
+    DirtyBlocks_RT.Init(true, BlockCount_RT.X * BlockCount_RT.Y);
+    DirtyBlockCount_RT = DirtyBlocks_RT.Num();
+
+    DirtyRevisions_RT.Reset();
+    DirtyRevisions_RT.Init(GetRevision(), DirtyBlocks_RT.Num());
+
+    UpdatePendingCount_RT();
+}
+
+void FMarchingSquaresVoxelMirror::MarkDirty_RT(const FIntRect& VoxelRect)
+{
+    check(IsInRenderingThread());
+
+    if (! bEnabled_RT)
+    {
+        return;
+    }
+
+    FIntRect ClampedRect(VoxelRect);
+    ClampedRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension_RT));
+
+    if (ClampedRect.Area() <= 0)
+    {
+        return;
+    }
+
+    const FIntPoint BlockMin(ClampedRect.Min / BLOCK_SIZE);
+    const FIntPoint BlockMax((ClampedRect.Max - FIntPoint(1,1)) / BLOCK_SIZE);
+
+    // GPU edits marked after a CPU voxel data copy supersede the copy
+
+    const uint32 DirtyRevision = GetRevision();
+
+    for (int32 by=BlockMin.Y; by<=BlockMax.Y; ++by)
+    for (int32 bx=BlockMin.X; bx<=BlockMax.X; ++bx)
+    {
+        const int32 BlockIndex = bx + by*BlockCount_RT.X;
+        FBitReference DirtyFlag(DirtyBlocks_RT[BlockIndex]);
+
+        DirtyRevisions_RT[BlockIndex] = DirtyRevision;
+
+        if (! DirtyFlag)
+        {
+            DirtyFlag = true;
+            ++DirtyBlockCount_RT;
+        }
+    }
+
+    UpdatePendingCount_RT();
+}
+
+void FMarchingSquaresVoxelMirror::UpdatePendingCount_RT()
+{
+    PendingBlockCount.Set(DirtyBlockCount_RT + ReadbackBlocks.Num());
+}
+
+void FMarchingSquaresVoxelMirror::Update_RT(FRHICommandListImmediate& RHICmdList, FRULRWBuffer& SrcStateData, FRULRWBuffer& SrcFeatureData, FRULRWBuffer& SrcDistanceData)
+{
+    check(IsInRenderingThread());
+
+    if (! bEnabled_RT)
+    {
+        return;
+    }
+
+    // Resolve in-flight readback, keep waiting if the staging copy fence
+    // has not been reached
+
+    if (ReadbackBlocks.Num() > 0)
+    {
+        check(Readback.IsValid());
+
+        if (! Readback->IsReady())
+        {
+            return;
+        }
+
+        ResolveReadback_RT();
+    }
+
+    const bool bValidSource = SrcStateData.IsValid()
+        && SrcFeatureData.IsValid()
+        && (DistanceLayerCount_RT == 0 || SrcDistanceData.IsValid());
+
+    if (DirtyBlockCount_RT > 0 && bValidSource)
+    {
+        StartReadback_RT(RHICmdList, SrcStateData, SrcFeatureData, SrcDistanceData);
+    }
+
+    UpdatePendingCount_RT();
+}
+
+void FMarchingSquaresVoxelMirror::StartReadback_RT(FRHICommandListImmediate& RHICmdList, FRULRWBuffer& SrcStateData, FRULRWBuffer& SrcFeatureData, FRULRWBuffer& SrcDistanceData)
+{
+    check(ReadbackBlocks.Num() == 0);
+
+    // Collect dirty blocks up to the readback block limit. Dirty blocks
+    // written by a CPU voxel data copy since they were marked dirty hold
+    // newer data than the GPU voxel data and are cleared without readback.
+
+    TArray<int32> ClearedBlocks;
+    {
+        FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+        for (TConstSetBitIterator<> It(DirtyBlocks_RT); It && ReadbackBlocks.Num() < MAX_READBACK_BLOCK_COUNT; ++It)
+        {
+            const int32 BlockIndex = It.GetIndex();
+            const uint32 DirtyRevision = DirtyRevisions_RT[BlockIndex];
+
+            ClearedBlocks.Emplace(BlockIndex);
+
+            if (! IsCPUWrittenAfter(BlockIndex, DirtyRevision))
+            {
+                ReadbackBlocks.Emplace(BlockIndex % BlockCount_RT.X, BlockIndex / BlockCount_RT.X);
+                ReadbackRevisions.Emplace(DirtyRevision);
+            }
+        }
+    }
+
+    for (int32 BlockIndex : ClearedBlocks)
+    {
+        DirtyBlocks_RT[BlockIndex] = false;
+    }
+
+    DirtyBlockCount_RT -= ClearedBlocks.Num();
+
+    if (ReadbackBlocks.Num() == 0)
+    {
+        return;
+    }
+
+    // Create readback buffers on first use, buffers are sized for the
+    // maximum readback block count and reused for subsequent readbacks.
+    // Distance layout changes reconfigure the mirror and release them.
+
+    if (! ReadbackData.IsValid() || ! ReadbackBlockData.IsValid())
+    {
+        ReadbackData.Release();
+        ReadbackData.Initialize(
+            sizeof(uint32),
+            MAX_READBACK_BLOCK_COUNT * GetReadbackBlockStride(DistanceLayerCount_RT),
+            PF_R32_UINT,
+            nullptr,
+            BUF_Static,
+            TEXT("VoxelMirrorReadbackData")
+            );
+
+        ReadbackBlockData.Release();
+        ReadbackBlockData.Initialize(
+            sizeof(uint32),
+            MAX_READBACK_BLOCK_COUNT,
+            PF_R32_UINT,
+            nullptr,
+            BUF_Static,
+            TEXT("VoxelMirrorReadbackBlockData")
+            );
+    }
+
+    // Write block voxel origins
+
+    const int32 ReadbackBlockCount = ReadbackBlocks.Num();
+
+    uint32* BlockDataPtr = reinterpret_cast<uint32*>(RHILockVertexBuffer(ReadbackBlockData.Buffer, 0, ReadbackBlockCount * sizeof(uint32), RLM_WriteOnly));
+
+    for (int32 i=0; i<ReadbackBlockCount; ++i)
+    {
+        const FIntPoint Origin(ReadbackBlocks[i] * BLOCK_SIZE);
+        BlockDataPtr[i] = (Origin.X & 0xFFFF) | (Origin.Y << 16);
+    }
+
+    RHIUnlockVertexBuffer(ReadbackBlockData.Buffer);
+
+    // Copy dirty blocks to the readback buffer
+
+    TShaderMap<FGlobalShaderType>* RHIShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+    RHICmdList.BeginComputePass(TEXT("VoxelMirrorCopy"));
+    {
+        TShaderMapRef<FMSQVoxelMirrorCopyCS> ComputeShader(RHIShaderMap);
+        ComputeShader->SetShader(RHICmdList);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelStateData"), SrcStateData.SRV);
+        ComputeShader->BindSRV(RHICmdList, TEXT("VoxelFeatureData"), SrcFeatureData.SRV);
+        if (DistanceLayerCount_RT > 0)
+        {
+            ComputeShader->BindSRV(RHICmdList, TEXT("VoxelDistanceData"), SrcDistanceData.SRV);
+        }
+        ComputeShader->BindSRV(RHICmdList, TEXT("ReadbackBlockData"), ReadbackBlockData.SRV);
+        ComputeShader->BindUAV(RHICmdList, TEXT("OutReadbackData"), ReadbackData.UAV);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_MapDim"), Dimension_RT);
+        ComputeShader->SetParameter(RHICmdList, TEXT("_BlockCount"), static_cast<uint32>(ReadbackBlockCount));
+        ComputeShader->SetParameter(RHICmdList, TEXT("_DistanceLayerCount"), static_cast<uint32>(DistanceLayerCount_RT));
+        ComputeShader->DispatchAndClear(RHICmdList, BLOCK_SIZE, BLOCK_SIZE, ReadbackBlockCount);
+    }
+    RHICmdList.EndComputePass();
+
+    // Copy to staging buffer, the readback writes its fence after the copy
+
+    if (! Readback.IsValid())
+    {
+        Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("VoxelMirrorReadback"));
+    }
+
+    Readback->EnqueueCopy(RHICmdList, ReadbackData.Buffer);
+}
+
+void FMarchingSquaresVoxelMirror::ResolveReadback_RT()
+{
+    const int32 ReadbackBlockCount = ReadbackBlocks.Num();
+    const int32 BlockStride = GetReadbackBlockStride(DistanceLayerCount_RT);
+    const uint32 ByteCount = ReadbackBlockCount * BlockStride * sizeof(uint32);
+
+    TArray<FIntPoint> ResolvedBlocks;
+    ResolvedBlocks.Reserve(ReadbackBlockCount);
+
+    // Staging buffer fence has been reached, lock does not stall
+
+    const uint32* ReadbackPtr = reinterpret_cast<const uint32*>(Readback->Lock(ByteCount));
+    {
+        FRWScopeLock ScopeLock(DataLock, SLT_Write);
+
+        ++Revision;
+
+        for (int32 i=0; i<ReadbackBlockCount; ++i)
+        {
+            const int32 BlockIndex = ReadbackBlocks[i].X + ReadbackBlocks[i].Y*BlockCount.X;
+
+            // Discard blocks written by a CPU voxel data copy while the
+            // readback was in flight
+
+            if (IsCPUWrittenAfter(BlockIndex, ReadbackRevisions[i]))
+            {
+                continue;
+            }
+
+            ResolvedBlocks.Emplace(ReadbackBlocks[i]);
+
+            const FIntPoint Origin(ReadbackBlocks[i] * BLOCK_SIZE);
+            BlockRevisions[BlockIndex] = Revision;
+
+            const FIntPoint Size(
+                FMath::Min<int32>(BLOCK_SIZE, Dimension.X-Origin.X),
+                FMath::Min<int32>(BLOCK_SIZE, Dimension.Y-Origin.Y)
+                );
+            const uint32* BlockPtr = ReadbackPtr + i * BlockStride;
+
+            for (int32 y=0; y<Size.Y; ++y)
+            for (int32 x=0; x<Size.X; ++x)
+            {
+                const int32 ridx = (x + y*BLOCK_SIZE) * 2;
+                const int32 vidx = GetVoxelIndex(Origin.X+x, Origin.Y+y);
+                VoxelStateData[vidx] = BlockPtr[ridx];
+                VoxelFeatureData[vidx] = BlockPtr[ridx+1];
+            }
+
+            // Distance pairs of each layer follow the voxel data. A CPU
+            // voxel data copy with a different distance layout may have
+            // replaced the mirror layout while the readback was in flight.
+
+            const uint32* DistancePtr = BlockPtr + BLOCK_SIZE*BLOCK_SIZE*2;
+            const int32 PairCountX = (Size.X+1) / 2;
+            const int32 LayerCount = (DistanceLayerCount == DistanceLayerCount_RT) ? DistanceLayerCount : 0;
+
+            for (int32 Layer=0; Layer<LayerCount; ++Layer)
+            for (int32 y=0; y<Size.Y; ++y)
+            for (int32 px=0; px<PairCountX; ++px)
+            {
+                const int32 ridx = Layer*(BLOCK_SIZE*BLOCK_SIZE/2) + px + y*(BLOCK_SIZE/2);
+                VoxelDistanceData[GetDistanceIndex(Origin.X+px*2, Origin.Y+y, Layer)] = DistancePtr[ridx];
+            }
+        }
+    }
+    Readback->Unlock();
+
+    ReadbackBlocks.Reset();
+    ReadbackRevisions.Reset();
+
+    if (ResolvedBlocks.Num() > 0)
+    {
+        ReadbackResolvedEvent.Broadcast(ResolvedBlocks);
+    }
+}
+
+void FMarchingSquaresVoxelMirror::Release_RT()
+{
+    check(IsInRenderingThread());
+
+    bEnabled_RT = false;
+    Dimension_RT = FIntPoint::ZeroValue;
+    BlockCount_RT = FIntPoint::ZeroValue;
+    DistanceLayerCount_RT = 0;
+    DistanceRange_RT = 1.f;
+
+    DirtyBlocks_RT.Empty();
+    DirtyBlockCount_RT = 0;
+    DirtyRevisions_RT.Empty();
+
+    ReadbackData.Release();
+    ReadbackBlockData.Release();
+    Readback.Reset();
+    ReadbackBlocks.Reset();
+    ReadbackRevisions.Reset();
+
+    UpdatePendingCount_RT();
+
+    FRWScopeLock ScopeLock(DataLock, SLT_Write);
+
+    Dimension = FIntPoint::ZeroValue;
+    VoxelStateData.Empty();
+    VoxelFeatureData.Empty();
+    VoxelDistanceData.Empty();
+    DistanceLayerCount = 0;
+
+    ResetBlockRevisions();
+}
+
+// CPU VOXEL DATA FUNCTIONS
+
+void FMarchingSquaresVoxelMirror::CopyVoxelData(const FMarchingSquaresCPUVoxelData& VoxelData, const FIntRect& VoxelRect)
+{
+    if (! VoxelData.IsValid())
+    {
+        return;
+    }
+
+    FRWScopeLock ScopeLock(DataLock, SLT_Write);
+
+    // Mirror has not been configured or was configured with a different
+    // dimension or distance layout, initialize mirror data with the CPU
+    // voxel data
+
+    const bool bSameLayout = Dimension == VoxelData.Dimension
+        && DistanceLayerCount == VoxelData.DistanceLayerCount
+        && DistanceRange == VoxelData.DistanceRange;
+
+    if (! bSameLayout)
+    {
+        Dimension = VoxelData.Dimension;
+        VoxelStateData = VoxelData.VoxelStateData;
+        VoxelFeatureData = VoxelData.VoxelFeatureData;
+        DistanceLayerCount = VoxelData.DistanceLayerCount;
+        DistanceRange = VoxelData.DistanceRange;
+        VoxelDistanceData = VoxelData.VoxelDistanceData;
+
+        ResetBlockRevisions();
+
+        // Every block holds CPU voxel data, discard pending readbacks
+
+        for (uint32& CPUBlockRevision : CPUBlockRevisions)
+        {
+            CPUBlockRevision = Revision;
+        }
+
+        return;
+    }
+
+    FIntRect CopyRect(VoxelRect);
+    CopyRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension));
+
+    if (CopyRect.Area() <= 0)
+    {
+        return;
+    }
+
+    ++Revision;
+    MarkBlockRevisions(CopyRect);
+
+    const int32 RowSize = CopyRect.Width() * sizeof(uint32);
+
+    for (int32 y=CopyRect.Min.Y; y<CopyRect.Max.Y; ++y)
+    {
+        const int32 i = GetVoxelIndex(CopyRect.Min.X, y);
+        FMemory::Memcpy(VoxelStateData.GetData()+i, VoxelData.VoxelStateData.GetData()+i, RowSize);
+        FMemory::Memcpy(VoxelFeatureData.GetData()+i, VoxelData.VoxelFeatureData.GetData()+i, RowSize);
+    }
+
+    // Copy distance pairs overlapping the rect, pairs on the rect bounds
+    // also carry the CPU distance of their voxel outside the rect
+
+    const int32 PairMinX = CopyRect.Min.X / 2;
+    const int32 PairSize = ((CopyRect.Max.X-1) / 2 - PairMinX + 1) * sizeof(uint32);
+
+    for (int32 Layer=0; Layer<DistanceLayerCount; ++Layer)
+    for (int32 y=CopyRect.Min.Y; y<CopyRect.Max.Y; ++y)
+    {
+        const int32 i = GetDistanceIndex(CopyRect.Min.X, y, Layer);
+        FMemory::Memcpy(VoxelDistanceData.GetData()+i, VoxelData.VoxelDistanceData.GetData()+i, PairSize);
+    }
+}
+
+// QUERY FUNCTIONS
+
+bool FMarchingSquaresVoxelMirror::IsValid() const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+    return Dimension.X > 1 && Dimension.Y > 1;
+}
+
+FIntPoint FMarchingSquaresVoxelMirror::GetDimension() const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+    return Dimension;
+}
+
+uint32 FMarchingSquaresVoxelMirror::GetRevision() const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+    return Revision;
+}
+
+uint32 FMarchingSquaresVoxelMirror::GetBlockRevisions(TArray<uint32>& OutBlockRevisions, FIntPoint& OutBlockCount) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    OutBlockRevisions = BlockRevisions;
+    OutBlockCount = BlockCount;
+
+    return Revision;
+}
+
+bool FMarchingSquaresVoxelMirror::CopyVoxelStates(const FIntRect& VoxelRect, TArray<uint32>& OutStates) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    const bool bValidRect = VoxelRect.Min.X >= 0 && VoxelRect.Min.Y >= 0
+                         && VoxelRect.Max.X <= Dimension.X && VoxelRect.Max.Y <= Dimension.Y
+                         && VoxelRect.Area() > 0;
+
+    if (! bValidRect)
+    {
+        return false;
+    }
+
+    const int32 Width = VoxelRect.Width();
+
+    OutStates.SetNumUninitialized(VoxelRect.Area());
+
+    for (int32 y=VoxelRect.Min.Y; y<VoxelRect.Max.Y; ++y)
+    {
+        FMemory::Memcpy(
+            OutStates.GetData() + (y-VoxelRect.Min.Y)*Width,
+            VoxelStateData.GetData() + GetVoxelIndex(VoxelRect.Min.X, y),
+            Width * sizeof(uint32)
+            );
+    }
+
+    return true;
+}
+
+void FMarchingSquaresVoxelMirror::VisitCellGeometry(
+    const FIntRect& CellRect,
+    TFunctionRef<void(const FIntPoint& Cell, uint8 FillType, const FCellGeometry& Geometry)> Visitor
+    ) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    FIntRect ClippedRect(CellRect);
+    ClippedRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension - FIntPoint(1,1)));
+
+    if (ClippedRect.Area() <= 0)
+    {
+        return;
+    }
+
+    for (int32 y=ClippedRect.Min.Y; y<ClippedRect.Max.Y; ++y)
+    for (int32 x=ClippedRect.Min.X; x<ClippedRect.Max.X; ++x)
+    {
+        const FIntPoint Cell(x, y);
+        const int32 i00 = GetVoxelIndex(x, y);
+
+        const uint8 FillTypes[4] = {
+            static_cast<uint8>(VoxelStateData[i00              ] & 0xFF),
+            static_cast<uint8>(VoxelStateData[i00+1            ] & 0xFF),
+            static_cast<uint8>(VoxelStateData[i00+Dimension.X  ] & 0xFF),
+            static_cast<uint8>(VoxelStateData[i00+Dimension.X+1] & 0xFF)
+            };
+
+        for (int32 i=0; i<4; ++i)
+        {
+            // Skip fill types already visited on previous corners
+
+            bool bVisited = false;
+
+            for (int32 j=0; j<i; ++j)
+            {
+                bVisited |= (FillTypes[j] == FillTypes[i]);
+            }
+
+            if (bVisited)
+            {
+                continue;
+            }
+
+            FCellGeometry Geometry;
+            GetCellGeometryUnlocked(Cell, FillTypes[i], Geometry);
+            Visitor(Cell, FillTypes[i], Geometry);
+        }
+    }
+}
+
+void FMarchingSquaresVoxelMirror::VisitCellGeometry(
+    const FIntRect& CellRect,
+    uint8 FillType,
+    TFunctionRef<void(const FIntPoint& Cell, const FCellGeometry& Geometry)> Visitor
+    ) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    FIntRect ClippedRect(CellRect);
+    ClippedRect.Clip(FIntRect(FIntPoint::ZeroValue, Dimension - FIntPoint(1,1)));
+
+    if (ClippedRect.Area() <= 0)
+    {
+        return;
+    }
+
+    for (int32 y=ClippedRect.Min.Y; y<ClippedRect.Max.Y; ++y)
+    for (int32 x=ClippedRect.Min.X; x<ClippedRect.Max.X; ++x)
+    {
+        const FIntPoint Cell(x, y);
+        FCellGeometry Geometry;
+
+        if (GetCellGeometryUnlocked(Cell, FillType, Geometry) && Geometry.CaseCode != 0)
+        {
+            Visitor(Cell, Geometry);
+        }
+    }
+}
+
+int32 FMarchingSquaresVoxelMirror::GetVoxelFillType(const FIntPoint& Voxel) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    if (Voxel.X < 0 || Voxel.Y < 0 || Voxel.X >= Dimension.X || Voxel.Y >= Dimension.Y)
+    {
+        return -1;
+    }
+
+    return VoxelStateData[GetVoxelIndex(Voxel.X, Voxel.Y)] & 0xFF;
+}
+
+float FMarchingSquaresVoxelMirror::GetVoxelDistanceUnlocked(int32 X, int32 Y, int32 Layer) const
+{
+    // Same decoding as UnpackVoxelDistance2()
+
+    const uint32 Pair = VoxelDistanceData[GetDistanceIndex(X, Y, Layer)];
+    const int16 SNorm = static_cast<int16>((X & 1) ? (Pair >> 16) : (Pair & 0xFFFF));
+
+    return (FMath::Max<int32>(SNorm, -32767) / 32767.f) * DistanceRange;
+}
+
+bool FMarchingSquaresVoxelMirror::GetCellGeometryUnlocked(const FIntPoint& Cell, uint8 FillType, FCellGeometry& OutGeometry) const
+{
+    if (Cell.X < 0 || Cell.Y < 0 || Cell.X >= (Dimension.X-1) || Cell.Y >= (Dimension.Y-1))
+    {
+        return false;
+    }
+
+    const int32 i00 = GetVoxelIndex(Cell.X, Cell.Y);
+    const int32 i10 = i00 + 1;
+    const int32 i01 = i00 + Dimension.X;
+    const int32 i11 = i01 + 1;
+
+    const uint32 State = VoxelStateData[i00];
+
+    OutGeometry.CaseCode  = ((State              & 0xFF) == FillType) << 0;
+    OutGeometry.CaseCode |= ((VoxelStateData[i10] & 0xFF) == FillType) << 1;
+    OutGeometry.CaseCode |= ((VoxelStateData[i01] & 0xFF) == FillType) << 2;
+    OutGeometry.CaseCode |= ((VoxelStateData[i11] & 0xFF) == FillType) << 3;
+
+    // Fill types with a distance layer place edge crossings and resolve
+    // saddles from corner distances, same as GetCellStateDistances() and
+    // the distance path of GetCellEdgeFeatures()
+
+    if (FillType < DistanceLayerCount)
+    {
+        const FIntPoint CornerOffsets[4] = {
+            FIntPoint(0, 0),
+            FIntPoint(1, 0),
+            FIntPoint(0, 1),
+            FIntPoint(1, 1)
+            };
+        float D[4];
+
+        for (int32 i=0; i<4; ++i)
+        {
+            const FIntPoint Corner(Cell + CornerOffsets[i]);
+            const float Distance = FMath::Max(FMath::Abs(GetVoxelDistanceUnlocked(Corner.X, Corner.Y, FillType)), 1e-3f);
+            D[i] = OutGeometry.IsCornerFilled(i) ? -Distance : Distance;
+        }
+
+        auto GetCrossingAlpha = [](float D0, float D1)
+        {
+            const float DD = D0 - D1;
+            return FMath::Clamp(D0 / ((FMath::Abs(DD) > 1e-6f) ? DD : 1e-6f), 0.f, 1.f);
+        };
+
+        OutGeometry.bFilledCenter = (D[0]+D[1]+D[2]+D[3]) * .25f <= 0.f;
+
+        OutGeometry.Crossings[0] = FVector2D(GetCrossingAlpha(D[0], D[1]), 0.f);
+        OutGeometry.Crossings[1] = FVector2D(GetCrossingAlpha(D[2], D[3]), 1.f);
+        OutGeometry.Crossings[2] = FVector2D(0.f, GetCrossingAlpha(D[0], D[2]));
+        OutGeometry.Crossings[3] = FVector2D(1.f, GetCrossingAlpha(D[1], D[3]));
+
+        return true;
+    }
+
+    OutGeometry.bFilledCenter = ((State >> 8) & 0xFF) == FillType;
+
+    // Edge crossing alphas, x-edge (low 16-bit) and y-edge (high 16-bit)
+    // of the owning voxel, same decoding as GetCellEdgeFeatures()
+
+    const float BottomAlpha = ( VoxelFeatureData[i00]        & 0xFF) / 255.f;
+    const float TopAlpha    = ( VoxelFeatureData[i01]        & 0xFF) / 255.f;
+    const float LeftAlpha   = ((VoxelFeatureData[i00] >> 16) & 0xFF) / 255.f;
+    const float RightAlpha  = ((VoxelFeatureData[i10] >> 16) & 0xFF) / 255.f;
+
+    OutGeometry.Crossings[0] = FVector2D(BottomAlpha, 0.f);
+    OutGeometry.Crossings[1] = FVector2D(TopAlpha, 1.f);
+    OutGeometry.Crossings[2] = FVector2D(0.f, LeftAlpha);
+    OutGeometry.Crossings[3] = FVector2D(1.f, RightAlpha);
+
+    return true;
+}
+
+bool FMarchingSquaresVoxelMirror::GetCellGeometry(const FIntPoint& Cell, uint8 FillType, FCellGeometry& OutGeometry) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+    return GetCellGeometryUnlocked(Cell, FillType, OutGeometry);
+}
+
+bool FMarchingSquaresVoxelMirror::IsPointFilled(const FVector2D& Point, uint8 FillType) const
+{
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    // Points on the map max bounds belong to the last cell
+
+    const FIntPoint Cell(
+        FMath::Min(FMath::FloorToInt(Point.X), Dimension.X-2),
+        FMath::Min(FMath::FloorToInt(Point.Y), Dimension.Y-2)
+        );
+
+    if (Point.X > (Dimension.X-1) || Point.Y > (Dimension.Y-1))
+    {
+        return false;
+    }
+
+    FCellGeometry Geometry;
+
+    if (! GetCellGeometryUnlocked(Cell, FillType, Geometry))
+    {
+        return false;
+    }
+
+    return IsCellPointFilled(Geometry, Point - FVector2D(Cell));
+}
+
+bool FMarchingSquaresVoxelMirror::Raycast(const FVector2D& Start, const FVector2D& End, uint8 FillType, FRaycastResult& OutResult) const
+{
+    using namespace MarchingSquaresVoxelMirrorCell;
+
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    if (Dimension.X < 2 || Dimension.Y < 2)
+    {
+        return false;
+    }
+
+    const FVector2D Dir(End - Start);
+    const FVector2D BoundsMax(Dimension.X-1, Dimension.Y-1);
+
+    // Clip ray segment to the map cell bounds
+
+    float TMin = 0.f;
+    float TMax = 1.f;
+
+    for (int32 Axis=0; Axis<2; ++Axis)
+    {
+        if (FMath::Abs(Dir[Axis]) < KINDA_SMALL_NUMBER)
+        {
+            if (Start[Axis] < 0.f || Start[Axis] > BoundsMax[Axis])
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float T0 = (0.f - Start[Axis]) / Dir[Axis];
+        float T1 = (BoundsMax[Axis] - Start[Axis]) / Dir[Axis];
+
+        if (T0 > T1)
+        {
+            Swap(T0, T1);
+        }
+
+        TMin = FMath::Max(TMin, T0);
+        TMax = FMath::Min(TMax, T1);
+    }
+
+    if (TMin > TMax)
+    {
+        return false;
+    }
+
+    // Traverse cells along the ray (Amanatides & Woo)
+
+    const FVector2D EntryPoint(Start + Dir * TMin);
+
+    FIntPoint Cell(
+        FMath::Clamp(FMath::FloorToInt(EntryPoint.X), 0, Dimension.X-2),
+        FMath::Clamp(FMath::FloorToInt(EntryPoint.Y), 0, Dimension.Y-2)
+        );
+
+    const FIntPoint Step(Dir.X >= 0.f ? 1 : -1, Dir.Y >= 0.f ? 1 : -1);
+
+    FVector2D TNext;
+    FVector2D TDelta;
+
+    for (int32 Axis=0; Axis<2; ++Axis)
+    {
+        if (FMath::Abs(Dir[Axis]) < KINDA_SMALL_NUMBER)
+        {
+            TNext[Axis] = BIG_NUMBER;
+            TDelta[Axis] = BIG_NUMBER;
+        }
+        else
+        {
+            const float Boundary = Cell[Axis] + (Step[Axis] > 0 ? 1 : 0);
+            TNext[Axis] = (Boundary - Start[Axis]) / Dir[Axis];
+            TDelta[Axis] = FMath::Abs(1.f / Dir[Axis]);
+        }
+    }
+
+    const int32 MaxStepCount = (Dimension.X + Dimension.Y) * 2;
+
+    for (int32 i=0; i<MaxStepCount; ++i)
+    {
+        FCellGeometry Geometry;
+
+        if (! GetCellGeometryUnlocked(Cell, FillType, Geometry))
+        {
+            break;
+        }
+
+        FCellSegment Segments[2];
+        const int32 SegmentCount = GetCellSegments(Geometry, Segments);
+        const FVector2D CellOrigin(Cell);
+
+        float HitTime = BIG_NUMBER;
+        FVector2D HitEdge;
+
+        for (int32 s=0; s<SegmentCount; ++s)
+        {
+            const FVector2D P0(CellOrigin + Segments[s].P0);
+            const FVector2D Edge(Segments[s].P1 - Segments[s].P0);
+            const float Denom = Cross(Dir, Edge);
+
+            if (FMath::Abs(Denom) < SMALL_NUMBER)
+            {
+                continue;
+            }
+
+            const FVector2D Offset(P0 - Start);
+            const float T = Cross(Offset, Edge) / Denom;
+            const float U = Cross(Offset, Dir) / Denom;
+
+            if (U >= 0.f && U <= 1.f && T >= TMin && T <= TMax && T < HitTime)
+            {
+                HitTime = T;
+                HitEdge = Edge;
+            }
+        }
+
+        if (HitTime <= TMax)
+        {
+            OutResult.Time = HitTime;
+            OutResult.Location = Start + Dir * HitTime;
+            OutResult.Normal = FVector2D(HitEdge.Y, -HitEdge.X).GetSafeNormal();
+            return true;
+        }
+
+        // Advance to the next cell
+
+        const int32 Axis = (TNext.X < TNext.Y) ? 0 : 1;
+
+        if (TNext[Axis] > TMax)
+        {
+            break;
+        }
+
+        Cell[Axis] += Step[Axis];
+        TNext[Axis] += TDelta[Axis];
+    }
+
+    return false;
+}
+
+float FMarchingSquaresVoxelMirror::GetCellCoverageUnlocked(const FIntPoint& Cell, uint8 FillType, const FBox2D& LocalRect) const
+{
+    using namespace MarchingSquaresVoxelMirrorCell;
+
+    FCellGeometry Geometry;
+
+    if (! GetCellGeometryUnlocked(Cell, FillType, Geometry))
+    {
+        return 0.f;
+    }
+
+    const bool bFullCell = LocalRect.Min.X <= 0.f && LocalRect.Min.Y <= 0.f
+                        && LocalRect.Max.X >= 1.f && LocalRect.Max.Y >= 1.f;
+
+    if (bFullCell)
+    {
+        return GetCellFilledArea(Geometry);
+    }
+
+    FCellPoly Polys[2];
+    const int32 PolyCount = BuildCellPolys(Geometry, Polys);
+
+    float Area = 0.f;
+
+    for (int32 i=0; i<PolyCount; ++i)
+    {
+        Area += GetClippedPolyArea(Polys[i], LocalRect);
+    }
+
+    return Area;
+}
+
+float FMarchingSquaresVoxelMirror::GetFillFraction(const FBox2D& Rect, uint8 FillType) const
+{
+    const FVector2D RectSize(Rect.Max - Rect.Min);
+    const float RectArea = RectSize.X * RectSize.Y;
+
+    if (RectArea <= 0.f)
+    {
+        return 0.f;
+    }
+
+    FRWScopeLock ScopeLock(DataLock, SLT_ReadOnly);
+
+    if (Dimension.X < 2 || Dimension.Y < 2)
+    {
+        return 0.f;
+    }
+
+    // Area outside the map is considered empty
+
+    const FVector2D ClipMin(FMath::Max(Rect.Min.X, 0.f), FMath::Max(Rect.Min.Y, 0.f));
+    const FVector2D ClipMax(FMath::Min(Rect.Max.X, Dimension.X-1.f), FMath::Min(Rect.Max.Y, Dimension.Y-1.f));
+
+    if (ClipMin.X >= ClipMax.X || ClipMin.Y >= ClipMax.Y)
+    {
+        return 0.f;
+    }
+
+    const FIntPoint CellMin(FMath::FloorToInt(ClipMin.X), FMath::FloorToInt(ClipMin.Y));
+    const FIntPoint CellMax(
+        FMath::Min(FMath::CeilToInt(ClipMax.X), Dimension.X-1),
+        FMath::Min(FMath::CeilToInt(ClipMax.Y), Dimension.Y-1)
+        );
+
+    float Area = 0.f;
+
+    for (int32 y=CellMin.Y; y<CellMax.Y; ++y)
+    for (int32 x=CellMin.X; x<CellMax.X; ++x)
+    {
+        const FVector2D CellOrigin(x, y);
+        const FBox2D LocalRect(ClipMin-CellOrigin, ClipMax-CellOrigin);
+        Area += GetCellCoverageUnlocked(FIntPoint(x, y), FillType, LocalRect);
+    }
+
+    return FMath::Clamp(Area / RectArea, 0.f, 1.f);
+}
+
+// CELL GEOMETRY UTILITY
+
+int32 FMarchingSquaresVoxelMirror::GetCellSegments(const FCellGeometry& Geometry, FCellSegment OutSegments[2])
+{
+    using namespace MarchingSquaresVoxelMirrorCell;
+
+    FCellPoly Polys[2];
+    const int32 PolyCount = BuildCellPolys(Geometry, Polys);
+
+    int32 SegmentCount = 0;
+
+    for (int32 p=0; p<PolyCount; ++p)
+    {
+        const FCellPoly& Poly(Polys[p]);
+
+        for (int32 i=0, j=Poly.Num-1; i<Poly.Num; j=i++)
+        {
+            if (Poly.IsCrossing(j) && Poly.IsCrossing(i) && SegmentCount < 2)
+            {
+                FCellSegment& Segment(OutSegments[SegmentCount++]);
+                Segment.P0 = Poly.Points[j];
+                Segment.P1 = Poly.Points[i];
+                Segment.Feature0 = Poly.Features[j];
+                Segment.Feature1 = Poly.Features[i];
+            }
+        }
+    }
+
+    return SegmentCount;
+}
+
+int32 FMarchingSquaresVoxelMirror::GetCellSideSegments(const FCellGeometry& Geometry, uint32 SideMask, FCellSegment OutSegments[4])
+{
+    using namespace MarchingSquaresVoxelMirrorCell;
+
+    // Sides of each cell feature, edge crossings then corners
+
+    static const uint32 FEATURE_SIDES[8] = {
+        CELL_SIDE_BOTTOM,
+        CELL_SIDE_TOP,
+        CELL_SIDE_LEFT,
+        CELL_SIDE_RIGHT,
+        CELL_SIDE_BOTTOM | CELL_SIDE_LEFT,
+        CELL_SIDE_BOTTOM | CELL_SIDE_RIGHT,
+        CELL_SIDE_TOP    | CELL_SIDE_LEFT,
+        CELL_SIDE_TOP    | CELL_SIDE_RIGHT
+        };
+
+    FCellPoly Polys[2];
+    const int32 PolyCount = BuildCellPolys(Geometry, Polys);
+
+    int32 SegmentCount = 0;
+
+    for (int32 p=0; p<PolyCount; ++p)
+    {
+        const FCellPoly& Poly(Polys[p]);
+
+        for (int32 i=0, j=Poly.Num-1; i<Poly.Num; j=i++)
+        {
+            // Polygon edge lies on a cell side if both end points share it
+
+            const uint32 EdgeSides = FEATURE_SIDES[Poly.Features[j]] & FEATURE_SIDES[Poly.Features[i]] & SideMask;
+
+            if (EdgeSides != 0 && Poly.Points[j] != Poly.Points[i] && SegmentCount < 4)
+            {
+                FCellSegment& Segment(OutSegments[SegmentCount++]);
+                Segment.P0 = Poly.Points[j];
+                Segment.P1 = Poly.Points[i];
+                Segment.Feature0 = Poly.Features[j];
+                Segment.Feature1 = Poly.Features[i];
+            }
+        }
+    }
+
+    return SegmentCount;
+}
+
+bool FMarchingSquaresVoxelMirror::IsCellPointFilled(const FCellGeometry& Geometry, const FVector2D& LocalPoint)
+{
+    using namespace MarchingSquaresVoxelMirrorCell;
+
+    FCellPoly Polys[2];
+    const int32 PolyCount = BuildCellPolys(Geometry, Polys);
+
+    for (int32 i=0; i<PolyCount; ++i)
+    {
+        if (IsPointInPoly(Polys[i], LocalPoint))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+float FMarchingSquaresVoxelMirror::GetCellFilledArea(const FCellGeometry& Geometry)
+{
+    using namespace MarchingSquaresVoxelMirrorCell;
+
+    FCellPoly Polys[2];
+    const int32 PolyCount = BuildCellPolys(Geometry, Polys);
+
+    float Area = 0.f;
+
+    for (int32 i=0; i<PolyCount; ++i)
+    {
+        Area += GetPolyArea(Polys[i].Points, Polys[i].Num);
+    }
+
+    return FMath::Min(Area, 1.f);
+}
@@ -0,0 +1,292 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "MarchingSquaresVoxelStats.h"
+
+#include "Async/ParallelFor.h"
+#include "MarchingSquaresVoxelMirror.h"
+
+const FMarchingSquaresVoxelStats::FFillTypeStats* FMarchingSquaresVoxelStats::FBlockStats::FindFillType(int32 FillType) const
+{
+    for (const FFillTypeStats& Stats : FillTypes)
+    {
+        if (Stats.FillType == FillType)
+        {
+            return &Stats;
+        }
+    }
+
+    return nullptr;
+}
+
+FMarchingSquaresVoxelStats::~FMarchingSquaresVoxelStats()
+{
+    // Wait for in-flight update, the task references this object
+
+    if (UpdateTask.IsValid() && ! UpdateTask->IsComplete())
+    {
+        FTaskGraphInterface::Get().WaitUntilTaskCompletes(UpdateTask);
+    }
+}
+
+void FMarchingSquaresVoxelStats::EvaluateBlock(const FMarchingSquaresVoxelMirror& Mirror, FBlockStats& Block)
+{
+    typedef FMarchingSquaresVoxelMirror::FCellGeometry FCellGeometry;
+    typedef FMarchingSquaresVoxelMirror::FCellSegment  FCellSegment;
+
+    double Areas[256] = { 0 };
+    double Perimeters[256] = { 0 };
+    bool   bPresent[256] = { false };
+
+    Mirror.VisitCellGeometry(
+        Block.CellRect,
+        [&](const FIntPoint& Cell, uint8 FillType, const FCellGeometry& Geometry)
+        {
+            FCellSegment Segments[2];
+            const int32 SegmentCount = FMarchingSquaresVoxelMirror::GetCellSegments(Geometry, Segments);
+
+            for (int32 i=0; i<SegmentCount; ++i)
+            {
+                Perimeters[FillType] += (Segments[i].P1 - Segments[i].P0).Size();
+            }
+
+            Areas[FillType] += FMarchingSquaresVoxelMirror::GetCellFilledArea(Geometry);
+            bPresent[FillType] = true;
+        } );
+
+    Block.FillTypes.Reset();
+
+    for (int32 i=0; i<256; ++i)
+    {
+        if (bPresent[i])
+        {
+            FFillTypeStats Stats;
+            Stats.FillType = i;
+            Stats.Area = static_cast<float>(Areas[i]);
+            Stats.Perimeter = static_cast<float>(Perimeters[i]);
+            Block.FillTypes.Emplace(Stats);
+        }
+    }
+}
+
+void FMarchingSquaresVoxelStats::Update(const FMarchingSquaresVoxelMirror& Mirror)
+{
+    enum { BLOCK_SIZE = FMarchingSquaresVoxelMirror::BLOCK_SIZE };
+
+    TArray<uint32> BlockRevisions;
+    FIntPoint MirrorBlockCount;
+
+    const uint32 Revision = Mirror.GetBlockRevisions(BlockRevisions, MirrorBlockCount);
+    const FIntPoint Dimension(Mirror.GetDimension());
+
+    bool bReset;
+    uint32 PrevRevision;
+
+    {
+        FRWScopeLock ScopeLock(StatsLock, SLT_ReadOnly);
+        bReset = (BlockCount != MirrorBlockCount) || (Blocks.Num() != BlockRevisions.Num());
+        PrevRevision = MirrorRevision;
+    }
+
+    // Collect blocks with cells affected by writes since the previous
+    // update. Cells of a block read voxels of the next block on each axis.
+
+    TArray<FBlockStats> DirtyBlocks;
+    TArray<int32> DirtyBlockIndices;
+
+    for (int32 by=0; by<MirrorBlockCount.Y; ++by)
+    for (int32 bx=0; bx<MirrorBlockCount.X; ++bx)
+    {
+        bool bDirty = bReset;
+
+        for (int32 y=by; ! bDirty && y<=FMath::Min(by+1, MirrorBlockCount.Y-1); ++y)
+        for (int32 x=bx; ! bDirty && x<=FMath::Min(bx+1, MirrorBlockCount.X-1); ++x)
+        {
+            bDirty = BlockRevisions[x + y*MirrorBlockCount.X] > PrevRevision;
+        }
+
+        if (bDirty)
+        {
+            const FIntPoint CellMin(bx*BLOCK_SIZE, by*BLOCK_SIZE);
+            const FIntPoint CellMax(
+                FMath::Min<int32>(CellMin.X+BLOCK_SIZE, Dimension.X-1),
+                FMath::Min<int32>(CellMin.Y+BLOCK_SIZE, Dimension.Y-1)
+                );
+
+            FBlockStats& Block(DirtyBlocks[DirtyBlocks.AddDefaulted()]);
+            Block.CellRect = FIntRect(CellMin, CellMin.ComponentMax(CellMax));
+            DirtyBlockIndices.Emplace(bx + by*MirrorBlockCount.X);
+        }
+    }
+
+    // Evaluate dirty blocks in parallel, each block reads the mirror under
+    // its own read lock to avoid stalling mirror writers
+
+    ParallelFor(DirtyBlocks.Num(), [&](int32 i)
+    {
+        EvaluateBlock(Mirror, DirtyBlocks[i]);
+    } );
+
+    FRWScopeLock ScopeLock(StatsLock, SLT_Write);
+
+    if (bReset)
+    {
+        Blocks.Reset();
+        Blocks.SetNum(BlockRevisions.Num());
+        BlockCount = MirrorBlockCount;
+    }
+
+    for (int32 i=0; i<DirtyBlocks.Num(); ++i)
+    {
+        Blocks[DirtyBlockIndices[i]] = MoveTemp(DirtyBlocks[i]);
+    }
+
+    MirrorRevision = Revision;
+    TotalCellArea = FMath::Max(0, Dimension.X-1) * FMath::Max(0, Dimension.Y-1);
+
+    // Accumulate map totals
+
+    double Areas[256] = { 0 };
+    double Perimeters[256] = { 0 };
+    bool   bPresent[256] = { false };
+
+    for (const FBlockStats& Block : Blocks)
+    {
+        for (const FFillTypeStats& Stats : Block.FillTypes)
+        {
+            Areas[Stats.FillType] += Stats.Area;
+            Perimeters[Stats.FillType] += Stats.Perimeter;
+            bPresent[Stats.FillType] = true;
+        }
+    }
+
+    Totals.Reset();
+
+    for (int32 i=0; i<256; ++i)
+    {
+        if (bPresent[i])
+        {
+            FFillTypeStats Stats;
+            Stats.FillType = i;
+            Stats.Area = static_cast<float>(Areas[i]);
+            Stats.Perimeter = static_cast<float>(Perimeters[i]);
+            Totals.Emplace(Stats);
+        }
+    }
+}
+
+bool FMarchingSquaresVoxelStats::UpdateAsync(const FMarchingSquaresVoxelMirror& Mirror, TFunction<void()> OnComplete)
+{
+    if (bUpdating.AtomicSet(true))
+    {
+        return false;
+    }
+
+    const FMarchingSquaresVoxelMirror* MirrorPtr(&Mirror);
+
+    UpdateTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this, MirrorPtr, OnComplete]()
+        {
+            Update(*MirrorPtr);
+            bUpdating = false;
+
+            if (OnComplete)
+            {
+                OnComplete();
+            }
+        },
+        TStatId(),
+        nullptr,
+        ENamedThreads::AnyBackgroundThreadNormalTask
+        );
+
+    return true;
+}
+
+void FMarchingSquaresVoxelStats::Reset()
+{
+    FRWScopeLock ScopeLock(StatsLock, SLT_Write);
+
+    BlockCount = FIntPoint::ZeroValue;
+    MirrorRevision = 0;
+    TotalCellArea = 0.f;
+
+    Blocks.Empty();
+    Totals.Empty();
+}
+
+// QUERY FUNCTIONS
+
+FMarchingSquaresVoxelStats::FFillTypeStats FMarchingSquaresVoxelStats::GetTotalStats(int32 FillType) const
+{
+    FRWScopeLock ScopeLock(StatsLock, SLT_ReadOnly);
+
+    for (const FFillTypeStats& Stats : Totals)
+    {
+        if (Stats.FillType == FillType)
+        {
+            return Stats;
+        }
+    }
+
+    FFillTypeStats EmptyStats;
+    EmptyStats.FillType = FillType;
+    return EmptyStats;
+}
+
+float FMarchingSquaresVoxelStats::GetCoverage(int32 FillType) const
+{
+    const FFillTypeStats Stats(GetTotalStats(FillType));
+
+    FRWScopeLock ScopeLock(StatsLock, SLT_ReadOnly);
+    return (TotalCellArea > 0.f) ? (Stats.Area / TotalCellArea) : 0.f;
+}
+
+TArray<FMarchingSquaresVoxelStats::FFillTypeStats> FMarchingSquaresVoxelStats::GetTotalStats() const
+{
+    FRWScopeLock ScopeLock(StatsLock, SLT_ReadOnly);
+    return Totals;
+}
+
+FIntPoint FMarchingSquaresVoxelStats::GetBlockCount() const
+{
+    FRWScopeLock ScopeLock(StatsLock, SLT_ReadOnly);
+    return BlockCount;
+}
+
+bool FMarchingSquaresVoxelStats::GetBlockStats(const FIntPoint& Block, FBlockStats& OutStats) const
+{
+    FRWScopeLock ScopeLock(StatsLock, SLT_ReadOnly);
+
+    if (Block.X < 0 || Block.Y < 0 || Block.X >= BlockCount.X || Block.Y >= BlockCount.Y)
+    {
+        return false;
+    }
+
+    OutStats = Blocks[Block.X + Block.Y*BlockCount.X];
+    return true;
+}